@@ -36,6 +36,10 @@ StreamSelector::StreamSelector(sfe::Movie& movie)
 
     m_streams[sfe::Video] = &movie.getStreams(sfe::Video);
     m_streams[sfe::Audio] = &movie.getStreams(sfe::Audio);
+    m_streams[sfe::Subtitle] = &movie.getStreams(sfe::Subtitle);
+    
+    // Subtitles are not displayed until asked
+    m_selectedStreamIndexes[sfe::Subtitle] = static_cast<int>(m_streams[sfe::Subtitle]->size());
 
     if (m_selectedStreamIndexes[sfe::Video] >= 0 &&
         m_selectedStreamIndexes[sfe::Video] < m_streams[sfe::Video]->size())
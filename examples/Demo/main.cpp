@@ -63,6 +63,7 @@ void displayShortcuts()
     << "\tI - Log media info and current state\n"
     << "\tAlt + V - Select next video stream\n"
     << "\tAlt + A - Select next audio stream\n"
+    << "\tAlt + S - Select next subtitle stream\n"
     << std::endl;
 }
 
@@ -141,6 +142,11 @@ int main(int argc, const char *argv[])
                             selector.selectNextStream(sfe::Audio);
                         break;
                         
+                    case sf::Keyboard::S:
+                        if (ev.key.alt)
+                            selector.selectNextStream(sfe::Subtitle);
+                        break;
+                        
                     case sf::Keyboard::F:
                         fullscreen = !fullscreen;
                         
@@ -0,0 +1,71 @@
+
+/*
+ *  AudioSettings.hpp
+ *  sfeMovie project
+ *
+ *  Copyright (C) 2010-2015 Lucas Soltic
+ *  lucas.soltic@orange.fr
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ *
+ */
+
+#ifndef SFEMOVIE_AUDIOSETTINGS_HPP
+#define SFEMOVIE_AUDIOSETTINGS_HPP
+
+#include <sfeMovie/Visibility.hpp>
+
+namespace sfe
+{
+    /** Algorithms that can be used to convert the audio sample rate
+     */
+    enum ResamplerEngine
+    {
+        DefaultResampler,   //!< FFmpeg's own resampler, always available
+        SoxResampler        //!< The SoX resampler, used if FFmpeg was built with libsoxr, otherwise the default one is used
+    };
+    
+    /** Trade-off between the sample rate conversion quality and its cost
+     */
+    enum ResamplerQuality
+    {
+        LowQuality,
+        MediumQuality,
+        HighQuality,
+        VeryHighQuality
+    };
+    
+    /** Formats of decoded audio samples
+     */
+    enum SampleFormat
+    {
+        Int16Samples,       //!< Interleaved signed 16 bits samples, the only format played by SFML
+        FloatSamples,       //!< Interleaved 32 bits float samples
+        PlanarFloatSamples  //!< 32 bits float samples, all the samples of a channel before the ones of the next channel
+    };
+    
+    /** Describes how the decoded audio is converted before being played
+     */
+    struct SFE_API AudioSettings
+    {
+        AudioSettings();
+        
+        unsigned int sampleRate;            //!< Output sample rate, or 0 to keep the media sample rate (default). Use the audio device sample rate so that OpenAL doesn't resample again
+        ResamplerEngine resamplerEngine;    //!< Resampling algorithm used when the sample rate is converted (default: DefaultResampler)
+        ResamplerQuality resamplerQuality;  //!< Quality of the sample rate conversion (default: MediumQuality)
+    };
+}
+
+#endif
@@ -0,0 +1,98 @@
+
+/*
+ *  Clock.hpp
+ *  sfeMovie project
+ *
+ *  Copyright (C) 2010-2015 Lucas Soltic
+ *  lucas.soltic@orange.fr
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ *
+ */
+
+#ifndef SFEMOVIE_CLOCK_HPP
+#define SFEMOVIE_CLOCK_HPP
+
+#include <SFML/System.hpp>
+#include <sfeMovie/Visibility.hpp>
+#include <atomic>
+
+namespace sfe
+{
+    /** Source of time used to measure the playing offset
+     *
+     * Implement this interface to control how fast the playback advances, for example to process
+     * a media faster than real time or to run it in lockstep with an external timeline
+     */
+    class SFE_API Clock
+    {
+    public:
+        /** Default destructor
+         */
+        virtual ~Clock();
+        
+        /** @return the time elapsed since the last call to restart() or since the clock creation
+         */
+        virtual sf::Time getElapsedTime() const = 0;
+        
+        /** Put the elapsed time back to zero
+         *
+         * @return the time elapsed before the restart
+         */
+        virtual sf::Time restart() = 0;
+    };
+    
+    /** Clock that follows the system time, this is the default clock
+     */
+    class SFE_API SystemClock : public Clock
+    {
+    public:
+        sf::Time getElapsedTime() const;
+        sf::Time restart();
+        
+    private:
+        sf::Clock m_clock;
+    };
+    
+    /** Clock that only advances when told to
+     *
+     * This makes playback deterministic: the playing offset only changes when advance() is called,
+     * no matter how long decoding takes. It can be used from several threads.
+     *
+     * @note Audio is still played by the audio device at its own pace, a manual clock is only
+     * meant for medias played without audio stream
+     */
+    class SFE_API ManualClock : public Clock
+    {
+    public:
+        /** Default constructor
+         */
+        ManualClock();
+        
+        /** Make the clock move forward
+         *
+         * @param duration how much time passes, must be positive
+         */
+        void advance(sf::Time duration);
+        
+        sf::Time getElapsedTime() const;
+        sf::Time restart();
+        
+    private:
+        std::atomic<sf::Int64> m_elapsedMicroseconds;
+    };
+}
+
+#endif
@@ -0,0 +1,192 @@
+
+/*
+ *  FrameReader.hpp
+ *  sfeMovie project
+ *
+ *  Copyright (C) 2010-2015 Lucas Soltic
+ *  lucas.soltic@orange.fr
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ *
+ */
+
+#ifndef SFEMOVIE_FRAMEREADER_HPP
+#define SFEMOVIE_FRAMEREADER_HPP
+
+#include <SFML/System.hpp>
+#include <sfeMovie/Visibility.hpp>
+#include <sfeMovie/StreamSelection.hpp>
+#include <sfeMovie/MediaFrame.hpp>
+#include <cstddef>
+#include <iterator>
+#include <memory>
+#include <string>
+
+namespace sfe
+{
+    class FrameReaderImpl;
+    /** Read the decoded frames of a media stream one after the other, as fast as they can be decoded
+     *
+     * Unlike Movie, a FrameReader doesn't play anything: there is no timer, no audio device and no texture.
+     * It is meant for batch processing, where each frame is pulled in a plain loop:
+     *
+     * @code
+     * sfe::FrameReader reader;
+     * if (reader.open("movie.ogv"))
+     * {
+     *     for (const sfe::MediaFrame& frame : reader)
+     *         process(frame);
+     * }
+     * @endcode
+     *
+     * Frames are given in the order the decoder outputs them, which is their presentation order.
+     */
+    class SFE_API FrameReader
+    {
+    public:
+        /** Input iterator over the frames that are left to read, meant for range-based for loops
+         *
+         * Incrementing the iterator reads the next frame from its FrameReader, so all the iterators
+         * of a FrameReader move together.
+         */
+        class SFE_API Iterator
+        {
+        public:
+            typedef std::input_iterator_tag iterator_category;
+            typedef MediaFrame value_type;
+            typedef std::ptrdiff_t difference_type;
+            typedef const MediaFrame* pointer;
+            typedef const MediaFrame& reference;
+            
+            /** @brief Create an iterator past the last frame
+             */
+            Iterator();
+            
+            const MediaFrame& operator*() const;
+            const MediaFrame* operator->() const;
+            Iterator& operator++();
+            bool operator==(const Iterator& other) const;
+            bool operator!=(const Iterator& other) const;
+            
+        private:
+            friend class FrameReader;
+            explicit Iterator(FrameReader& reader);
+            
+            FrameReader* m_reader;
+            MediaFrame m_frame;
+        };
+        
+        /** @brief Default constructor
+         */
+        FrameReader();
+        
+        /** @brief Default destructor
+         */
+        ~FrameReader();
+        
+        /** @brief Open the best stream of the given kind in a media file
+         *
+         * @param filename the path to the media file
+         * @param type the kind of frames to read, Video or Audio
+         * @return true on success, false if the media could not be opened or has no stream of this kind
+         */
+        bool open(const std::string& filename, MediaType type = Video);
+        
+        /** @brief Open the given stream of a media file
+         *
+         * @param filename the path to the media file
+         * @param stream the stream to read, as described by Movie::getStreams()
+         * @return true on success, false if the media or the stream could not be opened
+         */
+        bool open(const std::string& filename, const StreamDescriptor& stream);
+        
+        /** @brief Only return one frame out of @a stride
+         *
+         * Skipped frames are still decoded, as the following ones depend on them, but they are never
+         * given to the caller. The count restarts after each seek, so that the first frame after the
+         * seek position is always returned.
+         *
+         * @param stride 1 to read every frame (default), N to read every Nth frame
+         */
+        void setStride(unsigned int stride);
+        
+        /** @brief Returns the stride set with setStride()
+         *
+         * @return how many decoded frames make one returned frame
+         */
+        unsigned int getStride() const;
+        
+        /** @brief Only decode the key frames of a video stream
+         *
+         * The other frames are neither decoded nor returned, which makes reading much faster when only
+         * an overview of the video is needed. In this mode, seek() lands on the last key frame at or
+         * before the requested position.
+         *
+         * @param keyFramesOnly true to only read key frames, false to read all the frames (default)
+         */
+        void setKeyFramesOnly(bool keyFramesOnly);
+        
+        /** @brief Tell whether only key frames are read
+         *
+         * @return the value given to setKeyFramesOnly()
+         */
+        bool getKeyFramesOnly() const;
+        
+        /** @brief Move to the given position in the media
+         *
+         * The next frame read is the first one whose position is at or after @a position.
+         *
+         * @param position the position to read from, from the beginning of the media
+         * @return true on success, false if the media is not seekable or no media is open
+         */
+        bool seek(sf::Time position);
+        
+        /** @brief Decode and return the next frame
+         *
+         * @param frame [out] the next frame, left untouched when there is no more frame to read
+         * @return true if a frame was read, false at the end of the stream or if no media is open
+         */
+        bool readFrame(MediaFrame& frame);
+        
+        /** @brief Returns the duration of the media
+         *
+         * @return the media duration, or sf::Time::Zero if it is unknown or no media is open
+         */
+        sf::Time getDuration() const;
+        
+        /** @brief Returns the kind of frames read
+         *
+         * @return Video or Audio, Unknown if no media is open
+         */
+        MediaType getMediaType() const;
+        
+        /** @brief Read the next frame and return an iterator to it
+         *
+         * @return an iterator to the next frame, or end() if there is no more frame to read
+         */
+        Iterator begin();
+        
+        /** @brief Returns the iterator past the last frame
+         *
+         * @return the end iterator
+         */
+        Iterator end();
+        
+    private:
+        std::shared_ptr<FrameReaderImpl> m_impl;
+    };
+}
+
+#endif
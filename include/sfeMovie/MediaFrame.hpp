@@ -0,0 +1,147 @@
+
+/*
+ *  MediaFrame.hpp
+ *  sfeMovie project
+ *
+ *  Copyright (C) 2010-2015 Lucas Soltic
+ *  lucas.soltic@orange.fr
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ *
+ */
+
+#ifndef SFEMOVIE_MEDIAFRAME_HPP
+#define SFEMOVIE_MEDIAFRAME_HPP
+
+#include <SFML/System.hpp>
+#include <sfeMovie/Visibility.hpp>
+#include <sfeMovie/StreamSelection.hpp>
+#include <memory>
+
+struct AVFrame;
+
+namespace sfe
+{
+    /** Audio or video frame as output by the decoder, before any conversion
+     *
+     * The frame data is not copied: it is shared with the decoder output through FFmpeg reference counting.
+     * Copies of a MediaFrame share the same data, which stays valid as long as one of them exists, even
+     * once the movie has moved on to other frames. The data must not be modified.
+     */
+    class SFE_API MediaFrame
+    {
+    public:
+        /** @brief Create an empty frame, that holds no data until a frame is assigned to it
+         */
+        MediaFrame();
+        
+        /** @brief Tell whether this frame holds decoded data
+         *
+         * @return true if this frame was default constructed, false otherwise
+         */
+        bool isEmpty() const;
+        
+        /** @brief Returns the kind of stream the frame comes from
+         *
+         * @return Video or Audio, Unknown if the frame is empty
+         */
+        MediaType getMediaType() const;
+        
+        /** @brief Returns the position of the frame in the media
+         *
+         * @return the presentation time of the frame, from the beginning of the media
+         */
+        sf::Time getPosition() const;
+        
+        /** @brief Returns the format of the frame data
+         *
+         * @return an AVPixelFormat value for video frames, an AVSampleFormat value for audio frames, -1 if the frame is empty
+         */
+        int getFormat() const;
+        
+        /** @brief Returns the size of a video frame in pixels
+         *
+         * @return the frame size, or (0, 0) for audio frames
+         */
+        sf::Vector2i getSize() const;
+        
+        /** @brief Returns the count of samples per channel of an audio frame
+         *
+         * @return the count of samples, or 0 for video frames
+         */
+        unsigned int getSampleCount() const;
+        
+        /** @brief Returns the count of channels of an audio frame
+         *
+         * @return the count of channels, or 0 for video frames
+         */
+        unsigned int getChannelCount() const;
+        
+        /** @brief Returns the sample rate of an audio frame
+         *
+         * @return the sample rate in Hz, or 0 for video frames
+         */
+        unsigned int getSampleRate() const;
+        
+        /** @brief Returns the count of data planes
+         *
+         * Packed formats have a single plane. Planar video formats have one plane per component and
+         * planar audio formats have one plane per channel.
+         *
+         * @return the count of planes
+         */
+        unsigned int getPlaneCount() const;
+        
+        /** @brief Returns the data of the given plane
+         *
+         * @param plane the index of the plane, lower than getPlaneCount()
+         * @return the plane data, or nullptr if @a plane is out of range
+         */
+        const sf::Uint8* getData(unsigned int plane) const;
+        
+        /** @brief Returns the size in bytes of a line of the given plane
+         *
+         * For video frames, this may be larger than the width of the plane because of padding.
+         * For audio frames, only the line size of the first plane is meaningful.
+         *
+         * @param plane the index of the plane, lower than getPlaneCount()
+         * @return the line size, or 0 if @a plane is out of range
+         */
+        int getLineSize(unsigned int plane) const;
+        
+        /** @brief Returns the underlying FFmpeg frame
+         *
+         * This is meant for code that uses FFmpeg directly, the frame can be referenced
+         * with av_frame_ref() to outlive this MediaFrame.
+         *
+         * @return the decoded frame
+         */
+        const AVFrame* getAVFrame() const;
+        
+    private:
+        friend class Stream;
+        friend class FrameReaderImpl;
+        
+        /** Take ownership of @a frame, which is freed with av_frame_free() once no MediaFrame uses it anymore
+         */
+        MediaFrame(AVFrame* frame, MediaType type, sf::Time position);
+        
+        std::shared_ptr<const AVFrame> m_frame;
+        MediaType m_type;
+        sf::Time m_position;
+    };
+}
+
+#endif
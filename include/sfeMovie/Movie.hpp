@@ -30,9 +30,20 @@
 #include <SFML/System.hpp>
 #include <sfeMovie/Visibility.hpp>
 #include <sfeMovie/StreamSelection.hpp>
+#include <sfeMovie/PeakSummary.hpp>
+#include <sfeMovie/AudioSettings.hpp>
+#include <sfeMovie/Clock.hpp>
+#include <sfeMovie/MediaFrame.hpp>
+#include <sfeMovie/Thumbnail.hpp>
 #include <vector>
 #include <string>
 #include <memory>
+#include <functional>
+
+namespace sf
+{
+    class SoundBuffer;
+}
 
 namespace sfe
 {
@@ -66,6 +77,91 @@ namespace sfe
          */
         bool openFromFile(const std::string& filename);
         
+        /** @brief Called once an asynchronous opening is done, with true on success and false otherwise
+         */
+        typedef std::function<void(bool success)> OpenCallback;
+        
+        /** @brief Open a media file without blocking the calling thread
+         *
+         * Reading the media, probing its streams, loading the decoders and decoding the first video
+         * image are all done on a separate thread. Once done, the media replaces the current one
+         * during the next call to update(), which then calls @a callback. The first image is available
+         * right away from getCurrentImage() and draw(), so that it can be shown as a poster before
+         * playing.
+         *
+         * Until then the previous media, if any, stays usable. Calling openFromFile() or
+         * openFromFileAsync() again, or destroying the movie, cancels the opening in progress: its
+         * pending reads are aborted and its callback is never called.
+         *
+         * @param filename the path to the media file
+         * @param callback the function to call from update() once the opening is done, can be empty
+         * @param prepare true to also do the work of prepare() on the opening thread
+         */
+        void openFromFileAsync(const std::string& filename, OpenCallback callback, bool prepare = false);
+        
+        /** @brief Tell whether a media is being opened with openFromFileAsync()
+         *
+         * @return true until the callback of openFromFileAsync() has been called
+         */
+        bool isOpening() const;
+        
+        /** @brief Set how the decoded audio is converted before being played
+         *
+         * By default audio is played at the media sample rate, and OpenAL converts it to the audio
+         * device sample rate if they differ. Setting the device sample rate here makes the conversion
+         * happen only once, with the chosen resampling algorithm and quality.
+         *
+         * @note The settings apply to the medias opened afterwards with openFromFile()
+         *
+         * @param settings the audio output settings
+         */
+        void setAudioSettings(const AudioSettings& settings);
+        
+        /** @brief Returns the audio output settings
+         *
+         * @return the settings set with setAudioSettings()
+         */
+        const AudioSettings& getAudioSettings() const;
+        
+        /** @brief Set up to which size medias are read into memory at once
+         *
+         * Medias whose packets fit in this size are read entirely when opened. Playing, looping and seeking
+         * then never read the media file again, which is useful for short medias on slow or network storage.
+         *
+         * @note The limit applies to the medias opened afterwards with openFromFile()
+         *
+         * @param bytes the maximum size of the media packets, or 0 to always read the media while playing (default)
+         */
+        void setPacketCacheLimit(std::size_t bytes);
+        
+        /** @brief Returns the limit set with setPacketCacheLimit()
+         *
+         * @return the maximum size of the media packets read into memory, in bytes
+         */
+        std::size_t getPacketCacheLimit() const;
+        
+        /** @brief Set the clock that measures the playing offset
+         *
+         * By default the playback follows the system time. Giving a ManualClock instead lets the
+         * application decide when time passes: tests become deterministic, and a media can be
+         * processed as fast as it is decoded by advancing the clock between two calls to update().
+         *
+         * @note The clock applies to the medias opened afterwards with openFromFile()
+         * @note The clock is never restarted by the movie, so the same clock can be shared by several
+         * movies to play them on a common timeline
+         * @note Audio is always played at the audio device pace, use a custom clock only when no
+         * audio stream is selected
+         *
+         * @param clock the clock to use, or nullptr to follow the system time
+         */
+        void setClock(std::shared_ptr<Clock> clock);
+        
+        /** @brief Returns the clock set with setClock()
+         *
+         * @return the custom clock, or nullptr if the system time is used
+         */
+        std::shared_ptr<Clock> getClock() const;
+        
         /** @brief Return a description of all the streams of the given type contained in the opened media
          *
          * @param type the stream type (audio, video...) to return
@@ -78,15 +174,29 @@ namespace sfe
          * it is deactivated.
          *
          * @note When opening a new media file, the default behaviour is to automatically activate the first
-         * found audio and video streams
+         * found audio and video streams, subtitles are only displayed once a subtitle stream is activated
+         *
+         * Audio streams can also be changed while the movie is playing: the new stream takes over
+         * from the current one within about 100 ms, without interrupting the video
          *
-         * @warning This method can only be used when the movie is stopped
+         * @warning Except for audio streams while playing, this method can only be used when the movie is stopped
          *
          * @param streamDescriptor the descriptor of the stream to activate
          * @return true if the stream could be selected (ie. valid stream and movie is stopped)
          */
         bool selectStream(const StreamDescriptor& streamDescriptor);
         
+        /** @brief Get the media ready to start playing without delay
+         *
+         * Starting the playback normally involves reading the media, decoding the first video image and
+         * the first audio samples, and waiting for the audio device to start. This function decodes the
+         * first video image before returning, and starts decoding the audio in the background, so that a
+         * later play() only waits for the audio device to start, which takes less than a video frame.
+         *
+         * Streams must be selected before preparing. Seeking cancels the preparation.
+         */
+        void prepare();
+        
         /** @brief Start or resume playing the media playback
          *
          * This function starts the stream if it was stopped, resumes it if it was paused,
@@ -114,6 +224,17 @@ namespace sfe
          */
         void update();
         
+        /** @brief Returns how long the application can wait before update() has something to do
+         *
+         * This allows sleeping until the next video frame is due rather than calling update()
+         * continuously. When the media has no video, this is the time left until the end of the
+         * playback. When the movie is not playing, nothing will happen until it plays again and a
+         * very long time is returned.
+         *
+         * @return the time until the next call to update() is needed, zero if it's needed now
+         */
+        sf::Time getTimeUntilNextFrame() const;
+        
         /** @brief Sets the sound's volume (default is 100)
          *
          * @param volume the volume in range [0, 100]
@@ -195,6 +316,136 @@ namespace sfe
          */
         bool setPlayingOffset(const sf::Time& targetSeekTime);
         
+        /** @brief Choose whether the playback follows the audio device or the system clock
+         *
+         * By default the playing offset is measured with the system clock. Audio devices consume
+         * samples at a slightly different rate, which makes audio and video drift apart on long
+         * medias. When enabled, the audio actually being played becomes the reference: the playing
+         * offset, and thus the video, slowly adjusts to it.
+         *
+         * This has no effect if there is no selected audio stream.
+         *
+         * @param enabled true to synchronize the playback with the audio device
+         */
+        void setAudioMasterClock(bool enabled);
+        
+        /** @brief Tell whether the playback follows the audio device or the system clock
+         *
+         * @return true if the playback is synchronized with the audio device
+         */
+        bool getAudioMasterClock() const;
+        
+        /** @brief Choose whether the video is decoded on threads shared by all the movies
+         *
+         * By default video frames are decoded when calling update(). When shared decoding is
+         * enabled, frames are decoded ahead of time on a process-wide pool of threads that serves
+         * all the movies with shared decoding, and update() only displays the frame that is due.
+         * This keeps the rendering thread free when many movies are played at once.
+         *
+         * The shared threads read the video packets they need from the media, decode and convert
+         * them. Audio keeps its own decoding thread, which waits for the audio device.
+         *
+         * @note The setting applies to the medias opened afterwards with openFromFile()
+         *
+         * @param enabled true to decode on the shared threads
+         */
+        void setSharedDecoding(bool enabled);
+        
+        /** @brief Tell whether the video is decoded on threads shared by all the movies
+         *
+         * @return true if shared decoding is enabled
+         */
+        bool getSharedDecoding() const;
+        
+        /** @brief Set how urgent the decoding of this movie is compared to the other movies
+         *
+         * When the shared decoding threads are busy, the movies with the highest priority are
+         * decoded first. This has no effect when shared decoding is disabled.
+         *
+         * @param priority the decoding priority, 0 by default
+         */
+        void setDecodingPriority(int priority);
+        
+        /** @brief Returns the priority set with setDecodingPriority()
+         *
+         * @return the decoding priority of this movie
+         */
+        int getDecodingPriority() const;
+        
+        /** @brief Set how many threads are used for shared decoding
+         *
+         * @note This takes effect the next time the shared threads are started, that is when a
+         * movie with shared decoding is opened while no other one is
+         *
+         * @param threadCount the number of threads, or 0 to use one thread per core (default)
+         */
+        static void setSharedDecodingThreadCount(unsigned int threadCount);
+        
+        /** @brief Set how much memory can be used to keep the decoded frames of short videos
+         *
+         * When all the frames of a video stream fit in this budget, they are kept while the video is played
+         * for the first time. Looping and seeking in this video, or playing it again from another Movie,
+         * then displays the kept frames without decoding anything. They aren't used anymore once the size or
+         * the modification time of the media file changes. When the budget is exceeded, the frames
+         * of the least recently played videos are dropped first. The frame tap receives the kept frames in RGBA.
+         *
+         * @param bytes the memory budget shared by all movies, or 0 to keep no frame (default)
+         */
+        static void setFrameCacheBudget(std::size_t bytes);
+        
+        /** @brief Returns the budget set with setFrameCacheBudget()
+         *
+         * @return the memory budget in bytes
+         */
+        static std::size_t getFrameCacheBudget();
+        
+        /** @brief Transcode the video of a media file into a file that is much faster to decode
+         *
+         * The frames are stored as LZ4 compressed RGBA images in a file named after the media, with the
+         * ".sfefast" extension. When fast decode files are enabled, movies opening the media then display
+         * the frames from this file instead of decoding the video, which takes almost no CPU time at the cost
+         * of disk space. The file is ignored once the media is modified. This blocks until the whole video
+         * is transcoded.
+         *
+         * @param filename the path to the media file
+         * @return true on success, false otherwise
+         */
+        static bool createFastDecodeFile(const std::string& filename);
+        
+        /** @brief Enable or disable the use of the files made by createFastDecodeFile()
+         *
+         * When disabled, opening a media doesn't look for its fast decode file at all.
+         *
+         * @param enabled true to play the fast decode files of the opened media, false to always decode
+         * their video (default)
+         */
+        static void setFastDecodeFilesEnabled(bool enabled);
+        
+        /** @brief Returns whether fast decode files are used, see setFastDecodeFilesEnabled()
+         *
+         * @return true if the fast decode files are used
+         */
+        static bool areFastDecodeFilesEnabled();
+        
+        /** @brief Called with every frame decoded from the selected streams
+         */
+        typedef std::function<void(const MediaFrame& frame)> FrameTap;
+        
+        /** @brief Receive every frame decoded from the selected audio and video streams, without copy
+         *
+         * This is meant to analyze the frames while they are played. The tap is called from the thread that
+         * decodes the stream, which is the audio thread for audio frames and the thread calling update() or a
+         * shared decoding thread for video frames. It must return quickly as it delays the decoding, but it can
+         * keep the frame to process it later. Frames decoded while seeking to a new position are also given.
+         *
+         * Video frames played from the frame cache or from a fast decode file are not decoded again: they are
+         * given once shown, in the RGBA format they were stored in (AV_PIX_FMT_RGBA) rather than in the format
+         * of the decoder.
+         *
+         * @param tap the function to call for each decoded frame, or nullptr to stop receiving frames
+         */
+        void setFrameTap(FrameTap tap);
+        
         /** @brief Returns the latest movie image
          *
          * The returned image is a texture in VRAM.
@@ -206,6 +457,92 @@ namespace sfe
          * @return the current image of the movie for the activated video stream
          */
         const sf::Texture& getCurrentImage() const;
+        
+        /** @brief Decode the whole selected audio stream at once into a sound buffer
+         *
+         * This is meant for short sounds played many times, such as sound effects, that can then
+         * be played with sf::Sound without any decoding cost. Decoding is not paced by the playback
+         * and long streams are decoded on several threads. The movie playback is not affected
+         * and can be in any state.
+         *
+         * @warning This method blocks until the whole stream is decoded
+         *
+         * @param buffer the buffer that receives the decoded audio
+         * @return true on success, false if there is no selected audio stream or decoding failed
+         */
+        bool decodeAudio(sf::SoundBuffer& buffer) const;
+        
+        /** @brief Decode the whole selected audio stream at once into raw PCM samples
+         *
+         * The samples are interleaved signed 16 bits samples, with getChannelCount() channels
+         * at getSampleRate() samples per second.
+         *
+         * @see decodeAudio(sf::SoundBuffer&)
+         *
+         * @param samples the vector that receives the decoded samples
+         * @return true on success, false if there is no selected audio stream or decoding failed
+         */
+        bool decodeAudio(std::vector<sf::Int16>& samples) const;
+        
+        /** @brief Decode the whole selected audio stream at once into 32 bits float samples
+         *
+         * The samples are in [-1, 1], with getChannelCount() channels at getSampleRate() samples
+         * per second. Converting straight to float keeps the precision of float and 24 bits medias.
+         *
+         * @see decodeAudio(sf::SoundBuffer&)
+         *
+         * @param samples the vector that receives the decoded samples
+         * @param format FloatSamples for interleaved samples, or PlanarFloatSamples to get all the
+         * samples of the first channel, then all the ones of the second channel, and so on
+         * @return true on success, false if there is no selected audio stream, decoding failed
+         * or @a format is Int16Samples
+         */
+        bool decodeAudio(std::vector<float>& samples, SampleFormat format = FloatSamples) const;
+        
+        /** @brief Returns the waveform summary of the selected audio stream
+         *
+         * The summary is computed in the background from the first call on, and its peaks can be
+         * used while it is being computed. Later calls return the same summary as long as the
+         * selected audio stream doesn't change. The movie playback is not affected.
+         *
+         * With @a useDiskCache, the summary is loaded from or saved to a file next to the media,
+         * named after the media file with an additional ".sfepeaks" extension. This requires the
+         * directory of the media to be writable, and the saved summary is ignored once the media
+         * size or modification time changes.
+         *
+         * @param useDiskCache true to load and save the summary from the disk
+         * @return the waveform summary, or nullptr if there is no selected audio stream
+         */
+        std::shared_ptr<const PeakSummary> getPeakSummary(bool useDiskCache = false) const;
+        
+        /** @brief Extract thumbnails evenly spread over a video, typically for a scrub bar
+         *
+         * Only the key frame at or before each position is decoded, without going through the playback
+         * seeking, and the positions are processed in parallel on all the cores. The movie doesn't need
+         * to be opened.
+         *
+         * @warning This method blocks until all the thumbnails are extracted
+         *
+         * @param filename the path to the media file
+         * @param count how many thumbnails to extract, the i-th one being taken at i x duration / count
+         * @param size the size of the thumbnails, if its width or height is 0 it is computed from
+         * the other one to preserve the video aspect ratio
+         * @return the thumbnails ordered by requested position, empty if the media has no video stream.
+         * Positions whose key frame could not be decoded have no thumbnail
+         */
+        static Thumbnails extractThumbnails(const std::string& filename, unsigned int count, sf::Vector2u size);
+        
+        /** @brief Extract a thumbnail every @a interval of a video
+         *
+         * @see extractThumbnails(const std::string&, unsigned int, sf::Vector2u)
+         *
+         * @param filename the path to the media file
+         * @param interval the time between two thumbnails, the first one being taken at the beginning
+         * @param size the size of the thumbnails, if its width or height is 0 it is computed from
+         * the other one to preserve the video aspect ratio
+         * @return the thumbnails ordered by requested position, empty if the media has no video stream
+         */
+        static Thumbnails extractThumbnails(const std::string& filename, sf::Time interval, sf::Vector2u size);
     private:
         void draw(sf::RenderTarget& Target, sf::RenderStates states) const;
         std::shared_ptr<MovieImpl> m_impl;
@@ -0,0 +1,114 @@
+
+/*
+ *  PeakSummary.hpp
+ *  sfeMovie project
+ *
+ *  Copyright (C) 2010-2015 Lucas Soltic
+ *  lucas.soltic@orange.fr
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ *
+ */
+
+#ifndef SFEMOVIE_PEAKSUMMARY_HPP
+#define SFEMOVIE_PEAKSUMMARY_HPP
+
+#include <SFML/System.hpp>
+#include <sfeMovie/Visibility.hpp>
+#include <vector>
+#include <memory>
+
+namespace sfe
+{
+    /** Amplitude summary of a range of audio samples, values are normalized in range [-1, 1]
+     */
+    struct SFE_API Peak
+    {
+        float minimum;  //!< Lowest sample value of the range, all channels included
+        float maximum;  //!< Highest sample value of the range, all channels included
+        float rms;      //!< Root mean square of the samples of the range, all channels included
+    };
+    
+    class PeakSummaryImpl;
+    /** Multi-resolution waveform summary of an audio stream, meant to draw waveforms in timeline UIs
+     *
+     * The summary is organized in levels: at level 0 each peak covers getSamplesPerPeak(0) samples
+     * per channel, and each following level is 4 times coarser. The summary is computed in the
+     * background; peaks are available as soon as they are computed, from the beginning of the stream.
+     *
+     * All the methods can be called from any thread.
+     */
+    class SFE_API PeakSummary
+    {
+    public:
+        ~PeakSummary();
+        
+        /** @brief Returns the count of resolution levels
+         *
+         * @return the count of levels, level 0 being the finest one
+         */
+        unsigned int getLevelCount() const;
+        
+        /** @brief Returns the amount of audio samples per channel covered by each peak of the given level
+         *
+         * @param level the resolution level
+         * @return the amount of samples per channel summarized in one peak
+         */
+        unsigned int getSamplesPerPeak(unsigned int level) const;
+        
+        /** @brief Returns the duration covered by each peak of the given level
+         *
+         * @param level the resolution level
+         * @return the duration of one peak, or sf::Time::Zero if the audio stream is not open yet
+         */
+        sf::Time getPeakDuration(unsigned int level) const;
+        
+        /** @brief Returns the coarsest level whose peaks don't last longer than the given duration
+         *
+         * This is typically used with the duration of one pixel of the timeline.
+         *
+         * @param peakDuration the maximum duration of one peak
+         * @return the matching resolution level
+         */
+        unsigned int getLevelForDuration(sf::Time peakDuration) const;
+        
+        /** @brief Returns the peaks of the given level computed so far
+         *
+         * @param level the resolution level
+         * @return the peaks, from the beginning of the stream
+         */
+        std::vector<Peak> getPeaks(unsigned int level) const;
+        
+        /** @brief Returns the duration of audio summarized so far, from the beginning of the stream
+         *
+         * @return the summarized duration
+         */
+        sf::Time getSummarizedDuration() const;
+        
+        /** @brief Tell whether the whole audio stream has been summarized
+         *
+         * @return true if the summary is complete, false if it is still being computed or if it failed
+         */
+        bool isComplete() const;
+        
+    private:
+        friend class MovieImpl;
+        PeakSummary(std::shared_ptr<PeakSummaryImpl> impl);
+        
+        std::shared_ptr<PeakSummaryImpl> m_impl;
+    };
+}
+
+#endif
@@ -0,0 +1,180 @@
+
+/*
+ *  Playlist.hpp
+ *  sfeMovie project
+ *
+ *  Copyright (C) 2010-2015 Lucas Soltic
+ *  lucas.soltic@orange.fr
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ *
+ */
+
+#ifndef SFEMOVIE_PLAYLIST_HPP
+#define SFEMOVIE_PLAYLIST_HPP
+
+#include <SFML/Graphics.hpp>
+#include <sfeMovie/Visibility.hpp>
+#include <sfeMovie/Movie.hpp>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace sfe
+{
+    /** Plays a list of medias one after another without gap between them
+     *
+     * While an item plays, the next one is opened and prepared in the background, see
+     * Movie::openFromFileAsync() and Movie::prepare(). It is started the moment the current item
+     * ends, with its first image and audio already decoded, provided that update() is called once
+     * getTimeUntilNextFrame() elapsed.
+     *
+     * The playlist gives its own address to the asynchronous openings, so it can't be copied.
+     */
+    class SFE_API Playlist : public sf::Drawable, public sf::Transformable, public sf::NonCopyable
+    {
+    public:
+        Playlist();
+        ~Playlist();
+        
+        /** @brief Add a media at the end of the playlist
+         *
+         * @param filename the path to the media file
+         */
+        void add(const std::string& filename);
+        
+        /** @brief Stop the playback and remove all the medias
+         */
+        void clear();
+        
+        /** @brief Returns the count of medias in the playlist
+         *
+         * @return the count of medias added with add()
+         */
+        std::size_t getItemCount() const;
+        
+        /** @brief Returns the position in the playlist of the media being played
+         *
+         * @return the index of the current media, or getItemCount() if no media was started yet
+         */
+        std::size_t getCurrentItem() const;
+        
+        /** @brief Choose whether the playlist starts over once its last media ends
+         *
+         * @param loop true to play the medias again and again
+         */
+        void setLoop(bool loop);
+        
+        /** @brief Tell whether the playlist starts over once its last media ends
+         *
+         * @return true if the playlist loops
+         */
+        bool getLoop() const;
+        
+        /** @brief Start or resume playing the playlist
+         *
+         * If the first media is still being opened, playback starts as soon as it is ready
+         */
+        void play();
+        
+        /** @brief Pause the media being played
+         */
+        void pause();
+        
+        /** @brief Stop the playback and go back to the first media
+         */
+        void stop();
+        
+        /** @brief Returns the playlist status
+         *
+         * @return Playing until the last media ends, unless the playlist loops
+         */
+        Status getStatus() const;
+        
+        /** @brief Update the medias and switch to the next one when the current one ends
+         *
+         * This must be called regularly, like Movie::update()
+         */
+        void update();
+        
+        /** @brief Returns how long the application can wait before update() has something to do
+         *
+         * @see Movie::getTimeUntilNextFrame()
+         * @return the time until the next call to update() is needed, zero if it's needed now
+         */
+        sf::Time getTimeUntilNextFrame() const;
+        
+        /** @brief Scale the medias to fit the given frame
+         *
+         * @see Movie::fit()
+         */
+        void fit(sf::FloatRect frame, bool preserveRatio = true);
+        
+        /** @brief Set the sound volume of the medias
+         *
+         * @param volume the volume, from 0 (mute) to 100 (full volume)
+         */
+        void setVolume(float volume);
+        
+        /** @brief Returns the media being played
+         *
+         * @return the current media, which isn't opened until the first media is ready
+         */
+        const Movie& getCurrentMovie() const;
+        
+    private:
+        void draw(sf::RenderTarget& target, sf::RenderStates states) const;
+        
+        /** Open and prepare the media following the current one in the background
+         */
+        void openNextItem();
+        
+        /** Called once the media opened by openNextItem() is ready
+         */
+        void didOpenNextItem(bool success);
+        
+        /** Start playing the prepared next media and stop the current one
+         */
+        void switchToNextItem();
+        
+        /** @return true if the current media played until its end
+         */
+        bool currentItemEnded() const;
+        
+        /** @return the time left before the next media must be started for the current one to end without gap
+         */
+        sf::Time getTimeUntilSwitch() const;
+        
+        /** Apply the display settings to @a movie
+         */
+        void setupMovie(Movie& movie) const;
+        
+        std::vector<std::string> m_items;
+        std::shared_ptr<Movie> m_currentMovie;
+        std::shared_ptr<Movie> m_nextMovie;
+        std::size_t m_currentItem;
+        std::size_t m_nextItem;
+        bool m_hasCurrentMovie;
+        bool m_isOpeningNext;
+        bool m_isNextReady;
+        bool m_loop;
+        Status m_status;
+        sf::FloatRect m_frame;
+        bool m_preserveRatio;
+        float m_volume;
+    };
+}
+
+#endif
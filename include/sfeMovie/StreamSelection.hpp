@@ -35,7 +35,8 @@ namespace sfe
     {
         Audio,
         Video,
-        Unknown
+        Unknown,
+        Subtitle    //!< Added after Unknown so that the values of the former types don't change
     };
     
     /** Structure that allows both knowing metadata about each stream, and identifying streams
@@ -50,7 +51,7 @@ namespace sfe
          */
         static StreamDescriptor NoSelection(MediaType type);
         
-        MediaType type;            //!< Stream kind: video or audio
+        MediaType type;            //!< Stream kind: video, audio or subtitle
         int identifier;            //!< Internal stream identifier in the media, used for choosing which stream to enable
         std::string language;    //!< Language code defined by ISO 639-2, if set by the media
     };
@@ -0,0 +1,160 @@
+
+/*
+ *  TensorReader.hpp
+ *  sfeMovie project
+ *
+ *  Copyright (C) 2010-2015 Lucas Soltic
+ *  lucas.soltic@orange.fr
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ *
+ */
+
+#ifndef SFEMOVIE_TENSORREADER_HPP
+#define SFEMOVIE_TENSORREADER_HPP
+
+#include <SFML/System.hpp>
+#include <sfeMovie/Visibility.hpp>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace sfe
+{
+    /** Shape and normalization of the images written by TensorReader
+     */
+    struct SFE_API TensorFormat
+    {
+        enum Layout
+        {
+            NCHW,   //!< One plane per channel for each image: all the red values, then green, then blue
+            NHWC    //!< Interleaved channels for each image: red, green and blue values of each pixel in turn
+        };
+        
+        /** Default constructor, 224 x 224 NCHW images with values in range [0, 1]
+         */
+        TensorFormat();
+        
+        unsigned int width;     //!< Width of the images, frames are resized to it without preserving their ratio
+        unsigned int height;    //!< Height of the images, frames are resized to it without preserving their ratio
+        Layout layout;          //!< Order of the values in each image
+        float mean[3];          //!< Subtracted from the red, green and blue values once they are in range [0, 1]
+        float deviation[3];     //!< Then the red, green and blue values are divided by it
+    };
+    
+    class TensorReaderImpl;
+    /** Read the frames of a video stream as batches of float images, as expected by inference engines
+     *
+     * Each frame is resized, converted to RGB and normalized straight into the buffer given by the caller:
+     * a batch is made of getBatchSize() contiguous images of getImageElementCount() floats each.
+     * While the caller processes a batch, the frames of the next batch are decoded and resized
+     * on a background thread.
+     *
+     * @code
+     * sfe::TensorFormat format;
+     * format.mean[0] = 0.485f; format.mean[1] = 0.456f; format.mean[2] = 0.406f;
+     * format.deviation[0] = 0.229f; format.deviation[1] = 0.224f; format.deviation[2] = 0.225f;
+     *
+     * sfe::TensorReader reader;
+     * if (reader.open("movie.ogv", format, 32))
+     * {
+     *     std::vector<float> batch(reader.getBatchElementCount());
+     *     while (unsigned int count = reader.readBatch(batch.data()))
+     *         infer(batch.data(), count);
+     * }
+     * @endcode
+     */
+    class SFE_API TensorReader
+    {
+    public:
+        /** @brief Default constructor
+         */
+        TensorReader();
+        
+        /** @brief Default destructor
+         */
+        ~TensorReader();
+        
+        /** @brief Open the best video stream of a media file and start decoding its first batch
+         *
+         * @param filename the path to the media file
+         * @param format the size, layout and normalization of the output images
+         * @param batchSize the maximum amount of images per batch
+         * @return true on success, false if the media could not be opened, has no video stream
+         * or if @a format or @a batchSize is invalid
+         */
+        bool open(const std::string& filename, const TensorFormat& format, unsigned int batchSize);
+        
+        /** @brief Only read one frame out of @a stride
+         *
+         * As frames are decoded ahead, this takes effect from the next call to open() or seek().
+         *
+         * @see FrameReader::setStride()
+         *
+         * @param stride 1 to read every frame (default), N to read every Nth frame
+         */
+        void setStride(unsigned int stride);
+        
+        /** @brief Returns the stride set with setStride()
+         *
+         * @return how many decoded frames make one image
+         */
+        unsigned int getStride() const;
+        
+        /** @brief Move to the given position in the media
+         *
+         * The frames decoded ahead are discarded. The next image read is the first frame whose position is
+         * at or after @a position.
+         *
+         * @param position the position to read from, from the beginning of the media
+         * @return true on success, false if the media is not seekable or no media is open
+         */
+        bool seek(sf::Time position);
+        
+        /** @brief Write the next batch of images to @a batch
+         *
+         * This blocks until the frames of the batch are decoded, unless they already are.
+         *
+         * @param batch [out] the buffer to fill, it must be able to hold getBatchElementCount() floats
+         * @param positions [out] if not null, receives the position of each image of the batch
+         * @return the amount of images written, lower than the batch size once the end of the stream
+         * is reached, 0 when there is nothing left to read or no media is open
+         */
+        unsigned int readBatch(float* batch, std::vector<sf::Time>* positions = nullptr);
+        
+        /** @brief Returns the maximum amount of images per batch
+         *
+         * @return the batch size given to open(), 0 if no media is open
+         */
+        unsigned int getBatchSize() const;
+        
+        /** @brief Returns the amount of floats in one image
+         *
+         * @return 3 x width x height of the format given to open(), 0 if no media is open
+         */
+        std::size_t getImageElementCount() const;
+        
+        /** @brief Returns the amount of floats in a full batch
+         *
+         * @return getBatchSize() x getImageElementCount()
+         */
+        std::size_t getBatchElementCount() const;
+        
+    private:
+        std::shared_ptr<TensorReaderImpl> m_impl;
+    };
+}
+
+#endif
@@ -0,0 +1,45 @@
+
+/*
+ *  Thumbnail.hpp
+ *  sfeMovie project
+ *
+ *  Copyright (C) 2010-2015 Lucas Soltic
+ *  lucas.soltic@orange.fr
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ *
+ */
+
+#ifndef SFEMOVIE_THUMBNAIL_HPP
+#define SFEMOVIE_THUMBNAIL_HPP
+
+#include <SFML/Graphics.hpp>
+#include <sfeMovie/Visibility.hpp>
+#include <vector>
+
+namespace sfe
+{
+    /** Small image of a video at a given position, as extracted by Movie::extractThumbnails()
+     */
+    struct SFE_API Thumbnail
+    {
+        sf::Time position;  //!< Position of the key frame the thumbnail was made from
+        sf::Image image;    //!< The thumbnail pixels, in CPU memory so that it can be created from any thread
+    };
+    
+    typedef std::vector<Thumbnail> Thumbnails;
+}
+
+#endif
@@ -0,0 +1,112 @@
+
+/*
+ *  ThumbnailCache.hpp
+ *  sfeMovie project
+ *
+ *  Copyright (C) 2010-2015 Lucas Soltic
+ *  lucas.soltic@orange.fr
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ *
+ */
+
+#ifndef SFEMOVIE_THUMBNAILCACHE_HPP
+#define SFEMOVIE_THUMBNAILCACHE_HPP
+
+#include <SFML/Graphics.hpp>
+#include <sfeMovie/Visibility.hpp>
+#include <sfeMovie/Thumbnail.hpp>
+#include <memory>
+#include <string>
+
+namespace sfe
+{
+    class ThumbnailCacheImpl;
+    /** On-disk cache of posters and thumbnails, meant for media browsers that show many files at once
+     *
+     * Media files are identified by a fingerprint made of their size, modification time and a hash of their
+     * first and last blocks, so renaming a file keeps its cache entry and modifying it invalidates it.
+     * Copies usually get a new modification time, so they get their own entries.
+     * The cache index is memory mapped when the cache is opened: looking up cached thumbnails never
+     * opens the media nor a decoder.
+     *
+     * All the methods can be called from any thread.
+     */
+    class SFE_API ThumbnailCache
+    {
+    public:
+        /** @brief Default constructor
+         */
+        ThumbnailCache();
+        
+        /** @brief Default destructor
+         */
+        ~ThumbnailCache();
+        
+        /** @brief Use the given directory to store the cache
+         *
+         * The cache files are created in the directory if they don't exist yet. Once storing new thumbnails
+         * would make them larger than @a maxSize, the least recently stored thumbnails are removed from the files.
+         *
+         * @param directory an existing directory
+         * @param maxSize the size in bytes that the stored thumbnails can take on disk
+         * @return true on success, false if the cache files could not be created or read
+         */
+        bool open(const std::string& directory, sf::Uint64 maxSize = 256 * 1024 * 1024);
+        
+        /** @brief Returns the poster of a media, from the cache if possible
+         *
+         * The poster is the first key frame of the video. If it is not in the cache yet, it is extracted
+         * and stored in the cache, which blocks until its key frame is decoded.
+         *
+         * @param mediaFile the path to the media file
+         * @param size the size of the poster, if its width or height is 0 it is computed from the other
+         * one to preserve the video aspect ratio
+         * @param poster [out] the poster image
+         * @return true on success, false if the media has no video stream
+         */
+        bool getPoster(const std::string& mediaFile, sf::Vector2u size, sf::Image& poster);
+        
+        /** @brief Returns thumbnails evenly spread over a media, from the cache if possible
+         *
+         * Thumbnails that are not in the cache yet are extracted with Movie::extractThumbnails()
+         * and stored in the cache.
+         *
+         * @param mediaFile the path to the media file
+         * @param count how many thumbnails to extract
+         * @param size the size of the thumbnails, as for getPoster()
+         * @return the thumbnails, empty if the media has no video stream
+         */
+        Thumbnails getThumbnails(const std::string& mediaFile, unsigned int count, sf::Vector2u size);
+        
+        /** @brief Look up thumbnails in the cache only
+         *
+         * This never decodes anything, it is meant to show what is already known without delay.
+         *
+         * @param mediaFile the path to the media file
+         * @param count how many thumbnails were requested when they were cached, 1 for the poster
+         * @param size the size requested when they were cached
+         * @param thumbnails [out] the cached thumbnails, if found
+         * @return true if the thumbnails were in the cache, false otherwise
+         */
+        bool findThumbnails(const std::string& mediaFile, unsigned int count, sf::Vector2u size,
+                            Thumbnails& thumbnails) const;
+        
+    private:
+        std::shared_ptr<ThumbnailCacheImpl> m_impl;
+    };
+}
+
+#endif
@@ -0,0 +1,304 @@
+
+/*
+ *  AudioResampler.cpp
+ *  sfeMovie project
+ *
+ *  Copyright (C) 2010-2015 Lucas Soltic
+ *  lucas.soltic@orange.fr
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ *
+ */
+
+extern "C"
+{
+#include <libavutil/opt.h>
+#include <libavutil/channel_layout.h>
+#include <libswresample/swresample.h>
+}
+
+#include <cstring>
+#include "AudioResampler.hpp"
+#include "Macros.hpp"
+#include "Log.hpp"
+
+namespace sfe
+{
+    namespace
+    {
+        const int MaxPlaneCount = 64; // SWR_CH_MAX, the most channels libswresample handles
+        
+        uint64_t frameChannelLayout(const AVFrame* frame)
+        {
+            // Some media files don't define the channel layout, in this case take a default one
+            // according to the channels' count
+            if (frame->channel_layout != 0)
+                return frame->channel_layout;
+            
+            return av_get_default_channel_layout(frame->channels);
+        }
+    }
+    
+    uint64_t AudioResampler::playableChannelLayout(int channelCount)
+    {
+        // These are the channel counts for which SFML knows an OpenAL format
+        switch (channelCount)
+        {
+            case 1:     return AV_CH_LAYOUT_MONO;
+            case 2:     return AV_CH_LAYOUT_STEREO;
+            case 4:     return AV_CH_LAYOUT_QUAD;
+            case 6:     return AV_CH_LAYOUT_5POINT1_BACK;
+            case 7:     return AV_CH_LAYOUT_6POINT1;
+            case 8:     return AV_CH_LAYOUT_7POINT1;
+            default:    return AV_CH_LAYOUT_STEREO;
+        }
+    }
+    
+    AVSampleFormat AudioResampler::toAVSampleFormat(SampleFormat format)
+    {
+        switch (format)
+        {
+            case Int16Samples:          return AV_SAMPLE_FMT_S16;
+            case FloatSamples:          return AV_SAMPLE_FMT_FLT;
+            case PlanarFloatSamples:    return AV_SAMPLE_FMT_FLTP;
+            default:                    break;
+        }
+        
+        CHECK(false, "AudioResampler::toAVSampleFormat() - unhandled sample format " + s(format));
+        return AV_SAMPLE_FMT_NONE;
+    }
+    
+    bool AudioResampler::isEngineAvailable(ResamplerEngine engine)
+    {
+        if (engine == DefaultResampler)
+            return true;
+        
+        SwrContext* swrCtx = swr_alloc();
+        CHECK(swrCtx, "AudioResampler::isEngineAvailable() - out of memory");
+        
+        // Any conversion will do, only the engine initialization matters
+        av_opt_set_int        (swrCtx, "in_channel_layout",  AV_CH_LAYOUT_MONO,  0);
+        av_opt_set_int        (swrCtx, "in_sample_rate",     44100,              0);
+        av_opt_set_sample_fmt (swrCtx, "in_sample_fmt",      AV_SAMPLE_FMT_S16,  0);
+        av_opt_set_int        (swrCtx, "out_channel_layout", AV_CH_LAYOUT_MONO,  0);
+        av_opt_set_int        (swrCtx, "out_sample_rate",    48000,              0);
+        av_opt_set_sample_fmt (swrCtx, "out_sample_fmt",     AV_SAMPLE_FMT_S16,  0);
+        av_opt_set_int        (swrCtx, "resampler",          SWR_ENGINE_SOXR,    0);
+        
+        const bool available = swr_init(swrCtx) >= 0;
+        swr_free(&swrCtx);
+        return available;
+    }
+    
+    AudioResampler::AudioResampler(uint64_t outChannelLayout, SampleFormat outFormat, int outSampleRate,
+                                   ResamplerEngine engine, ResamplerQuality quality) :
+    m_outChannelLayout(outChannelLayout),
+    m_outChannelCount(av_get_channel_layout_nb_channels(outChannelLayout)),
+    m_outFormat(outFormat),
+    m_outAVFormat(toAVSampleFormat(outFormat)),
+    m_outSampleRate(outSampleRate),
+    m_engine(engine),
+    m_quality(quality),
+    m_swrCtx(nullptr)
+    {
+        CHECK(m_outChannelCount > 0, "AudioResampler::AudioResampler() - invalid output channel layout");
+        CHECK(m_outSampleRate > 0, "AudioResampler::AudioResampler() - invalid output sample rate");
+    }
+    
+    AudioResampler::~AudioResampler()
+    {
+        swr_free(&m_swrCtx);
+    }
+    
+    uint64_t AudioResampler::getChannelLayout() const
+    {
+        return m_outChannelLayout;
+    }
+    
+    int AudioResampler::getChannelCount() const
+    {
+        return m_outChannelCount;
+    }
+    
+    SampleFormat AudioResampler::getSampleFormat() const
+    {
+        return m_outFormat;
+    }
+    
+    int AudioResampler::getSampleRate() const
+    {
+        return m_outSampleRate;
+    }
+    
+    int AudioResampler::getBytesPerSample() const
+    {
+        return av_get_bytes_per_sample(m_outAVFormat);
+    }
+    
+    int AudioResampler::getOutputSampleCount(const AVFrame* frame) const
+    {
+        CHECK(frame, "AudioResampler::getOutputSampleCount() - invalid argument");
+        
+        return getOutputSampleCount(frame, frame->nb_samples);
+    }
+    
+    int AudioResampler::getOutputSampleCount(const AVFrame* frame, int count) const
+    {
+        CHECK(frame, "AudioResampler::getOutputSampleCount() - invalid argument");
+        
+        if (! m_swrCtx)
+        {
+            return static_cast<int>(av_rescale_rnd(count, m_outSampleRate,
+                                                   frame->sample_rate, AV_ROUND_UP));
+        }
+        
+        return static_cast<int>(av_rescale_rnd(swr_get_delay(m_swrCtx, frame->sample_rate) + count,
+                                               m_outSampleRate, frame->sample_rate, AV_ROUND_UP));
+    }
+    
+    int AudioResampler::convert(const AVFrame* frame, uint8_t* const* outPlanes, int outCapacity)
+    {
+        CHECK(frame, "AudioResampler::convert() - invalid argument");
+        
+        return convert(frame, 0, frame->nb_samples, outPlanes, outCapacity);
+    }
+    
+    int AudioResampler::convert(const AVFrame* frame, int offset, int count, uint8_t* const* outPlanes, int outCapacity)
+    {
+        CHECK(frame, "AudioResampler::convert() - invalid argument");
+        CHECK(outPlanes, "AudioResampler::convert() - invalid argument");
+        CHECK(offset >= 0 && count >= 0 && offset + count <= frame->nb_samples,
+              "AudioResampler::convert() - invalid sample range");
+        CHECK(getOutputSampleCount(frame, count) <= outCapacity, "AudioResampler::convert() - Going to overflow!!");
+        
+        const AVSampleFormat inFormat = static_cast<AVSampleFormat>(frame->format);
+        const int inPlaneCount = av_sample_fmt_is_planar(inFormat) ? frame->channels : 1;
+        const int inPlaneOffset = offset * av_get_bytes_per_sample(inFormat) * (inPlaneCount == 1 ? frame->channels : 1);
+        const uint8_t* inPlanes[MaxPlaneCount];
+        CHECK(inPlaneCount <= MaxPlaneCount, "AudioResampler::convert() - too many channels");
+        
+        for (int plane = 0; plane < inPlaneCount; plane++)
+            inPlanes[plane] = frame->extended_data[plane] + inPlaneOffset;
+        
+        if (canPassthrough(frame))
+        {
+            const int planeCount = av_sample_fmt_is_planar(m_outAVFormat) ? m_outChannelCount : 1;
+            const int planeSize = av_get_bytes_per_sample(m_outAVFormat) * count
+                                  * (planeCount == 1 ? m_outChannelCount : 1);
+            
+            for (int plane = 0; plane < planeCount; plane++)
+                std::memcpy(outPlanes[plane], inPlanes[plane], planeSize);
+            
+            return count;
+        }
+        
+        if (! m_swrCtx)
+            initSwr(frame);
+        
+        int err = swr_convert(m_swrCtx, const_cast<uint8_t**>(outPlanes), outCapacity, inPlanes, count);
+        CHECK(err >= 0, "AudioResampler::convert() - swr_convert() error");
+        
+        return err;
+    }
+    
+    int AudioResampler::getFlushSampleCount() const
+    {
+        if (! m_swrCtx)
+            return 0;
+        
+        return swr_get_out_samples(m_swrCtx, 0);
+    }
+    
+    int AudioResampler::flush(uint8_t* const* outPlanes, int outCapacity)
+    {
+        CHECK(outPlanes, "AudioResampler::flush() - invalid argument");
+        
+        if (! m_swrCtx)
+            return 0;
+        
+        int err = swr_convert(m_swrCtx, const_cast<uint8_t**>(outPlanes), outCapacity, nullptr, 0);
+        CHECK(err >= 0, "AudioResampler::flush() - swr_convert() error");
+        
+        return err;
+    }
+    
+    bool AudioResampler::canPassthrough(const AVFrame* frame) const
+    {
+        // Once samples went through the resampler, keep using it so that no buffered sample gets lost
+        return (m_swrCtx == nullptr &&
+                frame->format == m_outAVFormat &&
+                frame->sample_rate == m_outSampleRate &&
+                frameChannelLayout(frame) == m_outChannelLayout);
+    }
+    
+    void AudioResampler::initSwr(const AVFrame* frame)
+    {
+        CHECK0(m_swrCtx, "AudioResampler::initSwr() - resampler already initialized");
+        int err = 0;
+        
+        /* create resampler context */
+        m_swrCtx = swr_alloc();
+        CHECK(m_swrCtx, "AudioResampler::initSwr() - out of memory");
+        
+        /* set options */
+        av_opt_set_int        (m_swrCtx, "in_channel_layout",  frameChannelLayout(frame),                       0);
+        av_opt_set_int        (m_swrCtx, "in_sample_rate",     frame->sample_rate,                              0);
+        av_opt_set_sample_fmt (m_swrCtx, "in_sample_fmt",      static_cast<AVSampleFormat>(frame->format),      0);
+        av_opt_set_int        (m_swrCtx, "out_channel_layout", m_outChannelLayout,                              0);
+        av_opt_set_int        (m_swrCtx, "out_sample_rate",    m_outSampleRate,                                 0);
+        av_opt_set_sample_fmt (m_swrCtx, "out_sample_fmt",     m_outAVFormat,                                   0);
+        
+        setResamplingOptions(m_engine);
+        
+        /* initialize the resampling context */
+        err = swr_init(m_swrCtx);
+        
+        // libswresample can be built without soxr support
+        if (err < 0 && m_engine == SoxResampler)
+        {
+            sfeLogWarning("SoX resampler not available, falling back to the default resampler");
+            setResamplingOptions(DefaultResampler);
+            err = swr_init(m_swrCtx);
+        }
+        
+        CHECK(err >= 0, "AudioResampler::initSwr() - resampling context initialization error");
+        
+        sfeLogDebug("Audio resampler initialized from " + s(av_get_sample_fmt_name(static_cast<AVSampleFormat>(frame->format)))
+                    + " " + s(frame->sample_rate) + "Hz to " + s(av_get_sample_fmt_name(m_outAVFormat))
+                    + " " + s(m_outSampleRate) + "Hz");
+    }
+    
+    void AudioResampler::setResamplingOptions(ResamplerEngine engine)
+    {
+        if (engine == SoxResampler)
+        {
+            // Bits of precision: 20 is soxr's default, 28 its high quality and 33 its very high quality
+            static const int Precisions[] = { 16, 20, 28, 33 };
+            
+            av_opt_set_int(m_swrCtx, "resampler", SWR_ENGINE_SOXR,       0);
+            av_opt_set_int(m_swrCtx, "precision", Precisions[m_quality], 0);
+        }
+        else
+        {
+            // Medium quality matches libswresample's defaults
+            static const int FilterSizes[] = { 8, 32, 64, 128 };
+            static const int PhaseShifts[] = { 6, 10, 12, 14 };
+            
+            av_opt_set_int(m_swrCtx, "resampler",   SWR_ENGINE_SWR,          0);
+            av_opt_set_int(m_swrCtx, "filter_size", FilterSizes[m_quality],  0);
+            av_opt_set_int(m_swrCtx, "phase_shift", PhaseShifts[m_quality],  0);
+        }
+    }
+}
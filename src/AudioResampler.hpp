@@ -0,0 +1,175 @@
+
+/*
+ *  AudioResampler.hpp
+ *  sfeMovie project
+ *
+ *  Copyright (C) 2010-2015 Lucas Soltic
+ *  lucas.soltic@orange.fr
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ *
+ */
+
+#ifndef SFEMOVIE_AUDIORESAMPLER_HPP
+#define SFEMOVIE_AUDIORESAMPLER_HPP
+
+#include <sfeMovie/AudioSettings.hpp>
+#include <stdint.h>
+
+extern "C"
+{
+#include <libavcodec/avcodec.h>
+#include <libavutil/samplefmt.h>
+}
+
+namespace sfe
+{
+    /** Convert decoded audio frames to a given channel layout, sample format and sample rate
+     *
+     * When the decoded frames already match the requested output, no conversion is done and
+     * samples are copied as is
+     */
+    class AudioResampler
+    {
+    public:
+        /** Return the channel layout that matches the given channel count, if it can be played
+         * by the SFML audio backend
+         *
+         * Channels are ordered the way OpenAL expects them. If the channel count has no
+         * playable equivalent, the stereo layout is returned so that the source gets downmixed
+         *
+         * @param channelCount the channel count of the source
+         * @return the channel layout to use for playback
+         */
+        static uint64_t playableChannelLayout(int channelCount);
+        
+        /** @return the FFmpeg sample format that matches the given sample format
+         */
+        static AVSampleFormat toAVSampleFormat(SampleFormat format);
+        
+        /** Tell whether the given resampling algorithm can be used with this FFmpeg build
+         *
+         * @param engine the algorithm to check
+         * @return true if the algorithm is available, false if the default one would be used instead
+         */
+        static bool isEngineAvailable(ResamplerEngine engine);
+        
+        /** Create a resampler that outputs the given format
+         *
+         * The input format is taken from the frames given to convert()
+         *
+         * @param outChannelLayout the expected output channel layout
+         * @param outFormat the expected output sample format
+         * @param outSampleRate the expected output sample rate
+         * @param engine the algorithm used if the sample rate needs to be converted
+         * @param quality the quality of the sample rate conversion
+         */
+        AudioResampler(uint64_t outChannelLayout, SampleFormat outFormat, int outSampleRate,
+                       ResamplerEngine engine = DefaultResampler, ResamplerQuality quality = MediumQuality);
+        
+        /** Default destructor
+         */
+        ~AudioResampler();
+        
+        /** @return the output channel layout
+         */
+        uint64_t getChannelLayout() const;
+        
+        /** @return the output channel count
+         */
+        int getChannelCount() const;
+        
+        /** @return the output sample format
+         */
+        SampleFormat getSampleFormat() const;
+        
+        /** @return the output sample rate
+         */
+        int getSampleRate() const;
+        
+        /** @return the size in bytes of one output sample for one channel
+         */
+        int getBytesPerSample() const;
+        
+        /** @return the maximum amount of samples per channel that converting the given frame can output
+         */
+        int getOutputSampleCount(const AVFrame* frame) const;
+        
+        /** @return the maximum amount of samples per channel that converting @a count samples per channel
+         * of the given frame can output
+         */
+        int getOutputSampleCount(const AVFrame* frame, int count) const;
+        
+        /** Convert @a frame and write the result to @a outPlanes
+         *
+         * For interleaved formats only @a outPlanes[0] is used, for planar formats one plane
+         * per output channel is expected
+         *
+         * @param frame the decoded audio samples to convert
+         * @param outPlanes where the converted samples are written
+         * @param outCapacity the count of samples per channel that can be written to each plane
+         * @return the count of samples per channel written to @a outPlanes
+         */
+        int convert(const AVFrame* frame, uint8_t* const* outPlanes, int outCapacity);
+        
+        /** Convert @a count samples per channel of @a frame, from sample @a offset on
+         *
+         * This allows converting a long frame in several parts
+         *
+         * @see convert(const AVFrame*, uint8_t* const*, int)
+         */
+        int convert(const AVFrame* frame, int offset, int count, uint8_t* const* outPlanes, int outCapacity);
+        
+        /** @return the maximum amount of samples per channel that flush() can output
+         */
+        int getFlushSampleCount() const;
+        
+        /** Write the samples still buffered by the sample rate conversion to @a outPlanes
+         *
+         * This is to be called once the last frame of the stream has been converted
+         *
+         * @param outPlanes where the converted samples are written
+         * @param outCapacity the count of samples per channel that can be written to each plane
+         * @return the count of samples per channel written to @a outPlanes
+         */
+        int flush(uint8_t* const* outPlanes, int outCapacity);
+        
+    private:
+        /** @return true if @a frame can be copied as is to the output
+         */
+        bool canPassthrough(const AVFrame* frame) const;
+        
+        /** Create the libswresample context, this is only done once a frame needs conversion
+         */
+        void initSwr(const AVFrame* frame);
+        
+        /** Set the libswresample options matching the requested engine and quality
+         *
+         * @param engine the algorithm to use
+         */
+        void setResamplingOptions(ResamplerEngine engine);
+        
+        uint64_t m_outChannelLayout;
+        int m_outChannelCount;
+        SampleFormat m_outFormat;
+        AVSampleFormat m_outAVFormat;
+        int m_outSampleRate;
+        ResamplerEngine m_engine;
+        ResamplerQuality m_quality;
+        struct SwrContext* m_swrCtx;
+    };
+}
+
+#endif
@@ -27,13 +27,12 @@ extern "C"
 #include <libavformat/avformat.h>
 #include <libavcodec/avcodec.h>
 #include <libavutil/samplefmt.h>
-#include <libavutil/opt.h>
-#include <libavutil/channel_layout.h>
-#include <libswresample/swresample.h>
 }
 
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
 #include <cstring>
-#include <iostream>
 #include "AudioStream.hpp"
 #include "Log.hpp"
 #include <sfeMovie/Movie.hpp>
@@ -42,77 +41,89 @@ namespace sfe
 {
     namespace
     {
-        void waitForStatusUpdate(const sf::SoundStream& stream, sf::SoundStream::Status expectedStatus)
+        const int BytesPerSample = sizeof(sf::Int16); // Signed 16 bits audio sample
+        
+        const sf::Time RingBufferDuration = sf::seconds(2);     // Amount of audio decoded ahead of playback
+        const sf::Time MaxFrameDuration = sf::milliseconds(500); // Longest decoded frame the ring can take at once
+        const sf::Time ChunkDuration = sf::milliseconds(100);   // Audio given to SFML per onGetData() call
+        const sf::Time UnderrunDuration = sf::milliseconds(20); // Silence played when the decoder is late
+        const int DeviceBufferCount = 3;                         // Chunks queued by SFML before playing
+        
+        int outputSampleRate(const AVStream* stream, const AudioSettings& settings)
         {
-            // Wait for status to update
-            sf::Clock timeout;
-            while (stream.getStatus() != expectedStatus && timeout.getElapsedTime() < sf::seconds(5))
-                sf::sleep(sf::microseconds(10));
-            CHECK(timeout.getElapsedTime() < sf::seconds(5), "Audio did not reach state " + s(expectedStatus) + " within 5 seconds");
+            return settings.sampleRate > 0 ? settings.sampleRate : stream->codecpar->sample_rate;
         }
-        
-        const int BytesPerSample = sizeof(sf::Int16); // Signed 16 bits audio sample
     }
 
     AudioStream::AudioStream(AVFormatContext*& formatCtx, AVStream*& stream, DataSource& dataSource,
-                             std::shared_ptr<Timer> timer) :
+                             std::shared_ptr<Timer> timer, const AudioSettings& settings) :
     Stream(formatCtx, stream, dataSource, timer),
     
     // Public properties
     m_sampleRatePerChannel(0),
     
     // Private data
-    m_samplesBuffer(nullptr),
     m_audioFrame(nullptr),
     
     // Resampling
-    m_swrCtx(nullptr),
-    m_dstNbSamples(0),
-    m_maxDstNbSamples(0),
-    m_dstNbChannels(0),
-    m_dstLinesize(0),
-    m_dstData(nullptr)
+    m_resampler(AudioResampler::playableChannelLayout(stream->codecpar->channels), Int16Samples,
+                outputSampleRate(stream, settings), settings.resamplerEngine, settings.resamplerQuality),
+    
+    // Decoding thread
+    m_ringBuffer(static_cast<std::size_t>(m_resampler.getChannelCount() * m_resampler.getSampleRate()
+                                          * RingBufferDuration.asSeconds()),
+                 static_cast<std::size_t>(m_resampler.getChannelCount() * m_resampler.getSampleRate()
+                                          * MaxFrameDuration.asSeconds())),
+    m_pendingReadCount(0),
+    m_silence(),
+    m_decodingThread(),
+    m_decodingRequested(false),
+    m_decodingFinished(false),
+    m_decodingMutex(),
+    m_decodingCondition(),
+    
+    // Starting
+    m_startToken(0),
+    m_startPending(false),
+    m_startSilence(sf::Time::Zero),
+    m_prepared(false),
+    m_warmUpPosition(sf::Time::Zero),
+    
+    // Playback position
+    m_playbackStartPosition(sf::Time::Zero),
+    m_handedOutSamples(0),
+    m_prunedSilence(0),
+    m_silenceRuns(),
+    m_firstSilenceRun(0),
+    m_silenceRunCount(0),
+    m_playbackPositionMutex()
     {
         m_audioFrame = av_frame_alloc();
         CHECK(m_audioFrame, "AudioStream::AudioStream() - out of memory");
         
-        // Get some audio informations
-        m_sampleRatePerChannel = m_stream->codecpar->sample_rate;
+        // Get some audio informations, the sample rate is the one of the resampled audio
+        m_sampleRatePerChannel = m_resampler.getSampleRate();
         
-        // Alloc a two seconds buffer
-        m_samplesBuffer = (sf::Int16*)av_malloc(sizeof(sf::Int16) * av_get_channel_layout_nb_channels(AV_CH_LAYOUT_STEREO)
-                                                * m_sampleRatePerChannel * 2); // * 2 is for 2 seconds
-        CHECK(m_samplesBuffer, "AudioStream::AudioStream() - out of memory");
+        // Silence given to SFML when the decoding thread can't keep up
+        m_silence.resize(timeToSamples(UnderrunDuration), 0);
         
         // Initialize the sf::SoundStream
-        // Whatever the channel count is, it'll we resampled to stereo
-        sf::SoundStream::initialize(av_get_channel_layout_nb_channels(AV_CH_LAYOUT_STEREO), m_sampleRatePerChannel);
-        
-        // Initialize resampler to be able to give signed 16 bits samples to SFML
-        initResampler();
+        // The source channel layout is kept if SFML can play it, otherwise it'll be downmixed to stereo
+        sf::SoundStream::initialize(m_resampler.getChannelCount(), m_sampleRatePerChannel);
     }
     
     /** Default destructor
      */
     AudioStream::~AudioStream()
     {
+        // Both the SFML thread and the decoding thread use our data, they must be done first
+        sf::SoundStream::stop();
+        stopDecoding();
+        
         if (m_audioFrame)
         {
             av_frame_free(&m_audioFrame);
         }
-        
-        if (m_samplesBuffer)
-        {
-            av_free(m_samplesBuffer);
-        }
-        
-        if (m_dstData)
-        {
-            av_freep(&m_dstData[0]);
-        }
-        av_freep(&m_dstData);
-        
-        swr_free(&m_swrCtx);
     }
     
     void AudioStream::flushBuffers()
@@ -124,6 +135,13 @@ namespace sfe
         if (sfStatus != sf::SoundStream::Stopped)
             sf::SoundStream::stop();
         
+        // Flush the samples decoded ahead of playback
+        m_prepared = false;
+        stopDecoding();
+        m_ringBuffer.clear();
+        m_pendingReadCount = 0;
+        m_decodingFinished = false;
+        
         m_extraAudioTime = sf::Time::Zero;
         Stream::flushBuffers();
     }
@@ -135,6 +153,13 @@ namespace sfe
     
     void AudioStream::update()
     {
+        // SFML may not report the sound as playing until its thread actually started it
+        if (m_startPending)
+        {
+            setStatus(sfe::Playing);
+            return;
+        }
+        
         sf::SoundStream::Status sfStatus = sf::SoundStream::getStatus();
         
         switch (sfStatus)
@@ -210,7 +235,7 @@ namespace sfe
             }
             else
             {
-                av_packet_unref(packet);
+                recyclePacket(packet);
             }
         }
         while (currentPosition + pktDuration <= targetPosition);
@@ -220,77 +245,181 @@ namespace sfe
     
     bool AudioStream::onGetData(sf::SoundStream::Chunk& data)
     {
-        AVPacket* packet = nullptr;
-        data.samples = m_samplesBuffer;
+        // This is called from the SFML audio thread: it must never wait for demuxing or decoding
+        
+        // SFML copied the previously given samples to its own buffers, their storage can be reused
+        if (m_pendingReadCount > 0)
+        {
+            m_ringBuffer.commitRead(m_pendingReadCount);
+            m_pendingReadCount = 0;
+            m_decodingCondition.notify_one();
+        }
         
-        const int stereoChannelCount = av_get_channel_layout_nb_channels(AV_CH_LAYOUT_STEREO);
+        // Read the state before the ring, so that samples stored right before the end are not missed
+        const bool decodingFinished = m_decodingFinished;
+        const sf::Int16* samples = nullptr;
+        std::size_t samplesCount = m_ringBuffer.peekRead(samples, timeToSamples(ChunkDuration));
         
-        while (data.sampleCount < stereoChannelCount * m_sampleRatePerChannel &&
-               (nullptr != (packet = popEncodedData())))
+        if (samplesCount > 0)
         {
-            bool needsMoreDecoding = false;
-            bool gotFrame = false;
+            data.samples = samples;
+            data.sampleCount = samplesCount;
+            m_pendingReadCount = samplesCount;
+            trackHandedOutSamples(samplesCount, false);
             
-            do
+            // The first real samples are going to be played once the silence queued so far is over
+            if (m_startPending)
             {
-                needsMoreDecoding = decodePacket(packet, m_audioFrame, gotFrame);
-                
-                if (gotFrame)
-                {
-                    uint8_t* samplesBuffer = nullptr;
-                    int samplesCount = 0;
-                    
-                    resampleFrame(m_audioFrame, samplesBuffer, samplesCount);
-                    CHECK(samplesBuffer, "AudioStream::onGetData() - resampleFrame() error");
-                    CHECK(samplesCount > 0, "AudioStream::onGetData() - resampleFrame() error");
-                    CHECK(samplesToTime(data.sampleCount + samplesCount) < sf::seconds(2),
-                          "AudioStream::onGetData() - Going to overflow!!");
-                    
-                    if (m_extraAudioTime > sf::Time::Zero)
-                    {
-                        int samplesToDiscard = timeToSamples(m_extraAudioTime);
-                        if (samplesToDiscard > samplesCount)
-                        {
-                            samplesToDiscard = samplesCount;
-                            sfeLogDebug("Cannot discard all the extra audio samples in one time");
-                        }
-                        
-                        if (samplesToDiscard < stereoChannelCount && samplesCount > 0)
-                        {
-                            sfeLogDebug("Extra audio time is too small to discard audio samples: "
-                                        + s(m_extraAudioTime.asMicroseconds()) + "us");
-                            m_extraAudioTime = sf::Time::Zero;
-                        }
-                        else
-                        {
-                            CHECK(((samplesToDiscard / std::max(samplesCount, samplesToDiscard))
-                                   - (m_extraAudioTime.asMicroseconds()
-                                      / samplesToTime(samplesCount).asMicroseconds()))
-                                  < 0.1,
-                                  "It looks like an invalid amount of audio samples was discarded, "
-                                  "please report this bug");
-                            
-                            samplesBuffer += samplesToDiscard * BytesPerSample;
-                            samplesCount -= samplesToDiscard;
-                            
-                            m_extraAudioTime -= samplesToTime(samplesToDiscard);
-                        }
-                    }
-                    
-                    std::memcpy((void *)(data.samples + data.sampleCount),
-                                samplesBuffer, samplesCount * BytesPerSample);
-                    data.sampleCount += samplesCount;
-                }
+                m_startPending = false;
+                m_timer->releaseStart(m_startToken, m_startSilence);
             }
-            while (needsMoreDecoding);
             
-            av_packet_unref(packet);
+            return true;
         }
         
-        if (!packet)
+        if (decodingFinished)
+        {
             sfeLogDebug("No more audio packets, do not go further");
+            
+            if (m_startPending)
+            {
+                m_startPending = false;
+                m_timer->releaseStart(m_startToken);
+            }
+            
+            return false;
+        }
+        
+        // The decoding thread is late, keep the audio device running rather than stopping playback
+        if (m_startPending)
+        {
+            m_startSilence += UnderrunDuration;
+        }
+        else
+        {
+            sfeLogWarning("Audio decoding underrun, playing " + s(UnderrunDuration.asMilliseconds()) + "ms of silence");
+        }
+        
+        data.samples = &m_silence[0];
+        data.sampleCount = m_silence.size();
+        trackHandedOutSamples(m_silence.size(), true);
+        return true;
+    }
+    
+    bool AudioStream::getPlaybackPosition(sf::Time& position) const
+    {
+        if (m_startPending || sf::SoundStream::getStatus() != sf::SoundStream::Playing)
+            return false;
+        
+        const uint64_t playedSamples = timeToSamples(sf::SoundStream::getPlayingOffset());
+        std::lock_guard<std::mutex> lock(m_playbackPositionMutex);
+        uint64_t silence = m_prunedSilence;
         
-        return (packet != nullptr);
+        // Runs that were fully played are merged to keep the ring short
+        while (m_silenceRunCount > 0)
+        {
+            const SilenceRun& run = m_silenceRuns[m_firstSilenceRun];
+            
+            if (run.deviceOffset + run.length > playedSamples)
+            {
+                if (run.deviceOffset < playedSamples)
+                    silence += playedSamples - run.deviceOffset;
+                
+                break;
+            }
+            
+            m_prunedSilence += run.length;
+            silence += run.length;
+            m_firstSilenceRun = (m_firstSilenceRun + 1) % SilenceRunCapacity;
+            m_silenceRunCount--;
+        }
+        
+        position = m_playbackStartPosition + samplesToTime(static_cast<int>(playedSamples - silence));
+        return true;
+    }
+    
+    void AudioStream::prepare()
+    {
+        if (m_prepared || sf::SoundStream::getStatus() != sf::SoundStream::Stopped)
+            return;
+        
+        // The decoding thread fills the ring in the background, the audio device is left alone: play()
+        // starts it as usual, but finds the samples for all the buffers SFML queues before playing
+        startDecoding();
+        m_prepared = true;
+    }
+    
+    bool AudioStream::isPrepared() const
+    {
+        const std::size_t wantedSamples = std::min<std::size_t>(timeToSamples(ChunkDuration * static_cast<sf::Int64>(DeviceBufferCount)),
+                                                                m_ringBuffer.getCapacity());
+        
+        return m_prepared && (m_decodingFinished || m_ringBuffer.getReadableCount() >= wantedSamples);
+    }
+    
+    bool AudioStream::warmUp(sf::Time position)
+    {
+        CHECK(sf::SoundStream::getStatus() == sf::SoundStream::Stopped, "AudioStream::warmUp() - stream is playing");
+        
+        m_warmUpPosition = position;
+        
+        if (! fastForward(position))
+            return false;
+        
+        startDecoding();
+        return true;
+    }
+    
+    bool AudioStream::canSpliceIn(sf::Time position) const
+    {
+        if (m_decodingFinished)
+            return true;
+        
+        const sf::Time lateness = std::max(sf::Time::Zero, position - m_warmUpPosition);
+        return m_ringBuffer.getReadableCount() >= static_cast<std::size_t>(timeToSamples(lateness + ChunkDuration));
+    }
+    
+    void AudioStream::spliceIn(sf::Time position)
+    {
+        // The SFML thread is not running yet, so the ring can be read from here
+        std::size_t samplesToDrop = timeToSamples(std::max(sf::Time::Zero, position - m_warmUpPosition));
+        
+        while (samplesToDrop > 0)
+        {
+            const sf::Int16* samples = nullptr;
+            const std::size_t droppedCount = m_ringBuffer.peekRead(samples, samplesToDrop);
+            
+            if (droppedCount == 0)
+                break;
+            
+            m_ringBuffer.commitRead(droppedCount);
+            samplesToDrop -= droppedCount;
+        }
+        
+        m_decodingCondition.notify_one();
+        
+        {
+            std::lock_guard<std::mutex> lock(m_playbackPositionMutex);
+            m_playbackStartPosition = position;
+            m_handedOutSamples = 0;
+            m_prunedSilence = 0;
+            m_firstSilenceRun = 0;
+            m_silenceRunCount = 0;
+        }
+        
+        // The timer is already running, unlike in willPlay() it isn't held until the audio device starts
+        m_startPending = false;
+        m_prepared = false;
+        setStatus(sfe::Playing);
+        sf::SoundStream::play();
+    }
+    
+    void AudioStream::spliceOut()
+    {
+        sf::SoundStream::stop();
+        m_startPending = false;
+        setStatus(sfe::Stopped);
+        flushBuffers();
     }
     
     void AudioStream::onSeek(sf::Time timeOffset)
@@ -298,97 +427,228 @@ namespace sfe
         //        CHECK(0, "AudioStream::onSeek() - not implemented");
     }
     
-    bool AudioStream::decodePacket(AVPacket* packet, AVFrame* outputFrame, bool& gotFrame)
+    void AudioStream::decodeLoop()
     {
-        gotFrame = false;
-
-        if (avcodec_send_packet(m_context, packet) != 0) {
-          return true;
+        try
+        {
+            while (m_decodingRequested)
+            {
+                AVPacket* packet = popEncodedData();
+                
+                if (! packet)
+                    break;
+                
+                // Once the media is fully read, flush packets are given until the decoder is empty
+                const bool isFlushPacket = (packet->data == nullptr && packet->size == 0);
+                const bool gotFrame = decodePacket(packet);
+                recyclePacket(packet);
+                
+                if (isFlushPacket && !gotFrame)
+                    break;
+            }
         }
-
-        if (avcodec_receive_frame(m_context, outputFrame) != 0) {
-          return true;
+        catch (std::runtime_error& e)
+        {
+            sfeLogError("Audio decoding stopped: " + std::string(e.what()));
+        }
+        
+        if (m_decodingRequested)
+        {
+            m_decodingFinished = true;
+            notifyDecodingStateChanged();
         }
-
-        gotFrame = true;
-        return false;
     }
     
-    void AudioStream::initResampler()
+    bool AudioStream::decodePacket(AVPacket* packet)
     {
-        CHECK0(m_swrCtx, "AudioStream::initResampler() - resampler already initialized");
-        int err = 0;
+        bool gotFrame = false;
+        int err = avcodec_send_packet(m_context, packet);
         
-        /* create resampler context */
-        m_swrCtx = swr_alloc();
-        CHECK(m_swrCtx, "AudioStream::initResampler() - out of memory");
+        if (err < 0 && err != AVERROR(EAGAIN))
+        {
+            sfeLogDebug("Audio packet could not be decoded, error " + s(err));
+            return false;
+        }
         
-        // Some media files don't define the channel layout, in this case take a default one
-        // according to the channels' count
-        if (m_stream->codecpar->channel_layout == 0)
+        while (avcodec_receive_frame(m_context, m_audioFrame) == 0)
         {
-            m_stream->codecpar->channel_layout = av_get_default_channel_layout(m_stream->codecpar->channels);
+            gotFrame = true;
+            tapFrame(m_audioFrame);
+            
+            if (! storeFrame(m_audioFrame))
+                break;
         }
         
-        /* set options */
-        av_opt_set_int        (m_swrCtx, "in_channel_layout",  m_stream->codecpar->channel_layout, 0);
-        av_opt_set_int        (m_swrCtx, "in_sample_rate",     m_stream->codecpar->sample_rate,    0);
-        av_opt_set_sample_fmt (m_swrCtx, "in_sample_fmt",      static_cast<AVSampleFormat>(m_stream->codecpar->format),     0);
-        av_opt_set_int        (m_swrCtx, "out_channel_layout", AV_CH_LAYOUT_STEREO,             0);
-        av_opt_set_int        (m_swrCtx, "out_sample_rate",    m_stream->codecpar->sample_rate,    0);
-        av_opt_set_sample_fmt (m_swrCtx, "out_sample_fmt",     AV_SAMPLE_FMT_S16,               0);
-        
-        /* initialize the resampling context */
-        err = swr_init(m_swrCtx);
-        CHECK(err >= 0, "AudioStream::initResampler() - resampling context initialization error");
-        
-        /* compute the number of converted samples: buffering is avoided
-         * ensuring that the output buffer will contain at least all the
-         * converted input samples */
-        m_maxDstNbSamples = m_dstNbSamples = 1024;
-        
-        /* Create the resampling output buffer */
-        m_dstNbChannels = av_get_channel_layout_nb_channels(AV_CH_LAYOUT_STEREO);
-        err = av_samples_alloc_array_and_samples(&m_dstData, &m_dstLinesize, m_dstNbChannels,
-                                                 m_dstNbSamples, AV_SAMPLE_FMT_S16, 0);
-        CHECK(err >= 0, "AudioStream::initResampler() - av_samples_alloc_array_and_samples error");
+        return gotFrame;
     }
     
-    void AudioStream::resampleFrame(const AVFrame* frame, uint8_t*& outSamples, int& outNbSamples)
+    bool AudioStream::storeFrame(const AVFrame* frame)
     {
-        CHECK(m_swrCtx, "AudioStream::resampleFrame() - resampler is not initialized, call AudioStream::initResamplerFirst() !");
-        CHECK(frame, "AudioStream::resampleFrame() - invalid argument");
+        const int channelCount = m_resampler.getChannelCount();
+        const int maxWriteSize = static_cast<int>(m_ringBuffer.getMaxWriteSize());
+        int offset = 0;
+        
+        // A frame that outputs more samples than one write can hold is stored in several parts
+        while (offset < frame->nb_samples)
+        {
+            int count = frame->nb_samples - offset;
+            
+            while (count > 1 && m_resampler.getOutputSampleCount(frame, count) * channelCount > maxWriteSize)
+                count /= 2;
+            
+            if (! storeFrameSamples(frame, offset, count))
+                return false;
+            
+            offset += count;
+        }
+        
+        return true;
+    }
+    
+    bool AudioStream::storeFrameSamples(const AVFrame* frame, int offset, int count)
+    {
+        const int channelCount = m_resampler.getChannelCount();
+        const int maxSamplesCount = m_resampler.getOutputSampleCount(frame, count) * channelCount;
+        sf::Int16* samplesBuffer = nullptr;
+        
+        // Wait for the SFML audio thread to consume enough samples
+        while (m_decodingRequested && nullptr == (samplesBuffer = m_ringBuffer.reserveWrite(maxSamplesCount)))
+        {
+            std::unique_lock<std::mutex> lock(m_decodingMutex);
+            m_decodingCondition.wait_for(lock, std::chrono::milliseconds(100));
+        }
+        
+        if (! samplesBuffer)
+            return false;
+        
+        // Resample straight into the ring buffer
+        int samplesCount = resampleFrame(frame, offset, count, samplesBuffer, maxSamplesCount);
+        CHECK(samplesCount >= 0, "AudioStream::storeFrameSamples() - resampleFrame() error");
+        
+        // Resamplers with a delay line like soxr can output nothing for the first frames after a flush,
+        // keep the extra audio time for the next frames
+        if (samplesCount == 0)
+            return true;
+        
+        if (m_extraAudioTime > sf::Time::Zero)
+        {
+            int samplesToDiscard = timeToSamples(m_extraAudioTime);
+            if (samplesToDiscard > samplesCount)
+            {
+                samplesToDiscard = samplesCount;
+                sfeLogDebug("Cannot discard all the extra audio samples in one time");
+            }
+            
+            if (samplesToDiscard < channelCount && samplesCount > 0)
+            {
+                sfeLogDebug("Extra audio time is too small to discard audio samples: "
+                            + s(m_extraAudioTime.asMicroseconds()) + "us");
+                m_extraAudioTime = sf::Time::Zero;
+            }
+            else
+            {
+                CHECK(((samplesToDiscard / std::max(samplesCount, samplesToDiscard))
+                       - (m_extraAudioTime.asMicroseconds()
+                          / samplesToTime(samplesCount).asMicroseconds()))
+                      < 0.1,
+                      "It looks like an invalid amount of audio samples was discarded, "
+                      "please report this bug");
+                
+                // Only happens for the first frame after seeking: shift the kept samples
+                // back over the discarded ones
+                samplesCount -= samplesToDiscard;
+                std::memmove(samplesBuffer, samplesBuffer + samplesToDiscard,
+                             samplesCount * BytesPerSample);
+                
+                m_extraAudioTime -= samplesToTime(samplesToDiscard);
+            }
+        }
         
-        int src_rate, dst_rate, err, dst_bufsize;
-        src_rate = dst_rate = frame->sample_rate;
+        m_ringBuffer.commitWrite(samplesCount);
+        notifyDecodingStateChanged();
+        return true;
+    }
+    
+    void AudioStream::startDecoding()
+    {
+        // Once the end of the stream is reached, the thread stays finished until the buffers are flushed
+        if (m_decodingThread.joinable())
+            return;
+        
+        m_decodingRequested = true;
+        m_decodingThread = std::thread(&AudioStream::decodeLoop, this);
+    }
+    
+    void AudioStream::stopDecoding()
+    {
+        m_decodingRequested = false;
+        notifyDecodingStateChanged();
+        
+        if (m_decodingThread.joinable())
+            m_decodingThread.join();
+    }
+    
+    void AudioStream::notifyDecodingStateChanged()
+    {
+        // Taking the lock guarantees that a thread about to wait won't miss the notification
+        {
+            std::lock_guard<std::mutex> lock(m_decodingMutex);
+        }
+        
+        m_decodingCondition.notify_all();
+    }
+    
+    void AudioStream::trackHandedOutSamples(std::size_t samplesCount, bool isSilence)
+    {
+        std::lock_guard<std::mutex> lock(m_playbackPositionMutex);
         
-        /* compute destination number of samples */
-        m_dstNbSamples = av_rescale_rnd(swr_get_delay(m_swrCtx, src_rate) +
-                                        frame->nb_samples, dst_rate, src_rate, AV_ROUND_UP);
-        if (m_dstNbSamples > m_maxDstNbSamples)
+        if (isSilence)
         {
-            av_free(m_dstData[0]);
-            err = av_samples_alloc(m_dstData, &m_dstLinesize, m_dstNbChannels,
-                                   m_dstNbSamples, AV_SAMPLE_FMT_S16, 1);
-            CHECK(err >= 0, "AudioStream::resampleFrame() - out of memory");
-            m_maxDstNbSamples = m_dstNbSamples;
+            SilenceRun* lastRun = nullptr;
+            
+            if (m_silenceRunCount > 0)
+                lastRun = &m_silenceRuns[(m_firstSilenceRun + m_silenceRunCount - 1) % SilenceRunCapacity];
+            
+            if (lastRun && lastRun->deviceOffset + lastRun->length == m_handedOutSamples)
+            {
+                lastRun->length += samplesCount;
+            }
+            else
+            {
+                // Runs are separated by audio chunks and the device only queues a few of them, so when
+                // the ring is full its oldest run was already played and can be merged
+                if (m_silenceRunCount == SilenceRunCapacity)
+                {
+                    m_prunedSilence += m_silenceRuns[m_firstSilenceRun].length;
+                    m_firstSilenceRun = (m_firstSilenceRun + 1) % SilenceRunCapacity;
+                    m_silenceRunCount--;
+                }
+                
+                SilenceRun& run = m_silenceRuns[(m_firstSilenceRun + m_silenceRunCount) % SilenceRunCapacity];
+                run.deviceOffset = m_handedOutSamples;
+                run.length = samplesCount;
+                m_silenceRunCount++;
+            }
         }
         
-        /* convert to destination format */
-        err = swr_convert(m_swrCtx, m_dstData, m_dstNbSamples, (const uint8_t **)frame->extended_data, frame->nb_samples);
-        CHECK(err >= 0, "AudioStream::resampleFrame() - swr_convert() error");
+        m_handedOutSamples += samplesCount;
+    }
+    
+    int AudioStream::resampleFrame(const AVFrame* frame, int offset, int count, sf::Int16* outSamples, int outCapacity)
+    {
+        CHECK(frame, "AudioStream::resampleFrame() - invalid argument");
+        CHECK(outSamples, "AudioStream::resampleFrame() - invalid argument");
         
-        dst_bufsize = av_samples_get_buffer_size(&m_dstLinesize, m_dstNbChannels,
-                                                 err, AV_SAMPLE_FMT_S16, 1);
-        CHECK(dst_bufsize >= 0, "AudioStream::resampleFrame() - av_samples_get_buffer_size() error");
+        // S16 output is interleaved so there is a single plane
+        const int channelCount = m_resampler.getChannelCount();
+        uint8_t* outPlanes[1] = { reinterpret_cast<uint8_t*>(outSamples) };
         
-        outNbSamples = dst_bufsize / av_get_bytes_per_sample(AV_SAMPLE_FMT_S16);
-        outSamples = m_dstData[0];
+        return m_resampler.convert(frame, offset, count, outPlanes, outCapacity / channelCount) * channelCount;
     }
     
     int AudioStream::timeToSamples(const sf::Time& time) const
     {
-        const int channelCount = av_get_channel_layout_nb_channels(AV_CH_LAYOUT_STEREO);
+        const int channelCount = m_resampler.getChannelCount();
         int64_t samplesPerSecond = m_sampleRatePerChannel * channelCount;
         int64_t samples = (samplesPerSecond * time.asMicroseconds()) / 1000000;
         CHECK(samples >= 0, "computation overflow");
@@ -403,7 +663,7 @@ namespace sfe
     
     sf::Time AudioStream::samplesToTime(int nbSamples) const
     {
-        int64_t samplesPerChannel = nbSamples / av_get_channel_layout_nb_channels(AV_CH_LAYOUT_STEREO);
+        int64_t samplesPerChannel = nbSamples / m_resampler.getChannelCount();
         int64_t microseconds = 1000000 * samplesPerChannel / m_sampleRatePerChannel;
         CHECK(microseconds >= 0, "computation overflow");
         
@@ -413,49 +673,52 @@ namespace sfe
     void AudioStream::willPlay(const Timer &timer)
     {
         Stream::willPlay(timer);
+        startDecoding();
         
-        if (Stream::getStatus() == sfe::Stopped)
+        m_prepared = false;
+        
+        if (sf::SoundStream::getStatus() == sf::SoundStream::Stopped)
         {
-            sf::Time initialTime = sf::SoundStream::getPlayingOffset();
-            sf::Clock timeout;
-            sf::SoundStream::play();
-            
-            // Some audio drivers take time before the sound is actually played
-            // To avoid desynchronization with the timer, we don't return
-            // until the audio stream is actually started
-            while (sf::SoundStream::getPlayingOffset() == initialTime && timeout.getElapsedTime() < sf::seconds(5))
-                sf::sleep(sf::microseconds(10));
+            // Some audio drivers take time before the sound is actually played. Rather than waiting
+            // for it, hold the timer until the SFML thread gets its first samples, see onGetData()
+            m_startToken = m_timer->retainStart();
+            m_startSilence = sf::Time::Zero;
+            m_startPending = true;
             
-            CHECK(sf::SoundStream::getPlayingOffset() != initialTime, "is your audio device broken? Audio did not start within 5 seconds");
-        }
-        else
-        {
-            sf::SoundStream::play();
-            waitForStatusUpdate(*this, sf::SoundStream::Playing);
+            // SFML counts the played samples from zero again
+            std::lock_guard<std::mutex> lock(m_playbackPositionMutex);
+            m_playbackStartPosition = timer.getOffset();
+            m_handedOutSamples = 0;
+            m_prunedSilence = 0;
+            m_firstSilenceRun = 0;
+            m_silenceRunCount = 0;
         }
+        
+        // Resuming is immediate, starting happens asynchronously in the SFML thread
+        sf::SoundStream::play();
     }
     
     void AudioStream::didPlay(const Timer& timer, sfe::Status previousStatus)
     {
-        CHECK(SoundStream::getStatus() == SoundStream::Playing, "AudioStream::didPlay() - willPlay() not executed!");
         Stream::didPlay(timer, previousStatus);
     }
     
     void AudioStream::didPause(const Timer& timer, sfe::Status previousStatus)
     {
-        if (sf::SoundStream::getStatus() == sf::SoundStream::Playing)
-        {
+        // Pausing an OpenAL source is immediate
+        if (sf::SoundStream::getStatus() == sf::SoundStream::Playing || m_startPending)
             sf::SoundStream::pause();
-            waitForStatusUpdate(*this, sf::SoundStream::Paused);
-        }
         
+        m_startPending = false;
         Stream::didPause(timer, previousStatus);
     }
     
     void AudioStream::didStop(const Timer& timer, sfe::Status previousStatus)
     {
+        // Stopping only waits for the SFML thread to exit, which doesn't depend on the audio driver
         sf::SoundStream::stop();
-        waitForStatusUpdate(*this, sf::SoundStream::Stopped);
+        m_startPending = false;
+        m_prepared = false;
         
         Stream::didStop(timer, previousStatus);
     }
@@ -28,6 +28,13 @@
 
 #include <SFML/Audio.hpp>
 #include "Stream.hpp"
+#include "AudioResampler.hpp"
+#include "PcmRingBuffer.hpp"
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
 #include <stdint.h>
 
 namespace sfe
@@ -39,9 +46,11 @@ namespace sfe
          *
          * At the end of the constructor, the stream is guaranteed
          * to have all of its fields set and the decoder loaded
+         *
+         * @param settings the output sample rate and resampling algorithm to use
          */
         AudioStream(AVFormatContext*& formatCtx, AVStream*& stream, DataSource& dataSource,
-                    std::shared_ptr<Timer> timer);
+                    std::shared_ptr<Timer> timer, const AudioSettings& settings = AudioSettings());
         
         /** Default destructor
          */
@@ -65,6 +74,59 @@ namespace sfe
          */
         bool fastForward(sf::Time targetPosition) override;
         
+        /** Compute the media position of the audio being heard
+         *
+         * This is based on the amount of samples actually consumed by the audio device,
+         * the silence played when decoding is late excluded
+         *
+         * @param position [out] the position of the audio being played
+         * @return true if @a position could be computed, false if audio is not playing
+         */
+        bool getPlaybackPosition(sf::Time& position) const;
+        
+        /** Start decoding the beginning of the audio in the background, without waiting for it
+         *
+         * The audio device is only started by play(), which then finds its first samples decoded
+         * and no longer waits for the decoding
+         */
+        void prepare() override;
+        
+        /** Tell whether the audio decoded since prepare() is enough for the audio device to start
+         *
+         * @return true if prepare() was called and the buffers queued by SFML before playing can be filled
+         */
+        bool isPrepared() const;
+        
+        /** Start decoding in the background so that this stream can replace the playing audio stream
+         *
+         * The packets already given to this stream are decoded from @a position on, the audio before
+         * it is discarded. The stream must not be playing
+         *
+         * @param position the media position from which the audio will be needed
+         * @return true if the audio at @a position could be found, false otherwise
+         */
+        bool warmUp(sf::Time position);
+        
+        /** Tell whether the audio decoded since warmUp() is enough to start playing at @a position
+         *
+         * @param position the media position at which playback would start
+         * @return true if at least one chunk of audio from @a position on is decoded
+         */
+        bool canSpliceIn(sf::Time position) const;
+        
+        /** Start playing the audio decoded since warmUp() from @a position, without holding the timer
+         *
+         * The audio between the warm up position and @a position is dropped, so that the stream is
+         * in sync with the timer that is already running
+         *
+         * @param position the current timer position
+         */
+        void spliceIn(sf::Time position);
+        
+        /** Stop playing and discard the audio decoded ahead, so that another stream can take over
+         */
+        void spliceOut();
+        
         using sf::SoundStream::setVolume;
         using sf::SoundStream::getVolume;
         using sf::SoundStream::getSampleRate;
@@ -73,32 +135,66 @@ namespace sfe
         bool onGetData(sf::SoundStream::Chunk& data) override;
         void onSeek(sf::Time timeOffset) override;
         
-        /** Decode the encoded data @a packet into @a outputFrame
+        /** Decoding thread entry point
          *
-         * gotFrame being set to false means that decoding should still continue:
-         *  - with a new packet if false is returned
-         *    - with the same packet if true is returned
+         * Decode packets and store the resulting samples into the ring buffer until the end
+         * of the stream is reached or stopDecoding() is called
+         */
+        void decodeLoop();
+        
+        /** Decode the encoded data @a packet and store all the samples it contains into the ring buffer
          *
          * @param packet the encoded data
-         * @param outputFrame one decoded data
-         * @param gotFrame set to true if a frame has been extracted to outputFrame, false otherwise
-         * @return true if there's still data to decode in this packet, false otherwise
+         * @return true if at least one frame could be extracted from @a packet, false otherwise
+         */
+        bool decodePacket(AVPacket* packet);
+        
+        /** Resample @a frame into the ring buffer, waiting for the ring to have enough free space
+         *
+         * @param frame the decoded audio samples
+         * @return true if the samples were stored, false if decoding was stopped meanwhile
+         */
+        bool storeFrame(const AVFrame* frame);
+        
+        /** Resample @a count samples per channel of @a frame from sample @a offset on, and store them
+         * in the ring buffer with a single write
+         *
+         * @return false if decoding was stopped while waiting for room in the ring buffer
+         */
+        bool storeFrameSamples(const AVFrame* frame, int offset, int count);
+        
+        /** Start the decoding thread if it is not already running
+         */
+        void startDecoding();
+        
+        /** Stop the decoding thread and wait for it to exit
          */
-        bool decodePacket(AVPacket* packet, AVFrame* outputFrame, bool& gotFrame);
+        void stopDecoding();
         
-        /** Initialize the audio resampler for conversion from many formats to signed 16 bits audio
+        /** Notify the threads waiting for a change in the ring buffer or decoding state
+         */
+        void notifyDecodingStateChanged();
+        
+        /** Remember how many samples were given to SFML, to know later on which part was silence
          *
-         * This must be called before any packet is decoded and resampled
+         * @param samplesCount the amount of samples given to SFML
+         * @param isSilence true if the samples are silence rather than media audio
          */
-        void initResampler();
+        void trackHandedOutSamples(std::size_t samplesCount, bool isSilence);
         
         /** Resample the decoded audio frame @a frame into signed 16 bits audio samples
+         *
+         * The samples are written directly to @a outSamples, no intermediate buffer is used.
+         * If the frame is already in the output format, it is copied as is
          *
          * @param frame the audio samples to convert
-         * @param outSamples [out] the convertedSamples
-         * @param outNbSamples [out] the count of signed 16 bits samples in @a outSamples
+         * @param offset the first sample per channel of @a frame to convert
+         * @param count the count of samples per channel of @a frame to convert
+         * @param outSamples [out] where the converted samples are written
+         * @param outCapacity the count of signed 16 bits samples that can be written to @a outSamples
+         * @return the count of signed 16 bits samples written to @a outSamples
          */
-        void resampleFrame(const AVFrame* frame, uint8_t*& outSamples, int& outNbSamples);
+        int resampleFrame(const AVFrame* frame, int offset, int count, sf::Int16* outSamples, int outCapacity);
         
         /** @return the amount of samples that would last the given time with the current audio stream
          * properties
@@ -120,17 +216,46 @@ namespace sfe
         unsigned m_sampleRatePerChannel;
         
         // Private data
-        sf::Int16* m_samplesBuffer;
         AVFrame* m_audioFrame;
         sf::Time m_extraAudioTime;
         
         // Resampling
-        struct SwrContext* m_swrCtx;
-        int m_dstNbSamples;
-        int m_maxDstNbSamples;
-        int m_dstNbChannels;
-        int m_dstLinesize;
-        uint8_t** m_dstData;
+        AudioResampler m_resampler;
+        
+        // Decoding thread
+        PcmRingBuffer m_ringBuffer;
+        std::size_t m_pendingReadCount;
+        std::vector<sf::Int16> m_silence;
+        std::thread m_decodingThread;
+        std::atomic<bool> m_decodingRequested;
+        std::atomic<bool> m_decodingFinished;
+        std::mutex m_decodingMutex;
+        std::condition_variable m_decodingCondition;
+        
+        // Starting
+        uint64_t m_startToken;
+        std::atomic<bool> m_startPending;
+        sf::Time m_startSilence;
+        bool m_prepared;
+        sf::Time m_warmUpPosition;
+        
+        // Playback position
+        struct SilenceRun
+        {
+            uint64_t deviceOffset;
+            uint64_t length;
+        };
+        
+        // The runs are tracked from the SFML audio thread, so they live in a fixed ring that never allocates
+        static const std::size_t SilenceRunCapacity = 16;
+        
+        sf::Time m_playbackStartPosition;
+        uint64_t m_handedOutSamples;
+        mutable uint64_t m_prunedSilence;
+        mutable SilenceRun m_silenceRuns[SilenceRunCapacity];
+        mutable std::size_t m_firstSilenceRun;
+        mutable std::size_t m_silenceRunCount;
+        mutable std::mutex m_playbackPositionMutex;
     };
 }
 
@@ -0,0 +1,494 @@
+
+/*
+ *  AudioTrackDecoder.cpp
+ *  sfeMovie project
+ *
+ *  Copyright (C) 2010-2015 Lucas Soltic
+ *  lucas.soltic@orange.fr
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ *
+ */
+
+extern "C"
+{
+#include <libavformat/avformat.h>
+#include <libavcodec/avcodec.h>
+}
+
+#include "AudioTrackDecoder.hpp"
+#include "AudioResampler.hpp"
+#include "Macros.hpp"
+#include "Log.hpp"
+#include "Stream.hpp"
+#include "Utilities.hpp"
+#include <algorithm>
+#include <cstring>
+#include <functional>
+#include <limits>
+#include <stdexcept>
+#include <thread>
+
+namespace sfe
+{
+    namespace
+    {
+        // Streams shorter than this are decoded on a single thread, splitting them isn't worth it
+        const std::size_t MinPacketsPerSegment = 500;
+        
+        // Packets decoded before and after a segment to prime the decoder, this covers
+        // the overlap of transform codecs and the mp3 bit reservoir
+        const std::size_t BoundaryPacketCount = 8;
+        
+        // The playable channel layouts have at most 8 channels
+        const std::size_t MaxPlaneCount = 8;
+        
+        int isInterrupted(void* opaque)
+        {
+            return *static_cast<const std::atomic<bool>*>(opaque) ? 1 : 0;
+        }
+    }
+    
+    AudioTrackDecoder::AudioTrackDecoder(const std::string& sourceFile, int streamIndex,
+                                         const AudioSettings& settings,
+                                         std::shared_ptr<const std::atomic<bool> > interruption) :
+    m_formatCtx(nullptr),
+    m_interruption(interruption),
+    m_stream(nullptr),
+    m_packets(),
+    m_channelLayout(0),
+    m_channelCount(0),
+    m_sampleRate(0),
+    m_settings(settings)
+    {
+        CHECK(sourceFile.size(), "AudioTrackDecoder::AudioTrackDecoder() - invalid argument: sourceFile");
+        
+        // Same as the Demuxer, FFmpeg checks the flag while it waits for I/O
+        if (m_interruption)
+        {
+            m_formatCtx = avformat_alloc_context();
+            CHECK(m_formatCtx, "AudioTrackDecoder::AudioTrackDecoder() - avformat_alloc_context() error");
+            m_formatCtx->interrupt_callback.callback = isInterrupted;
+            m_formatCtx->interrupt_callback.opaque = const_cast<std::atomic<bool>*>(m_interruption.get());
+        }
+        
+        int err = avformat_open_input(&m_formatCtx, sourceFile.c_str(), nullptr, nullptr);
+        CHECK0(err, "AudioTrackDecoder::AudioTrackDecoder() - error while opening media: " + sourceFile);
+        
+        try
+        {
+            err = avformat_find_stream_info(m_formatCtx, nullptr);
+            CHECK0(err, "AudioTrackDecoder::AudioTrackDecoder() - error while retreiving media information");
+            CHECK(streamIndex >= 0 && static_cast<unsigned>(streamIndex) < m_formatCtx->nb_streams,
+                  "AudioTrackDecoder::AudioTrackDecoder() - invalid stream index " + s(streamIndex));
+            
+            m_stream = m_formatCtx->streams[streamIndex];
+            CHECK(m_stream->codecpar->codec_type == AVMEDIA_TYPE_AUDIO,
+                  "AudioTrackDecoder::AudioTrackDecoder() - " + Stream::AVStreamDescription(m_stream)
+                  + " is not an audio stream");
+            
+            // Same output as AudioStream
+            m_channelLayout = AudioResampler::playableChannelLayout(m_stream->codecpar->channels);
+            m_channelCount = av_get_channel_layout_nb_channels(m_channelLayout);
+            m_sampleRate = settings.sampleRate > 0 ? settings.sampleRate : m_stream->codecpar->sample_rate;
+            
+            // Don't bother demuxing the other streams
+            for (unsigned int i = 0; i < m_formatCtx->nb_streams; i++)
+            {
+                if (m_formatCtx->streams[i] != m_stream)
+                    m_formatCtx->streams[i]->discard = AVDISCARD_ALL;
+            }
+        }
+        catch (std::runtime_error&)
+        {
+            avformat_close_input(&m_formatCtx);
+            throw;
+        }
+    }
+    
+    AudioTrackDecoder::~AudioTrackDecoder()
+    {
+        for (AVPacket*& packet : m_packets)
+            av_packet_free(&packet);
+        
+        avformat_close_input(&m_formatCtx);
+    }
+    
+    void AudioTrackDecoder::decode(std::vector<sf::Int16>& samples)
+    {
+        std::vector<Segment> segments;
+        decodeSegments(Int16Samples, segments);
+        
+        samples.resize(getDecodedSize(segments) / sizeof(sf::Int16));
+        
+        if (! samples.empty())
+            copyDecodedSamples(segments, reinterpret_cast<uint8_t*>(&samples[0]));
+    }
+    
+    void AudioTrackDecoder::decode(std::vector<float>& samples, SampleFormat format)
+    {
+        CHECK(format == FloatSamples || format == PlanarFloatSamples,
+              "AudioTrackDecoder::decode() - invalid argument: format");
+        
+        std::vector<Segment> segments;
+        decodeSegments(format, segments);
+        
+        samples.resize(getDecodedSize(segments) / sizeof(float));
+        
+        if (! samples.empty())
+            copyDecodedSamples(segments, reinterpret_cast<uint8_t*>(&samples[0]));
+    }
+    
+    void AudioTrackDecoder::decodeSegments(SampleFormat format, std::vector<Segment>& segments)
+    {
+        readPackets();
+        CHECK(! interruptionRequested(), "AudioTrackDecoder::decode() - decoding interrupted");
+        
+        std::size_t segmentCount = computeSegmentCount();
+        
+        for (int attempt = 0; attempt < 2; attempt++)
+        {
+            const std::size_t packetsPerSegment = m_packets.size() / segmentCount;
+            segments.assign(segmentCount, Segment());
+            
+            for (std::size_t i = 0; i < segmentCount; i++)
+            {
+                segments[i].format = format;
+                segments[i].stopped = false;
+                segments[i].begin = i * packetsPerSegment;
+                segments[i].end = (i + 1 < segmentCount) ? (i + 1) * packetsPerSegment : m_packets.size();
+            }
+            
+            // The calling thread takes the first segment
+            std::vector<std::thread> threads;
+            for (std::size_t i = 1; i < segmentCount; i++)
+                threads.push_back(std::thread(&AudioTrackDecoder::decodeSegment, this, std::ref(segments[i])));
+            
+            decodeSegment(segments[0]);
+            
+            for (std::thread& thread : threads)
+                thread.join();
+            
+            std::string error;
+            for (const Segment& segment : segments)
+            {
+                if (error.empty())
+                    error = segment.error;
+            }
+            
+            if (error.empty())
+                break;
+            
+            CHECK(segmentCount > 1, error);
+            
+            sfeLogWarning("Could not decode " + Stream::AVStreamDescription(m_stream) + " in parallel ("
+                          + error + "), decoding it again on a single thread");
+            segmentCount = 1;
+        }
+        
+        const std::size_t bytesPerSample = (format == Int16Samples) ? sizeof(sf::Int16) : sizeof(float);
+        sfeLogDebug("Decoded " + s(getDecodedSize(segments) / bytesPerSample / m_channelCount)
+                    + " audio samples per channel using " + s(segmentCount) + " thread(s)");
+    }
+    
+    std::size_t AudioTrackDecoder::getDecodedSize(const std::vector<Segment>& segments)
+    {
+        std::size_t size = 0;
+        
+        for (const Segment& segment : segments)
+        {
+            for (const std::vector<uint8_t>& plane : segment.planes)
+                size += plane.size();
+        }
+        
+        return size;
+    }
+    
+    void AudioTrackDecoder::copyDecodedSamples(const std::vector<Segment>& segments, uint8_t* output)
+    {
+        // Segments that decoded nothing have no plane at all
+        std::size_t planeCount = 0;
+        for (const Segment& segment : segments)
+            planeCount = std::max(planeCount, segment.planes.size());
+        
+        for (std::size_t plane = 0; plane < planeCount; plane++)
+        {
+            for (const Segment& segment : segments)
+            {
+                if (plane < segment.planes.size() && ! segment.planes[plane].empty())
+                {
+                    std::memcpy(output, &segment.planes[plane][0], segment.planes[plane].size());
+                    output += segment.planes[plane].size();
+                }
+            }
+        }
+    }
+    
+    
+    bool AudioTrackDecoder::decode(const SampleHandler& handler)
+    {
+        CHECK(handler, "AudioTrackDecoder::decode() - invalid argument: handler");
+        
+        Segment segment;
+        segment.begin = 0;
+        segment.end = 0;
+        segment.format = Int16Samples;
+        segment.handler = handler;
+        segment.stopped = false;
+        
+        AVCodecContext* context = nullptr;
+        AVFrame* frame = nullptr;
+        AVPacket* packet = nullptr;
+        
+        try
+        {
+            const int64_t beginPts = std::numeric_limits<int64_t>::min();
+            const int64_t endPts = std::numeric_limits<int64_t>::max();
+            
+            AudioResampler resampler(m_channelLayout, Int16Samples, m_sampleRate,
+                                     m_settings.resamplerEngine, m_settings.resamplerQuality);
+            context = createDecoder();
+            frame = av_frame_alloc();
+            packet = av_packet_alloc();
+            CHECK(frame && packet, "AudioTrackDecoder::decode() - out of memory");
+            
+            // Each packet is decoded right after it is read rather than after the whole stream is read
+            while (!segment.stopped && !interruptionRequested() && av_read_frame(m_formatCtx, packet) >= 0)
+            {
+                if (packet->stream_index == m_stream->index)
+                    decodePacket(segment, context, resampler, frame, packet, beginPts, endPts);
+                
+                av_packet_unref(packet);
+            }
+            
+            segment.stopped = segment.stopped || interruptionRequested();
+            
+            if (!segment.stopped)
+                decodePacket(segment, context, resampler, frame, nullptr, beginPts, endPts);
+            
+            // Samples delayed by the sample rate conversion are only output once the stream ends
+            if (!segment.stopped)
+                storeSamples(segment, resampler, nullptr);
+        }
+        catch (std::runtime_error& e)
+        {
+            segment.error = e.what();
+        }
+        
+        av_packet_free(&packet);
+        av_frame_free(&frame);
+        avcodec_free_context(&context);
+        
+        CHECK(segment.error.empty(), segment.error);
+        return !segment.stopped;
+    }
+    
+    int AudioTrackDecoder::getChannelCount() const
+    {
+        return m_channelCount;
+    }
+    
+    int AudioTrackDecoder::getSampleRate() const
+    {
+        return m_sampleRate;
+    }
+    
+    void AudioTrackDecoder::readPackets()
+    {
+        CHECK(m_packets.empty(), "AudioTrackDecoder::readPackets() - the stream was already read");
+        
+        AVPacket* packet = av_packet_alloc();
+        CHECK(packet, "AudioTrackDecoder::readPackets() - out of memory");
+        
+        while (av_read_frame(m_formatCtx, packet) >= 0)
+        {
+            if (packet->stream_index == m_stream->index)
+            {
+                m_packets.push_back(packet);
+                packet = av_packet_alloc();
+                CHECK(packet, "AudioTrackDecoder::readPackets() - out of memory");
+            }
+            else
+            {
+                av_packet_unref(packet);
+            }
+        }
+        
+        av_packet_free(&packet);
+    }
+    
+    std::size_t AudioTrackDecoder::computeSegmentCount() const
+    {
+        const std::size_t threadCount = std::max(1u, std::thread::hardware_concurrency());
+        const std::size_t segmentCount = std::min(threadCount, m_packets.size() / MinPacketsPerSegment);
+        
+        if (segmentCount <= 1)
+            return 1;
+        
+        // Parts can't be resampled independently without glitches at their boundaries
+        if (m_sampleRate != m_stream->codecpar->sample_rate)
+            return 1;
+        
+        // Segment boundaries are found from the packet timestamps
+        for (const AVPacket* packet : m_packets)
+        {
+            if (packet->pts == AV_NOPTS_VALUE)
+                return 1;
+        }
+        
+        return segmentCount;
+    }
+    
+    void AudioTrackDecoder::decodeSegment(Segment& segment) const
+    {
+        AVCodecContext* context = nullptr;
+        AVFrame* frame = nullptr;
+        
+        try
+        {
+            const bool isWholeStream = (segment.begin == 0 && segment.end == m_packets.size());
+            const std::size_t first = segment.begin - std::min(segment.begin, BoundaryPacketCount);
+            const std::size_t last = std::min(segment.end + BoundaryPacketCount, m_packets.size());
+            const int64_t beginPts = (segment.begin > 0) ? m_packets[segment.begin]->pts
+                                                         : std::numeric_limits<int64_t>::min();
+            const int64_t endPts = (segment.end < m_packets.size()) ? m_packets[segment.end]->pts
+                                                                    : std::numeric_limits<int64_t>::max();
+            
+            AudioResampler resampler(m_channelLayout, segment.format, m_sampleRate,
+                                     m_settings.resamplerEngine, m_settings.resamplerQuality);
+            context = createDecoder();
+            frame = av_frame_alloc();
+            CHECK(frame, "AudioTrackDecoder::decodeSegment() - out of memory");
+            
+            for (std::size_t i = first; i <= last && !segment.stopped; i++)
+            {
+                // Only the last segment drains the decoder, the others stop after their boundary packets
+                if (i == last && last < m_packets.size())
+                    break;
+                
+                decodePacket(segment, context, resampler, frame, (i < last) ? m_packets[i] : nullptr, beginPts, endPts);
+            }
+            
+            // Samples delayed by the sample rate conversion are only output once the stream ends
+            if (isWholeStream && !segment.stopped)
+                storeSamples(segment, resampler, nullptr);
+        }
+        catch (std::runtime_error& e)
+        {
+            segment.error = e.what();
+        }
+        
+        av_frame_free(&frame);
+        avcodec_free_context(&context);
+    }
+    
+    void AudioTrackDecoder::decodePacket(Segment& segment, AVCodecContext* context, AudioResampler& resampler,
+                                         AVFrame* frame, const AVPacket* packet, int64_t beginPts, int64_t endPts) const
+    {
+        const bool keepsAllFrames = (beginPts == std::numeric_limits<int64_t>::min() &&
+                                     endPts == std::numeric_limits<int64_t>::max());
+        int err = avcodec_send_packet(context, packet);
+        
+        if (err < 0 && err != AVERROR(EAGAIN))
+        {
+            sfeLogDebug("Audio packet could not be decoded, error " + s(err));
+            return;
+        }
+        
+        while (!segment.stopped && avcodec_receive_frame(context, frame) == 0)
+        {
+            const int64_t pts = frame->best_effort_timestamp;
+            CHECK(keepsAllFrames || pts != AV_NOPTS_VALUE, "decoded audio has no timestamp");
+            
+            if (keepsAllFrames || (pts >= beginPts && pts < endPts))
+                storeSamples(segment, resampler, frame);
+            
+            av_frame_unref(frame);
+        }
+    }
+    
+    bool AudioTrackDecoder::interruptionRequested() const
+    {
+        return m_interruption && *m_interruption;
+    }
+    
+    void AudioTrackDecoder::storeSamples(Segment& segment, AudioResampler& resampler, const AVFrame* frame) const
+    {
+        const int maxSamplesCount = frame ? resampler.getOutputSampleCount(frame) : resampler.getFlushSampleCount();
+        
+        if (maxSamplesCount <= 0)
+            return;
+        
+        // Interleaved formats have a single plane holding the samples of all the channels
+        const bool isPlanar = (segment.format == PlanarFloatSamples);
+        const std::size_t planeCount = isPlanar ? m_channelCount : 1;
+        const std::size_t bytesPerSample = ((segment.format == Int16Samples) ? sizeof(sf::Int16) : sizeof(float))
+                                           * (isPlanar ? 1 : m_channelCount);
+        
+        CHECK(planeCount <= MaxPlaneCount, "AudioTrackDecoder::storeSamples() - too many channels");
+        segment.planes.resize(planeCount);
+        
+        const std::size_t offset = segment.planes[0].size();
+        uint8_t* outPlanes[MaxPlaneCount];
+        
+        for (std::size_t plane = 0; plane < planeCount; plane++)
+        {
+            segment.planes[plane].resize(offset + maxSamplesCount * bytesPerSample);
+            outPlanes[plane] = &segment.planes[plane][offset];
+        }
+        
+        int samplesCount = frame ? resampler.convert(frame, outPlanes, maxSamplesCount)
+                                 : resampler.flush(outPlanes, maxSamplesCount);
+        CHECK(samplesCount >= 0, "AudioTrackDecoder::storeSamples() - resampling error");
+        
+        for (std::vector<uint8_t>& plane : segment.planes)
+            plane.resize(offset + samplesCount * bytesPerSample);
+        
+        // Streamed samples are handed out right away, the buffer is only reused for conversion
+        if (segment.handler)
+        {
+            if (samplesCount > 0)
+            {
+                segment.stopped = !segment.handler(reinterpret_cast<const sf::Int16*>(&segment.planes[0][0]),
+                                                   samplesCount * m_channelCount);
+            }
+            
+            segment.planes[0].clear();
+        }
+    }
+    
+    AVCodecContext* AudioTrackDecoder::createDecoder() const
+    {
+        const std::string codecName = avcodec_get_name(m_stream->codecpar->codec_id);
+        const AVCodec* codec = avcodec_find_decoder(m_stream->codecpar->codec_id);
+        CHECK(codec, "AudioTrackDecoder::createDecoder() - no decoder for " + codecName + " codec");
+        
+        AVCodecContext* context = avcodec_alloc_context3(codec);
+        CHECK(context, "AudioTrackDecoder::createDecoder() - unable to allocate codec context for codec " + codecName);
+        
+        int err = avcodec_parameters_to_context(context, m_stream->codecpar);
+        
+        if (err == 0)
+            err = avcodec_open2(context, codec, nullptr);
+        
+        if (err != 0)
+        {
+            avcodec_free_context(&context);
+            CHECK(false, "AudioTrackDecoder::createDecoder() - unable to load decoder for codec " + codecName);
+        }
+        
+        return context;
+    }
+}
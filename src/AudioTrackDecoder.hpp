@@ -0,0 +1,205 @@
+
+/*
+ *  AudioTrackDecoder.hpp
+ *  sfeMovie project
+ *
+ *  Copyright (C) 2010-2015 Lucas Soltic
+ *  lucas.soltic@orange.fr
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ *
+ */
+
+#ifndef SFEMOVIE_AUDIOTRACKDECODER_HPP
+#define SFEMOVIE_AUDIOTRACKDECODER_HPP
+
+#include <SFML/Config.hpp>
+#include <sfeMovie/AudioSettings.hpp>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+extern "C"
+{
+#include <libavformat/avformat.h>
+#include <libavcodec/avcodec.h>
+}
+
+namespace sfe
+{
+    class AudioResampler;
+    
+    /** Decode a whole audio stream at once, as fast as possible
+     *
+     * Unlike AudioStream, decoding isn't paced by a Timer. When all the samples are wanted at once,
+     * the encoded packets are read first, then long streams are split at packet boundaries and each
+     * part is decoded on its own thread, unless the sample rate needs to be converted. When the samples
+     * are streamed, each packet is decoded as soon as it is read.
+     * Samples are converted with the same AudioResampler setup as AudioStream, so the result
+     * sounds the same as when the stream is played
+     */
+    class AudioTrackDecoder
+    {
+    public:
+        /** Function given each chunk of decoded interleaved samples, it returns false to stop decoding
+         */
+        typedef std::function<bool(const sf::Int16* samples, std::size_t samplesCount)> SampleHandler;
+        
+        /** Open the given audio stream of a media file
+         *
+         * @param sourceFile the path of the media to decode
+         * @param streamIndex the index of the audio stream in the media
+         * @param settings the output sample rate and resampling algorithm to use
+         * @param interruption if not nullptr, opening, reading and decoding the media stop as soon as
+         * this flag is set, from any thread
+         */
+        AudioTrackDecoder(const std::string& sourceFile, int streamIndex,
+                          const AudioSettings& settings = AudioSettings(),
+                          std::shared_ptr<const std::atomic<bool> > interruption = nullptr);
+        
+        /** Default destructor
+         */
+        ~AudioTrackDecoder();
+        
+        /** Decode the whole audio stream
+         *
+         * A decoder reads its media once, so only one of the decode() methods can be called
+         *
+         * @param samples [out] the decoded interleaved signed 16 bits samples
+         */
+        void decode(std::vector<sf::Int16>& samples);
+        
+        /** Decode the whole audio stream into 32 bits float samples
+         *
+         * @see decode(std::vector<sf::Int16>&)
+         *
+         * @param samples [out] the decoded samples
+         * @param format FloatSamples or PlanarFloatSamples, the layout of @a samples
+         */
+        void decode(std::vector<float>& samples, SampleFormat format);
+        
+        /** Decode the whole audio stream on the calling thread, in order
+         *
+         * The packets are decoded while they are read and the samples are given to @a handler as soon
+         * as they are decoded, which gives the first samples early and allows processing long streams
+         * without keeping all of their samples in memory
+         *
+         * @param handler the function that receives the decoded samples
+         * @return true if the whole stream was decoded, false if @a handler stopped decoding or if
+         * decoding was interrupted
+         */
+        bool decode(const SampleHandler& handler);
+        
+        /** @return the channel count of the decoded samples
+         */
+        int getChannelCount() const;
+        
+        /** @return the sample rate of the decoded samples
+         */
+        int getSampleRate() const;
+        
+    private:
+        /** A contiguous range of packets decoded by a single thread
+         */
+        struct Segment
+        {
+            std::size_t begin;
+            std::size_t end;
+            SampleFormat format;
+            std::vector<std::vector<uint8_t> > planes; // A single plane unless the format is planar
+            SampleHandler handler;
+            bool stopped;
+            std::string error;
+        };
+        
+        /** Read all the encoded packets of the audio stream, then decode them into @a segments, in parallel
+         * when possible
+         *
+         * @param format the format of the decoded samples
+         * @param segments [out] the decoded parts of the stream, in order
+         */
+        void decodeSegments(SampleFormat format, std::vector<Segment>& segments);
+        
+        /** @return the size in bytes of the samples decoded into @a segments
+         */
+        static std::size_t getDecodedSize(const std::vector<Segment>& segments);
+        
+        /** Copy the samples decoded into @a segments to @a output, one plane after the other
+         */
+        static void copyDecodedSamples(const std::vector<Segment>& segments, uint8_t* output);
+        
+        /** Read all the encoded packets of the audio stream
+         */
+        void readPackets();
+        
+        /** @return the amount of segments the packets can be split into
+         */
+        std::size_t computeSegmentCount() const;
+        
+        /** Decode the packets of @a segment into its samples, or give them to its handler if it has one
+         *
+         * Packets surrounding the segment are decoded too so that the decoder state at the segment
+         * boundaries is the same as if the whole stream were decoded at once; only the frames whose
+         * timestamp falls within the segment are kept
+         *
+         * @param segment the segment to decode
+         */
+        void decodeSegment(Segment& segment) const;
+        
+        /** Send @a packet to the decoder and store the frames it gives back with storeSamples()
+         *
+         * Only the frames whose timestamp is within [@a beginPts, @a endPts) are stored, all of them
+         * are when this range is unbounded
+         *
+         * @param segment the segment being decoded
+         * @param context the decoder of the segment
+         * @param resampler the resampler of the segment
+         * @param frame the frame receiving the decoded audio
+         * @param packet the packet to decode, or nullptr to drain the decoder
+         */
+        void decodePacket(Segment& segment, AVCodecContext* context, AudioResampler& resampler, AVFrame* frame,
+                          const AVPacket* packet, int64_t beginPts, int64_t endPts) const;
+        
+        /** @return true if the interruption flag given on construction is set
+         */
+        bool interruptionRequested() const;
+        
+        /** Convert @a frame and append the result to the planes of @a segment, or give it to its handler
+         *
+         * @param segment the segment being decoded
+         * @param resampler the resampler of the segment
+         * @param frame the decoded audio, or nullptr to flush the resampler
+         */
+        void storeSamples(Segment& segment, AudioResampler& resampler, const AVFrame* frame) const;
+        
+        /** @return a new decoder for the audio stream, to be freed with avcodec_free_context()
+         */
+        AVCodecContext* createDecoder() const;
+        
+        AVFormatContext* m_formatCtx;
+        std::shared_ptr<const std::atomic<bool> > m_interruption;
+        AVStream* m_stream;
+        std::vector<AVPacket*> m_packets;
+        uint64_t m_channelLayout;
+        int m_channelCount;
+        int m_sampleRate;
+        AudioSettings m_settings;
+    };
+}
+
+#endif
@@ -0,0 +1,63 @@
+
+/*
+ *  Clock.cpp
+ *  sfeMovie project
+ *
+ *  Copyright (C) 2010-2015 Lucas Soltic
+ *  lucas.soltic@orange.fr
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ *
+ */
+
+#include <sfeMovie/Clock.hpp>
+
+namespace sfe
+{
+    Clock::~Clock()
+    {
+    }
+    
+    sf::Time SystemClock::getElapsedTime() const
+    {
+        return m_clock.getElapsedTime();
+    }
+    
+    sf::Time SystemClock::restart()
+    {
+        return m_clock.restart();
+    }
+    
+    ManualClock::ManualClock() :
+    m_elapsedMicroseconds(0)
+    {
+    }
+    
+    void ManualClock::advance(sf::Time duration)
+    {
+        if (duration > sf::Time::Zero)
+            m_elapsedMicroseconds += duration.asMicroseconds();
+    }
+    
+    sf::Time ManualClock::getElapsedTime() const
+    {
+        return sf::microseconds(m_elapsedMicroseconds.load());
+    }
+    
+    sf::Time ManualClock::restart()
+    {
+        return sf::microseconds(m_elapsedMicroseconds.exchange(0));
+    }
+}
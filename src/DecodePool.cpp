@@ -0,0 +1,252 @@
+
+/*
+ *  DecodePool.cpp
+ *  sfeMovie project
+ *
+ *  Copyright (C) 2010-2015 Lucas Soltic
+ *  lucas.soltic@orange.fr
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ *
+ */
+
+#include "DecodePool.hpp"
+#include "Log.hpp"
+#include <algorithm>
+#include <stdexcept>
+
+namespace sfe
+{
+    std::weak_ptr<DecodePool> DecodePool::g_sharedPool;
+    unsigned int DecodePool::g_sharedThreadCount = 0;
+    std::mutex DecodePool::g_sharedPoolMutex;
+    
+    std::shared_ptr<DecodePool> DecodePool::getShared()
+    {
+        std::lock_guard<std::mutex> lock(g_sharedPoolMutex);
+        std::shared_ptr<DecodePool> pool = g_sharedPool.lock();
+        
+        if (! pool)
+        {
+            pool = std::make_shared<DecodePool>(g_sharedThreadCount);
+            g_sharedPool = pool;
+        }
+        
+        return pool;
+    }
+    
+    void DecodePool::setSharedThreadCount(unsigned int threadCount)
+    {
+        std::lock_guard<std::mutex> lock(g_sharedPoolMutex);
+        g_sharedThreadCount = threadCount;
+    }
+    
+    DecodePool::DecodePool(unsigned int threadCount) :
+    m_workers(),
+    m_nextSequence(0),
+    m_pendingJobs(0),
+    m_stopRequested(false),
+    m_sleepMutex(),
+    m_sleepCondition()
+    {
+        if (threadCount == 0)
+            threadCount = std::max(1u, std::thread::hardware_concurrency());
+        
+        for (unsigned int i = 0; i < threadCount; i++)
+            m_workers.push_back(std::unique_ptr<Worker>(new Worker));
+        
+        // Start the threads only once all the queues exist, as they look into each other's queues
+        for (std::size_t i = 0; i < m_workers.size(); i++)
+            m_workers[i]->thread = std::thread(&DecodePool::run, this, i);
+        
+        sfeLogDebug("Started decoding pool with " + s(threadCount) + " threads");
+    }
+    
+    DecodePool::~DecodePool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_sleepMutex);
+            m_stopRequested = true;
+        }
+        
+        m_sleepCondition.notify_all();
+        
+        for (std::unique_ptr<Worker>& worker : m_workers)
+            worker->thread.join();
+    }
+    
+    DecodePool::JobId DecodePool::schedule(Task task, int priority)
+    {
+        Job job;
+        job.task = task;
+        job.priority = priority;
+        job.sequence = m_nextSequence++;
+        
+        // Keep the work of a pool thread on this thread, spread the work of other threads
+        std::size_t target = static_cast<std::size_t>(job.sequence % m_workers.size());
+        
+        for (std::size_t i = 0; i < m_workers.size(); i++)
+        {
+            if (m_workers[i]->thread.get_id() == std::this_thread::get_id())
+            {
+                target = i;
+                break;
+            }
+        }
+        
+        // Count the job before it can be taken, so that the count never goes below zero
+        {
+            std::lock_guard<std::mutex> lock(m_sleepMutex);
+            m_pendingJobs++;
+        }
+        
+        {
+            std::lock_guard<std::mutex> lock(m_workers[target]->mutex);
+            m_workers[target]->jobs.push_back(job);
+        }
+        
+        m_sleepCondition.notify_one();
+        return job.sequence;
+    }
+    
+    bool DecodePool::cancel(JobId identifier)
+    {
+        for (std::unique_ptr<Worker>& worker : m_workers)
+        {
+            std::lock_guard<std::mutex> lock(worker->mutex);
+            
+            for (std::vector<Job>::iterator it = worker->jobs.begin(); it != worker->jobs.end(); ++it)
+            {
+                if (it->sequence == identifier)
+                {
+                    worker->jobs.erase(it);
+                    
+                    std::lock_guard<std::mutex> sleepLock(m_sleepMutex);
+                    m_pendingJobs--;
+                    return true;
+                }
+            }
+        }
+        
+        return false;
+    }
+    
+    unsigned int DecodePool::getThreadCount() const
+    {
+        return static_cast<unsigned int>(m_workers.size());
+    }
+    
+    void DecodePool::run(std::size_t index)
+    {
+        while (true)
+        {
+            Job job;
+            
+            if (takeJob(index, job))
+            {
+                {
+                    std::lock_guard<std::mutex> lock(m_sleepMutex);
+                    m_pendingJobs--;
+                }
+                
+                try
+                {
+                    job.task();
+                }
+                catch (std::exception& e)
+                {
+                    sfeLogError("DecodePool - " + std::string(e.what()));
+                }
+                
+                continue;
+            }
+            
+            std::unique_lock<std::mutex> lock(m_sleepMutex);
+            m_sleepCondition.wait(lock, [this]() { return m_stopRequested || m_pendingJobs > 0; });
+            
+            if (m_stopRequested)
+                return;
+        }
+    }
+    
+    bool DecodePool::takeJob(std::size_t index, Job& job)
+    {
+        while (true)
+        {
+            std::size_t bestQueue = m_workers.size();
+            int bestPriority = 0;
+            
+            // The own queue is looked at first, so that it wins among tasks of equal priority
+            for (std::size_t i = 0; i < m_workers.size(); i++)
+            {
+                const std::size_t queue = (index + i) % m_workers.size();
+                std::lock_guard<std::mutex> lock(m_workers[queue]->mutex);
+                
+                if (m_workers[queue]->jobs.empty())
+                    continue;
+                
+                const int priority = findBestJob(m_workers[queue]->jobs)->priority;
+                
+                if (bestQueue == m_workers.size() || priority > bestPriority)
+                {
+                    bestQueue = queue;
+                    bestPriority = priority;
+                }
+            }
+            
+            if (bestQueue == m_workers.size())
+                return false;
+            
+            // Another thread may have taken the task meanwhile, then look again
+            if (takeJobFrom(bestQueue, bestPriority, job))
+                return true;
+        }
+    }
+    
+    bool DecodePool::takeJobFrom(std::size_t queue, int minPriority, Job& job)
+    {
+        Worker& worker = *m_workers[queue];
+        std::lock_guard<std::mutex> lock(worker.mutex);
+        
+        if (worker.jobs.empty())
+            return false;
+        
+        std::vector<Job>::iterator best = findBestJob(worker.jobs);
+        
+        if (best->priority < minPriority)
+            return false;
+        
+        job = std::move(*best);
+        worker.jobs.erase(best);
+        return true;
+    }
+    
+    std::vector<DecodePool::Job>::iterator DecodePool::findBestJob(std::vector<Job>& jobs)
+    {
+        // Queues hold at most a few tasks per media, a linear search is cheaper than keeping them sorted
+        std::vector<Job>::iterator best = jobs.begin();
+        
+        for (std::vector<Job>::iterator it = jobs.begin(); it != jobs.end(); ++it)
+        {
+            if (it->priority > best->priority ||
+                (it->priority == best->priority && it->sequence < best->sequence))
+            {
+                best = it;
+            }
+        }
+        
+        return best;
+    }
+}
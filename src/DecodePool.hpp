@@ -0,0 +1,153 @@
+
+/*
+ *  DecodePool.hpp
+ *  sfeMovie project
+ *
+ *  Copyright (C) 2010-2015 Lucas Soltic
+ *  lucas.soltic@orange.fr
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ *
+ */
+
+#ifndef SFEMOVIE_DECODEPOOL_HPP
+#define SFEMOVIE_DECODEPOOL_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <stdint.h>
+
+namespace sfe
+{
+    /** Fixed-size set of threads that run the decoding work of several medias
+     *
+     * Each worker has its own queue of tasks. Priorities apply to the whole pool: a worker runs the
+     * task with the highest priority of all the queues, and prefers its own queue among tasks of
+     * equal priority so that related work stays on the same core.
+     *
+     * Only video streams use it: their tasks read packets from the demuxer when their queue runs
+     * out, then decode and convert frames. Audio streams keep their dedicated thread because it
+     * blocks while the audio device drains its buffer, which would hold a worker.
+     */
+    class DecodePool
+    {
+    public:
+        typedef std::function<void()> Task;
+        
+        /** Identifies a task queued with schedule()
+         */
+        typedef uint64_t JobId;
+        
+        /** Return the pool shared by all the medias of the process, creating it if needed
+         *
+         * The shared pool is destroyed once no media uses it anymore
+         */
+        static std::shared_ptr<DecodePool> getShared();
+        
+        /** Set how many threads the shared pool will have
+         *
+         * This takes effect the next time the shared pool is created
+         *
+         * @param threadCount the thread count, or 0 to use one thread per core
+         */
+        static void setSharedThreadCount(unsigned int threadCount);
+        
+        /** Start the pool threads
+         *
+         * @param threadCount the thread count, or 0 to use one thread per core
+         */
+        explicit DecodePool(unsigned int threadCount);
+        
+        /** Default destructor, waits for the running tasks and drops the pending ones
+         */
+        ~DecodePool();
+        
+        /** Queue a task to run on one of the pool threads
+         *
+         * When called from a pool thread, the task is queued to this thread so that related
+         * work stays on the same core unless another thread is idle
+         *
+         * @param task the work to do
+         * @param priority the tasks with the highest value are run first
+         * @return an identifier that can be given to cancel()
+         */
+        JobId schedule(Task task, int priority = 0);
+        
+        /** Remove a task that no thread started yet
+         *
+         * @param identifier the identifier returned by schedule()
+         * @return true if the task was removed and will never run, false if it already started
+         */
+        bool cancel(JobId identifier);
+        
+        /** @return the number of threads of this pool
+         */
+        unsigned int getThreadCount() const;
+        
+    private:
+        struct Job
+        {
+            Task task;
+            int priority;
+            uint64_t sequence;
+        };
+        
+        struct Worker
+        {
+            std::mutex mutex;
+            std::vector<Job> jobs;
+            std::thread thread;
+        };
+        
+        /** Run the tasks of all the queues for worker @a index, until the pool is destroyed
+         */
+        void run(std::size_t index);
+        
+        /** Take the task with the highest priority of all the queues for worker @a index
+         *
+         * @return true if a task was found and moved to @a job
+         */
+        bool takeJob(std::size_t index, Job& job);
+        
+        /** Take the task with the highest priority from the queue of worker @a queue, if its priority
+         * is at least @a minPriority
+         *
+         * @return true if a task was found and moved to @a job
+         */
+        bool takeJobFrom(std::size_t queue, int minPriority, Job& job);
+        
+        /** @return the task of @a jobs to run first, @a jobs must not be empty
+         */
+        static std::vector<Job>::iterator findBestJob(std::vector<Job>& jobs);
+        
+        std::vector<std::unique_ptr<Worker> > m_workers;
+        std::atomic<uint64_t> m_nextSequence;
+        std::size_t m_pendingJobs;
+        bool m_stopRequested;
+        std::mutex m_sleepMutex;
+        std::condition_variable m_sleepCondition;
+        
+        static std::weak_ptr<DecodePool> g_sharedPool;
+        static unsigned int g_sharedThreadCount;
+        static std::mutex g_sharedPoolMutex;
+    };
+}
+
+#endif
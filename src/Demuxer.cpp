@@ -33,9 +33,12 @@ extern "C"
 #include "Demuxer.hpp"
 #include "VideoStream.hpp"
 #include "AudioStream.hpp"
+#include "SubtitleStream.hpp"
 #include "Log.hpp"
 #include "Utilities.hpp"
 #include "TimerPriorities.hpp"
+#include <algorithm>
+#include <cstring>
 #include <iostream>
 #include <stdexcept>
 
@@ -49,16 +52,45 @@ namespace sfe
         ONCE(Log::initialize());
     }
     
+    /** AVFormatContext interrupt callback, @a opaque is the interruption flag of the demuxer
+     */
+    static int isInterrupted(void* opaque)
+    {
+        return *static_cast<const std::atomic<bool>*>(opaque) ? 1 : 0;
+    }
+    
     static MediaType AVMediaTypeToMediaType(AVMediaType type)
     {
         switch (type)
         {
             case AVMEDIA_TYPE_AUDIO:    return Audio;
             case AVMEDIA_TYPE_VIDEO:    return Video;
+            case AVMEDIA_TYPE_SUBTITLE: return Subtitle;
             default:                    return Unknown;
         }
     }
     
+    // How far after the playback position a new audio stream takes over, the time it has to decode.
+    // Kept under the duration of the audio chunks given to the device, so that a switch never takes longer
+    static const sf::Time AudioSwitchLead = sf::milliseconds(50);
+    
+    // Most packets kept for each audio stream that is not selected
+    static const std::size_t StandbyPacketLimit = 512;
+    
+    /** @return the media position at which the content of @a packet ends
+     */
+    static sf::Time packetEndPosition(const AVPacket* packet, const AVStream* stream)
+    {
+        int64_t timestamp = packet->pts != AV_NOPTS_VALUE ? packet->pts : packet->dts;
+        
+        if (timestamp == AV_NOPTS_VALUE)
+            return sf::Time::Zero;
+        
+        int64_t startTime = stream->start_time != AV_NOPTS_VALUE ? stream->start_time : 0;
+        AVRational seconds = av_mul_q(av_make_q(timestamp - startTime + packet->duration, 1), stream->time_base);
+        return sf::microseconds(static_cast<sf::Int64>(1000000 * av_q2d(seconds)));
+    }
+    
     const std::list<Demuxer::DemuxerInfo>& Demuxer::getAvailableDemuxers()
     {
         void* iter = nullptr;
@@ -107,8 +139,10 @@ namespace sfe
     }
     
     Demuxer::Demuxer(const std::string& sourceFile, std::shared_ptr<Timer> timer,
-                     VideoStream::Delegate& videoDelegate) :
+                     VideoStream::Delegate& videoDelegate, const AudioSettings& audioSettings,
+                     std::shared_ptr<const std::atomic<bool> > interruption) :
     m_formatCtx(nullptr),
+    m_interruption(interruption),
     m_eofReached(false),
     m_streams(),
     m_ignoredStreams(),
@@ -116,7 +150,20 @@ namespace sfe
     m_timer(timer),
     m_connectedAudioStream(nullptr),
     m_connectedVideoStream(nullptr),
-    m_duration(sf::Time::Zero)
+    m_connectedSubtitleStream(nullptr),
+    m_switchingAudioStream(nullptr),
+    m_audioSwitchPosition(sf::Time::Zero),
+    m_standbyAudioPackets(),
+    m_duration(sf::Time::Zero),
+    m_audioMasterClock(false),
+    m_pendingDataForActiveStreams(),
+    m_packetArena(nullptr),
+    m_cachedPackets(),
+    m_cachedKeyFrames(),
+    m_nextCachedPacket(0),
+    m_recycledPackets(),
+    m_recycledPacketsMutex(),
+    m_allocatedPacketCount(0)
     {
         CHECK(sourceFile.size(), "Demuxer::Demuxer() - invalid argument: sourceFile");
         CHECK(timer, "Inconsistency error: null timer");
@@ -125,6 +172,15 @@ namespace sfe
         
         initialize();
         
+        // Checked by FFmpeg while it waits for I/O, so that opening a slow media can be aborted
+        if (m_interruption)
+        {
+            m_formatCtx = avformat_alloc_context();
+            CHECK(m_formatCtx, "Demuxer::Demuxer() - avformat_alloc_context() error");
+            m_formatCtx->interrupt_callback.callback = isInterrupted;
+            m_formatCtx->interrupt_callback.opaque = const_cast<std::atomic<bool>*>(m_interruption.get());
+        }
+        
         // Open the movie file
         err = avformat_open_input(&m_formatCtx, sourceFile.c_str(), nullptr, nullptr);
         CHECK0(err, "Demuxer::Demuxer() - error while opening media: " + sourceFile);
@@ -166,7 +222,7 @@ namespace sfe
                         break;
                         
                     case AVMEDIA_TYPE_AUDIO:
-                        stream = std::make_shared<AudioStream>(m_formatCtx, ffstream, *this, timer);
+                        stream = std::make_shared<AudioStream>(m_formatCtx, ffstream, *this, timer, audioSettings);
                         
                         if (m_duration == sf::Time::Zero)
                         {
@@ -175,6 +231,12 @@ namespace sfe
                         
                         sfeLogDebug("Loaded " + avcodec_get_name(ffstream->codecpar->codec_id) + " audio stream");
                         break;
+                        
+                    case AVMEDIA_TYPE_SUBTITLE:
+                        stream = std::make_shared<SubtitleStream>(m_formatCtx, ffstream, *this, timer);
+                        
+                        sfeLogDebug("Loaded " + avcodec_get_name(ffstream->codecpar->codec_id) + " subtitle stream");
+                        break;
                     default:
                         m_ignoredStreams[ffstream->index] = Stream::AVStreamDescription(ffstream);
                         sfeLogDebug(m_ignoredStreams[ffstream->index] + " ignored");
@@ -215,6 +277,8 @@ namespace sfe
         m_streams.clear();
         m_connectedAudioStream.reset();
         m_connectedVideoStream.reset();
+        m_connectedSubtitleStream.reset();
+        m_switchingAudioStream.reset();
         
         if (m_formatCtx)
         {
@@ -223,6 +287,12 @@ namespace sfe
         }
         
         flushBuffers();
+        
+        for (AVPacket* packet : m_recycledPackets)
+            av_free(packet);
+        
+        // Packets still referencing the packet cache keep their own reference to it
+        av_buffer_unref(&m_packetArena);
     }
     
     const std::map<int, std::shared_ptr<Stream> >& Demuxer::getStreams() const
@@ -266,11 +336,14 @@ namespace sfe
     void Demuxer::selectAudioStream(std::shared_ptr<AudioStream> stream)
     {
         Status oldStatus = m_timer->getStatus();
-        CHECK(oldStatus == Stopped, "Changing the selected stream after starting "
-              "the movie playback isn't supported yet");
+        CHECK(oldStatus != Paused, "Changing the selected audio stream while the movie playback "
+              "is paused isn't supported yet");
         
         if (oldStatus == Playing)
-            m_timer->pause();
+        {
+            switchAudioStream(stream);
+            return;
+        }
         
         if (stream != m_connectedAudioStream)
         {
@@ -285,8 +358,18 @@ namespace sfe
             m_connectedAudioStream = stream;
         }
         
-        if (oldStatus == Playing)
-            m_timer->play();
+        // The packets read while the stream wasn't selected are the ones it starts from
+        if (stream)
+        {
+            sf::Lock l(m_synchronized);
+            PacketQueue& standbyPackets = m_standbyAudioPackets[stream.get()];
+            
+            while (! standbyPackets.empty())
+            {
+                stream->pushEncodedData(standbyPackets.front());
+                standbyPackets.pop_front();
+            }
+        }
     }
     
     void Demuxer::selectFirstAudioStream()
@@ -339,6 +422,31 @@ namespace sfe
         return std::dynamic_pointer_cast<VideoStream>(m_connectedVideoStream);
     }
     
+    void Demuxer::selectSubtitleStream(std::shared_ptr<SubtitleStream> stream)
+    {
+        Status oldStatus = m_timer->getStatus();
+        CHECK(oldStatus == Stopped, "Changing the selected stream after starting "
+              "the movie playback isn't supported yet");
+        
+        if (stream != m_connectedSubtitleStream)
+        {
+            if (m_connectedSubtitleStream)
+            {
+                m_connectedSubtitleStream->disconnect();
+            }
+            
+            if (stream)
+                stream->connect();
+            
+            m_connectedSubtitleStream = stream;
+        }
+    }
+    
+    std::shared_ptr<SubtitleStream> Demuxer::getSelectedSubtitleStream() const
+    {
+        return std::dynamic_pointer_cast<SubtitleStream>(m_connectedSubtitleStream);
+    }
+    
     void Demuxer::feedStream(Stream& stream)
     {
         CHECK(! stream.isPassive(), "Internal inconcistency - Cannot feed a passive stream");
@@ -362,7 +470,7 @@ namespace sfe
             {
                 if (!distributePacket(pkt, stream))
                 {
-                    av_packet_unref(pkt);
+                    recyclePacket(pkt);
                 }
             }
         }
@@ -378,19 +486,44 @@ namespace sfe
         if (m_connectedAudioStream)
             set.insert(m_connectedAudioStream);
         
+        if (m_connectedSubtitleStream)
+            set.insert(m_connectedSubtitleStream);
+        
         return set;
     }
     
     void Demuxer::update()
     {
-        std::map<int, std::shared_ptr<Stream> > streams = getStreams();
+        if (m_switchingAudioStream)
+            spliceAudioStream();
+        
+        // Synchronize first so that the streams are updated against the corrected timer
+        std::shared_ptr<AudioStream> audioStream = getSelectedAudioStream();
+        sf::Time audioPosition;
+        
+        if (m_audioMasterClock && audioStream && audioStream->getPlaybackPosition(audioPosition))
+            m_timer->synchronize(audioPosition);
         
-        for(std::pair<int, std::shared_ptr<Stream> > pair : streams)
+        // Let the streams whose work is due know about it
+        m_timer->processWakeUps();
+        
+        // Iterated in place: copying the streams would allocate on every update
+        for (const std::pair<const int, std::shared_ptr<Stream> >& pair : m_streams)
         {
             pair.second->update();
         }
     }
     
+    void Demuxer::setAudioMasterClock(bool enabled)
+    {
+        m_audioMasterClock = enabled;
+    }
+    
+    bool Demuxer::getAudioMasterClock() const
+    {
+        return m_audioMasterClock;
+    }
+    
     bool Demuxer::didReachEndOfFile() const
     {
         return m_eofReached;
@@ -401,68 +534,258 @@ namespace sfe
         return m_duration;
     }
     
+    bool Demuxer::loadPacketCache(std::size_t maxSize)
+    {
+        sf::Lock l(m_synchronized);
+        CHECK(m_timer->getStatus() == Stopped && ! m_packetArena,
+              "Demuxer::loadPacketCache() - the packets must be cached before playing");
+        
+        // Don't read anything when the file alone doesn't fit
+        if (m_formatCtx->pb && avio_size(m_formatCtx->pb) > static_cast<int64_t>(maxSize))
+            return false;
+        
+        std::vector<AVPacket*> packets;
+        std::size_t arenaSize = 0;
+        bool fits = true;
+        AVPacket* packet = nullptr;
+        
+        while (fits && (packet = readPacket()) != nullptr)
+        {
+            packets.push_back(packet);
+            arenaSize += packet->size + AV_INPUT_BUFFER_PADDING_SIZE;
+            
+            // The packets side data is not cached
+            fits = arenaSize <= maxSize && packet->side_data_elems == 0;
+        }
+        
+        if (fits && ! packets.empty())
+        {
+            m_packetArena = av_buffer_allocz(arenaSize);
+            CHECK(m_packetArena, "Demuxer::loadPacketCache() - out of memory");
+            
+            std::size_t offset = 0;
+            
+            for (AVPacket* source : packets)
+            {
+                const CachedPacket cached =
+                {
+                    offset, source->size, source->pts, source->dts, source->duration, source->stream_index, source->flags
+                };
+                
+                std::memcpy(m_packetArena->data + offset, source->data, source->size);
+                offset += source->size + AV_INPUT_BUFFER_PADDING_SIZE;
+                
+                // Positioned the same way as Stream::computeEncodedPosition() does
+                if ((cached.flags & AV_PKT_FLAG_KEY) && cached.streamIndex < static_cast<int>(m_formatCtx->nb_streams))
+                {
+                    const AVStream* stream = m_formatCtx->streams[cached.streamIndex];
+                    int64_t timestamp = cached.dts;
+                    
+                    if (timestamp == AV_NOPTS_VALUE && cached.pts != AV_NOPTS_VALUE)
+                        timestamp = cached.pts - (stream->start_time != AV_NOPTS_VALUE ? stream->start_time : 0);
+                    
+                    if (timestamp != AV_NOPTS_VALUE)
+                    {
+                        AVRational seconds = av_mul_q(av_make_q(timestamp, 1), stream->time_base);
+                        m_cachedKeyFrames[cached.streamIndex].push_back(std::make_pair(sf::microseconds(1000000 * av_q2d(seconds)),
+                                                                                       m_cachedPackets.size()));
+                    }
+                }
+                
+                m_cachedPackets.push_back(cached);
+            }
+            
+            for (std::pair<const int, KeyFrameIndex>& pair : m_cachedKeyFrames)
+                std::stable_sort(pair.second.begin(), pair.second.end());
+        }
+        
+        for (AVPacket* source : packets)
+            recyclePacket(source);
+        
+        m_eofReached = false;
+        
+        if (! m_packetArena)
+        {
+            sfeLogDebug("The packets don't fit in the packet cache, reading the media from its beginning again");
+            
+            int64_t timestamp = 0;
+            
+            if (m_formatCtx->iformat->flags & AVFMT_SEEK_TO_PTS && m_formatCtx->start_time != AV_NOPTS_VALUE)
+                timestamp += m_formatCtx->start_time;
+            
+            int err = avformat_seek_file(m_formatCtx, -1, INT64_MIN, timestamp, INT64_MAX, AVSEEK_FLAG_BACKWARD);
+            CHECK0(err, "Demuxer::loadPacketCache() - error while seeking back to the beginning");
+            return false;
+        }
+        
+        sfeLogDebug("Cached " + s(m_cachedPackets.size()) + " packets, " + s(arenaSize) + " bytes");
+        m_nextCachedPacket = 0;
+        return true;
+    }
+    
+    bool Demuxer::hasPacketCache() const
+    {
+        return m_packetArena != nullptr;
+    }
+    
+    std::size_t Demuxer::getAllocatedPacketCount() const
+    {
+        sf::Lock l(m_recycledPacketsMutex);
+        return m_allocatedPacketCount;
+    }
+    
+    AVPacket* Demuxer::allocatePacket()
+    {
+        {
+            sf::Lock l(m_recycledPacketsMutex);
+            
+            if (! m_recycledPackets.empty())
+            {
+                AVPacket* packet = m_recycledPackets.back();
+                m_recycledPackets.pop_back();
+                return packet;
+            }
+            
+            m_allocatedPacketCount++;
+        }
+        
+        AVPacket* packet = (AVPacket *)av_malloc(sizeof(*packet));
+        CHECK(packet, "Demuxer::allocatePacket() - out of memory");
+        av_init_packet(packet);
+        packet->data = nullptr;
+        packet->size = 0;
+        return packet;
+    }
+    
+    void Demuxer::recyclePacket(AVPacket* packet)
+    {
+        av_packet_unref(packet);
+        
+        sf::Lock l(m_recycledPacketsMutex);
+        m_recycledPackets.push_back(packet);
+    }
+    
     AVPacket* Demuxer::readPacket()
     {
         sf::Lock l(m_synchronized);
         
+        if (m_packetArena)
+            return readCachedPacket();
+        
         AVPacket *pkt = nullptr;
         int err = 0;
         
-        pkt = (AVPacket *)av_malloc(sizeof(*pkt));
-        CHECK(pkt, "Demuxer::readPacket() - out of memory");
-        av_init_packet(pkt);
-        
+        pkt = allocatePacket();
         err = av_read_frame(m_formatCtx, pkt);
         
         if (err < 0)
         {
-            av_packet_unref(pkt);
+            recyclePacket(pkt);
             pkt = nullptr;
         }
         
         return pkt;
     }
     
+    AVPacket* Demuxer::readCachedPacket()
+    {
+        if (m_nextCachedPacket >= m_cachedPackets.size())
+            return nullptr;
+        
+        const CachedPacket& cached = m_cachedPackets[m_nextCachedPacket++];
+        AVPacket* pkt = allocatePacket();
+        
+        // The packet references the packet cache rather than copying its data
+        pkt->buf = av_buffer_ref(m_packetArena);
+        CHECK(pkt->buf, "Demuxer::readCachedPacket() - out of memory");
+        
+        pkt->data = m_packetArena->data + cached.offset;
+        pkt->size = cached.size;
+        pkt->pts = cached.pts;
+        pkt->dts = cached.dts;
+        pkt->duration = cached.duration;
+        pkt->stream_index = cached.streamIndex;
+        pkt->flags = cached.flags;
+        return pkt;
+    }
+    
+    void Demuxer::seekPacketCache(sf::Time position)
+    {
+        std::size_t next = m_cachedPackets.size();
+        
+        for (const std::pair<const int, std::shared_ptr<Stream> >& pair : m_streams)
+        {
+            const std::shared_ptr<Stream>& stream = pair.second;
+            
+            if ((stream != m_connectedVideoStream && stream != m_connectedAudioStream) ||
+                stream->isPassive() || ! stream->usesPackets())
+                continue;
+            
+            // The last key frame at or before position, the stream then fast forwards up to position
+            const KeyFrameIndex& keyFrames = m_cachedKeyFrames[pair.first];
+            KeyFrameIndex::const_iterator it = std::upper_bound(keyFrames.begin(), keyFrames.end(), position,
+                                                                [](sf::Time time, const std::pair<sf::Time, std::size_t>& keyFrame)
+            {
+                return time < keyFrame.first;
+            });
+            
+            next = std::min(next, it == keyFrames.begin() ? 0 : (it - 1)->second);
+        }
+        
+        m_nextCachedPacket = next < m_cachedPackets.size() ? next : 0;
+    }
+    
     void Demuxer::flushBuffers()
     {
         sf::Lock l(m_synchronized);
         
-        for (std::pair<const Stream*, std::list<AVPacket*> >&& pair : m_pendingDataForActiveStreams)
+        for (std::pair<const Stream* const, PacketQueue>& pair : m_pendingDataForActiveStreams)
         {
-            for (AVPacket* packet : pair.second)
+            while (! pair.second.empty())
             {
-                av_packet_unref(packet);
+                recyclePacket(pair.second.front());
+                pair.second.pop_front();
             }
         }
         
         m_pendingDataForActiveStreams.clear();
+        
+        for (std::pair<const Stream* const, PacketQueue>& pair : m_standbyAudioPackets)
+        {
+            while (! pair.second.empty())
+            {
+                recyclePacket(pair.second.front());
+                pair.second.pop_front();
+            }
+        }
     }
     
     void Demuxer::queueEncodedData(AVPacket* packet)
     {
         sf::Lock l(m_synchronized);
         
-        std::set<std::shared_ptr<Stream>> connectedStreams = getSelectedStreams();
+        // Called for most packets, so the selected streams are not gathered in a new set
+        const std::shared_ptr<Stream> connectedStreams[] = { m_connectedVideoStream, m_connectedAudioStream,
+                                                             m_switchingAudioStream };
         
-        for (std::shared_ptr<Stream> stream : connectedStreams)
+        for (const std::shared_ptr<Stream>& stream : connectedStreams)
         {
-            if (stream->canUsePacket(packet))
+            if (stream && stream->canUsePacket(packet))
             {
-                std::list<AVPacket*>& packets = m_pendingDataForActiveStreams[stream.get()];
-                packets.push_back(packet);
+                m_pendingDataForActiveStreams[stream.get()].push_back(packet);
                 return;
             }
         }
         
         sfeLogError("No stream can use the packet, destroying it");
-        av_packet_unref(packet);
+        recyclePacket(packet);
     }
     
     bool Demuxer::hasPendingDataForStream(const Stream& stream) const
     {
         sf::Lock l(m_synchronized);
         
-        const std::map<const Stream*, std::list<AVPacket*> >::const_iterator it =
+        const std::map<const Stream*, PacketQueue>::const_iterator it =
             m_pendingDataForActiveStreams.find(&stream);
         
         if (it != m_pendingDataForActiveStreams.end())
@@ -475,12 +798,12 @@ namespace sfe
     {
         sf::Lock l(m_synchronized);
         
-        std::map<const Stream*, std::list<AVPacket*> >::iterator it
+        std::map<const Stream*, PacketQueue>::iterator it
             = m_pendingDataForActiveStreams.find(&stream);
         
         if (it != m_pendingDataForActiveStreams.end())
         {
-            std::list<AVPacket*>& pendingPackets = it->second;
+            PacketQueue& pendingPackets = it->second;
             
             if (! pendingPackets.empty())
             {
@@ -505,10 +828,11 @@ namespace sfe
         {
              std::shared_ptr<Stream>  targetStream = it->second;
             
-            // We don't want to store the packets for inactive streams,
-            // let them be freed
-            if (targetStream == getSelectedVideoStream() ||
-                targetStream == getSelectedAudioStream())
+            // We don't want to store the packets for inactive streams or
+            // streams that don't decode them, let them be freed
+            if ((targetStream == m_connectedVideoStream || targetStream == m_connectedAudioStream ||
+                 targetStream == m_connectedSubtitleStream || targetStream == m_switchingAudioStream) &&
+                targetStream->usesPackets())
             {
                 if (targetStream.get() == &stream || targetStream->isPassive())
                     targetStream->pushEncodedData(packet);
@@ -517,6 +841,12 @@ namespace sfe
                 
                 distributed = true;
             }
+            else if (m_connectedAudioStream && targetStream->getStreamKind() == Audio)
+            {
+                // Only needed to switch from an audio stream to another one
+                keepStandbyPacket(packet, *targetStream);
+                distributed = true;
+            }
         }
         
         return distributed;
@@ -536,6 +866,158 @@ namespace sfe
         }
     }
     
+    void Demuxer::keepStandbyPacket(AVPacket* packet, const Stream& stream)
+    {
+        sf::Lock l(m_synchronized);
+        
+        const AVStream* ffstream = m_formatCtx->streams[packet->stream_index];
+        const sf::Time position = m_timer->getOffset();
+        PacketQueue& standbyPackets = m_standbyAudioPackets[&stream];
+        standbyPackets.push_back(packet);
+        
+        // Only the audio that is not played yet is needed to switch to this stream
+        while (! standbyPackets.empty() &&
+               (standbyPackets.size() > StandbyPacketLimit ||
+                packetEndPosition(standbyPackets.front(), ffstream) < position))
+        {
+            recyclePacket(standbyPackets.front());
+            standbyPackets.pop_front();
+        }
+    }
+    
+    void Demuxer::switchAudioStream(std::shared_ptr<AudioStream> stream)
+    {
+        if (stream == m_switchingAudioStream)
+            return;
+        
+        cancelAudioSwitch();
+        
+        if (stream == m_connectedAudioStream)
+            return;
+        
+        // Disabling audio doesn't need to wait for anything
+        if (! stream)
+        {
+            std::shared_ptr<AudioStream> oldStream = getSelectedAudioStream();
+            oldStream->spliceOut();
+            oldStream->disconnect();
+            
+            sf::Lock l(m_synchronized);
+            m_connectedAudioStream.reset();
+            return;
+        }
+        
+        {
+            sf::Lock l(m_synchronized);
+            m_switchingAudioStream = stream;
+            m_audioSwitchPosition = m_timer->getOffset() + AudioSwitchLead;
+            
+            // The media was read ahead of the playback, the packets of the new stream that were read
+            // meanwhile are the ones it starts from
+            PacketQueue& standbyPackets = m_standbyAudioPackets[stream.get()];
+            
+            while (! standbyPackets.empty())
+            {
+                stream->pushEncodedData(standbyPackets.front());
+                standbyPackets.pop_front();
+            }
+        }
+        
+        if (! stream->warmUp(m_audioSwitchPosition))
+        {
+            sfeLogError("Demuxer::switchAudioStream() - could not find the audio to switch to at "
+                        + s(m_audioSwitchPosition.asSeconds()) + "s");
+            cancelAudioSwitch();
+        }
+    }
+    
+    void Demuxer::spliceAudioStream()
+    {
+        std::shared_ptr<AudioStream> newStream = std::static_pointer_cast<AudioStream>(m_switchingAudioStream);
+        const sf::Time position = m_timer->getOffset();
+        
+        // Until the new stream is ready the current one keeps playing, so there's never a gap
+        if (m_timer->getStatus() != Playing || m_timer->isStarting() || position < m_audioSwitchPosition ||
+            ! newStream->canSpliceIn(position))
+            return;
+        
+        // The new stream starts before the old one stops, the old one's decoding must stop while its
+        // packets are still distributed to it
+        newStream->connect();
+        newStream->spliceIn(position);
+        
+        std::shared_ptr<AudioStream> oldStream = getSelectedAudioStream();
+        
+        if (oldStream)
+        {
+            oldStream->spliceOut();
+            oldStream->disconnect();
+        }
+        
+        sf::Lock l(m_synchronized);
+        m_connectedAudioStream = newStream;
+        m_switchingAudioStream.reset();
+        
+        // The packets read for the old stream are kept in case playback switches back to it
+        if (oldStream)
+        {
+            PacketQueue& pendingPackets = m_pendingDataForActiveStreams[oldStream.get()];
+            
+            while (! pendingPackets.empty())
+            {
+                AVPacket* packet = pendingPackets.front();
+                pendingPackets.pop_front();
+                keepStandbyPacket(packet, *oldStream);
+            }
+        }
+        
+        sfeLogDebug("Switched audio stream at " + s(position.asSeconds()) + "s");
+    }
+    
+    void Demuxer::cancelAudioSwitch()
+    {
+        if (! m_switchingAudioStream)
+            return;
+        
+        // Its decoding must stop while its packets are still distributed to it
+        std::static_pointer_cast<AudioStream>(m_switchingAudioStream)->spliceOut();
+        
+        sf::Lock l(m_synchronized);
+        PacketQueue& pendingPackets = m_pendingDataForActiveStreams[m_switchingAudioStream.get()];
+        
+        while (! pendingPackets.empty())
+        {
+            recyclePacket(pendingPackets.front());
+            pendingPackets.pop_front();
+        }
+        
+        m_switchingAudioStream.reset();
+    }
+    
+    void Demuxer::commitAudioSwitch()
+    {
+        if (! m_switchingAudioStream)
+            return;
+        
+        std::shared_ptr<AudioStream> newStream = std::static_pointer_cast<AudioStream>(m_switchingAudioStream);
+        std::shared_ptr<AudioStream> oldStream = getSelectedAudioStream();
+        
+        // Seeking decodes the new stream again from the new position
+        newStream->spliceOut();
+        
+        if (oldStream)
+        {
+            oldStream->spliceOut();
+            oldStream->disconnect();
+        }
+        
+        newStream->connect();
+        
+        sf::Lock l(m_synchronized);
+        m_connectedAudioStream = newStream;
+        m_switchingAudioStream.reset();
+    }
+    
     void Demuxer::requestMoreData(Stream& starvingStream)
     {
         CHECK(! starvingStream.isPassive(), "Internal inconcistency - passive streams cannot request data");
@@ -551,6 +1033,8 @@ namespace sfe
     
     bool Demuxer::didSeek(const Timer &timer, sf::Time oldPosition)
     {
+        // The demuxer is notified first, so the streams notified next are the ones selected from now on
+        commitAudioSwitch();
         resetEndOfFileStatus();
         sf::Time newPosition = timer.getOffset();
         std::set< std::shared_ptr<Stream> > connectedStreams;
@@ -559,9 +1043,22 @@ namespace sfe
             connectedStreams.insert(m_connectedVideoStream);
         if (m_connectedAudioStream)
             connectedStreams.insert(m_connectedAudioStream);
+        if (m_connectedSubtitleStream)
+            connectedStreams.insert(m_connectedSubtitleStream);
 
         CHECK(!connectedStreams.empty(), "Inconcistency error: seeking with no active stream");
         
+        // The packets to play from are found in the packet cache at once, the media is not read
+        if (m_packetArena)
+        {
+            for (std::shared_ptr<Stream> stream : connectedStreams)
+                stream->flushBuffers();
+            flushBuffers();
+            
+            seekPacketCache(newPosition);
+            return true;
+        }
+        
         // Trivial seeking to beginning
         if (newPosition == sf::Time::Zero)
         {
@@ -619,7 +1116,7 @@ namespace sfe
                 // Compute the new gap
                 for (std::shared_ptr<Stream> stream : connectedStreams)
                 {
-                    if (stream->isPassive())
+                    if (stream->isPassive() || ! stream->usesPackets())
                         continue;
                     
                     sf::Time position;
@@ -29,13 +29,16 @@
 #include "Stream.hpp"
 #include "AudioStream.hpp"
 #include "VideoStream.hpp"
+#include "SubtitleStream.hpp"
 #include "Timer.hpp"
+#include <atomic>
 #include <map>
 #include <string>
 #include <set>
 #include <list>
 #include <utility>
 #include <memory>
+#include <vector>
 
 namespace sfe
 {
@@ -80,8 +83,12 @@ namespace sfe
          * @param sourceFile the path of the media to open and play
          * @param timer the timer with which the media streams will be synchronized
          * @param videoDelegate the delegate that will handle the images produced by the VideoStreams
+         * @param audioSettings how the AudioStreams convert their audio before playing it
+         * @param interruption if given, the media reads and seeks are aborted once it becomes true
          */
-        Demuxer(const std::string& sourceFile, std::shared_ptr<Timer> timer, VideoStream::Delegate& videoDelegate);
+        Demuxer(const std::string& sourceFile, std::shared_ptr<Timer> timer, VideoStream::Delegate& videoDelegate,
+                const AudioSettings& audioSettings = AudioSettings(),
+                std::shared_ptr<const std::atomic<bool> > interruption = nullptr);
         
         /** Default destructor
          */
@@ -113,6 +120,10 @@ namespace sfe
          * If another stream of the same kind is already enabled, it is first disabled and disconnected
          * so that only one stream of the same kind can be enabled at the same time.
          *
+         * While playing, the new stream is decoded in the background from the packets kept for it and
+         * takes over from the playing stream in update(), within about one audio chunk, without
+         * interrupting the video. Until then getSelectedAudioStream() returns the previous stream
+         *
          * @param stream the audio stream to enable and connect for playing, or nullptr to disable audio
          */
         void selectAudioStream(std::shared_ptr<AudioStream> stream);
@@ -150,6 +161,21 @@ namespace sfe
          */
         std::shared_ptr<VideoStream> getSelectedVideoStream() const;
         
+        /** Enable the given subtitle stream and connect it to the reference timer
+         *
+         * No subtitle stream is enabled unless asked, if another subtitle stream is already enabled,
+         * it is first disabled and disconnected
+         *
+         * @param stream the subtitle stream to enable and connect for playing, or nullptr to disable subtitles
+         */
+        void selectSubtitleStream(std::shared_ptr<SubtitleStream> stream);
+        
+        /** Get the currently selected subtitle stream, if there's one
+         *
+         * @return the currently selected subtitle stream, or nullptr if there's none
+         */
+        std::shared_ptr<SubtitleStream> getSelectedSubtitleStream() const;
+        
         /** Read encoded data from the media and makes sure that the given stream
          * has enough data
          *
@@ -162,9 +188,22 @@ namespace sfe
         std::set<std::shared_ptr<Stream>> getSelectedStreams() const;
         
         /** Update the media status and eventually decode frames
+         *
+         * When the audio master clock is enabled, the timer is first synchronized with the audio
+         * being played
          */
         void update();
         
+        /** Choose whether the timer follows the audio being played or the system clock
+         *
+         * @param enabled true to synchronize the timer with the selected audio stream
+         */
+        void setAudioMasterClock(bool enabled);
+        
+        /** @return true if the timer follows the audio being played
+         */
+        bool getAudioMasterClock() const;
+        
         /** Tell whether the demuxer has reached the end of the file and can no more feed the streams
          *
          * @return whether the end of the media file has been reached
@@ -177,10 +216,56 @@ namespace sfe
          */
         sf::Time getDuration() const;
         
+        /** Read all the packets of the media into memory at once
+         *
+         * Playing, looping and seeking then never read the media again, and seeking finds the packets
+         * to play from in the key frames index rather than by seeking in the media. This must be called
+         * before any packet is read, nothing is done if the packets don't fit in @a maxSize
+         *
+         * @param maxSize the maximum size of the packets data in bytes
+         * @return true if the packets are read from memory from now on
+         */
+        bool loadPacketCache(std::size_t maxSize);
+        
+        /** @return true if the packets are read from memory
+         */
+        bool hasPacketCache() const;
+        
+        /** @return the number of AVPacket structures allocated so far, the others were reused
+         */
+        std::size_t getAllocatedPacketCount() const;
+        
     private:
+        /** A packet of the packet cache, its data is in m_packetArena
+         */
+        struct CachedPacket
+        {
+            std::size_t offset;
+            int size;
+            int64_t pts;
+            int64_t dts;
+            int64_t duration;
+            int streamIndex;
+            int flags;
+        };
+        
+        /** Position and index in m_cachedPackets of the key frames of a stream, sorted by position
+         */
+        typedef std::vector<std::pair<sf::Time, std::size_t> > KeyFrameIndex;
+        
+        /** Make a packet out of the next cached packet, that shares the data of the packet cache
+         *
+         * @return the packet, or nullptr if all the cached packets were read
+         */
+        AVPacket* readCachedPacket();
+        
+        /** Find the cached packet from which the selected streams can play at @a position
+         */
+        void seekPacketCache(sf::Time position);
+        
         /** Read a encoded packet from the media file
          *
-         * You're responsible for freeing the returned packet
+         * The returned packet must be given back with recyclePacket()
          *
          * @return the read packet, or nullptr if the end of file has been reached
          */
@@ -227,14 +312,46 @@ namespace sfe
          */
         void extractDurationFromStream(const AVStream* stream);
         
+        /** Keep a packet of an audio stream that is not selected, in case playback switches to it
+         *
+         * The packets whose audio was already played are dropped, as are the oldest ones past
+         * a limit
+         *
+         * @param packet the packet to keep
+         * @param stream the stream the packet belongs to
+         */
+        void keepStandbyPacket(AVPacket* packet, const Stream& stream);
+        
+        /** Start decoding @a stream in the background to replace the playing audio stream
+         *
+         * @param stream the audio stream to switch to, or nullptr to disable audio right away
+         */
+        void switchAudioStream(std::shared_ptr<AudioStream> stream);
+        
+        /** Replace the playing audio stream with the one being switched to, if its audio is ready
+         * and the switch position is reached
+         */
+        void spliceAudioStream();
+        
+        /** Abandon the switch started by switchAudioStream(), if any
+         */
+        void cancelAudioSwitch();
+        
+        /** Make the stream being switched to the selected audio stream at once, used when the timer seeks
+         */
+        void commitAudioSwitch();
+        
         // Data source interface
         void requestMoreData(Stream& starvingStream) override;
         void resetEndOfFileStatus() override;
+        AVPacket* allocatePacket() override;
+        void recyclePacket(AVPacket* packet) override;
         
         // Timer interface
         bool didSeek(const Timer& timer, sf::Time oldPosition) override;
         
         AVFormatContext* m_formatCtx;
+        std::shared_ptr<const std::atomic<bool> > m_interruption;
         bool m_eofReached;
         std::map<int, std::shared_ptr<Stream> > m_streams;
         std::map<int, std::string> m_ignoredStreams;
@@ -242,8 +359,28 @@ namespace sfe
         std::shared_ptr<Timer> m_timer;
         std::shared_ptr<Stream> m_connectedAudioStream;
         std::shared_ptr<Stream> m_connectedVideoStream;
+        std::shared_ptr<Stream> m_connectedSubtitleStream;
+        
+        // Switching audio streams while playing, the packets of the audio streams that are not
+        // selected are kept for a while so that their decoding can start from the playback position
+        std::shared_ptr<Stream> m_switchingAudioStream;
+        sf::Time m_audioSwitchPosition;
+        std::map<const Stream*, PacketQueue> m_standbyAudioPackets;
         sf::Time m_duration;
-        std::map<const Stream*, std::list<AVPacket*> > m_pendingDataForActiveStreams;
+        bool m_audioMasterClock;
+        std::map<const Stream*, PacketQueue> m_pendingDataForActiveStreams;
+        
+        // Packet cache, all the packets data is in a single buffer shared by the packets being played
+        AVBufferRef* m_packetArena;
+        std::vector<CachedPacket> m_cachedPackets;
+        std::map<int, KeyFrameIndex> m_cachedKeyFrames;
+        std::size_t m_nextCachedPacket;
+        
+        // The packets given back by the streams, locked on its own as the streams recycle their packets
+        // while holding their own lock
+        std::vector<AVPacket*> m_recycledPackets;
+        mutable sf::Mutex m_recycledPacketsMutex;
+        std::size_t m_allocatedPacketCount;
         
         static std::list<DemuxerInfo> g_availableDemuxers;
         static std::list<DecoderInfo> g_availableDecoders;
@@ -0,0 +1,261 @@
+
+/*
+ *  FastDecodeFile.cpp
+ *  sfeMovie project
+ *
+ *  Copyright (C) 2010-2015 Lucas Soltic
+ *  lucas.soltic@orange.fr
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ *
+ */
+
+extern "C"
+{
+#include <libswscale/swscale.h>
+}
+
+#include "FastDecodeFile.hpp"
+#include "FrameReaderImpl.hpp"
+#include "Lz4.hpp"
+#include "Utilities.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+namespace sfe
+{
+    namespace
+    {
+        const char FileMagic[8] = { 'S', 'F', 'E', 'F', 'A', 'S', 'T', 'D' };
+        const uint32_t FileVersion = 1;
+        
+        template <typename T>
+        void writeValue(std::ofstream& file, const T& value)
+        {
+            file.write(reinterpret_cast<const char*>(&value), sizeof(value));
+        }
+    }
+    
+    std::atomic<bool> FastDecodeFile::g_enabled(false);
+    
+    std::string FastDecodeFile::pathFor(const std::string& mediaFile)
+    {
+        return mediaFile + ".sfefast";
+    }
+    
+    bool FastDecodeFile::create(const std::string& mediaFile)
+    {
+        Header header;
+        std::memset(&header, 0, sizeof(header));
+        std::memcpy(header.magic, FileMagic, sizeof(FileMagic));
+        header.version = FileVersion;
+        
+        FrameReaderImpl reader;
+        
+        if (! getFileStatus(mediaFile, header.mediaSize, header.modificationTime) || ! reader.open(mediaFile, Video, -1))
+        {
+            sfeLogError("Movie::createFastDecodeFile() - could not open " + mediaFile);
+            return false;
+        }
+        
+        header.streamIndex = reader.getStreamIndex();
+        
+        // Written aside then renamed, so that a partially written file is never used
+        const std::string path = pathFor(mediaFile);
+        const std::string temporaryPath = path + ".tmp";
+        std::ofstream file(temporaryPath.c_str(), std::ios::binary | std::ios::trunc);
+        std::vector<IndexEntry> index;
+        std::vector<uint8_t> pixels;
+        std::vector<uint8_t> compressed;
+        SwsContext* swsCtx = nullptr;
+        bool success = true;
+        
+        writeValue(file, header);
+        
+        try
+        {
+            MediaFrame frame;
+            
+            while (file && reader.readFrame(frame))
+            {
+                const AVFrame* source = frame.getAVFrame();
+                
+                // Frames are converted to the size of the first one, which is the size of the video texture
+                if (index.empty())
+                {
+                    header.width = source->width;
+                    header.height = source->height;
+                    pixels.resize(4 * static_cast<std::size_t>(header.width) * header.height);
+                    compressed.resize(lz4CompressBound(pixels.size()));
+                }
+                
+                swsCtx = sws_getCachedContext(swsCtx, source->width, source->height,
+                                              static_cast<AVPixelFormat>(source->format),
+                                              header.width, header.height, AV_PIX_FMT_RGBA,
+                                              SWS_BILINEAR, nullptr, nullptr, nullptr);
+                CHECK(swsCtx, "sws_getCachedContext() error");
+                
+                uint8_t* planes[4] = { pixels.data(), nullptr, nullptr, nullptr };
+                int linesizes[4] = { static_cast<int>(4 * header.width), 0, 0, 0 };
+                sws_scale(swsCtx, source->data, source->linesize, 0, source->height, planes, linesizes);
+                
+                IndexEntry entry;
+                entry.position = frame.getPosition().asMicroseconds();
+                entry.offset = static_cast<uint64_t>(file.tellp());
+                entry.size = lz4Compress(pixels.data(), pixels.size(), compressed.data());
+                file.write(reinterpret_cast<const char*>(compressed.data()), entry.size);
+                index.push_back(entry);
+            }
+        }
+        catch (std::runtime_error& e)
+        {
+            sfeLogError("Movie::createFastDecodeFile() - " + std::string(e.what()));
+            success = false;
+        }
+        
+        if (swsCtx)
+            sws_freeContext(swsCtx);
+        
+        std::stable_sort(index.begin(), index.end(), [](const IndexEntry& first, const IndexEntry& second)
+        {
+            return first.position < second.position;
+        });
+        
+        header.frameCount = index.size();
+        header.indexOffset = static_cast<uint64_t>(file.tellp());
+        
+        for (const IndexEntry& entry : index)
+            writeValue(file, entry);
+        
+        file.seekp(0);
+        writeValue(file, header);
+        file.close();
+        
+        if (! success || ! file || index.empty())
+        {
+            sfeLogError("Movie::createFastDecodeFile() - could not write " + path);
+            std::remove(temporaryPath.c_str());
+            return false;
+        }
+        
+        std::remove(path.c_str());
+        
+        if (std::rename(temporaryPath.c_str(), path.c_str()) != 0)
+        {
+            sfeLogError("Movie::createFastDecodeFile() - could not write " + path);
+            std::remove(temporaryPath.c_str());
+            return false;
+        }
+        
+        sfeLogDebug("Transcoded " + s(index.size()) + " frames of " + mediaFile + " to " + path);
+        return true;
+    }
+    
+    void FastDecodeFile::setEnabled(bool enabled)
+    {
+        g_enabled = enabled;
+    }
+    
+    bool FastDecodeFile::isEnabled()
+    {
+        return g_enabled;
+    }
+    
+    FastDecodeFile::FastDecodeFile() :
+    m_file(),
+    m_header()
+    {
+    }
+    
+    bool FastDecodeFile::open(const std::string& mediaFile)
+    {
+        const std::string path = pathFor(mediaFile);
+        uint64_t mediaSize = 0;
+        int64_t modificationTime = 0;
+        
+        if (! m_file.open(path))
+            return false;
+        
+        if (m_file.getSize() < sizeof(Header))
+        {
+            m_file.close();
+            return false;
+        }
+        
+        std::memcpy(&m_header, m_file.getData(), sizeof(Header));
+        
+        if (std::memcmp(m_header.magic, FileMagic, sizeof(FileMagic)) != 0 || m_header.version != FileVersion ||
+            m_header.indexOffset > m_file.getSize() ||
+            m_header.frameCount > (m_file.getSize() - m_header.indexOffset) / sizeof(IndexEntry) ||
+            m_header.frameCount == 0)
+        {
+            sfeLogWarning("Ignoring invalid fast decode file " + path);
+            m_file.close();
+            return false;
+        }
+        
+        if (! getFileStatus(mediaFile, mediaSize, modificationTime) || mediaSize != m_header.mediaSize ||
+            modificationTime != m_header.modificationTime)
+        {
+            sfeLogWarning("Ignoring outdated fast decode file " + path);
+            m_file.close();
+            return false;
+        }
+        
+        sfeLogDebug("Playing " + mediaFile + " from " + path);
+        return true;
+    }
+    
+    int FastDecodeFile::getStreamIndex() const
+    {
+        return m_header.streamIndex;
+    }
+    
+    sf::Vector2u FastDecodeFile::getFrameSize() const
+    {
+        return sf::Vector2u(m_header.width, m_header.height);
+    }
+    
+    std::size_t FastDecodeFile::getFrameCount() const
+    {
+        return static_cast<std::size_t>(m_header.frameCount);
+    }
+    
+    sf::Time FastDecodeFile::getFramePosition(std::size_t index) const
+    {
+        return sf::microseconds(getIndexEntry(index).position);
+    }
+    
+    bool FastDecodeFile::readFrame(std::size_t index, uint8_t* pixels) const
+    {
+        const IndexEntry entry = getIndexEntry(index);
+        const std::size_t frameSize = 4 * static_cast<std::size_t>(m_header.width) * m_header.height;
+        
+        if (entry.offset > m_header.indexOffset || entry.size > m_header.indexOffset - entry.offset)
+            return false;
+        
+        return lz4Decompress(m_file.getData() + entry.offset, static_cast<std::size_t>(entry.size), pixels, frameSize);
+    }
+    
+    FastDecodeFile::IndexEntry FastDecodeFile::getIndexEntry(std::size_t index) const
+    {
+        IndexEntry entry;
+        std::memcpy(&entry, m_file.getData() + m_header.indexOffset + index * sizeof(IndexEntry), sizeof(IndexEntry));
+        return entry;
+    }
+}
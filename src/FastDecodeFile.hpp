@@ -0,0 +1,125 @@
+
+/*
+ *  FastDecodeFile.hpp
+ *  sfeMovie project
+ *
+ *  Copyright (C) 2010-2015 Lucas Soltic
+ *  lucas.soltic@orange.fr
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ *
+ */
+
+#ifndef SFEMOVIE_FASTDECODEFILE_HPP
+#define SFEMOVIE_FASTDECODEFILE_HPP
+
+#include "MappedFile.hpp"
+#include <SFML/System.hpp>
+#include <atomic>
+#include <string>
+#include <stdint.h>
+
+namespace sfe
+{
+    /** Video stream transcoded to LZ4 compressed RGBA frames, played instead of decoding the media
+     *
+     * The file is stored next to the media and memory-mapped, the frames are found through an index.
+     * It is only used while the media keeps the size and modification time it had when transcoded.
+     */
+    class FastDecodeFile : public sf::NonCopyable
+    {
+    public:
+        /** @return the path of the fast decode file of @a mediaFile
+         */
+        static std::string pathFor(const std::string& mediaFile);
+        
+        /** @see Movie::createFastDecodeFile()
+         */
+        static bool create(const std::string& mediaFile);
+        
+        /** @see Movie::setFastDecodeFilesEnabled()
+         */
+        static void setEnabled(bool enabled);
+        
+        /** @see Movie::areFastDecodeFilesEnabled()
+         */
+        static bool isEnabled();
+        
+        /** Default constructor
+         */
+        FastDecodeFile();
+        
+        /** Map the fast decode file of @a mediaFile
+         *
+         * @return true on success, false if there is no such file or it is invalid or outdated
+         */
+        bool open(const std::string& mediaFile);
+        
+        /** @return the index of the transcoded stream in the media
+         */
+        int getStreamIndex() const;
+        
+        /** @return the size of the frames
+         */
+        sf::Vector2u getFrameSize() const;
+        
+        /** @return the number of frames
+         */
+        std::size_t getFrameCount() const;
+        
+        /** @return the position of frame @a index, frames are sorted by position
+         */
+        sf::Time getFramePosition(std::size_t index) const;
+        
+        /** Decompress frame @a index
+         *
+         * @param pixels the output RGBA buffer, 4 * width * height bytes long
+         * @return true on success, false if the frame data is corrupted
+         */
+        bool readFrame(std::size_t index, uint8_t* pixels) const;
+        
+    private:
+        struct Header
+        {
+            char magic[8];
+            uint32_t version;
+            int32_t streamIndex;
+            uint32_t width;
+            uint32_t height;
+            uint64_t mediaSize;
+            int64_t modificationTime;
+            uint64_t frameCount;
+            uint64_t indexOffset;
+        };
+        
+        struct IndexEntry
+        {
+            int64_t position; // In microseconds
+            uint64_t offset;
+            uint64_t size;
+        };
+        
+        /** @return the index entry of frame @a index
+         */
+        IndexEntry getIndexEntry(std::size_t index) const;
+        
+        MappedFile m_file;
+        Header m_header;
+        
+        static std::atomic<bool> g_enabled;
+    };
+}
+
+#endif
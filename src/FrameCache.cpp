@@ -0,0 +1,95 @@
+
+/*
+ *  FrameCache.cpp
+ *  sfeMovie project
+ *
+ *  Copyright (C) 2010-2015 Lucas Soltic
+ *  lucas.soltic@orange.fr
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ *
+ */
+
+#include "FrameCache.hpp"
+#include "Log.hpp"
+
+namespace sfe
+{
+    std::list<FrameCache::Entry> FrameCache::g_entries;
+    std::map<std::string, std::list<FrameCache::Entry>::iterator> FrameCache::g_entriesByKey;
+    std::size_t FrameCache::g_usedBytes = 0;
+    std::size_t FrameCache::g_budget = 0;
+    std::mutex FrameCache::g_mutex;
+    
+    void FrameCache::setBudget(std::size_t bytes)
+    {
+        std::lock_guard<std::mutex> lock(g_mutex);
+        g_budget = bytes;
+        evict(bytes);
+    }
+    
+    std::size_t FrameCache::getBudget()
+    {
+        std::lock_guard<std::mutex> lock(g_mutex);
+        return g_budget;
+    }
+    
+    std::shared_ptr<const FrameCache::Clip> FrameCache::find(const std::string& key)
+    {
+        std::lock_guard<std::mutex> lock(g_mutex);
+        std::map<std::string, std::list<Entry>::iterator>::iterator it = g_entriesByKey.find(key);
+        
+        if (it == g_entriesByKey.end())
+            return nullptr;
+        
+        g_entries.splice(g_entries.begin(), g_entries, it->second);
+        return it->second->clip;
+    }
+    
+    void FrameCache::insert(const std::string& key, std::shared_ptr<const Clip> clip)
+    {
+        std::size_t size = 0;
+        
+        for (const Frame& frame : *clip)
+            size += frame.pixels.size() + sizeof(Frame);
+        
+        std::lock_guard<std::mutex> lock(g_mutex);
+        
+        if (size > g_budget || g_entriesByKey.find(key) != g_entriesByKey.end())
+            return;
+        
+        evict(g_budget - size);
+        
+        Entry entry = { key, clip, size };
+        g_entries.push_front(entry);
+        g_entriesByKey[key] = g_entries.begin();
+        g_usedBytes += size;
+        
+        sfeLogDebug("Cached " + s(clip->size()) + " frames of " + key + ", " + s(g_usedBytes) + " bytes used");
+    }
+    
+    void FrameCache::evict(std::size_t budget)
+    {
+        while (g_usedBytes > budget)
+        {
+            const Entry& entry = g_entries.back();
+            sfeLogDebug("Evicted the cached frames of " + entry.key);
+            
+            g_usedBytes -= entry.size;
+            g_entriesByKey.erase(entry.key);
+            g_entries.pop_back();
+        }
+    }
+}
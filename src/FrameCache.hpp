@@ -0,0 +1,102 @@
+
+/*
+ *  FrameCache.hpp
+ *  sfeMovie project
+ *
+ *  Copyright (C) 2010-2015 Lucas Soltic
+ *  lucas.soltic@orange.fr
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ *
+ */
+
+#ifndef SFEMOVIE_FRAMECACHE_HPP
+#define SFEMOVIE_FRAMECACHE_HPP
+
+#include <SFML/System.hpp>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+namespace sfe
+{
+    /** Process-wide cache of the decoded frames of short video streams
+     *
+     * A clip holds every frame of a stream, so that the streams playing it again can do so without
+     * decoding. The clips that don't fit in the memory budget anymore are evicted, least recently used first.
+     */
+    class FrameCache
+    {
+    public:
+        /** A decoded frame in RGBA format
+         */
+        struct Frame
+        {
+            sf::Time position;
+            std::vector<uint8_t> pixels;
+        };
+        
+        /** All the frames of a video stream, sorted by position
+         */
+        typedef std::vector<Frame> Clip;
+        
+        /** Set how much memory the cached clips can use, evicting clips if needed
+         *
+         * @param bytes the memory budget, or 0 to disable the cache (default)
+         */
+        static void setBudget(std::size_t bytes);
+        
+        /** @return the memory budget set with setBudget()
+         */
+        static std::size_t getBudget();
+        
+        /** Return the clip cached for @a key and mark it as the most recently used one
+         *
+         * @return the cached clip, or nullptr if there is none
+         */
+        static std::shared_ptr<const Clip> find(const std::string& key);
+        
+        /** Cache @a clip for @a key, evicting the least recently used clips if needed
+         *
+         * Nothing is cached if the clip alone exceeds the budget
+         */
+        static void insert(const std::string& key, std::shared_ptr<const Clip> clip);
+        
+    private:
+        struct Entry
+        {
+            std::string key;
+            std::shared_ptr<const Clip> clip;
+            std::size_t size;
+        };
+        
+        /** Evict the least recently used clips until the used memory fits in @a budget, the lock must be held
+         */
+        static void evict(std::size_t budget);
+        
+        // Most recently used first. Evicted clips are freed once the streams playing them release them
+        static std::list<Entry> g_entries;
+        static std::map<std::string, std::list<Entry>::iterator> g_entriesByKey;
+        static std::size_t g_usedBytes;
+        static std::size_t g_budget;
+        static std::mutex g_mutex;
+    };
+}
+
+#endif
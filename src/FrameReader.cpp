@@ -0,0 +1,145 @@
+
+/*
+ *  FrameReader.cpp
+ *  sfeMovie project
+ *
+ *  Copyright (C) 2010-2015 Lucas Soltic
+ *  lucas.soltic@orange.fr
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ *
+ */
+
+#include <sfeMovie/FrameReader.hpp>
+#include "FrameReaderImpl.hpp"
+
+namespace sfe
+{
+    FrameReader::Iterator::Iterator() :
+    m_reader(nullptr),
+    m_frame()
+    {
+    }
+    
+    FrameReader::Iterator::Iterator(FrameReader& reader) :
+    m_reader(&reader),
+    m_frame()
+    {
+        ++(*this);
+    }
+    
+    const MediaFrame& FrameReader::Iterator::operator*() const
+    {
+        return m_frame;
+    }
+    
+    const MediaFrame* FrameReader::Iterator::operator->() const
+    {
+        return &m_frame;
+    }
+    
+    FrameReader::Iterator& FrameReader::Iterator::operator++()
+    {
+        if (m_reader && ! m_reader->readFrame(m_frame))
+        {
+            m_reader = nullptr;
+            m_frame = MediaFrame();
+        }
+        
+        return *this;
+    }
+    
+    bool FrameReader::Iterator::operator==(const Iterator& other) const
+    {
+        return m_reader == other.m_reader;
+    }
+    
+    bool FrameReader::Iterator::operator!=(const Iterator& other) const
+    {
+        return !(*this == other);
+    }
+    
+    FrameReader::FrameReader() :
+    m_impl(std::make_shared<FrameReaderImpl>())
+    {
+    }
+    
+    FrameReader::~FrameReader()
+    {
+    }
+    
+    bool FrameReader::open(const std::string& filename, MediaType type)
+    {
+        return m_impl->open(filename, type, -1);
+    }
+    
+    bool FrameReader::open(const std::string& filename, const StreamDescriptor& stream)
+    {
+        if (stream.identifier < 0)
+            return false;
+        
+        return m_impl->open(filename, stream.type, stream.identifier);
+    }
+    
+    void FrameReader::setStride(unsigned int stride)
+    {
+        m_impl->setStride(stride);
+    }
+    
+    unsigned int FrameReader::getStride() const
+    {
+        return m_impl->getStride();
+    }
+    
+    void FrameReader::setKeyFramesOnly(bool keyFramesOnly)
+    {
+        m_impl->setKeyFramesOnly(keyFramesOnly);
+    }
+    
+    bool FrameReader::getKeyFramesOnly() const
+    {
+        return m_impl->getKeyFramesOnly();
+    }
+    
+    bool FrameReader::seek(sf::Time position)
+    {
+        return m_impl->seek(position);
+    }
+    
+    bool FrameReader::readFrame(MediaFrame& frame)
+    {
+        return m_impl->readFrame(frame);
+    }
+    
+    sf::Time FrameReader::getDuration() const
+    {
+        return m_impl->getDuration();
+    }
+    
+    MediaType FrameReader::getMediaType() const
+    {
+        return m_impl->getMediaType();
+    }
+    
+    FrameReader::Iterator FrameReader::begin()
+    {
+        return Iterator(*this);
+    }
+    
+    FrameReader::Iterator FrameReader::end()
+    {
+        return Iterator();
+    }
+}
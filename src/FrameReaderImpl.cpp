@@ -0,0 +1,278 @@
+
+/*
+ *  FrameReaderImpl.cpp
+ *  sfeMovie project
+ *
+ *  Copyright (C) 2010-2015 Lucas Soltic
+ *  lucas.soltic@orange.fr
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ *
+ */
+
+#include "FrameReaderImpl.hpp"
+#include "Macros.hpp"
+#include "Log.hpp"
+#include "Utilities.hpp"
+#include <stdexcept>
+
+namespace sfe
+{
+    FrameReaderImpl::FrameReaderImpl() :
+    m_formatCtx(nullptr),
+    m_stream(nullptr),
+    m_context(nullptr),
+    m_packet(nullptr),
+    m_frame(nullptr),
+    m_type(Unknown),
+    m_stride(1),
+    m_keyFramesOnly(false),
+    m_decodedSinceSeek(0),
+    m_seekPosition(),
+    m_flushing(false)
+    {
+    }
+    
+    FrameReaderImpl::~FrameReaderImpl()
+    {
+        close();
+    }
+    
+    bool FrameReaderImpl::open(const std::string& filename, MediaType type, int streamIndex)
+    {
+        close();
+        
+        try
+        {
+            CHECK(type == Audio || type == Video, "FrameReader::open() - invalid argument: type");
+            
+            int err = avformat_open_input(&m_formatCtx, filename.c_str(), nullptr, nullptr);
+            CHECK0(err, "FrameReader::open() - error while opening media: " + filename);
+            
+            err = avformat_find_stream_info(m_formatCtx, nullptr);
+            CHECK0(err, "FrameReader::open() - error while retreiving media information");
+            
+            const AVMediaType ffmpegType = (type == Video) ? AVMEDIA_TYPE_VIDEO : AVMEDIA_TYPE_AUDIO;
+            
+            if (streamIndex < 0)
+                streamIndex = av_find_best_stream(m_formatCtx, ffmpegType, -1, -1, nullptr, 0);
+            
+            CHECK(streamIndex >= 0 && static_cast<unsigned>(streamIndex) < m_formatCtx->nb_streams,
+                  "FrameReader::open() - no " + mediaTypeToString(type) + " stream in " + filename);
+            
+            m_stream = m_formatCtx->streams[streamIndex];
+            CHECK(m_stream->codecpar->codec_type == ffmpegType,
+                  "FrameReader::open() - " + Stream::AVStreamDescription(m_stream) + " is not a "
+                  + mediaTypeToString(type) + " stream");
+            
+            // Don't bother demuxing the other streams
+            for (unsigned int i = 0; i < m_formatCtx->nb_streams; i++)
+            {
+                if (m_formatCtx->streams[i] != m_stream)
+                    m_formatCtx->streams[i]->discard = AVDISCARD_ALL;
+            }
+            
+            const std::string codecName = avcodec_get_name(m_stream->codecpar->codec_id);
+            const AVCodec* codec = avcodec_find_decoder(m_stream->codecpar->codec_id);
+            CHECK(codec, "FrameReader::open() - no decoder for " + codecName + " codec");
+            
+            m_context = avcodec_alloc_context3(codec);
+            CHECK(m_context, "FrameReader::open() - unable to allocate codec context for codec " + codecName);
+            
+            err = avcodec_parameters_to_context(m_context, m_stream->codecpar);
+            CHECK0(err, "FrameReader::open() - unable to copy codec parameters to context for codec " + codecName);
+            
+            err = avcodec_open2(m_context, codec, nullptr);
+            CHECK0(err, "FrameReader::open() - unable to load decoder for codec " + codecName);
+            m_context->skip_frame = m_keyFramesOnly ? AVDISCARD_NONKEY : AVDISCARD_DEFAULT;
+            
+            m_packet = av_packet_alloc();
+            m_frame = av_frame_alloc();
+            CHECK(m_packet && m_frame, "FrameReader::open() - out of memory");
+        }
+        catch (std::runtime_error& e)
+        {
+            sfeLogError(e.what());
+            close();
+            return false;
+        }
+        
+        m_type = type;
+        m_decodedSinceSeek = 0;
+        m_seekPosition = sf::Time::Zero;
+        m_flushing = false;
+        return true;
+    }
+    
+    void FrameReaderImpl::setStride(unsigned int stride)
+    {
+        m_stride = stride > 0 ? stride : 1;
+    }
+    
+    unsigned int FrameReaderImpl::getStride() const
+    {
+        return m_stride;
+    }
+    
+    void FrameReaderImpl::setKeyFramesOnly(bool keyFramesOnly)
+    {
+        m_keyFramesOnly = keyFramesOnly;
+        
+        if (m_context)
+            m_context->skip_frame = keyFramesOnly ? AVDISCARD_NONKEY : AVDISCARD_DEFAULT;
+    }
+    
+    bool FrameReaderImpl::getKeyFramesOnly() const
+    {
+        return m_keyFramesOnly;
+    }
+    
+    bool FrameReaderImpl::seek(sf::Time position)
+    {
+        if (! m_formatCtx)
+            return false;
+        
+        if (position < sf::Time::Zero)
+            position = sf::Time::Zero;
+        
+        // Land on the last key frame before the position, the frames in between are decoded and dropped by readFrame()
+        const int64_t startTime = m_stream->start_time != AV_NOPTS_VALUE ? m_stream->start_time : 0;
+        const int64_t timestamp = startTime + av_rescale_q(position.asMicroseconds(), AV_TIME_BASE_Q, m_stream->time_base);
+        int err = avformat_seek_file(m_formatCtx, m_stream->index, INT64_MIN, timestamp, timestamp, AVSEEK_FLAG_BACKWARD);
+        
+        if (err < 0)
+        {
+            sfeLogError("FrameReader::seek() - error while seeking at time " + s(position.asMilliseconds()) + "ms");
+            return false;
+        }
+        
+        avcodec_flush_buffers(m_context);
+        m_decodedSinceSeek = 0;
+        m_seekPosition = position;
+        m_flushing = false;
+        return true;
+    }
+    
+    bool FrameReaderImpl::readFrame(MediaFrame& frame)
+    {
+        if (! m_formatCtx)
+            return false;
+        
+        try
+        {
+            while (decodeNextFrame())
+            {
+                const sf::Time position = framePosition(m_frame, m_stream);
+                
+                // Frames before the key frame found by seeking are never decoded in key frames only mode
+                const bool beforeSeekPosition = !m_keyFramesOnly && position < m_seekPosition;
+                
+                if (beforeSeekPosition || (m_decodedSinceSeek++ % m_stride) != 0)
+                {
+                    av_frame_unref(m_frame);
+                    continue;
+                }
+                
+                // The decoded buffers are handed over to the caller rather than copied
+                AVFrame* output = av_frame_alloc();
+                CHECK(output, "FrameReader::readFrame() - out of memory");
+                av_frame_move_ref(output, m_frame);
+                
+                frame = MediaFrame(output, m_type, position);
+                return true;
+            }
+        }
+        catch (std::runtime_error& e)
+        {
+            sfeLogError(e.what());
+        }
+        
+        return false;
+    }
+    
+    sf::Time FrameReaderImpl::getDuration() const
+    {
+        if (! m_formatCtx || m_formatCtx->duration == AV_NOPTS_VALUE)
+            return sf::Time::Zero;
+        
+        // AV_TIME_BASE is one microsecond
+        return sf::microseconds(m_formatCtx->duration);
+    }
+    
+    MediaType FrameReaderImpl::getMediaType() const
+    {
+        return m_type;
+    }
+    
+    int FrameReaderImpl::getStreamIndex() const
+    {
+        return m_stream ? m_stream->index : -1;
+    }
+    
+    void FrameReaderImpl::close()
+    {
+        if (m_frame)
+            av_frame_free(&m_frame);
+        
+        if (m_packet)
+            av_packet_free(&m_packet);
+        
+        if (m_context)
+            avcodec_free_context(&m_context);
+        
+        if (m_formatCtx)
+            avformat_close_input(&m_formatCtx);
+        
+        m_stream = nullptr;
+        m_type = Unknown;
+    }
+    
+    bool FrameReaderImpl::decodeNextFrame()
+    {
+        while (true)
+        {
+            int err = avcodec_receive_frame(m_context, m_frame);
+            
+            if (err == 0)
+                return true;
+            
+            if (err == AVERROR_EOF || m_flushing)
+                return false;
+            
+            CHECK(err == AVERROR(EAGAIN), "FrameReader::readFrame() - decoding error " + s(err));
+            
+            if (av_read_frame(m_formatCtx, m_packet) < 0)
+            {
+                // End of file, let the decoder output the frames it still holds
+                m_flushing = true;
+                avcodec_send_packet(m_context, nullptr);
+                continue;
+            }
+            
+            // The decoder would discard the other frames anyway, don't even give it their packets
+            const bool skipped = m_keyFramesOnly && !(m_packet->flags & AV_PKT_FLAG_KEY);
+            
+            if (m_packet->stream_index == m_stream->index && !skipped)
+            {
+                err = avcodec_send_packet(m_context, m_packet);
+                
+                if (err < 0)
+                    sfeLogDebug("FrameReader::readFrame() - packet could not be decoded, error " + s(err));
+            }
+            
+            av_packet_unref(m_packet);
+        }
+    }
+}
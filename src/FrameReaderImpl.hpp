@@ -0,0 +1,122 @@
+
+/*
+ *  FrameReaderImpl.hpp
+ *  sfeMovie project
+ *
+ *  Copyright (C) 2010-2015 Lucas Soltic
+ *  lucas.soltic@orange.fr
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ *
+ */
+
+#ifndef SFEMOVIE_FRAMEREADERIMPL_HPP
+#define SFEMOVIE_FRAMEREADERIMPL_HPP
+
+#include <sfeMovie/FrameReader.hpp>
+#include <string>
+
+extern "C"
+{
+#include <libavformat/avformat.h>
+#include <libavcodec/avcodec.h>
+}
+
+namespace sfe
+{
+    /** Decode the frames of a single stream in a loop, without Timer, Demuxer or playback objects
+     *
+     * Like AudioTrackDecoder, this owns its own format and codec contexts so that a media can be
+     * read independently of any Movie
+     */
+    class FrameReaderImpl
+    {
+    public:
+        /** Default constructor
+         */
+        FrameReaderImpl();
+        
+        /** Default destructor
+         */
+        ~FrameReaderImpl();
+        
+        /** @see FrameReader::open()
+         *
+         * @param streamIndex the index of the stream to read, or -1 to pick the best stream of kind @a type
+         */
+        bool open(const std::string& filename, MediaType type, int streamIndex);
+        
+        /** @see FrameReader::setStride()
+         */
+        void setStride(unsigned int stride);
+        
+        /** @see FrameReader::getStride()
+         */
+        unsigned int getStride() const;
+        
+        /** @see FrameReader::setKeyFramesOnly()
+         */
+        void setKeyFramesOnly(bool keyFramesOnly);
+        
+        /** @see FrameReader::getKeyFramesOnly()
+         */
+        bool getKeyFramesOnly() const;
+        
+        /** @see FrameReader::seek()
+         */
+        bool seek(sf::Time position);
+        
+        /** @see FrameReader::readFrame()
+         */
+        bool readFrame(MediaFrame& frame);
+        
+        /** @see FrameReader::getDuration()
+         */
+        sf::Time getDuration() const;
+        
+        /** @see FrameReader::getMediaType()
+         */
+        MediaType getMediaType() const;
+        
+        /** @return the index of the read stream in the media, or -1 if no media is opened
+         */
+        int getStreamIndex() const;
+        
+    private:
+        /** Free the contexts of the opened media, if any
+         */
+        void close();
+        
+        /** Decode frames into m_frame until the decoder outputs one, reading packets as needed
+         *
+         * @return true if m_frame holds a new frame, false at the end of the stream
+         */
+        bool decodeNextFrame();
+        
+        AVFormatContext* m_formatCtx;
+        AVStream* m_stream;
+        AVCodecContext* m_context;
+        AVPacket* m_packet;
+        AVFrame* m_frame;
+        MediaType m_type;
+        unsigned int m_stride;
+        bool m_keyFramesOnly;
+        unsigned int m_decodedSinceSeek;
+        sf::Time m_seekPosition;
+        bool m_flushing;
+    };
+}
+
+#endif
@@ -25,6 +25,7 @@
 #include "Log.hpp"
 #include "Macros.hpp"
 #include <iostream>
+#include <atomic>
 #include <SFML/System.hpp>
 extern "C"
 {
@@ -35,7 +36,7 @@ namespace sfe
 {
     namespace Log
     {
-        static int g_logLevel = ErrorLogLevel;
+        static std::atomic<int> g_logLevel(ErrorLogLevel);
         static sf::Mutex g_synchronized;
         
         void initialize()
@@ -62,6 +63,11 @@ namespace sfe
             }
         }
         
+        bool isEnabled(LogLevel level)
+        {
+            return g_logLevel >= level;
+        }
+        
         static std::string filename(const std::string& filepath)
         {
             size_t pos = filepath.find_last_of("/");
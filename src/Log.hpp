@@ -34,9 +34,10 @@
 #define FUNC_NAME __func__
 #endif
 
-#define sfeLogDebug(message) sfe::Log::debug(__FILE__, std::string(":") + sfe::s(__LINE__) + ": " + std::string(FUNC_NAME) + "()" + " - " + message)
-#define sfeLogWarning(message) sfe::Log::warning(__FILE__, std::string(":") + sfe::s(__LINE__) + ": " + std::string(FUNC_NAME) + "()" + " - " + message)
-#define sfeLogError(message) sfe::Log::error(__FILE__, std::string(":") + sfe::s(__LINE__) + ": " + std::string(FUNC_NAME) + "()" + " - " + message)
+// The message is only built when it is going to be logged, so that filtered out messages cost no allocation
+#define sfeLogDebug(message) do { if (sfe::Log::isEnabled(sfe::Log::DebugLogLevel)) sfe::Log::debug(__FILE__, std::string(":") + sfe::s(__LINE__) + ": " + std::string(FUNC_NAME) + "()" + " - " + message); } while (false)
+#define sfeLogWarning(message) do { if (sfe::Log::isEnabled(sfe::Log::WarningLogLevel)) sfe::Log::warning(__FILE__, std::string(":") + sfe::s(__LINE__) + ": " + std::string(FUNC_NAME) + "()" + " - " + message); } while (false)
+#define sfeLogError(message) do { if (sfe::Log::isEnabled(sfe::Log::ErrorLogLevel)) sfe::Log::error(__FILE__, std::string(":") + sfe::s(__LINE__) + ": " + std::string(FUNC_NAME) + "()" + " - " + message); } while (false)
 
 namespace sfe
 {
@@ -60,6 +61,10 @@ namespace sfe
          */
         void setLogLevel(LogLevel level);
         
+        /** @return true if messages of the given @a level pass the currently set filter
+         */
+        bool isEnabled(LogLevel level);
+        
         /** Log a debug @a message if the currently set mask allows it
          *
          * @param message the debug message to log
@@ -0,0 +1,211 @@
+
+/*
+ *  Lz4.cpp
+ *  sfeMovie project
+ *
+ *  Copyright (C) 2010-2015 Lucas Soltic
+ *  lucas.soltic@orange.fr
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ *
+ */
+
+#include "Lz4.hpp"
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+namespace sfe
+{
+    namespace
+    {
+        const int HashLog = 12;
+        const std::size_t MinMatch = 4;
+        const std::size_t MaxOffset = 65535;
+        
+        // The format requires the last 5 bytes to be literals and the last match to start 12 bytes before the end
+        const std::size_t LastLiterals = 5;
+        const std::size_t MatchLimit = 12;
+        
+        uint32_t read32(const uint8_t* data)
+        {
+            uint32_t value;
+            std::memcpy(&value, data, sizeof(value));
+            return value;
+        }
+        
+        uint32_t hash(uint32_t sequence)
+        {
+            return (sequence * 2654435761U) >> (32 - HashLog);
+        }
+        
+        void writeLength(uint8_t*& output, std::size_t length)
+        {
+            while (length >= 255)
+            {
+                *output++ = 255;
+                length -= 255;
+            }
+            
+            *output++ = static_cast<uint8_t>(length);
+        }
+        
+        bool readLength(const uint8_t*& input, const uint8_t* inputEnd, std::size_t& length)
+        {
+            uint8_t byte = 255;
+            
+            while (byte == 255)
+            {
+                if (input == inputEnd)
+                    return false;
+                
+                byte = *input++;
+                length += byte;
+            }
+            
+            return true;
+        }
+        
+        /** Write a sequence made of @a literalLength literals then a match, or only literals if @a matchLength is 0
+         */
+        void writeSequence(uint8_t*& output, const uint8_t* literals, std::size_t literalLength,
+                           std::size_t offset, std::size_t matchLength)
+        {
+            const std::size_t matchCode = matchLength ? matchLength - MinMatch : 0;
+            *output++ = static_cast<uint8_t>((std::min<std::size_t>(literalLength, 15) << 4) |
+                                             std::min<std::size_t>(matchCode, 15));
+            
+            if (literalLength >= 15)
+                writeLength(output, literalLength - 15);
+            
+            std::memcpy(output, literals, literalLength);
+            output += literalLength;
+            
+            if (matchLength == 0)
+                return;
+            
+            *output++ = static_cast<uint8_t>(offset & 0xff);
+            *output++ = static_cast<uint8_t>(offset >> 8);
+            
+            if (matchCode >= 15)
+                writeLength(output, matchCode - 15);
+        }
+    }
+    
+    std::size_t lz4CompressBound(std::size_t size)
+    {
+        return size + size / 255 + 16;
+    }
+    
+    std::size_t lz4Compress(const uint8_t* source, std::size_t size, uint8_t* destination)
+    {
+        uint8_t* output = destination;
+        std::size_t anchor = 0;
+        
+        if (size > MatchLimit)
+        {
+            std::vector<uint32_t> table(1 << HashLog, 0);
+            const std::size_t matchEnd = size - LastLiterals;
+            std::size_t position = 1;
+            
+            while (position + MatchLimit < size)
+            {
+                const uint32_t sequence = read32(source + position);
+                const uint32_t key = hash(sequence);
+                const std::size_t candidate = table[key];
+                table[key] = static_cast<uint32_t>(position);
+                
+                if (position - candidate > MaxOffset || read32(source + candidate) != sequence)
+                {
+                    position++;
+                    continue;
+                }
+                
+                std::size_t length = MinMatch;
+                
+                while (position + length < matchEnd && source[candidate + length] == source[position + length])
+                    length++;
+                
+                writeSequence(output, source + anchor, position - anchor, position - candidate, length);
+                position += length;
+                anchor = position;
+            }
+        }
+        
+        writeSequence(output, source + anchor, size - anchor, 0, 0);
+        return static_cast<std::size_t>(output - destination);
+    }
+    
+    bool lz4Decompress(const uint8_t* source, std::size_t sourceSize, uint8_t* destination, std::size_t size)
+    {
+        const uint8_t* input = source;
+        const uint8_t* inputEnd = source + sourceSize;
+        uint8_t* output = destination;
+        uint8_t* outputEnd = destination + size;
+        
+        while (input < inputEnd)
+        {
+            const uint8_t token = *input++;
+            std::size_t literalLength = token >> 4;
+            
+            if (literalLength == 15 && ! readLength(input, inputEnd, literalLength))
+                return false;
+            
+            if (literalLength > static_cast<std::size_t>(inputEnd - input) ||
+                literalLength > static_cast<std::size_t>(outputEnd - output))
+                return false;
+            
+            std::memcpy(output, input, literalLength);
+            input += literalLength;
+            output += literalLength;
+            
+            // The last sequence only has literals
+            if (input == inputEnd)
+                break;
+            
+            if (inputEnd - input < 2)
+                return false;
+            
+            const std::size_t offset = input[0] | (input[1] << 8);
+            input += 2;
+            std::size_t matchLength = token & 15;
+            
+            if (matchLength == 15 && ! readLength(input, inputEnd, matchLength))
+                return false;
+            
+            matchLength += MinMatch;
+            
+            if (offset == 0 || offset > static_cast<std::size_t>(output - destination) ||
+                matchLength > static_cast<std::size_t>(outputEnd - output))
+                return false;
+            
+            const uint8_t* match = output - offset;
+            
+            // Overlapping matches repeat the bytes being written
+            if (offset >= matchLength)
+            {
+                std::memcpy(output, match, matchLength);
+                output += matchLength;
+            }
+            else
+            {
+                for (std::size_t i = 0; i < matchLength; i++)
+                    *output++ = *match++;
+            }
+        }
+        
+        return output == outputEnd;
+    }
+}
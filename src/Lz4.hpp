@@ -0,0 +1,60 @@
+
+/*
+ *  Lz4.hpp
+ *  sfeMovie project
+ *
+ *  Copyright (C) 2010-2015 Lucas Soltic
+ *  lucas.soltic@orange.fr
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ *
+ */
+
+#ifndef SFEMOVIE_LZ4_HPP
+#define SFEMOVIE_LZ4_HPP
+
+#include <cstddef>
+#include <stdint.h>
+
+namespace sfe
+{
+    /** Return the largest size that lz4Compress() can output for @a size bytes of input
+     */
+    std::size_t lz4CompressBound(std::size_t size);
+    
+    /** Compress @a size bytes into an LZ4 block
+     *
+     * Matches are only searched with a small hash table: the compression ratio is lower than the one
+     * of the reference implementation, but the output can be read by any LZ4 block decoder
+     *
+     * @param source the data to compress
+     * @param size the size of @a source in bytes
+     * @param destination the output buffer, at least lz4CompressBound(size) bytes long
+     * @return the size of the compressed block in bytes
+     */
+    std::size_t lz4Compress(const uint8_t* source, std::size_t size, uint8_t* destination);
+    
+    /** Decompress an LZ4 block
+     *
+     * @param source the compressed block
+     * @param sourceSize the size of @a source in bytes
+     * @param destination the output buffer
+     * @param size the exact decompressed size in bytes
+     * @return true on success, false if the block is invalid or doesn't decompress to @a size bytes
+     */
+    bool lz4Decompress(const uint8_t* source, std::size_t sourceSize, uint8_t* destination, std::size_t size);
+}
+
+#endif
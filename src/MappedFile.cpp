@@ -0,0 +1,167 @@
+
+/*
+ *  MappedFile.cpp
+ *  sfeMovie project
+ *
+ *  Copyright (C) 2010-2015 Lucas Soltic
+ *  lucas.soltic@orange.fr
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ *
+ */
+
+#include "MappedFile.hpp"
+
+#if defined(SFML_SYSTEM_WINDOWS)
+    #ifndef WIN32_LEAN_AND_MEAN
+    #define WIN32_LEAN_AND_MEAN
+    #endif
+    #include <windows.h>
+#else
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+namespace sfe
+{
+    MappedFile::MappedFile() :
+    m_data(nullptr),
+    m_size(0),
+    m_mapping(nullptr)
+    {
+    }
+    
+    MappedFile::~MappedFile()
+    {
+        close();
+    }
+    
+#if defined(SFML_SYSTEM_WINDOWS)
+    bool MappedFile::open(const std::string& path)
+    {
+        close();
+        
+        HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr,
+                                  OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        
+        if (file == INVALID_HANDLE_VALUE)
+            return false;
+        
+        LARGE_INTEGER size;
+        
+        if (! GetFileSizeEx(file, &size))
+        {
+            CloseHandle(file);
+            return false;
+        }
+        
+        // Empty files cannot be mapped, but they are valid
+        if (size.QuadPart == 0)
+        {
+            CloseHandle(file);
+            return true;
+        }
+        
+        HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        CloseHandle(file);
+        
+        if (! mapping)
+            return false;
+        
+        const void* data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+        
+        if (! data)
+        {
+            CloseHandle(mapping);
+            return false;
+        }
+        
+        m_data = static_cast<const uint8_t*>(data);
+        m_size = static_cast<std::size_t>(size.QuadPart);
+        m_mapping = mapping;
+        return true;
+    }
+    
+    void MappedFile::close()
+    {
+        if (m_data)
+            UnmapViewOfFile(m_data);
+        
+        if (m_mapping)
+            CloseHandle(m_mapping);
+        
+        m_data = nullptr;
+        m_size = 0;
+        m_mapping = nullptr;
+    }
+#else
+    bool MappedFile::open(const std::string& path)
+    {
+        close();
+        
+        int descriptor = ::open(path.c_str(), O_RDONLY);
+        
+        if (descriptor < 0)
+            return false;
+        
+        struct stat info;
+        
+        if (fstat(descriptor, &info) != 0)
+        {
+            ::close(descriptor);
+            return false;
+        }
+        
+        // Empty files cannot be mapped, but they are valid
+        if (info.st_size == 0)
+        {
+            ::close(descriptor);
+            return true;
+        }
+        
+        // The mapping stays valid once the descriptor is closed
+        void* data = mmap(nullptr, static_cast<std::size_t>(info.st_size), PROT_READ, MAP_SHARED, descriptor, 0);
+        ::close(descriptor);
+        
+        if (data == MAP_FAILED)
+            return false;
+        
+        m_data = static_cast<const uint8_t*>(data);
+        m_size = static_cast<std::size_t>(info.st_size);
+        return true;
+    }
+    
+    void MappedFile::close()
+    {
+        if (m_data)
+            munmap(const_cast<uint8_t*>(m_data), m_size);
+        
+        m_data = nullptr;
+        m_size = 0;
+    }
+#endif
+    
+    const uint8_t* MappedFile::getData() const
+    {
+        return m_data;
+    }
+    
+    std::size_t MappedFile::getSize() const
+    {
+        return m_size;
+    }
+}
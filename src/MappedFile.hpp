@@ -0,0 +1,73 @@
+
+/*
+ *  MappedFile.hpp
+ *  sfeMovie project
+ *
+ *  Copyright (C) 2010-2015 Lucas Soltic
+ *  lucas.soltic@orange.fr
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ *
+ */
+
+#ifndef SFEMOVIE_MAPPEDFILE_HPP
+#define SFEMOVIE_MAPPEDFILE_HPP
+
+#include <SFML/System.hpp>
+#include <cstddef>
+#include <string>
+#include <stdint.h>
+
+namespace sfe
+{
+    /** Read-only memory mapping of a whole file
+     */
+    class MappedFile : public sf::NonCopyable
+    {
+    public:
+        /** Default constructor
+         */
+        MappedFile();
+        
+        /** Default destructor, unmaps the file
+         */
+        ~MappedFile();
+        
+        /** Map the file at @a path, unmapping the previously mapped one if any
+         *
+         * @return true on success, false if the file could not be opened or mapped
+         */
+        bool open(const std::string& path);
+        
+        /** Unmap the file, if any
+         */
+        void close();
+        
+        /** @return the file content, or nullptr if no file is mapped or the mapped file is empty
+         */
+        const uint8_t* getData() const;
+        
+        /** @return the size of the mapped file in bytes
+         */
+        std::size_t getSize() const;
+        
+    private:
+        const uint8_t* m_data;
+        std::size_t m_size;
+        void* m_mapping; // Only used on Windows, where the mapping object must outlive the view
+    };
+}
+
+#endif
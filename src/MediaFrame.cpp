@@ -0,0 +1,134 @@
+
+/*
+ *  MediaFrame.cpp
+ *  sfeMovie project
+ *
+ *  Copyright (C) 2010-2015 Lucas Soltic
+ *  lucas.soltic@orange.fr
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ *
+ */
+
+#include <sfeMovie/MediaFrame.hpp>
+extern "C"
+{
+#include <libavutil/frame.h>
+#include <libavutil/pixdesc.h>
+#include <libavutil/samplefmt.h>
+}
+
+namespace sfe
+{
+    MediaFrame::MediaFrame() :
+    m_frame(),
+    m_type(Unknown),
+    m_position()
+    {
+    }
+    
+    MediaFrame::MediaFrame(AVFrame* frame, MediaType type, sf::Time position) :
+    m_frame(frame, [](const AVFrame* frame)
+    {
+        AVFrame* ownedFrame = const_cast<AVFrame*>(frame);
+        av_frame_free(&ownedFrame);
+    }),
+    m_type(type),
+    m_position(position)
+    {
+    }
+    
+    bool MediaFrame::isEmpty() const
+    {
+        return m_frame == nullptr;
+    }
+    
+    MediaType MediaFrame::getMediaType() const
+    {
+        return m_type;
+    }
+    
+    sf::Time MediaFrame::getPosition() const
+    {
+        return m_position;
+    }
+    
+    int MediaFrame::getFormat() const
+    {
+        return m_frame ? m_frame->format : -1;
+    }
+    
+    sf::Vector2i MediaFrame::getSize() const
+    {
+        if (m_type != Video || ! m_frame)
+            return sf::Vector2i();
+        
+        return sf::Vector2i(m_frame->width, m_frame->height);
+    }
+    
+    unsigned int MediaFrame::getSampleCount() const
+    {
+        return m_type == Audio ? static_cast<unsigned int>(m_frame->nb_samples) : 0;
+    }
+    
+    unsigned int MediaFrame::getChannelCount() const
+    {
+        return m_type == Audio ? static_cast<unsigned int>(m_frame->channels) : 0;
+    }
+    
+    unsigned int MediaFrame::getSampleRate() const
+    {
+        return m_type == Audio ? static_cast<unsigned int>(m_frame->sample_rate) : 0;
+    }
+    
+    unsigned int MediaFrame::getPlaneCount() const
+    {
+        if (! m_frame)
+            return 0;
+        
+        if (m_type == Audio)
+        {
+            if (av_sample_fmt_is_planar(static_cast<AVSampleFormat>(m_frame->format)))
+                return getChannelCount();
+            
+            return 1;
+        }
+        
+        int planeCount = av_pix_fmt_count_planes(static_cast<AVPixelFormat>(m_frame->format));
+        return planeCount > 0 ? static_cast<unsigned int>(planeCount) : 0;
+    }
+    
+    const sf::Uint8* MediaFrame::getData(unsigned int plane) const
+    {
+        if (plane >= getPlaneCount())
+            return nullptr;
+        
+        // Audio frames with many channels only have all their planes in extended_data
+        return m_frame->extended_data[plane];
+    }
+    
+    int MediaFrame::getLineSize(unsigned int plane) const
+    {
+        if (plane >= getPlaneCount())
+            return 0;
+        
+        return m_type == Audio ? m_frame->linesize[0] : m_frame->linesize[plane];
+    }
+    
+    const AVFrame* MediaFrame::getAVFrame() const
+    {
+        return m_frame.get();
+    }
+}
@@ -24,6 +24,8 @@
 
 #include <sfeMovie/Movie.hpp>
 #include "MovieImpl.hpp"
+#include "ThumbnailExtractor.hpp"
+#include "FastDecodeFile.hpp"
 
 
 namespace sfe
@@ -43,6 +45,46 @@ namespace sfe
         return m_impl->openFromFile(filename);
     }
     
+    void Movie::openFromFileAsync(const std::string& filename, OpenCallback callback, bool prepare)
+    {
+        m_impl->openFromFileAsync(filename, callback, prepare);
+    }
+    
+    bool Movie::isOpening() const
+    {
+        return m_impl->isOpening();
+    }
+    
+    void Movie::setAudioSettings(const AudioSettings& settings)
+    {
+        m_impl->setAudioSettings(settings);
+    }
+    
+    const AudioSettings& Movie::getAudioSettings() const
+    {
+        return m_impl->getAudioSettings();
+    }
+    
+    void Movie::setPacketCacheLimit(std::size_t bytes)
+    {
+        m_impl->setPacketCacheLimit(bytes);
+    }
+    
+    std::size_t Movie::getPacketCacheLimit() const
+    {
+        return m_impl->getPacketCacheLimit();
+    }
+    
+    void Movie::setClock(std::shared_ptr<Clock> clock)
+    {
+        m_impl->setClock(clock);
+    }
+    
+    std::shared_ptr<Clock> Movie::getClock() const
+    {
+        return m_impl->getClock();
+    }
+    
     const Streams& Movie::getStreams(MediaType type) const
     {
         return m_impl->getStreams(type);
@@ -53,6 +95,11 @@ namespace sfe
         return m_impl->selectStream(streamDescriptor);
     }
     
+    void Movie::prepare()
+    {
+        m_impl->prepare();
+    }
+    
     void Movie::play()
     {
         m_impl->play();
@@ -77,6 +124,12 @@ namespace sfe
     }
     
     
+    sf::Time Movie::getTimeUntilNextFrame() const
+    {
+        return m_impl->getTimeUntilNextFrame();
+    }
+    
+    
     void Movie::setVolume(float volume)
     {
         m_impl->setVolume(volume);
@@ -148,12 +201,107 @@ namespace sfe
         return m_impl->setPlayingOffset(targetSeekTime);
     }
     
+    void Movie::setAudioMasterClock(bool enabled)
+    {
+        m_impl->setAudioMasterClock(enabled);
+    }
+    
+    bool Movie::getAudioMasterClock() const
+    {
+        return m_impl->getAudioMasterClock();
+    }
+    
+    void Movie::setSharedDecoding(bool enabled)
+    {
+        m_impl->setSharedDecoding(enabled);
+    }
+    
+    bool Movie::getSharedDecoding() const
+    {
+        return m_impl->getSharedDecoding();
+    }
+    
+    void Movie::setFrameTap(FrameTap tap)
+    {
+        m_impl->setFrameTap(tap);
+    }
+    
+    void Movie::setDecodingPriority(int priority)
+    {
+        m_impl->setDecodingPriority(priority);
+    }
+    
+    int Movie::getDecodingPriority() const
+    {
+        return m_impl->getDecodingPriority();
+    }
+    
+    void Movie::setSharedDecodingThreadCount(unsigned int threadCount)
+    {
+        MovieImpl::setSharedDecodingThreadCount(threadCount);
+    }
+    
+    void Movie::setFrameCacheBudget(std::size_t bytes)
+    {
+        MovieImpl::setFrameCacheBudget(bytes);
+    }
+    
+    std::size_t Movie::getFrameCacheBudget()
+    {
+        return MovieImpl::getFrameCacheBudget();
+    }
+    
+    void Movie::setFastDecodeFilesEnabled(bool enabled)
+    {
+        MovieImpl::setFastDecodeFilesEnabled(enabled);
+    }
+    
+    bool Movie::areFastDecodeFilesEnabled()
+    {
+        return MovieImpl::areFastDecodeFilesEnabled();
+    }
+    
+    bool Movie::createFastDecodeFile(const std::string& filename)
+    {
+        return FastDecodeFile::create(filename);
+    }
+    
+    Thumbnails Movie::extractThumbnails(const std::string& filename, unsigned int count, sf::Vector2u size)
+    {
+        return ThumbnailExtractor(filename, size).extract(count);
+    }
+    
+    Thumbnails Movie::extractThumbnails(const std::string& filename, sf::Time interval, sf::Vector2u size)
+    {
+        return ThumbnailExtractor(filename, size).extract(interval);
+    }
+    
     
     const sf::Texture& Movie::getCurrentImage() const
     {
         return m_impl->getCurrentImage();
     }
     
+    bool Movie::decodeAudio(sf::SoundBuffer& buffer) const
+    {
+        return m_impl->decodeAudio(buffer);
+    }
+    
+    bool Movie::decodeAudio(std::vector<sf::Int16>& samples) const
+    {
+        return m_impl->decodeAudio(samples);
+    }
+    
+    bool Movie::decodeAudio(std::vector<float>& samples, SampleFormat format) const
+    {
+        return m_impl->decodeAudio(samples, format);
+    }
+    
+    std::shared_ptr<const PeakSummary> Movie::getPeakSummary(bool useDiskCache) const
+    {
+        return m_impl->getPeakSummary(useDiskCache);
+    }
+    
     void Movie::draw(sf::RenderTarget& target, sf::RenderStates states) const
     {
         states.transform *= getTransform();
@@ -24,10 +24,17 @@
 
 #include "MovieImpl.hpp"
 #include "Demuxer.hpp"
+#include "AudioTrackDecoder.hpp"
+#include "PeakSummaryImpl.hpp"
 #include "Timer.hpp"
+#include "DecodePool.hpp"
+#include "FastDecodeFile.hpp"
+#include "FrameCache.hpp"
 #include "Log.hpp"
 #include "Utilities.hpp"
+#include <algorithm>
 #include <cmath>
+#include <limits>
 #include <iostream>
 
 #define LAYOUT_DEBUGGER_ENABLED 0
@@ -36,62 +43,266 @@ namespace sfe
 {
     MovieImpl::MovieImpl(sf::Transformable& movieView) :
     m_movieView(movieView),
+    m_filename(),
     m_demuxer(nullptr),
     m_timer(nullptr),
-    m_videoSprite()
+    m_videoSprite(),
+    m_peakSummary(),
+    m_audioMasterClock(false),
+    m_audioSettings(),
+    m_packetCacheLimit(0),
+    m_clock(),
+    m_sharedDecoding(false),
+    m_decodingPriority(0),
+    m_frameTap(),
+    m_openingThread(),
+    m_openingMutex(),
+    m_openingFilename(),
+    m_openingCallback(),
+    m_openedMedia(),
+    m_openingCancelled(),
+    m_openingDone(false),
+    m_openingSucceeded(false)
     {
     }
     
     MovieImpl::~MovieImpl()
     {
+        cancelAsyncOpen();
+        
         if (m_timer && m_timer->getStatus() != Stopped)
             stop();
     }
     
     bool MovieImpl::openFromFile(const std::string& filename)
     {
+        cancelAsyncOpen();
+        
+        LoadedMedia media;
+        if (! loadMedia(filename, m_clock, m_audioSettings, m_packetCacheLimit, *this, false, false, nullptr, media))
+            return false;
+        
+        installMedia(filename, media);
+        return true;
+    }
+    
+    void MovieImpl::openFromFileAsync(const std::string& filename, Movie::OpenCallback callback, bool prepare)
+    {
+        cancelAsyncOpen();
+        
+        m_openingFilename = filename;
+        m_openingCallback = callback;
+        m_openedMedia = std::make_shared<LoadedMedia>();
+        m_openingCancelled = std::make_shared<std::atomic<bool> >(false);
+        m_openingDone = false;
+        m_openingSucceeded = false;
+        
+        // The settings are copied so that they can be changed while opening
+        std::shared_ptr<LoadedMedia> media = m_openedMedia;
+        std::shared_ptr<const std::atomic<bool> > cancelled = m_openingCancelled;
+        std::shared_ptr<Clock> clock = m_clock;
+        AudioSettings audioSettings = m_audioSettings;
+        std::size_t packetCacheLimit = m_packetCacheLimit;
+        
+        m_openingThread = std::thread([this, filename, clock, audioSettings, packetCacheLimit, prepare, cancelled, media]()
+        {
+            bool success = loadMedia(filename, clock, audioSettings, packetCacheLimit, *this, true, prepare,
+                                     cancelled, *media);
+            
+            std::lock_guard<std::mutex> lock(m_openingMutex);
+            m_openingDone = true;
+            m_openingSucceeded = success;
+        });
+    }
+    
+    bool MovieImpl::isOpening() const
+    {
+        return m_openingThread.joinable();
+    }
+    
+    bool MovieImpl::loadMedia(const std::string& filename, std::shared_ptr<Clock> clock,
+                              const AudioSettings& audioSettings, std::size_t packetCacheLimit,
+                              VideoStream::Delegate& delegate, bool decodePoster, bool prepare,
+                              std::shared_ptr<const std::atomic<bool> > cancelled, LoadedMedia& media)
+    {
+        // Checked between the steps, the I/O of the current step being aborted by the demuxer
+        auto isCancelled = [&cancelled, &filename]()
+        {
+            if (! cancelled || ! *cancelled)
+                return false;
+            
+            sfeLogDebug("Movie::openFromFileAsync() - opening of " + filename + " cancelled");
+            return true;
+        };
+        
         try
         {
-            m_timer = std::make_shared<Timer>();
-            m_demuxer = std::make_shared<Demuxer>(filename, m_timer, *this);
-            m_audioStreamsDesc = m_demuxer->computeStreamDescriptors(Audio);
-            m_videoStreamsDesc = m_demuxer->computeStreamDescriptors(Video);
-
-            std::set< std::shared_ptr<Stream> > audioStreams = m_demuxer->getStreamsOfType(Audio);
-            std::set< std::shared_ptr<Stream> > videoStreams = m_demuxer->getStreamsOfType(Video);
-
-            m_demuxer->selectFirstAudioStream();
-            m_demuxer->selectFirstVideoStream();
+            media.timer = std::make_shared<Timer>(clock);
+            media.demuxer = std::make_shared<Demuxer>(filename, media.timer, delegate, audioSettings, cancelled);
+            media.audioStreamsDesc = media.demuxer->computeStreamDescriptors(Audio);
+            media.videoStreamsDesc = media.demuxer->computeStreamDescriptors(Video);
+            media.subtitleStreamsDesc = media.demuxer->computeStreamDescriptors(Subtitle);
+            media.hasPoster = false;
+            
+            media.demuxer->selectFirstAudioStream();
+            media.demuxer->selectFirstVideoStream();
+            
+            if (isCancelled())
+                return false;
+            
+            if (packetCacheLimit > 0)
+                media.demuxer->loadPacketCache(packetCacheLimit);
+            
+            if (isCancelled())
+                return false;
             
-            if (audioStreams.empty() && videoStreams.empty())
+            if (media.audioStreamsDesc.empty() && media.videoStreamsDesc.empty())
             {
                 sfeLogError("Movie::openFromFile() - No supported audio or video stream in this media");
                 return false;
             }
-            else
+            
+            std::shared_ptr<VideoStream> videoStream = media.demuxer->getSelectedVideoStream();
+            
+            if (decodePoster && videoStream)
+            {
+                videoStream->preload();
+                media.hasPoster = true;
+            }
+            
+            if (prepare)
             {
-                if (!videoStreams.empty())
+                for (std::shared_ptr<Stream> stream : media.demuxer->getSelectedStreams())
                 {
-                    sf::Vector2f size = getSize();
-                    m_displayFrame = sf::FloatRect(0, 0, size.x, size.y);
+                    if (isCancelled())
+                        return false;
+                    
+                    stream->prepare();
                 }
-                
-                return true;
             }
+            
+            return ! isCancelled();
         }
         catch (std::runtime_error& e)
         {
-            sfeLogError(e.what());
+            // Aborted I/O makes FFmpeg fail, which is expected
+            if (! isCancelled())
+                sfeLogError(e.what());
+            
             return false;
         }
     }
     
+    void MovieImpl::installMedia(const std::string& filename, const LoadedMedia& media)
+    {
+        // The sprite must not keep pointing to the texture of the previous media
+        m_videoSprite = sf::Sprite();
+        
+        m_timer = media.timer;
+        m_demuxer = media.demuxer;
+        m_demuxer->setAudioMasterClock(m_audioMasterClock);
+        m_filename = filename;
+        m_peakSummary.reset();
+        m_audioStreamsDesc = media.audioStreamsDesc;
+        m_videoStreamsDesc = media.videoStreamsDesc;
+        m_subtitleStreamsDesc = media.subtitleStreamsDesc;
+        
+        for (const std::pair<const int, std::shared_ptr<Stream> >& pair : m_demuxer->getStreams())
+            pair.second->setFrameTap(m_frameTap);
+        
+        std::set< std::shared_ptr<Stream> > videoStreams = m_demuxer->getStreamsOfType(Video);
+        
+        if (m_sharedDecoding && !videoStreams.empty())
+        {
+            std::shared_ptr<DecodePool> pool = DecodePool::getShared();
+            
+            for (std::shared_ptr<Stream> stream : videoStreams)
+                std::static_pointer_cast<VideoStream>(stream)->setDecodePool(pool, m_decodingPriority);
+        }
+        
+        if (!videoStreams.empty())
+        {
+            sf::Vector2f size = getSize();
+            m_displayFrame = sf::FloatRect(0, 0, size.x, size.y);
+        }
+        
+        std::shared_ptr<VideoStream> videoStream = m_demuxer->getSelectedVideoStream();
+        
+        if (media.hasPoster && videoStream)
+            didUpdateVideo(*videoStream, videoStream->getVideoTexture());
+    }
+    
+    void MovieImpl::finishAsyncOpen()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_openingMutex);
+            if (! m_openingDone)
+                return;
+        }
+        
+        m_openingThread.join();
+        
+        std::shared_ptr<LoadedMedia> media = m_openedMedia;
+        Movie::OpenCallback callback = m_openingCallback;
+        bool success = m_openingSucceeded;
+        m_openedMedia.reset();
+        m_openingCallback = Movie::OpenCallback();
+        
+        if (success)
+            installMedia(m_openingFilename, *media);
+        
+        if (callback)
+            callback(success);
+    }
+    
+    void MovieImpl::cancelAsyncOpen()
+    {
+        if (m_openingThread.joinable())
+        {
+            *m_openingCancelled = true;
+            m_openingThread.join();
+            m_openedMedia.reset();
+            m_openingCallback = Movie::OpenCallback();
+        }
+    }
+    
+    void MovieImpl::setAudioSettings(const AudioSettings& settings)
+    {
+        m_audioSettings = settings;
+    }
+    
+    const AudioSettings& MovieImpl::getAudioSettings() const
+    {
+        return m_audioSettings;
+    }
+    
+    void MovieImpl::setPacketCacheLimit(std::size_t bytes)
+    {
+        m_packetCacheLimit = bytes;
+    }
+    
+    std::size_t MovieImpl::getPacketCacheLimit() const
+    {
+        return m_packetCacheLimit;
+    }
+    
+    void MovieImpl::setClock(std::shared_ptr<Clock> clock)
+    {
+        m_clock = clock;
+    }
+    
+    std::shared_ptr<Clock> MovieImpl::getClock() const
+    {
+        return m_clock;
+    }
+    
     const Streams& MovieImpl::getStreams(MediaType type) const
     {
         switch (type)
         {
             case Audio: return m_audioStreamsDesc;
             case Video: return m_videoStreamsDesc;
+            case Subtitle: return m_subtitleStreamsDesc;
             default: CHECK(false, "Movie::getStreams() - Unknown stream type:" + mediaTypeToString(type));
         }
     }
@@ -104,7 +315,8 @@ namespace sfe
             return false;
         }
         
-        if (m_timer->getStatus() != Stopped)
+        // Audio streams are switched while playing without interrupting the playback
+        if (m_timer->getStatus() != Stopped && !(streamDescriptor.type == Audio && m_timer->getStatus() == Playing))
         {
             sfeLogError("Movie::selectStream() - cannot select a stream while media is not stopped");
             return false;
@@ -127,6 +339,9 @@ namespace sfe
             case Video:
                 m_demuxer->selectVideoStream(std::dynamic_pointer_cast<VideoStream>(streamToSelect));
                 return true;
+            case Subtitle:
+                m_demuxer->selectSubtitleStream(std::dynamic_pointer_cast<SubtitleStream>(streamToSelect));
+                return true;
             default:
                 sfeLogWarning("Movie::selectStream() - stream activation for stream of kind "
                               + mediaTypeToString(it->second->getStreamKind()) + " is not supported");
@@ -134,6 +349,30 @@ namespace sfe
         }
     }
     
+    void MovieImpl::prepare()
+    {
+        if (m_demuxer && m_timer)
+        {
+            if (m_timer->getStatus() != Stopped)
+            {
+                sfeLogError("Movie::prepare() - media is not stopped");
+                return;
+            }
+            
+            for (std::shared_ptr<Stream> stream : m_demuxer->getSelectedStreams())
+                stream->prepare();
+            
+            std::shared_ptr<VideoStream> videoStream = m_demuxer->getSelectedVideoStream();
+            
+            if (videoStream)
+                didUpdateVideo(*videoStream, videoStream->getVideoTexture());
+        }
+        else
+        {
+            sfeLogError("Movie::prepare() - No media loaded, cannot prepare");
+        }
+    }
+    
     void MovieImpl::play()
     {
         if (m_demuxer && m_timer)
@@ -187,8 +426,9 @@ namespace sfe
             
             std::shared_ptr<VideoStream> videoStream(m_demuxer->getSelectedVideoStream());
             
+            // The first frame is shown again from the next update() rather than decoded from stop()
             if (videoStream)
-                videoStream->preload();
+                videoStream->requestPreload();
         }
         else
         {
@@ -198,6 +438,8 @@ namespace sfe
     
     void MovieImpl::update()
     {
+        finishAsyncOpen();
+        
         if (m_demuxer && m_timer)
         {
             m_demuxer->update();
@@ -233,6 +475,35 @@ namespace sfe
         }
     }
     
+    sf::Time MovieImpl::getTimeUntilNextFrame() const
+    {
+        // While audio is starting the timer doesn't move, so it can't tell when frames will be due
+        static const sf::Time StartingPollingInterval = sf::milliseconds(5);
+        static const sf::Time NoUpdateNeeded = sf::microseconds(std::numeric_limits<sf::Int64>::max());
+        
+        if (!m_demuxer || !m_timer || m_timer->getStatus() != Playing)
+            return NoUpdateNeeded;
+        
+        sf::Time delay;
+        
+        if (m_timer->getTimeUntilNextWakeUp(delay))
+        {
+            if (m_timer->isStarting())
+                delay = std::min(delay, StartingPollingInterval);
+            
+            return delay;
+        }
+        
+        // The next video frame isn't known until update() looks for it
+        if (m_demuxer->getSelectedVideoStream())
+            return sf::Time::Zero;
+        
+        if (m_timer->isStarting())
+            return StartingPollingInterval;
+        
+        return std::max(sf::Time::Zero, getDuration() - getPlayingOffset());
+    }
+    
     void MovieImpl::setVolume(float volume)
     {
         if (m_demuxer && m_timer)
@@ -443,6 +714,81 @@ namespace sfe
         return seekingResult;
     }
     
+    void MovieImpl::setAudioMasterClock(bool enabled)
+    {
+        m_audioMasterClock = enabled;
+        
+        if (m_demuxer)
+            m_demuxer->setAudioMasterClock(enabled);
+    }
+    
+    bool MovieImpl::getAudioMasterClock() const
+    {
+        return m_audioMasterClock;
+    }
+    
+    void MovieImpl::setSharedDecoding(bool enabled)
+    {
+        m_sharedDecoding = enabled;
+    }
+    
+    bool MovieImpl::getSharedDecoding() const
+    {
+        return m_sharedDecoding;
+    }
+    
+    void MovieImpl::setFrameTap(Movie::FrameTap tap)
+    {
+        m_frameTap = tap;
+        
+        if (m_demuxer)
+        {
+            for (const std::pair<const int, std::shared_ptr<Stream> >& pair : m_demuxer->getStreams())
+                pair.second->setFrameTap(tap);
+        }
+    }
+    
+    void MovieImpl::setDecodingPriority(int priority)
+    {
+        m_decodingPriority = priority;
+        
+        if (m_demuxer)
+        {
+            for (std::shared_ptr<Stream> stream : m_demuxer->getStreamsOfType(Video))
+                std::static_pointer_cast<VideoStream>(stream)->setDecodingPriority(priority);
+        }
+    }
+    
+    int MovieImpl::getDecodingPriority() const
+    {
+        return m_decodingPriority;
+    }
+    
+    void MovieImpl::setSharedDecodingThreadCount(unsigned int threadCount)
+    {
+        DecodePool::setSharedThreadCount(threadCount);
+    }
+    
+    void MovieImpl::setFrameCacheBudget(std::size_t bytes)
+    {
+        FrameCache::setBudget(bytes);
+    }
+    
+    std::size_t MovieImpl::getFrameCacheBudget()
+    {
+        return FrameCache::getBudget();
+    }
+    
+    void MovieImpl::setFastDecodeFilesEnabled(bool enabled)
+    {
+        FastDecodeFile::setEnabled(enabled);
+    }
+    
+    bool MovieImpl::areFastDecodeFilesEnabled()
+    {
+        return FastDecodeFile::isEnabled();
+    }
+    
     const sf::Texture& MovieImpl::getCurrentImage() const
     {
         static sf::Texture emptyTexture;
@@ -457,9 +803,146 @@ namespace sfe
         }
     }
     
+    bool MovieImpl::decodeAudio(sf::SoundBuffer& buffer) const
+    {
+        std::vector<sf::Int16> samples;
+        unsigned channelCount = 0;
+        unsigned sampleRate = 0;
+        
+        if (! decodeAudio(samples, channelCount, sampleRate))
+            return false;
+        
+        if (! buffer.loadFromSamples(samples.empty() ? nullptr : &samples[0], samples.size(), channelCount, sampleRate))
+        {
+            sfeLogError("Movie::decodeAudio() - could not load the decoded samples into the sound buffer");
+            return false;
+        }
+        
+        return true;
+    }
+    
+    bool MovieImpl::decodeAudio(std::vector<sf::Int16>& samples) const
+    {
+        unsigned channelCount = 0;
+        unsigned sampleRate = 0;
+        
+        return decodeAudio(samples, channelCount, sampleRate);
+    }
+    
+    bool MovieImpl::decodeAudio(std::vector<float>& samples, SampleFormat format) const
+    {
+        if (format != FloatSamples && format != PlanarFloatSamples)
+        {
+            sfeLogError("Movie::decodeAudio() - float samples can only be decoded as FloatSamples or PlanarFloatSamples");
+            return false;
+        }
+        
+        return decodeSelectedAudio([&samples, format](AudioTrackDecoder& decoder)
+        {
+            decoder.decode(samples, format);
+        });
+    }
+    
+    bool MovieImpl::decodeAudio(std::vector<sf::Int16>& samples, unsigned& channelCount, unsigned& sampleRate) const
+    {
+        return decodeSelectedAudio([&samples, &channelCount, &sampleRate](AudioTrackDecoder& decoder)
+        {
+            decoder.decode(samples);
+            channelCount = decoder.getChannelCount();
+            sampleRate = decoder.getSampleRate();
+        });
+    }
+    
+    bool MovieImpl::decodeSelectedAudio(const std::function<void(AudioTrackDecoder&)>& decode) const
+    {
+        if (!m_demuxer)
+        {
+            sfeLogError("Movie::decodeAudio() - No media loaded, cannot decode audio");
+            return false;
+        }
+        
+        const int streamIndex = getSelectedAudioStreamIndex();
+        
+        if (streamIndex < 0)
+        {
+            sfeLogError("Movie::decodeAudio() - No audio stream selected, cannot decode audio");
+            return false;
+        }
+        
+        try
+        {
+            // The decoder uses its own media context so that playback isn't disturbed
+            AudioTrackDecoder decoder(m_filename, streamIndex, m_audioSettings);
+            decode(decoder);
+            return true;
+        }
+        catch (std::runtime_error& e)
+        {
+            sfeLogError(e.what());
+            return false;
+        }
+    }
+    
+    std::shared_ptr<const PeakSummary> MovieImpl::getPeakSummary(bool useDiskCache) const
+    {
+        if (!m_demuxer)
+        {
+            sfeLogError("Movie::getPeakSummary() - No media loaded, cannot summarize audio");
+            return nullptr;
+        }
+        
+        const int streamIndex = getSelectedAudioStreamIndex();
+        
+        if (streamIndex < 0)
+        {
+            sfeLogError("Movie::getPeakSummary() - No audio stream selected, cannot summarize audio");
+            return nullptr;
+        }
+        
+        if (!m_peakSummary || m_peakSummary->m_impl->getStreamIndex() != streamIndex)
+        {
+            std::shared_ptr<PeakSummaryImpl> impl = std::make_shared<PeakSummaryImpl>(m_filename, streamIndex,
+                                                                                      useDiskCache ? m_filename + ".sfepeaks" : "");
+            m_peakSummary.reset(new PeakSummary(impl));
+        }
+        
+        return m_peakSummary;
+    }
+    
+    int MovieImpl::getSelectedAudioStreamIndex() const
+    {
+        std::shared_ptr<AudioStream> audioStream = m_demuxer->getSelectedAudioStream();
+        
+        if (audioStream)
+        {
+            for (const auto& pair : m_demuxer->getStreams())
+            {
+                if (pair.second == audioStream)
+                    return pair.first;
+            }
+        }
+        
+        return -1;
+    }
+    
     void MovieImpl::draw(sf::RenderTarget& target, sf::RenderStates states) const
     {
         target.draw(m_videoSprite, states);
+        
+        std::shared_ptr<SubtitleStream> subtitleStream = m_demuxer ? m_demuxer->getSelectedSubtitleStream() : nullptr;
+        
+        // The overlay has the size of the video frame, so it is laid out like the video
+        if (subtitleStream && subtitleStream->hasVisibleSubtitles() && m_videoSprite.getTexture())
+        {
+            const sf::Texture& overlay = subtitleStream->getOverlay();
+            const sf::Vector2u videoSize = m_videoSprite.getTexture()->getSize();
+            sf::Sprite subtitleSprite(overlay);
+            
+            subtitleSprite.setPosition(m_videoSprite.getPosition());
+            subtitleSprite.setScale(m_videoSprite.getScale().x * videoSize.x / overlay.getSize().x,
+                                    m_videoSprite.getScale().y * videoSize.y / overlay.getSize().y);
+            target.draw(subtitleSprite, states);
+        }
 
 #if LAYOUT_DEBUGGER_ENABLED
         target.draw(m_debugger, states);
@@ -25,10 +25,15 @@
 #ifndef SFEMOVIE_MOVIEIMPL_HPP
 #define SFEMOVIE_MOVIEIMPL_HPP
 
+#include <atomic>
 #include <cstring>
+#include <functional>
 #include <memory>
 #include <string>
+#include <vector>
 #include <stdexcept>
+#include <mutex>
+#include <thread>
 #include <SFML/Config.hpp>
 #include "VideoStream.hpp"
 #include "DebugTools/LayoutDebugger.hpp"
@@ -36,6 +41,7 @@
 namespace sfe
 {
     class Demuxer;
+    class AudioTrackDecoder;
     
     class MovieImpl : public VideoStream::Delegate, public sf::Drawable
     {
@@ -47,6 +53,38 @@ namespace sfe
          */
         bool openFromFile(const std::string& filename);
         
+        /** @see Movie::openFromFileAsync()
+         */
+        void openFromFileAsync(const std::string& filename, Movie::OpenCallback callback, bool prepare);
+        
+        /** @see Movie::isOpening()
+         */
+        bool isOpening() const;
+        
+        /** @see Movie::setAudioSettings()
+         */
+        void setAudioSettings(const AudioSettings& settings);
+        
+        /** @see Movie::getAudioSettings()
+         */
+        const AudioSettings& getAudioSettings() const;
+        
+        /** @see Movie::setPacketCacheLimit()
+         */
+        void setPacketCacheLimit(std::size_t bytes);
+        
+        /** @see Movie::getPacketCacheLimit()
+         */
+        std::size_t getPacketCacheLimit() const;
+        
+        /** @see Movie::setClock()
+         */
+        void setClock(std::shared_ptr<Clock> clock);
+        
+        /** @see Movie::getClock()
+         */
+        std::shared_ptr<Clock> getClock() const;
+        
         
         /** @see Movie::getStreams()
          */
@@ -56,6 +94,10 @@ namespace sfe
          */
         bool selectStream(const StreamDescriptor& streamDescriptor);
         
+        /** @see Movie::prepare()
+         */
+        void prepare();
+        
         /** @see Movie::play()
          */
         void play();
@@ -76,6 +118,11 @@ namespace sfe
         void update();
         
         
+        /** @see Movie::getTimeUntilNextFrame()
+         */
+        sf::Time getTimeUntilNextFrame() const;
+        
+        
         /** @see Movie::setVolume()
          */
         void setVolume(float volume);
@@ -134,22 +181,167 @@ namespace sfe
          */
         bool setPlayingOffset(const sf::Time& targetSeekTime);
         
+        /** @see Movie::setAudioMasterClock()
+         */
+        void setAudioMasterClock(bool enabled);
+        
+        /** @see Movie::getAudioMasterClock()
+         */
+        bool getAudioMasterClock() const;
+        
+        /** @see Movie::setSharedDecoding()
+         */
+        void setSharedDecoding(bool enabled);
+        
+        /** @see Movie::getSharedDecoding()
+         */
+        bool getSharedDecoding() const;
+        
+        /** @see Movie::setFrameTap()
+         */
+        void setFrameTap(Movie::FrameTap tap);
+        
+        /** @see Movie::setDecodingPriority()
+         */
+        void setDecodingPriority(int priority);
+        
+        /** @see Movie::getDecodingPriority()
+         */
+        int getDecodingPriority() const;
+        
+        /** @see Movie::setSharedDecodingThreadCount()
+         */
+        static void setSharedDecodingThreadCount(unsigned int threadCount);
+        
+        /** @see Movie::setFrameCacheBudget()
+         */
+        static void setFrameCacheBudget(std::size_t bytes);
+        
+        /** @see Movie::getFrameCacheBudget()
+         */
+        static std::size_t getFrameCacheBudget();
+        
+        /** @see Movie::setFastDecodeFilesEnabled()
+         */
+        static void setFastDecodeFilesEnabled(bool enabled);
+        
+        /** @see Movie::areFastDecodeFilesEnabled()
+         */
+        static bool areFastDecodeFilesEnabled();
+        
         /** @see Movie::getCurrentImage()
          */
         const sf::Texture& getCurrentImage() const;
         
+        /** @see Movie::decodeAudio(sf::SoundBuffer&)
+         */
+        bool decodeAudio(sf::SoundBuffer& buffer) const;
+        
+        /** @see Movie::decodeAudio(std::vector<sf::Int16>&)
+         */
+        bool decodeAudio(std::vector<sf::Int16>& samples) const;
+        
+        /** @see Movie::decodeAudio(std::vector<float>&, SampleFormat)
+         */
+        bool decodeAudio(std::vector<float>& samples, SampleFormat format) const;
+        
+        /** @see Movie::getPeakSummary()
+         */
+        std::shared_ptr<const PeakSummary> getPeakSummary(bool useDiskCache) const;
+        
         void draw(sf::RenderTarget& target, sf::RenderStates states) const override;
         void didUpdateVideo(const VideoStream& sender, const sf::Texture& image) override;
 
     private:
+        /** Everything that is created when opening a media, before it replaces the current one
+         */
+        struct LoadedMedia
+        {
+            std::shared_ptr<Timer> timer;
+            std::shared_ptr<Demuxer> demuxer;
+            Streams audioStreamsDesc;
+            Streams videoStreamsDesc;
+            Streams subtitleStreamsDesc;
+            bool hasPoster;
+        };
+        
+        /** Open a media without touching the current one, this can be run from any thread
+         *
+         * @param filename the path to the media file
+         * @param clock the clock for the media timer, or nullptr for the system clock
+         * @param audioSettings how the audio streams convert their audio
+         * @param packetCacheLimit the maximum size of the packets to read into memory at once, 0 to read none
+         * @param delegate the delegate that will handle the images produced by the video streams
+         * @param decodePoster true to decode the first video image right away
+         * @param prepare true to also prepare the selected streams, see Movie::prepare()
+         * @param cancelled if given, opening is given up and the media I/O aborted once it becomes true
+         * @param[out] media the opened media
+         * @return true on success, false otherwise
+         */
+        static bool loadMedia(const std::string& filename, std::shared_ptr<Clock> clock,
+                              const AudioSettings& audioSettings, std::size_t packetCacheLimit,
+                              VideoStream::Delegate& delegate, bool decodePoster, bool prepare,
+                              std::shared_ptr<const std::atomic<bool> > cancelled, LoadedMedia& media);
+        
+        /** Replace the current media with @a media
+         */
+        void installMedia(const std::string& filename, const LoadedMedia& media);
+        
+        /** Install the media opened by openFromFileAsync() and call its callback, if the opening is done
+         */
+        void finishAsyncOpen();
+        
+        /** Abort the opening started by openFromFileAsync(), wait for its thread and discard its result
+         */
+        void cancelAsyncOpen();
+        
+        /** Decode the whole selected audio stream
+         *
+         * @param samples [out] the decoded samples
+         * @param channelCount [out] the channel count of the decoded samples
+         * @param sampleRate [out] the sample rate of the decoded samples
+         * @return true on success, false otherwise
+         */
+        bool decodeAudio(std::vector<sf::Int16>& samples, unsigned& channelCount, unsigned& sampleRate) const;
+        
+        /** Give a decoder of the selected audio stream to @a decode, the errors it throws are logged
+         *
+         * @return true on success, false otherwise
+         */
+        bool decodeSelectedAudio(const std::function<void(AudioTrackDecoder&)>& decode) const;
+        
+        /** @return the index of the selected audio stream in the media, or -1 if there's none
+         */
+        int getSelectedAudioStreamIndex() const;
+        
         sf::Transformable& m_movieView;
+        std::string m_filename;
         std::shared_ptr<Demuxer> m_demuxer;
         std::shared_ptr<Timer> m_timer;
         sf::Sprite m_videoSprite;
         Streams m_audioStreamsDesc;
         Streams m_videoStreamsDesc;
+        Streams m_subtitleStreamsDesc;
         sf::FloatRect m_displayFrame;
         LayoutDebugger<sf::Sprite> m_debugger;
+        mutable std::shared_ptr<PeakSummary> m_peakSummary;
+        bool m_audioMasterClock;
+        AudioSettings m_audioSettings;
+        std::size_t m_packetCacheLimit;
+        std::shared_ptr<Clock> m_clock;
+        bool m_sharedDecoding;
+        int m_decodingPriority;
+        Movie::FrameTap m_frameTap;
+        
+        // Asynchronous opening
+        std::thread m_openingThread;
+        std::mutex m_openingMutex;
+        std::string m_openingFilename;
+        Movie::OpenCallback m_openingCallback;
+        std::shared_ptr<LoadedMedia> m_openedMedia;
+        std::shared_ptr<std::atomic<bool> > m_openingCancelled;
+        bool m_openingDone;
+        bool m_openingSucceeded;
     };
     
 }
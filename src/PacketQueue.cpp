@@ -0,0 +1,96 @@
+
+/*
+ *  PacketQueue.cpp
+ *  sfeMovie project
+ *
+ *  Copyright (C) 2010-2015 Lucas Soltic
+ *  lucas.soltic@orange.fr
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ *
+ */
+
+#include "PacketQueue.hpp"
+#include "Macros.hpp"
+
+namespace sfe
+{
+    namespace
+    {
+        const std::size_t InitialCapacity = 16;
+    }
+    
+    PacketQueue::PacketQueue() :
+    m_packets(InitialCapacity, nullptr),
+    m_head(0),
+    m_size(0)
+    {
+    }
+    
+    void PacketQueue::push_back(AVPacket* packet)
+    {
+        if (m_size == m_packets.size())
+            grow();
+        
+        m_packets[(m_head + m_size) % m_packets.size()] = packet;
+        m_size++;
+    }
+    
+    void PacketQueue::push_front(AVPacket* packet)
+    {
+        if (m_size == m_packets.size())
+            grow();
+        
+        m_head = (m_head + m_packets.size() - 1) % m_packets.size();
+        m_packets[m_head] = packet;
+        m_size++;
+    }
+    
+    AVPacket* PacketQueue::front() const
+    {
+        CHECK(m_size > 0, "PacketQueue::front() - empty queue");
+        return m_packets[m_head];
+    }
+    
+    void PacketQueue::pop_front()
+    {
+        CHECK(m_size > 0, "PacketQueue::pop_front() - empty queue");
+        m_packets[m_head] = nullptr;
+        m_head = (m_head + 1) % m_packets.size();
+        m_size--;
+    }
+    
+    bool PacketQueue::empty() const
+    {
+        return m_size == 0;
+    }
+    
+    std::size_t PacketQueue::size() const
+    {
+        return m_size;
+    }
+    
+    void PacketQueue::grow()
+    {
+        // Unwrap the packets at the beginning of the new storage
+        std::vector<AVPacket*> packets(m_packets.size() * 2, nullptr);
+        
+        for (std::size_t i = 0; i < m_size; i++)
+            packets[i] = m_packets[(m_head + i) % m_packets.size()];
+        
+        m_packets.swap(packets);
+        m_head = 0;
+    }
+}
@@ -0,0 +1,85 @@
+
+/*
+ *  PacketQueue.hpp
+ *  sfeMovie project
+ *
+ *  Copyright (C) 2010-2015 Lucas Soltic
+ *  lucas.soltic@orange.fr
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ *
+ */
+
+#ifndef SFEMOVIE_PACKETQUEUE_HPP
+#define SFEMOVIE_PACKETQUEUE_HPP
+
+#include <cstddef>
+#include <vector>
+
+extern "C"
+{
+#include <libavcodec/avcodec.h>
+}
+
+namespace sfe
+{
+    /** Queue of encoded packets stored in a ring
+     *
+     * Unlike std::list or std::deque, the storage is only reallocated when the queue grows beyond
+     * its largest size so far, so pushing and popping packets never allocates during playback
+     */
+    class PacketQueue
+    {
+    public:
+        /** Default constructor
+         */
+        PacketQueue();
+        
+        /** Add @a packet at the end of the queue
+         */
+        void push_back(AVPacket* packet);
+        
+        /** Add @a packet at the beginning of the queue
+         */
+        void push_front(AVPacket* packet);
+        
+        /** @return the packet at the beginning of the queue, the queue must not be empty
+         */
+        AVPacket* front() const;
+        
+        /** Remove the packet at the beginning of the queue, the queue must not be empty
+         */
+        void pop_front();
+        
+        /** @return true if the queue holds no packet
+         */
+        bool empty() const;
+        
+        /** @return the count of packets in the queue
+         */
+        std::size_t size() const;
+        
+    private:
+        /** Make room for one more packet
+         */
+        void grow();
+        
+        std::vector<AVPacket*> m_packets;
+        std::size_t m_head;
+        std::size_t m_size;
+    };
+}
+
+#endif
@@ -0,0 +1,110 @@
+
+/*
+ *  PcmRingBuffer.cpp
+ *  sfeMovie project
+ *
+ *  Copyright (C) 2010-2015 Lucas Soltic
+ *  lucas.soltic@orange.fr
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ *
+ */
+
+#include "PcmRingBuffer.hpp"
+#include "Macros.hpp"
+#include <algorithm>
+#include <cstring>
+
+namespace sfe
+{
+    PcmRingBuffer::PcmRingBuffer(std::size_t capacity, std::size_t maxWriteSize) :
+    m_storage(capacity + maxWriteSize),
+    m_capacity(capacity),
+    m_maxWriteSize(maxWriteSize),
+    m_readCount(0),
+    m_writeCount(0)
+    {
+        CHECK(capacity > 0, "PcmRingBuffer::PcmRingBuffer() - invalid capacity");
+        CHECK(maxWriteSize <= capacity, "PcmRingBuffer::PcmRingBuffer() - writes cannot be bigger than the ring");
+    }
+    
+    sf::Int16* PcmRingBuffer::reserveWrite(std::size_t count)
+    {
+        CHECK(count <= m_maxWriteSize, "PcmRingBuffer::reserveWrite() - write is too big for the ring tail");
+        
+        if (getWritableCount() < count)
+            return nullptr;
+        
+        return &m_storage[m_writeCount.load(std::memory_order_relaxed) % m_capacity];
+    }
+    
+    void PcmRingBuffer::commitWrite(std::size_t count)
+    {
+        CHECK(count <= getWritableCount(), "PcmRingBuffer::commitWrite() - committing more than the free space");
+        
+        const std::size_t writeCount = m_writeCount.load(std::memory_order_relaxed);
+        const std::size_t position = writeCount % m_capacity;
+        
+        // Move what went to the tail back to the beginning of the ring, this area is known to be free
+        if (position + count > m_capacity)
+        {
+            std::memcpy(&m_storage[0], &m_storage[m_capacity],
+                        (position + count - m_capacity) * sizeof(sf::Int16));
+        }
+        
+        m_writeCount.store(writeCount + count, std::memory_order_release);
+    }
+    
+    std::size_t PcmRingBuffer::peekRead(const sf::Int16*& samples, std::size_t maxCount) const
+    {
+        const std::size_t readCount = m_readCount.load(std::memory_order_relaxed);
+        const std::size_t position = readCount % m_capacity;
+        
+        samples = &m_storage[position];
+        return std::min(std::min(getReadableCount(), maxCount), m_capacity - position);
+    }
+    
+    void PcmRingBuffer::commitRead(std::size_t count)
+    {
+        CHECK(count <= getReadableCount(), "PcmRingBuffer::commitRead() - releasing more than the stored samples");
+        m_readCount.store(m_readCount.load(std::memory_order_relaxed) + count, std::memory_order_release);
+    }
+    
+    std::size_t PcmRingBuffer::getReadableCount() const
+    {
+        return m_writeCount.load(std::memory_order_acquire) - m_readCount.load(std::memory_order_acquire);
+    }
+    
+    std::size_t PcmRingBuffer::getWritableCount() const
+    {
+        return m_capacity - getReadableCount();
+    }
+    
+    std::size_t PcmRingBuffer::getCapacity() const
+    {
+        return m_capacity;
+    }
+    
+    std::size_t PcmRingBuffer::getMaxWriteSize() const
+    {
+        return m_maxWriteSize;
+    }
+    
+    void PcmRingBuffer::clear()
+    {
+        m_readCount.store(0);
+        m_writeCount.store(0);
+    }
+}
@@ -0,0 +1,118 @@
+
+/*
+ *  PcmRingBuffer.hpp
+ *  sfeMovie project
+ *
+ *  Copyright (C) 2010-2015 Lucas Soltic
+ *  lucas.soltic@orange.fr
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ *
+ */
+
+#ifndef SFEMOVIE_PCMRINGBUFFER_HPP
+#define SFEMOVIE_PCMRINGBUFFER_HPP
+
+#include <SFML/Config.hpp>
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+namespace sfe
+{
+    /** Lock-free single producer / single consumer ring buffer of signed 16 bits audio samples
+     *
+     * The producer writes in place through reserveWrite() / commitWrite() and the consumer reads
+     * in place through peekRead() / commitRead(), so that samples never need to be staged elsewhere.
+     *
+     * To let the producer write a whole decoded frame contiguously even when it wraps around, the
+     * storage is followed by a tail area. Samples written to the tail are moved back to the beginning
+     * of the ring when they are committed
+     */
+    class PcmRingBuffer
+    {
+    public:
+        /** Create a ring buffer
+         *
+         * @param capacity the count of samples the ring can hold
+         * @param maxWriteSize the maximum count of samples that can be written in one reserveWrite() call
+         */
+        PcmRingBuffer(std::size_t capacity, std::size_t maxWriteSize);
+        
+        /** Get the location where at least @a count samples can be written contiguously
+         *
+         * Producer side only
+         *
+         * @param count the count of samples that the producer wants to write
+         * @return the write location, or nullptr if there is not enough free space for now
+         */
+        sf::Int16* reserveWrite(std::size_t count);
+        
+        /** Make the @a count samples written to the location returned by reserveWrite() available to the consumer
+         *
+         * Producer side only
+         */
+        void commitWrite(std::size_t count);
+        
+        /** Get the oldest samples that can be read contiguously
+         *
+         * Consumer side only
+         *
+         * @param[out] samples the read location
+         * @param maxCount the maximum count of samples to return
+         * @return the count of samples that can be read from @a samples
+         */
+        std::size_t peekRead(const sf::Int16*& samples, std::size_t maxCount) const;
+        
+        /** Release the @a count oldest samples so that the producer can reuse their storage
+         *
+         * Consumer side only
+         */
+        void commitRead(std::size_t count);
+        
+        /** @return the count of samples that can currently be read
+         */
+        std::size_t getReadableCount() const;
+        
+        /** @return the count of samples that can currently be written
+         */
+        std::size_t getWritableCount() const;
+        
+        /** @return the count of samples the ring can hold
+         */
+        std::size_t getCapacity() const;
+        
+        /** @return the maximum count of samples that can be written in one reserveWrite() call
+         */
+        std::size_t getMaxWriteSize() const;
+        
+        /** Drop all the stored samples
+         *
+         * @warning This must not be called while the producer or the consumer are using the ring
+         */
+        void clear();
+        
+    private:
+        std::vector<sf::Int16> m_storage;
+        std::size_t m_capacity;
+        std::size_t m_maxWriteSize;
+        
+        // Monotonic counters, positions in the storage are these counters modulo m_capacity
+        std::atomic<std::size_t> m_readCount;
+        std::atomic<std::size_t> m_writeCount;
+    };
+}
+
+#endif
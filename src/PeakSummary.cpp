@@ -0,0 +1,73 @@
+
+/*
+ *  PeakSummary.cpp
+ *  sfeMovie project
+ *
+ *  Copyright (C) 2010-2015 Lucas Soltic
+ *  lucas.soltic@orange.fr
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ *
+ */
+
+#include <sfeMovie/PeakSummary.hpp>
+#include "PeakSummaryImpl.hpp"
+
+namespace sfe
+{
+    PeakSummary::PeakSummary(std::shared_ptr<PeakSummaryImpl> impl) :
+    m_impl(impl)
+    {
+    }
+    
+    PeakSummary::~PeakSummary()
+    {
+    }
+    
+    unsigned int PeakSummary::getLevelCount() const
+    {
+        return m_impl->getLevelCount();
+    }
+    
+    unsigned int PeakSummary::getSamplesPerPeak(unsigned int level) const
+    {
+        return m_impl->getSamplesPerPeak(level);
+    }
+    
+    sf::Time PeakSummary::getPeakDuration(unsigned int level) const
+    {
+        return m_impl->getPeakDuration(level);
+    }
+    
+    unsigned int PeakSummary::getLevelForDuration(sf::Time peakDuration) const
+    {
+        return m_impl->getLevelForDuration(peakDuration);
+    }
+    
+    std::vector<Peak> PeakSummary::getPeaks(unsigned int level) const
+    {
+        return m_impl->getPeaks(level);
+    }
+    
+    sf::Time PeakSummary::getSummarizedDuration() const
+    {
+        return m_impl->getSummarizedDuration();
+    }
+    
+    bool PeakSummary::isComplete() const
+    {
+        return m_impl->isComplete();
+    }
+}
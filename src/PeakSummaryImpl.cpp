@@ -0,0 +1,476 @@
+
+/*
+ *  PeakSummaryImpl.cpp
+ *  sfeMovie project
+ *
+ *  Copyright (C) 2010-2015 Lucas Soltic
+ *  lucas.soltic@orange.fr
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ *
+ */
+
+#include "PeakSummaryImpl.hpp"
+#include "AudioTrackDecoder.hpp"
+#include "Macros.hpp"
+#include "Log.hpp"
+#include "Utilities.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <stdexcept>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #define SFEMOVIE_PEAKS_SSE2 1
+    #include <emmintrin.h>
+#else
+    #define SFEMOVIE_PEAKS_SSE2 0
+#endif
+
+namespace sfe
+{
+    namespace
+    {
+        const unsigned int LevelCount = 8;
+        const unsigned int BaseSamplesPerPeak = 256; // Samples per channel of each level 0 peak
+        const unsigned int LevelFactor = 4;          // Peaks of a level merged into one peak of the next level
+        
+        const float SampleScale = 1.f / 32768.f;
+        
+        const char CacheMagic[8] = { 'S', 'F', 'E', 'P', 'E', 'A', 'K', 'S' };
+        const uint32_t CacheVersion = 2;
+        
+        template <typename T>
+        void writeValue(std::ofstream& file, const T& value)
+        {
+            file.write(reinterpret_cast<const char*>(&value), sizeof(value));
+        }
+        
+        template <typename T>
+        bool readValue(std::ifstream& file, T& value)
+        {
+            return static_cast<bool>(file.read(reinterpret_cast<char*>(&value), sizeof(value)));
+        }
+    }
+    
+    PeakSummaryImpl::SampleAccumulator::SampleAccumulator() :
+    minimum(std::numeric_limits<sf::Int16>::max()),
+    maximum(std::numeric_limits<sf::Int16>::min()),
+    sumSquares(0),
+    samplesCount(0)
+    {
+    }
+    
+    PeakSummaryImpl::PeakAccumulator::PeakAccumulator() :
+    minimum(std::numeric_limits<float>::max()),
+    maximum(-std::numeric_limits<float>::max()),
+    sumSquares(0),
+    samplesCount(0),
+    peaksCount(0)
+    {
+    }
+    
+    PeakSummaryImpl::PeakSummaryImpl(const std::string& mediaFile, int streamIndex, const std::string& cacheFile) :
+    m_mediaFile(mediaFile),
+    m_streamIndex(streamIndex),
+    m_cacheFile(cacheFile),
+    m_channelCount(0),
+    m_sampleRate(0),
+    m_summarizedSamples(0),
+    m_complete(false),
+    m_levels(LevelCount),
+    m_mutex(),
+    m_sampleAccumulator(),
+    m_peakAccumulators(LevelCount),
+    m_cancelRequested(std::make_shared<std::atomic<bool> >(false)),
+    m_thread()
+    {
+        m_thread = std::thread(&PeakSummaryImpl::computeLoop, this);
+    }
+    
+    PeakSummaryImpl::~PeakSummaryImpl()
+    {
+        *m_cancelRequested = true;
+        
+        if (m_thread.joinable())
+            m_thread.join();
+    }
+    
+    int PeakSummaryImpl::getStreamIndex() const
+    {
+        return m_streamIndex;
+    }
+    
+    unsigned int PeakSummaryImpl::getLevelCount() const
+    {
+        return LevelCount;
+    }
+    
+    unsigned int PeakSummaryImpl::getSamplesPerPeak(unsigned int level) const
+    {
+        CHECK(level < LevelCount, "PeakSummary::getSamplesPerPeak() - invalid level " + s(level));
+        
+        unsigned int samplesPerPeak = BaseSamplesPerPeak;
+        for (unsigned int i = 0; i < level; i++)
+            samplesPerPeak *= LevelFactor;
+        
+        return samplesPerPeak;
+    }
+    
+    sf::Time PeakSummaryImpl::getPeakDuration(unsigned int level) const
+    {
+        const unsigned int samplesPerPeak = getSamplesPerPeak(level);
+        std::lock_guard<std::mutex> lock(m_mutex);
+        
+        if (m_sampleRate <= 0)
+            return sf::Time::Zero;
+        
+        return sf::microseconds(static_cast<sf::Int64>(samplesPerPeak) * 1000000 / m_sampleRate);
+    }
+    
+    unsigned int PeakSummaryImpl::getLevelForDuration(sf::Time peakDuration) const
+    {
+        unsigned int level = 0;
+        
+        while (level + 1 < LevelCount && getPeakDuration(level + 1) <= peakDuration)
+            level++;
+        
+        return level;
+    }
+    
+    std::vector<Peak> PeakSummaryImpl::getPeaks(unsigned int level) const
+    {
+        CHECK(level < LevelCount, "PeakSummary::getPeaks() - invalid level " + s(level));
+        
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_levels[level];
+    }
+    
+    sf::Time PeakSummaryImpl::getSummarizedDuration() const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        
+        if (m_sampleRate <= 0)
+            return sf::Time::Zero;
+        
+        return sf::microseconds(static_cast<sf::Int64>(m_summarizedSamples * 1000000 / m_sampleRate));
+    }
+    
+    bool PeakSummaryImpl::isComplete() const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_complete;
+    }
+    
+    void PeakSummaryImpl::reduceSamples(const sf::Int16* samples, std::size_t samplesCount,
+                                        SampleAccumulator& accumulator)
+    {
+        sf::Int16 minimum = accumulator.minimum;
+        sf::Int16 maximum = accumulator.maximum;
+        uint64_t sumSquares = accumulator.sumSquares;
+        std::size_t i = 0;
+        
+#if SFEMOVIE_PEAKS_SSE2
+        if (samplesCount >= 8)
+        {
+            const __m128i zero = _mm_setzero_si128();
+            __m128i minimums = _mm_set1_epi16(minimum);
+            __m128i maximums = _mm_set1_epi16(maximum);
+            __m128i sums = zero;
+            
+            for (; i + 8 <= samplesCount; i += 8)
+            {
+                const __m128i values = _mm_loadu_si128(reinterpret_cast<const __m128i*>(samples + i));
+                minimums = _mm_min_epi16(minimums, values);
+                maximums = _mm_max_epi16(maximums, values);
+                
+                // Each pair of squares fits in an unsigned 32 bits integer, widen them before summing
+                const __m128i squares = _mm_madd_epi16(values, values);
+                sums = _mm_add_epi64(sums, _mm_unpacklo_epi32(squares, zero));
+                sums = _mm_add_epi64(sums, _mm_unpackhi_epi32(squares, zero));
+            }
+            
+            sf::Int16 minimumLanes[8];
+            sf::Int16 maximumLanes[8];
+            uint64_t sumLanes[2];
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(minimumLanes), minimums);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(maximumLanes), maximums);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(sumLanes), sums);
+            
+            for (int lane = 0; lane < 8; lane++)
+            {
+                minimum = std::min(minimum, minimumLanes[lane]);
+                maximum = std::max(maximum, maximumLanes[lane]);
+            }
+            
+            sumSquares += sumLanes[0] + sumLanes[1];
+        }
+#endif
+        
+        for (; i < samplesCount; i++)
+        {
+            const int32_t value = samples[i];
+            minimum = std::min(minimum, samples[i]);
+            maximum = std::max(maximum, samples[i]);
+            sumSquares += static_cast<uint64_t>(value * value);
+        }
+        
+        accumulator.minimum = minimum;
+        accumulator.maximum = maximum;
+        accumulator.sumSquares = sumSquares;
+        accumulator.samplesCount += samplesCount;
+    }
+    
+    void PeakSummaryImpl::computeLoop()
+    {
+        try
+        {
+            if (!m_cacheFile.empty() && loadCache())
+            {
+                sfeLogDebug("Loaded peak summary from " + m_cacheFile);
+                return;
+            }
+            
+            AudioTrackDecoder decoder(m_mediaFile, m_streamIndex, AudioSettings(), m_cancelRequested);
+            
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_channelCount = decoder.getChannelCount();
+                m_sampleRate = decoder.getSampleRate();
+            }
+            
+            if (! decoder.decode([this](const sf::Int16* samples, std::size_t samplesCount)
+                                 {
+                                     return addSamples(samples, samplesCount);
+                                 }))
+            {
+                return;
+            }
+            
+            flushPeaks();
+            
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_complete = true;
+            }
+            
+            if (!m_cacheFile.empty())
+                saveCache();
+        }
+        catch (std::runtime_error& e)
+        {
+            sfeLogError("Could not compute the peak summary of " + m_mediaFile + ": " + e.what());
+        }
+    }
+    
+    bool PeakSummaryImpl::addSamples(const sf::Int16* samples, std::size_t samplesCount)
+    {
+        const std::size_t samplesPerPeak = BaseSamplesPerPeak * m_channelCount;
+        
+        while (samplesCount > 0)
+        {
+            const std::size_t count = std::min(samplesCount, samplesPerPeak - m_sampleAccumulator.samplesCount);
+            reduceSamples(samples, count, m_sampleAccumulator);
+            samples += count;
+            samplesCount -= count;
+            
+            if (m_sampleAccumulator.samplesCount == samplesPerPeak)
+            {
+                PeakAccumulator peak;
+                peak.minimum = m_sampleAccumulator.minimum * SampleScale;
+                peak.maximum = m_sampleAccumulator.maximum * SampleScale;
+                peak.sumSquares = m_sampleAccumulator.sumSquares * SampleScale * SampleScale;
+                peak.samplesCount = m_sampleAccumulator.samplesCount;
+                
+                m_sampleAccumulator = SampleAccumulator();
+                addPeak(0, peak);
+            }
+        }
+        
+        return !*m_cancelRequested;
+    }
+    
+    void PeakSummaryImpl::addPeak(unsigned int level, const PeakAccumulator& peak)
+    {
+        Peak result;
+        result.minimum = peak.minimum;
+        result.maximum = peak.maximum;
+        result.rms = static_cast<float>(std::sqrt(peak.sumSquares / peak.samplesCount));
+        
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_levels[level].push_back(result);
+            
+            if (level == 0)
+                m_summarizedSamples += peak.samplesCount / m_channelCount;
+        }
+        
+        if (level + 1 < LevelCount)
+        {
+            PeakAccumulator& next = m_peakAccumulators[level + 1];
+            next.minimum = std::min(next.minimum, peak.minimum);
+            next.maximum = std::max(next.maximum, peak.maximum);
+            next.sumSquares += peak.sumSquares;
+            next.samplesCount += peak.samplesCount;
+            next.peaksCount++;
+            
+            if (next.peaksCount == LevelFactor)
+            {
+                PeakAccumulator completed = next;
+                next = PeakAccumulator();
+                addPeak(level + 1, completed);
+            }
+        }
+    }
+    
+    void PeakSummaryImpl::flushPeaks()
+    {
+        if (m_sampleAccumulator.samplesCount > 0)
+        {
+            PeakAccumulator peak;
+            peak.minimum = m_sampleAccumulator.minimum * SampleScale;
+            peak.maximum = m_sampleAccumulator.maximum * SampleScale;
+            peak.sumSquares = m_sampleAccumulator.sumSquares * SampleScale * SampleScale;
+            peak.samplesCount = m_sampleAccumulator.samplesCount;
+            
+            m_sampleAccumulator = SampleAccumulator();
+            addPeak(0, peak);
+        }
+        
+        for (unsigned int level = 1; level < LevelCount; level++)
+        {
+            if (m_peakAccumulators[level].peaksCount > 0)
+            {
+                PeakAccumulator partial = m_peakAccumulators[level];
+                m_peakAccumulators[level] = PeakAccumulator();
+                addPeak(level, partial);
+            }
+        }
+    }
+    
+    bool PeakSummaryImpl::loadCache()
+    {
+        std::ifstream file(m_cacheFile.c_str(), std::ios::binary);
+        
+        if (!file)
+            return false;
+        
+        uint64_t currentMediaSize = 0;
+        int64_t currentModificationTime = 0;
+        
+        if (!getFileStatus(m_mediaFile, currentMediaSize, currentModificationTime))
+            return false;
+        
+        char magic[sizeof(CacheMagic)];
+        uint32_t version = 0, samplesPerPeak = 0, levelFactor = 0, levelCount = 0;
+        uint64_t mediaSize = 0, summarizedSamples = 0;
+        int64_t modificationTime = 0;
+        int32_t streamIndex = 0, channelCount = 0, sampleRate = 0;
+        
+        if (!file.read(magic, sizeof(magic)) || std::memcmp(magic, CacheMagic, sizeof(magic)) != 0
+            || !readValue(file, version) || version != CacheVersion
+            || !readValue(file, mediaSize) || mediaSize != currentMediaSize
+            || !readValue(file, modificationTime) || modificationTime != currentModificationTime
+            || !readValue(file, streamIndex) || streamIndex != m_streamIndex
+            || !readValue(file, samplesPerPeak) || samplesPerPeak != BaseSamplesPerPeak
+            || !readValue(file, levelFactor) || levelFactor != LevelFactor
+            || !readValue(file, levelCount) || levelCount != LevelCount
+            || !readValue(file, channelCount) || channelCount <= 0
+            || !readValue(file, sampleRate) || sampleRate <= 0
+            || !readValue(file, summarizedSamples))
+        {
+            sfeLogDebug("Ignoring outdated or invalid peak summary cache " + m_cacheFile);
+            return false;
+        }
+        
+        std::vector<std::vector<Peak> > levels(LevelCount);
+        
+        for (std::vector<Peak>& peaks : levels)
+        {
+            uint64_t peaksCount = 0;
+            
+            if (!readValue(file, peaksCount) || peaksCount > summarizedSamples / BaseSamplesPerPeak + 1)
+                return false;
+            
+            peaks.resize(static_cast<std::size_t>(peaksCount));
+            
+            if (peaksCount > 0 && !file.read(reinterpret_cast<char*>(&peaks[0]), peaks.size() * sizeof(Peak)))
+                return false;
+        }
+        
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_channelCount = channelCount;
+        m_sampleRate = sampleRate;
+        m_summarizedSamples = summarizedSamples;
+        m_levels.swap(levels);
+        m_complete = true;
+        
+        return true;
+    }
+    
+    void PeakSummaryImpl::saveCache() const
+    {
+        uint64_t mediaSize = 0;
+        int64_t modificationTime = 0;
+        
+        if (!getFileStatus(m_mediaFile, mediaSize, modificationTime))
+            return;
+        
+        // Write to a temporary file first so that readers never see a partially written cache
+        const std::string temporaryFile = m_cacheFile + ".tmp";
+        
+        {
+            std::ofstream file(temporaryFile.c_str(), std::ios::binary | std::ios::trunc);
+            std::lock_guard<std::mutex> lock(m_mutex);
+            
+            file.write(CacheMagic, sizeof(CacheMagic));
+            writeValue(file, CacheVersion);
+            writeValue(file, mediaSize);
+            writeValue(file, modificationTime);
+            writeValue(file, static_cast<int32_t>(m_streamIndex));
+            writeValue(file, static_cast<uint32_t>(BaseSamplesPerPeak));
+            writeValue(file, static_cast<uint32_t>(LevelFactor));
+            writeValue(file, static_cast<uint32_t>(LevelCount));
+            writeValue(file, static_cast<int32_t>(m_channelCount));
+            writeValue(file, static_cast<int32_t>(m_sampleRate));
+            writeValue(file, m_summarizedSamples);
+            
+            for (const std::vector<Peak>& peaks : m_levels)
+            {
+                writeValue(file, static_cast<uint64_t>(peaks.size()));
+                
+                if (!peaks.empty())
+                    file.write(reinterpret_cast<const char*>(&peaks[0]), peaks.size() * sizeof(Peak));
+            }
+            
+            if (!file)
+            {
+                sfeLogWarning("Could not write the peak summary cache " + temporaryFile);
+                return;
+            }
+        }
+        
+        std::remove(m_cacheFile.c_str());
+        
+        if (std::rename(temporaryFile.c_str(), m_cacheFile.c_str()) != 0)
+        {
+            sfeLogWarning("Could not write the peak summary cache " + m_cacheFile);
+            std::remove(temporaryFile.c_str());
+        }
+    }
+}
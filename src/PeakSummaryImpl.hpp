@@ -0,0 +1,169 @@
+
+/*
+ *  PeakSummaryImpl.hpp
+ *  sfeMovie project
+ *
+ *  Copyright (C) 2010-2015 Lucas Soltic
+ *  lucas.soltic@orange.fr
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ *
+ */
+
+#ifndef SFEMOVIE_PEAKSUMMARYIMPL_HPP
+#define SFEMOVIE_PEAKSUMMARYIMPL_HPP
+
+#include <SFML/System.hpp>
+#include <sfeMovie/PeakSummary.hpp>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <stdint.h>
+
+namespace sfe
+{
+    class PeakSummaryImpl
+    {
+    public:
+        /** Raw statistics of the samples of the peak being computed at level 0
+         */
+        struct SampleAccumulator
+        {
+            SampleAccumulator();
+            
+            sf::Int16 minimum;
+            sf::Int16 maximum;
+            uint64_t sumSquares;
+            std::size_t samplesCount;
+        };
+        
+        /** Reduce @a samplesCount interleaved samples into @a accumulator, with SSE2 when available
+         */
+        static void reduceSamples(const sf::Int16* samples, std::size_t samplesCount, SampleAccumulator& accumulator);
+        
+        /** Start computing the summary of the given audio stream in the background
+         *
+         * @param mediaFile the path of the media to summarize
+         * @param streamIndex the index of the audio stream in the media
+         * @param cacheFile the file where the summary is loaded from and saved to, or an empty string
+         * to disable caching. The cached summary is only used if the media size and modification time
+         * didn't change
+         */
+        PeakSummaryImpl(const std::string& mediaFile, int streamIndex, const std::string& cacheFile);
+        
+        /** Default destructor, stops computing the summary
+         */
+        ~PeakSummaryImpl();
+        
+        /** @return the index of the summarized audio stream
+         */
+        int getStreamIndex() const;
+        
+        /** @see PeakSummary::getLevelCount()
+         */
+        unsigned int getLevelCount() const;
+        
+        /** @see PeakSummary::getSamplesPerPeak()
+         */
+        unsigned int getSamplesPerPeak(unsigned int level) const;
+        
+        /** @see PeakSummary::getPeakDuration()
+         */
+        sf::Time getPeakDuration(unsigned int level) const;
+        
+        /** @see PeakSummary::getLevelForDuration()
+         */
+        unsigned int getLevelForDuration(sf::Time peakDuration) const;
+        
+        /** @see PeakSummary::getPeaks()
+         */
+        std::vector<Peak> getPeaks(unsigned int level) const;
+        
+        /** @see PeakSummary::getSummarizedDuration()
+         */
+        sf::Time getSummarizedDuration() const;
+        
+        /** @see PeakSummary::isComplete()
+         */
+        bool isComplete() const;
+        
+    private:
+        /** Normalized statistics of a peak, possibly merged from the peaks of the previous level
+         */
+        struct PeakAccumulator
+        {
+            PeakAccumulator();
+            
+            float minimum;
+            float maximum;
+            double sumSquares;
+            uint64_t samplesCount;
+            unsigned int peaksCount;
+        };
+        
+        /** Background thread entry point
+         */
+        void computeLoop();
+        
+        /** Add decoded samples to the summary
+         *
+         * @return false if computing the summary was cancelled
+         */
+        bool addSamples(const sf::Int16* samples, std::size_t samplesCount);
+        
+        /** Store a completed peak and merge it into the next level
+         */
+        void addPeak(unsigned int level, const PeakAccumulator& peak);
+        
+        /** Store the incomplete peaks left at the end of the stream
+         */
+        void flushPeaks();
+        
+        /** Load the summary from the cache file, if it is valid for the summarized media
+         *
+         * @return true if the summary could be loaded
+         */
+        bool loadCache();
+        
+        /** Save the complete summary to the cache file
+         */
+        void saveCache() const;
+        
+        std::string m_mediaFile;
+        int m_streamIndex;
+        std::string m_cacheFile;
+        
+        // Shared with the background thread
+        int m_channelCount;
+        int m_sampleRate;
+        uint64_t m_summarizedSamples;
+        bool m_complete;
+        std::vector<std::vector<Peak> > m_levels;
+        mutable std::mutex m_mutex;
+        
+        // Background thread only
+        SampleAccumulator m_sampleAccumulator;
+        std::vector<PeakAccumulator> m_peakAccumulators;
+        
+        // Shared with the decoder, which stops reading the media as soon as it is set
+        std::shared_ptr<std::atomic<bool> > m_cancelRequested;
+        std::thread m_thread;
+    };
+}
+
+#endif
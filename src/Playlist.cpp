@@ -0,0 +1,323 @@
+
+/*
+ *  Playlist.cpp
+ *  sfeMovie project
+ *
+ *  Copyright (C) 2010-2015 Lucas Soltic
+ *  lucas.soltic@orange.fr
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ *
+ */
+
+#include <sfeMovie/Playlist.hpp>
+#include "Log.hpp"
+#include <algorithm>
+
+namespace sfe
+{
+    namespace
+    {
+        // How long a prepared media takes to output its first sample after play(), see Movie::prepare().
+        // The next media is started this long before the current one ends so that they join without gap
+        const sf::Time SwitchLeadTime = sf::milliseconds(5);
+    }
+    
+    Playlist::Playlist() :
+    m_items(),
+    m_currentMovie(std::make_shared<Movie>()),
+    m_nextMovie(std::make_shared<Movie>()),
+    m_currentItem(0),
+    m_nextItem(0),
+    m_hasCurrentMovie(false),
+    m_isOpeningNext(false),
+    m_isNextReady(false),
+    m_loop(false),
+    m_status(Stopped),
+    m_frame(),
+    m_preserveRatio(true),
+    m_volume(100)
+    {
+    }
+    
+    Playlist::~Playlist()
+    {
+    }
+    
+    void Playlist::add(const std::string& filename)
+    {
+        m_items.push_back(filename);
+        
+        // The first media is prepared right away, the other ones once the previous one plays
+        if (! m_hasCurrentMovie && ! m_isOpeningNext && ! m_isNextReady)
+            openNextItem();
+    }
+    
+    void Playlist::clear()
+    {
+        // Fresh movies discard any opening in progress
+        m_currentMovie = std::make_shared<Movie>();
+        m_nextMovie = std::make_shared<Movie>();
+        m_items.clear();
+        m_currentItem = 0;
+        m_nextItem = 0;
+        m_hasCurrentMovie = false;
+        m_isOpeningNext = false;
+        m_isNextReady = false;
+        m_status = Stopped;
+    }
+    
+    std::size_t Playlist::getItemCount() const
+    {
+        return m_items.size();
+    }
+    
+    std::size_t Playlist::getCurrentItem() const
+    {
+        return m_hasCurrentMovie ? m_currentItem : m_items.size();
+    }
+    
+    void Playlist::setLoop(bool loop)
+    {
+        m_loop = loop;
+        
+        // The last media may now have a next one
+        if (m_hasCurrentMovie && ! m_isOpeningNext && ! m_isNextReady)
+            openNextItem();
+    }
+    
+    bool Playlist::getLoop() const
+    {
+        return m_loop;
+    }
+    
+    void Playlist::play()
+    {
+        if (m_items.empty())
+        {
+            sfeLogError("Playlist::play() - The playlist is empty, cannot play");
+            return;
+        }
+        
+        m_status = Playing;
+        
+        if (m_hasCurrentMovie && m_currentMovie->getStatus() == Paused)
+            m_currentMovie->play();
+        
+        update();
+    }
+    
+    void Playlist::pause()
+    {
+        if (m_status != Playing)
+        {
+            sfeLogError("Playlist::pause() - The playlist is not playing");
+            return;
+        }
+        
+        m_status = Paused;
+        
+        if (m_hasCurrentMovie && m_currentMovie->getStatus() == Playing)
+            m_currentMovie->pause();
+    }
+    
+    void Playlist::stop()
+    {
+        std::vector<std::string> items = m_items;
+        bool loop = m_loop;
+        
+        clear();
+        m_loop = loop;
+        
+        for (const std::string& item : items)
+            add(item);
+    }
+    
+    Status Playlist::getStatus() const
+    {
+        return m_status;
+    }
+    
+    void Playlist::update()
+    {
+        if (m_hasCurrentMovie)
+            m_currentMovie->update();
+        
+        // Installs the next media once it's opened, which calls didOpenNextItem()
+        if (m_isOpeningNext)
+            m_nextMovie->update();
+        
+        if (m_status != Playing)
+            return;
+        
+        if (! m_hasCurrentMovie || currentItemEnded())
+        {
+            if (m_isNextReady)
+            {
+                switchToNextItem();
+            }
+            else if (! m_isOpeningNext)
+            {
+                // Nothing comes next
+                m_status = Stopped;
+            }
+        }
+    }
+    
+    sf::Time Playlist::getTimeUntilNextFrame() const
+    {
+        if (m_status != Playing || ! m_hasCurrentMovie)
+            return m_isOpeningNext ? sf::Time::Zero : m_currentMovie->getTimeUntilNextFrame();
+        
+        // Wake up right when the next media must be started, rather than on the first update after the end
+        if (m_isNextReady)
+            return std::min(m_currentMovie->getTimeUntilNextFrame(), getTimeUntilSwitch());
+        
+        return m_currentMovie->getTimeUntilNextFrame();
+    }
+    
+    void Playlist::fit(sf::FloatRect frame, bool preserveRatio)
+    {
+        m_frame = frame;
+        m_preserveRatio = preserveRatio;
+        
+        if (m_hasCurrentMovie)
+            setupMovie(*m_currentMovie);
+        
+        if (m_isNextReady)
+            setupMovie(*m_nextMovie);
+    }
+    
+    void Playlist::setVolume(float volume)
+    {
+        m_volume = volume;
+        
+        if (m_hasCurrentMovie)
+            m_currentMovie->setVolume(volume);
+        
+        if (m_isNextReady)
+            m_nextMovie->setVolume(volume);
+    }
+    
+    const Movie& Playlist::getCurrentMovie() const
+    {
+        return *m_currentMovie;
+    }
+    
+    void Playlist::draw(sf::RenderTarget& target, sf::RenderStates states) const
+    {
+        if (m_hasCurrentMovie)
+        {
+            states.transform *= getTransform();
+            target.draw(*m_currentMovie, states);
+        }
+    }
+    
+    void Playlist::openNextItem()
+    {
+        if (m_items.empty())
+            return;
+        
+        std::size_t next = m_currentItem + 1;
+        
+        if (! m_hasCurrentMovie)
+            next = 0;
+        
+        if (next >= m_items.size())
+        {
+            if (! m_loop)
+                return;
+            
+            next = 0;
+        }
+        
+        m_nextItem = next;
+        m_isOpeningNext = true;
+        m_isNextReady = false;
+        m_nextMovie->openFromFileAsync(m_items[next], [this](bool success) { didOpenNextItem(success); }, true);
+    }
+    
+    void Playlist::didOpenNextItem(bool success)
+    {
+        m_isOpeningNext = false;
+        
+        if (success)
+        {
+            setupMovie(*m_nextMovie);
+            m_isNextReady = true;
+            return;
+        }
+        
+        sfeLogWarning("Playlist - Could not open " + m_items[m_nextItem] + ", skipping it");
+        
+        // Try the media after the one that failed, unless they all failed
+        std::size_t failed = m_nextItem;
+        std::size_t next = failed + 1;
+        
+        if (next >= m_items.size())
+        {
+            if (! m_loop)
+                return;
+            
+            next = 0;
+        }
+        
+        if (m_hasCurrentMovie ? next == (m_currentItem + 1) % m_items.size() : next == 0)
+            return;
+        
+        m_nextItem = next;
+        m_isOpeningNext = true;
+        m_nextMovie->openFromFileAsync(m_items[next], [this](bool success) { didOpenNextItem(success); }, true);
+    }
+    
+    void Playlist::switchToNextItem()
+    {
+        // The next media is prepared, so it starts right away and its first image is shown
+        m_nextMovie->play();
+        
+        std::swap(m_currentMovie, m_nextMovie);
+        m_currentItem = m_nextItem;
+        m_isNextReady = false;
+        
+        bool hadCurrentMovie = m_hasCurrentMovie;
+        m_hasCurrentMovie = true;
+        
+        if (hadCurrentMovie && m_nextMovie->getStatus() != Stopped)
+            m_nextMovie->stop();
+        
+        openNextItem();
+    }
+    
+    bool Playlist::currentItemEnded() const
+    {
+        // The end timestamp is reached before the streams notice that they have no more data
+        return m_currentMovie->getStatus() == Stopped ||
+               (m_currentMovie->getDuration() > sf::Time::Zero && getTimeUntilSwitch() == sf::Time::Zero);
+    }
+    
+    sf::Time Playlist::getTimeUntilSwitch() const
+    {
+        const sf::Time remaining = m_currentMovie->getDuration() - m_currentMovie->getPlayingOffset();
+        return std::max(sf::Time::Zero, remaining - SwitchLeadTime);
+    }
+    
+    void Playlist::setupMovie(Movie& movie) const
+    {
+        if (m_frame.width > 0 && m_frame.height > 0)
+            movie.fit(m_frame, m_preserveRatio);
+        
+        movie.setVolume(m_volume);
+    }
+}
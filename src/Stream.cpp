@@ -53,7 +53,8 @@ namespace sfe
     m_streamID(-1),
     m_packetList(),
     m_status(Stopped),
-    m_readerMutex()
+    m_readerMutex(),
+    m_frameTap()
     {
         CHECK(stream, "Stream::Stream() - invalid stream argument");
         CHECK(timer, "Inconcistency error: null timer");
@@ -146,11 +147,8 @@ namespace sfe
         {
             if (m_codec->capabilities & AV_CODEC_CAP_DELAY)
             {
-                AVPacket* flushPacket = (AVPacket*)av_malloc(sizeof(*flushPacket));
-                av_init_packet(flushPacket);
-                flushPacket->data = nullptr;
-                flushPacket->size = 0;
-                result = flushPacket;
+                // Recycled packets are empty, which makes them flush packets
+                result = m_dataSource.allocatePacket();
                 
                 sfeLogDebug("Sending flush packet: " + mediaTypeToString(getStreamKind()));
             }
@@ -177,13 +175,18 @@ namespace sfe
             pkt = m_packetList.front();
             m_packetList.pop_front();
             
-            av_packet_unref(pkt);
+            recyclePacket(pkt);
         }
     }
     
     bool Stream::needsMoreData() const
     {
-        return m_packetList.size() < 10;
+        return usesPackets() && m_packetList.size() < 10;
+    }
+    
+    bool Stream::usesPackets() const
+    {
+        return true;
     }
     
     MediaType Stream::getStreamKind() const
@@ -267,6 +270,44 @@ namespace sfe
         return false;
     }
     
+    void Stream::prepare()
+    {
+    }
+    
+    void Stream::setFrameTap(Movie::FrameTap tap)
+    {
+        std::shared_ptr<const Movie::FrameTap> newTap;
+        
+        if (tap)
+            newTap = std::make_shared<const Movie::FrameTap>(tap);
+        
+        std::atomic_store(&m_frameTap, newTap);
+    }
+    
+    void Stream::tapFrame(const AVFrame* frame)
+    {
+        tapFrame(frame, framePosition(frame, m_stream));
+    }
+    
+    void Stream::tapFrame(const AVFrame* frame, sf::Time position)
+    {
+        std::shared_ptr<const Movie::FrameTap> tap = std::atomic_load(&m_frameTap);
+        
+        if (! tap)
+            return;
+        
+        // Only the frame properties are allocated, the data buffers are shared with the decoder output
+        AVFrame* reference = av_frame_clone(frame);
+        CHECK(reference, "Stream::tapFrame() - av_frame_clone() error");
+        
+        (*tap)(MediaFrame(reference, getStreamKind(), position));
+    }
+    
+    bool Stream::hasFrameTap() const
+    {
+        return std::atomic_load(&m_frameTap) != nullptr;
+    }
+    
     void Stream::setStatus(Status status)
     {
         m_status = status;
@@ -299,4 +340,9 @@ namespace sfe
     {
         return !m_packetList.empty();
     }
+    
+    void Stream::recyclePacket(AVPacket* packet)
+    {
+        m_dataSource.recyclePacket(packet);
+    }
 }
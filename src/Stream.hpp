@@ -27,6 +27,7 @@
 
 #include "Macros.hpp"
 #include "Timer.hpp"
+#include "PacketQueue.hpp"
 #include <list>
 #include <memory>
 #include <SFML/System.hpp>
@@ -47,6 +48,14 @@ namespace sfe
         {
             virtual void requestMoreData(Stream& starvingStream) = 0;
             virtual void resetEndOfFileStatus() = 0;
+            
+            /** @return an empty packet, reused from the recycled ones when possible
+             */
+            virtual AVPacket* allocatePacket() = 0;
+            
+            /** Unreference the data of @a packet and keep it for reuse by allocatePacket()
+             */
+            virtual void recyclePacket(AVPacket* packet) = 0;
         };
         
         /** @return a textual description of the given FFmpeg stream
@@ -108,11 +117,17 @@ namespace sfe
         /** Used by the demuxer to know if this stream should be fed with more data
          *
          * The default implementation returns true if the packet list contains less than 10 packets
+         * and the stream uses packets
          *
          * @return true if the demuxer should give more data to this stream, false otherwise
          */
         virtual bool needsMoreData() const;
         
+        /** @return false if this stream plays without encoded data for now, in which case the demuxer
+         * discards its packets. Default implementation always returns true
+         */
+        virtual bool usesPackets() const;
+        
         /** Get the stream kind (either audio or video stream)
          *
          * @return the kind of stream represented by this stream
@@ -170,6 +185,18 @@ namespace sfe
          * returns false
          */
         virtual bool isPassive() const;
+        
+        /** Do ahead of time the work that would otherwise delay the start of the playback
+         *
+         * This is only called while the stream is stopped. The default implementation does nothing
+         */
+        virtual void prepare();
+        
+        /** Set the function to call with every frame decoded from now on, or nullptr
+         *
+         * This can be called from any thread
+         */
+        void setFrameTap(Movie::FrameTap tap);
     protected:
         // Timer::Observer interface
         void didPlay(const Timer& timer, Status previousStatus) override;
@@ -181,8 +208,24 @@ namespace sfe
          */
         bool hasPackets();
         
+        /** Give back a packet obtained from popEncodedData() once it's no more needed
+         */
+        void recyclePacket(AVPacket* packet);
+        
         void setStatus(Status status);
         
+        /** Give a new reference to the just decoded @a frame to the frame tap, if any
+         */
+        void tapFrame(const AVFrame* frame);
+        
+        /** Give a new reference to @a frame to the frame tap, if any, as the frame at @a position
+         */
+        void tapFrame(const AVFrame* frame, sf::Time position);
+        
+        /** @return true if a frame tap is set, so that frames that don't come from the decoder are only built for it
+         */
+        bool hasFrameTap() const;
+        
         AVFormatContext* & m_formatCtx;
         AVStream*& m_stream;
         
@@ -192,9 +235,12 @@ namespace sfe
         AVCodecContext* m_context;
         int m_streamID;
         std::string m_language;
-        std::list <AVPacket*> m_packetList;
+        PacketQueue m_packetList;
         Status m_status;
         sf::Mutex m_readerMutex;
+        
+        // Read by the decoding thread for every frame: swapped atomically rather than locked
+        std::shared_ptr<const Movie::FrameTap> m_frameTap;
     };
 }
 
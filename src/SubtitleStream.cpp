@@ -0,0 +1,439 @@
+
+/*
+ *  SubtitleStream.cpp
+ *  sfeMovie project
+ *
+ *  Copyright (C) 2010-2015 Lucas Soltic
+ *  lucas.soltic@orange.fr
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ *
+ */
+
+#include "SubtitleStream.hpp"
+#include "Log.hpp"
+#include "Utilities.hpp"
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+namespace sfe
+{
+    namespace
+    {
+        // Size of the overlay when the media has no video stream
+        const unsigned int DefaultFrameWidth = 1280;
+        const unsigned int DefaultFrameHeight = 720;
+        
+        // Display duration of the subtitles whose packets don't tell it
+        const long long DefaultDuration = 5000;
+        
+        // libass keeps the glyphs and the rendered bitmaps of the events in these caches, so that
+        // rendering an event again only composes already rasterized bitmaps
+        const int GlyphCacheSize = 10000;
+        const int BitmapCacheMegabytes = 64;
+        
+        /** @return true if the rendering of an event with the given @a text and @a effect changes over time
+         */
+        bool isAnimated(const char* text, const char* effect)
+        {
+            static const char* const AnimationTags[] = { "\\t(", "\\move", "\\fad", "\\k", "\\K" };
+            
+            if (effect && *effect)
+                return true;
+            
+            if (! text)
+                return false;
+            
+            for (const char* tag : AnimationTags)
+            {
+                if (std::strstr(text, tag))
+                    return true;
+            }
+            
+            return false;
+        }
+    }
+    
+    SubtitleStream::SubtitleStream(AVFormatContext*& formatCtx, AVStream*& stream, DataSource& dataSource,
+                                   std::shared_ptr<Timer> timer) :
+    Stream(formatCtx, stream, dataSource, timer),
+#ifdef SFEMOVIE_USE_LIBASS
+    m_library(nullptr),
+    m_renderer(nullptr),
+    m_track(nullptr),
+    m_libassFailed(false),
+#endif
+    m_frameSize(DefaultFrameWidth, DefaultFrameHeight),
+    m_events(),
+    m_activeEvents(),
+    m_previousActiveEvents(),
+    m_hasAnimatedEvents(false),
+    m_validFrom(0),
+    m_validUntil(0),
+    m_needsRendering(true),
+    m_pixels(),
+    m_overlay(),
+    m_hasVisibleSubtitles(false)
+    {
+#ifndef SFEMOVIE_USE_LIBASS
+        CHECK(false, "SubtitleStream() - sfeMovie is built without libass, subtitles are not supported");
+#endif
+        
+        // Text subtitles are all decoded to ASS events, bitmap subtitles would need their own compositing
+        const AVCodecDescriptor* descriptor = avcodec_descriptor_get(m_stream->codecpar->codec_id);
+        CHECK(descriptor && (descriptor->props & AV_CODEC_PROP_TEXT_SUB),
+              "SubtitleStream() - bitmap subtitles are not supported");
+        
+        for (unsigned int i = 0; i < m_formatCtx->nb_streams; i++)
+        {
+            const AVCodecParameters* parameters = m_formatCtx->streams[i]->codecpar;
+            
+            if (parameters->codec_type == AVMEDIA_TYPE_VIDEO && parameters->width > 0 && parameters->height > 0)
+            {
+                m_frameSize = sf::Vector2u(parameters->width, parameters->height);
+                break;
+            }
+        }
+    }
+    
+    SubtitleStream::~SubtitleStream()
+    {
+#ifdef SFEMOVIE_USE_LIBASS
+        release();
+#endif
+    }
+    
+    MediaType SubtitleStream::getStreamKind() const
+    {
+        return Subtitle;
+    }
+    
+    void SubtitleStream::update()
+    {
+        while (hasPackets())
+        {
+            AVPacket* packet = popEncodedData();
+            
+            if (! packet)
+                break;
+            
+            // Flush packets carry no subtitle
+            if (packet->data)
+                decodePacket(packet);
+            
+            recyclePacket(packet);
+        }
+        
+        if (m_events.empty())
+            return;
+        
+        const long long position = m_timer->getOffset().asMicroseconds() / 1000;
+        
+        // Nothing to do until the set of active subtitles changes
+        if (! m_needsRendering && ! m_hasAnimatedEvents && position >= m_validFrom && position < m_validUntil)
+            return;
+        
+        const bool didChange = updateActiveEvents(position) || m_needsRendering || m_hasAnimatedEvents;
+        m_needsRendering = false;
+        
+        if (! didChange)
+            return;
+        
+        // The overlay is kept while hidden, libass then tells if the next subtitles look the same
+        if (m_activeEvents.empty())
+        {
+            m_hasVisibleSubtitles = false;
+            return;
+        }
+        
+#ifdef SFEMOVIE_USE_LIBASS
+        if (! loadRenderer())
+        {
+            m_hasVisibleSubtitles = false;
+            return;
+        }
+        
+        int detectChange = 0;
+        ASS_Image* images = ass_render_frame(m_renderer, m_track, position, &detectChange);
+        
+        if (detectChange != 0)
+            compose(images);
+        
+        m_hasVisibleSubtitles = images != nullptr;
+#endif
+    }
+    
+    void SubtitleStream::flushBuffers()
+    {
+        Stream::flushBuffers();
+        
+        // The decoded events stay in the track, only the display must be refreshed for the new position
+        m_needsRendering = true;
+    }
+    
+    bool SubtitleStream::fastForward(sf::Time targetPosition)
+    {
+        return true;
+    }
+    
+    bool SubtitleStream::isPassive() const
+    {
+        return true;
+    }
+    
+    const sf::Texture& SubtitleStream::getOverlay() const
+    {
+        return m_overlay;
+    }
+    
+    bool SubtitleStream::hasVisibleSubtitles() const
+    {
+        return m_hasVisibleSubtitles;
+    }
+    
+    void SubtitleStream::decodePacket(AVPacket* packet)
+    {
+#ifdef SFEMOVIE_USE_LIBASS
+        if (! loadTrack())
+            return;
+        
+        AVSubtitle subtitle;
+        int gotSubtitle = 0;
+        
+        int err = avcodec_decode_subtitle2(m_context, &subtitle, &gotSubtitle, packet);
+        
+        if (err < 0)
+        {
+            sfeLogWarning("SubtitleStream::decodePacket() - error while decoding subtitle packet");
+            return;
+        }
+        
+        if (! gotSubtitle)
+            return;
+        
+        const AVRational milliseconds = av_make_q(1, 1000);
+        const int64_t timestamp = packet->pts != AV_NOPTS_VALUE ? packet->pts : packet->dts;
+        const int64_t startTime = m_stream->start_time != AV_NOPTS_VALUE ? m_stream->start_time : 0;
+        
+        const long long start = av_rescale_q(timestamp - startTime, m_stream->time_base, milliseconds)
+            + subtitle.start_display_time;
+        long long duration = DefaultDuration;
+        
+        if (subtitle.end_display_time > subtitle.start_display_time &&
+            subtitle.end_display_time != std::numeric_limits<uint32_t>::max())
+            duration = subtitle.end_display_time - subtitle.start_display_time;
+        else if (packet->duration > 0)
+            duration = av_rescale_q(packet->duration, m_stream->time_base, milliseconds);
+        
+        for (unsigned int i = 0; i < subtitle.num_rects; i++)
+        {
+            const AVSubtitleRect* rect = subtitle.rects[i];
+            
+            if (rect->type != SUBTITLE_ASS || ! rect->ass)
+                continue;
+            
+            // libass drops the events it already has, which happens when packets are read again after seeking
+            const int eventCount = m_track->n_events;
+            ass_process_chunk(m_track, rect->ass, static_cast<int>(std::strlen(rect->ass)), start, duration);
+            
+            for (int j = eventCount; j < m_track->n_events; j++)
+            {
+                const ASS_Event& event = m_track->events[j];
+                
+                Event entry;
+                entry.start = event.Start;
+                entry.end = event.Start + event.Duration;
+                entry.animated = isAnimated(event.Text, event.Effect);
+                m_events.push_back(entry);
+                m_needsRendering = true;
+            }
+        }
+        
+        avsubtitle_free(&subtitle);
+#endif
+    }
+    
+    bool SubtitleStream::updateActiveEvents(long long position)
+    {
+        // Swapped rather than copied so that their storage is reused
+        m_previousActiveEvents.swap(m_activeEvents);
+        m_activeEvents.clear();
+        m_hasAnimatedEvents = false;
+        m_validFrom = std::numeric_limits<long long>::min();
+        m_validUntil = std::numeric_limits<long long>::max();
+        
+        for (std::size_t i = 0; i < m_events.size(); i++)
+        {
+            const Event& event = m_events[i];
+            
+            if (event.start <= position && position < event.end)
+            {
+                m_activeEvents.push_back(i);
+                m_hasAnimatedEvents = m_hasAnimatedEvents || event.animated;
+                m_validFrom = std::max(m_validFrom, event.start);
+                m_validUntil = std::min(m_validUntil, event.end);
+            }
+            else if (event.start > position)
+            {
+                m_validUntil = std::min(m_validUntil, event.start);
+            }
+            else
+            {
+                m_validFrom = std::max(m_validFrom, event.end);
+            }
+        }
+        
+        return m_activeEvents != m_previousActiveEvents;
+    }
+    
+#ifdef SFEMOVIE_USE_LIBASS
+    bool SubtitleStream::loadTrack()
+    {
+        if (m_track)
+            return true;
+        
+        if (m_libassFailed)
+            return false;
+        
+        try
+        {
+            m_library = ass_library_init();
+            CHECK(m_library, "SubtitleStream::loadTrack() - unable to initialize libass");
+            
+            // Fonts embedded in the media (usually Matroska attachments) are used by the ASS styles
+            for (unsigned int i = 0; i < m_formatCtx->nb_streams; i++)
+            {
+                const AVStream* attachment = m_formatCtx->streams[i];
+                const AVCodecParameters* parameters = attachment->codecpar;
+                
+                if (parameters->codec_type != AVMEDIA_TYPE_ATTACHMENT || parameters->extradata_size <= 0 ||
+                    (parameters->codec_id != AV_CODEC_ID_TTF && parameters->codec_id != AV_CODEC_ID_OTF))
+                    continue;
+                
+                AVDictionaryEntry* filename = av_dict_get(attachment->metadata, "filename", nullptr, 0);
+                ass_add_font(m_library, const_cast<char*>(filename ? filename->value : ""),
+                             reinterpret_cast<char*>(parameters->extradata), parameters->extradata_size);
+            }
+            
+            m_track = ass_new_track(m_library);
+            CHECK(m_track, "SubtitleStream::loadTrack() - unable to create libass track");
+            
+            // The styles of the ASS events, either from the media or generated by the text decoders
+            if (m_context->subtitle_header && m_context->subtitle_header_size > 0)
+            {
+                ass_process_codec_private(m_track, reinterpret_cast<char*>(m_context->subtitle_header),
+                                          m_context->subtitle_header_size);
+            }
+        }
+        catch (std::runtime_error& e)
+        {
+            sfeLogError("Subtitles disabled: " + std::string(e.what()));
+            release();
+            m_libassFailed = true;
+            return false;
+        }
+        
+        return true;
+    }
+    
+    bool SubtitleStream::loadRenderer()
+    {
+        if (m_renderer)
+            return true;
+        
+        if (m_libassFailed)
+            return false;
+        
+        try
+        {
+            m_renderer = ass_renderer_init(m_library);
+            CHECK(m_renderer, "SubtitleStream::loadRenderer() - unable to initialize libass renderer");
+            
+            ass_set_frame_size(m_renderer, m_frameSize.x, m_frameSize.y);
+            ass_set_cache_limits(m_renderer, GlyphCacheSize, BitmapCacheMegabytes);
+            ass_set_fonts(m_renderer, nullptr, "sans-serif", ASS_FONTPROVIDER_AUTODETECT, nullptr, 1);
+            
+            m_pixels.resize(m_frameSize.x * m_frameSize.y * 4);
+            CHECK(m_overlay.create(m_frameSize.x, m_frameSize.y),
+                  "SubtitleStream::loadRenderer() - sf::Texture::create() error");
+        }
+        catch (std::runtime_error& e)
+        {
+            sfeLogError("Subtitles disabled: " + std::string(e.what()));
+            release();
+            m_libassFailed = true;
+            return false;
+        }
+        
+        return true;
+    }
+    
+    void SubtitleStream::compose(const ASS_Image* images)
+    {
+        std::fill(m_pixels.begin(), m_pixels.end(), 0);
+        
+        // libass images are alpha masks of a single color, clipped to the frame size
+        for (const ASS_Image* image = images; image; image = image->next)
+        {
+            const unsigned int red = (image->color >> 24) & 0xFF;
+            const unsigned int green = (image->color >> 16) & 0xFF;
+            const unsigned int blue = (image->color >> 8) & 0xFF;
+            const unsigned int opacity = 255 - (image->color & 0xFF);
+            
+            for (int y = 0; y < image->h; y++)
+            {
+                const unsigned char* source = image->bitmap + y * image->stride;
+                uint8_t* destination = &m_pixels[((image->dst_y + y) * m_frameSize.x + image->dst_x) * 4];
+                
+                for (int x = 0; x < image->w; x++, destination += 4)
+                {
+                    const unsigned int alpha = opacity * source[x] / 255;
+                    
+                    if (alpha == 0)
+                        continue;
+                    
+                    // "Over" blending with straight alpha
+                    const unsigned int coveredAlpha = destination[3] * (255 - alpha) / 255;
+                    const unsigned int resultAlpha = alpha + coveredAlpha;
+                    
+                    destination[0] = (red * alpha + destination[0] * coveredAlpha) / resultAlpha;
+                    destination[1] = (green * alpha + destination[1] * coveredAlpha) / resultAlpha;
+                    destination[2] = (blue * alpha + destination[2] * coveredAlpha) / resultAlpha;
+                    destination[3] = resultAlpha;
+                }
+            }
+        }
+        
+        m_overlay.update(m_pixels.data());
+    }
+    
+    void SubtitleStream::release()
+    {
+        if (m_track)
+            ass_free_track(m_track);
+        
+        if (m_renderer)
+            ass_renderer_done(m_renderer);
+        
+        if (m_library)
+            ass_library_done(m_library);
+        
+        m_track = nullptr;
+        m_renderer = nullptr;
+        m_library = nullptr;
+    }
+#endif
+}
@@ -0,0 +1,165 @@
+
+/*
+ *  SubtitleStream.hpp
+ *  sfeMovie project
+ *
+ *  Copyright (C) 2010-2015 Lucas Soltic
+ *  lucas.soltic@orange.fr
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ *
+ */
+
+#ifndef SFEMOVIE_SUBTITLESTREAM_HPP
+#define SFEMOVIE_SUBTITLESTREAM_HPP
+
+#include "Stream.hpp"
+#include <SFML/Graphics.hpp>
+#include <vector>
+#include <stdint.h>
+
+#ifdef SFEMOVIE_USE_LIBASS
+extern "C"
+{
+#include <ass/ass.h>
+}
+#endif
+
+namespace sfe
+{
+    class SubtitleStream : public Stream
+    {
+    public:
+        /** Create a subtitle stream from the given FFmpeg stream
+         *
+         * Text subtitles are converted to ASS by the FFmpeg decoder, then all subtitles are
+         * rendered by libass in an overlay of the size of the first video stream of the media.
+         * libass is only set up once the stream receives its first packet, and the renderer and the
+         * overlay once the first subtitle is displayed. Throws when sfeMovie is built without libass
+         */
+        SubtitleStream(AVFormatContext*& formatCtx, AVStream*& stream, DataSource& dataSource,
+                       std::shared_ptr<Timer> timer);
+        
+        /** Default destructor
+         */
+        virtual ~SubtitleStream();
+        
+        /** Get the stream kind
+         *
+         * @return Subtitle
+         */
+        MediaType getStreamKind() const override;
+        
+        /** Decode the received packets and render the subtitles active at the timer position
+         *
+         * The subtitles are only rendered again when the set of active subtitles changes, or
+         * while an active subtitle is animated
+         */
+        void update() override;
+        
+        /** Empty the encoded data queue, the subtitles already decoded are kept
+         */
+        void flushBuffers() override;
+        
+        /** Subtitles don't need to be decoded ahead of time, so nothing is discarded
+         *
+         * @return true
+         */
+        bool fastForward(sf::Time targetPosition) override;
+        
+        /** Subtitle packets are scarce, they are given to this stream as the other streams read the media
+         *
+         * @return true
+         */
+        bool isPassive() const override;
+        
+        /** @return the texture with the rendered subtitles, of the size of the video
+         */
+        const sf::Texture& getOverlay() const;
+        
+        /** @return true if subtitles are displayed at the current position
+         */
+        bool hasVisibleSubtitles() const;
+    
+    private:
+        /** Timing of a subtitle decoded in the libass track
+         */
+        struct Event
+        {
+            long long start;
+            long long end;
+            bool animated;
+        };
+        
+        /** Decode @a packet and give its subtitles to libass
+         */
+        void decodePacket(AVPacket* packet);
+        
+#ifdef SFEMOVIE_USE_LIBASS
+        /** Initialize libass and the track receiving the decoded events, if not done yet
+         *
+         * @return true if the track can be used
+         */
+        bool loadTrack();
+        
+        /** Initialize the libass renderer, its fonts and the overlay, if not done yet
+         *
+         * The fonts of the system are scanned here, which can take a while the first time
+         *
+         * @return true if the subtitles can be rendered
+         */
+        bool loadRenderer();
+#endif
+        
+        /** Find the subtitles active at @a position and how long this set of subtitles stays unchanged
+         *
+         * @param position the position in milliseconds
+         * @return true if the set of active subtitles differs from the previous one
+         */
+        bool updateActiveEvents(long long position);
+        
+#ifdef SFEMOVIE_USE_LIBASS
+        /** Blend the images rendered by libass into the overlay
+         */
+        void compose(const ASS_Image* images);
+        
+        /** Free the libass objects
+         */
+        void release();
+        
+        ASS_Library* m_library;
+        ASS_Renderer* m_renderer;
+        ASS_Track* m_track;
+        bool m_libassFailed;
+#endif
+        sf::Vector2u m_frameSize;
+        
+        std::vector<Event> m_events;
+        std::vector<std::size_t> m_activeEvents;
+        std::vector<std::size_t> m_previousActiveEvents;
+        bool m_hasAnimatedEvents;
+        
+        // The active subtitles are known not to change between these positions, in milliseconds
+        long long m_validFrom;
+        long long m_validUntil;
+        bool m_needsRendering;
+        
+        std::vector<uint8_t> m_pixels;
+        sf::Texture m_overlay;
+        bool m_hasVisibleSubtitles;
+    };
+}
+
+#endif
@@ -0,0 +1,90 @@
+
+/*
+ *  TensorReader.cpp
+ *  sfeMovie project
+ *
+ *  Copyright (C) 2010-2015 Lucas Soltic
+ *  lucas.soltic@orange.fr
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ *
+ */
+
+#include <sfeMovie/TensorReader.hpp>
+#include "TensorReaderImpl.hpp"
+
+namespace sfe
+{
+    TensorFormat::TensorFormat() :
+    width(224),
+    height(224),
+    layout(NCHW)
+    {
+        for (int channel = 0; channel < 3; channel++)
+        {
+            mean[channel] = 0.f;
+            deviation[channel] = 1.f;
+        }
+    }
+    
+    TensorReader::TensorReader() :
+    m_impl(std::make_shared<TensorReaderImpl>())
+    {
+    }
+    
+    TensorReader::~TensorReader()
+    {
+    }
+    
+    bool TensorReader::open(const std::string& filename, const TensorFormat& format, unsigned int batchSize)
+    {
+        return m_impl->open(filename, format, batchSize);
+    }
+    
+    void TensorReader::setStride(unsigned int stride)
+    {
+        m_impl->setStride(stride);
+    }
+    
+    unsigned int TensorReader::getStride() const
+    {
+        return m_impl->getStride();
+    }
+    
+    bool TensorReader::seek(sf::Time position)
+    {
+        return m_impl->seek(position);
+    }
+    
+    unsigned int TensorReader::readBatch(float* batch, std::vector<sf::Time>* positions)
+    {
+        return m_impl->readBatch(batch, positions);
+    }
+    
+    unsigned int TensorReader::getBatchSize() const
+    {
+        return m_impl->getBatchSize();
+    }
+    
+    std::size_t TensorReader::getImageElementCount() const
+    {
+        return m_impl->getImageElementCount();
+    }
+    
+    std::size_t TensorReader::getBatchElementCount() const
+    {
+        return getBatchSize() * getImageElementCount();
+    }
+}
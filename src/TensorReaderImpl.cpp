@@ -0,0 +1,354 @@
+
+/*
+ *  TensorReaderImpl.cpp
+ *  sfeMovie project
+ *
+ *  Copyright (C) 2010-2015 Lucas Soltic
+ *  lucas.soltic@orange.fr
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ *
+ */
+
+#include "TensorReaderImpl.hpp"
+#include "Macros.hpp"
+#include "Log.hpp"
+#include <stdexcept>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #define SFEMOVIE_TENSORS_SSE2 1
+    #include <emmintrin.h>
+#else
+    #define SFEMOVIE_TENSORS_SSE2 0
+#endif
+
+namespace sfe
+{
+    namespace
+    {
+        /** Write input[i] * scales[i % 12] + biases[i % 12] to output[i] for each of the @a count values
+         */
+        void normalize(const uint8_t* input, float* output, std::size_t count,
+                       const float (&scales)[12], const float (&biases)[12])
+        {
+            std::size_t i = 0;
+            
+#if SFEMOVIE_TENSORS_SSE2
+            // 48 bytes make 12 float registers, which go through the 3 scale and bias registers 4 times
+            const __m128 scale[3] = { _mm_loadu_ps(scales), _mm_loadu_ps(scales + 4), _mm_loadu_ps(scales + 8) };
+            const __m128 bias[3] = { _mm_loadu_ps(biases), _mm_loadu_ps(biases + 4), _mm_loadu_ps(biases + 8) };
+            const __m128i zero = _mm_setzero_si128();
+            
+            for (; i + 48 <= count; i += 48)
+            {
+                for (int block = 0; block < 3; block++)
+                {
+                    const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(input + i + 16 * block));
+                    const __m128i low = _mm_unpacklo_epi8(bytes, zero);
+                    const __m128i high = _mm_unpackhi_epi8(bytes, zero);
+                    const __m128i values[4] =
+                    {
+                        _mm_unpacklo_epi16(low, zero), _mm_unpackhi_epi16(low, zero),
+                        _mm_unpacklo_epi16(high, zero), _mm_unpackhi_epi16(high, zero)
+                    };
+                    
+                    for (int j = 0; j < 4; j++)
+                    {
+                        const int pattern = (block * 4 + j) % 3;
+                        const __m128 floats = _mm_cvtepi32_ps(values[j]);
+                        _mm_storeu_ps(output + i + 16 * block + 4 * j,
+                                      _mm_add_ps(_mm_mul_ps(floats, scale[pattern]), bias[pattern]));
+                    }
+                }
+            }
+#endif
+            
+            for (; i < count; i++)
+                output[i] = input[i] * scales[i % 12] + biases[i % 12];
+        }
+    }
+    
+    TensorReaderImpl::TensorReaderImpl() :
+    m_reader(),
+    m_format(),
+    m_batchSize(0),
+    m_stride(1),
+    m_swsCtx(nullptr),
+    m_images(),
+    m_firstImage(0),
+    m_imageCount(0),
+    m_endOfStream(false),
+    m_stopDecoding(false),
+    m_imagesMutex(),
+    m_imagesCondition(),
+    m_decodingThread()
+    {
+    }
+    
+    TensorReaderImpl::~TensorReaderImpl()
+    {
+        stopDecoding();
+        
+        if (m_swsCtx)
+            sws_freeContext(m_swsCtx);
+    }
+    
+    bool TensorReaderImpl::open(const std::string& filename, const TensorFormat& format, unsigned int batchSize)
+    {
+        stopDecoding();
+        m_batchSize = 0;
+        
+        if (format.width == 0 || format.height == 0 || batchSize == 0)
+        {
+            sfeLogError("TensorReader::open() - invalid argument: the image size and batch size must not be 0");
+            return false;
+        }
+        
+        for (int channel = 0; channel < 3; channel++)
+        {
+            if (format.deviation[channel] == 0)
+            {
+                sfeLogError("TensorReader::open() - invalid argument: the deviations must not be 0");
+                return false;
+            }
+        }
+        
+        if (! m_reader.open(filename, Video, -1))
+            return false;
+        
+        m_reader.setStride(m_stride);
+        m_format = format;
+        
+        // (value / 255 - mean) / deviation
+        for (int i = 0; i < 12; i++)
+        {
+            for (int plane = 0; plane < 3; plane++)
+            {
+                const int channel = (format.layout == TensorFormat::NCHW) ? plane : i % 3;
+                m_scales[plane][i] = 1.f / (255.f * format.deviation[channel]);
+                m_biases[plane][i] = -format.mean[channel] / format.deviation[channel];
+            }
+        }
+        
+        m_images.assign(2 * batchSize, Image());
+        
+        for (Image& image : m_images)
+            image.pixels.resize(3 * format.width * format.height);
+        
+        m_batchSize = batchSize;
+        startDecoding();
+        return true;
+    }
+    
+    void TensorReaderImpl::setStride(unsigned int stride)
+    {
+        m_stride = stride > 0 ? stride : 1;
+    }
+    
+    unsigned int TensorReaderImpl::getStride() const
+    {
+        return m_stride;
+    }
+    
+    bool TensorReaderImpl::seek(sf::Time position)
+    {
+        if (m_batchSize == 0)
+            return false;
+        
+        stopDecoding();
+        m_reader.setStride(m_stride);
+        bool success = m_reader.seek(position);
+        startDecoding();
+        
+        return success;
+    }
+    
+    unsigned int TensorReaderImpl::readBatch(float* batch, std::vector<sf::Time>* positions)
+    {
+        CHECK(batch, "TensorReader::readBatch() - invalid argument: batch");
+        
+        if (positions)
+            positions->clear();
+        
+        unsigned int count = 0;
+        
+        while (count < m_batchSize)
+        {
+            std::size_t index;
+            
+            {
+                std::unique_lock<std::mutex> lock(m_imagesMutex);
+                m_imagesCondition.wait(lock, [this]() { return m_imageCount > 0 || m_endOfStream; });
+                
+                if (m_imageCount == 0)
+                    break;
+                
+                index = m_firstImage;
+            }
+            
+            // The decoding thread never writes to an image that is still queued
+            const Image& image = m_images[index];
+            convert(image, batch + count * getImageElementCount());
+            
+            if (positions)
+                positions->push_back(image.position);
+            
+            {
+                std::lock_guard<std::mutex> lock(m_imagesMutex);
+                m_firstImage = (m_firstImage + 1) % m_images.size();
+                m_imageCount--;
+            }
+            
+            m_imagesCondition.notify_all();
+            count++;
+        }
+        
+        return count;
+    }
+    
+    unsigned int TensorReaderImpl::getBatchSize() const
+    {
+        return m_batchSize;
+    }
+    
+    std::size_t TensorReaderImpl::getImageElementCount() const
+    {
+        if (m_batchSize == 0)
+            return 0;
+        
+        return 3 * static_cast<std::size_t>(m_format.width) * m_format.height;
+    }
+    
+    void TensorReaderImpl::decodeAhead()
+    {
+        try
+        {
+            while (true)
+            {
+                std::size_t index;
+                
+                {
+                    std::unique_lock<std::mutex> lock(m_imagesMutex);
+                    m_imagesCondition.wait(lock, [this]()
+                    {
+                        return m_stopDecoding || m_imageCount < m_images.size();
+                    });
+                    
+                    if (m_stopDecoding)
+                        return;
+                    
+                    index = (m_firstImage + m_imageCount) % m_images.size();
+                }
+                
+                MediaFrame frame;
+                
+                if (! m_reader.readFrame(frame))
+                    break;
+                
+                resize(frame, m_images[index]);
+                
+                {
+                    std::lock_guard<std::mutex> lock(m_imagesMutex);
+                    m_imageCount++;
+                }
+                
+                m_imagesCondition.notify_all();
+            }
+        }
+        catch (std::runtime_error& e)
+        {
+            sfeLogError("TensorReader - decoding stopped: " + std::string(e.what()));
+        }
+        
+        {
+            std::lock_guard<std::mutex> lock(m_imagesMutex);
+            m_endOfStream = true;
+        }
+        
+        m_imagesCondition.notify_all();
+    }
+    
+    void TensorReaderImpl::resize(const MediaFrame& frame, Image& image)
+    {
+        const AVFrame* source = frame.getAVFrame();
+        const int width = static_cast<int>(m_format.width);
+        const int height = static_cast<int>(m_format.height);
+        const bool planar = (m_format.layout == TensorFormat::NCHW);
+        
+        m_swsCtx = sws_getCachedContext(m_swsCtx, source->width, source->height, static_cast<AVPixelFormat>(source->format),
+                                        width, height, planar ? AV_PIX_FMT_GBRP : AV_PIX_FMT_RGB24,
+                                        SWS_BILINEAR, nullptr, nullptr, nullptr);
+        CHECK(m_swsCtx, "TensorReader - sws_getCachedContext() error");
+        
+        uint8_t* pixels = image.pixels.data();
+        const std::size_t planeSize = static_cast<std::size_t>(width) * height;
+        
+        // GBRP planes are stored in RGB order so that they match the output channels
+        uint8_t* planes[4] = { pixels, nullptr, nullptr, nullptr };
+        int linesizes[4] = { 3 * width, 0, 0, 0 };
+        
+        if (planar)
+        {
+            planes[0] = pixels + planeSize;
+            planes[1] = pixels + 2 * planeSize;
+            planes[2] = pixels;
+            linesizes[0] = linesizes[1] = linesizes[2] = width;
+        }
+        
+        sws_scale(m_swsCtx, source->data, source->linesize, 0, source->height, planes, linesizes);
+        image.position = frame.getPosition();
+    }
+    
+    void TensorReaderImpl::convert(const Image& image, float* output) const
+    {
+        const std::size_t planeSize = static_cast<std::size_t>(m_format.width) * m_format.height;
+        
+        if (m_format.layout == TensorFormat::NCHW)
+        {
+            for (int plane = 0; plane < 3; plane++)
+            {
+                normalize(image.pixels.data() + plane * planeSize, output + plane * planeSize, planeSize,
+                          m_scales[plane], m_biases[plane]);
+            }
+        }
+        else
+        {
+            normalize(image.pixels.data(), output, 3 * planeSize, m_scales[0], m_biases[0]);
+        }
+    }
+    
+    void TensorReaderImpl::startDecoding()
+    {
+        m_decodingThread = std::thread(&TensorReaderImpl::decodeAhead, this);
+    }
+    
+    void TensorReaderImpl::stopDecoding()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_imagesMutex);
+            m_stopDecoding = true;
+        }
+        
+        m_imagesCondition.notify_all();
+        
+        if (m_decodingThread.joinable())
+            m_decodingThread.join();
+        
+        m_firstImage = 0;
+        m_imageCount = 0;
+        m_endOfStream = false;
+        m_stopDecoding = false;
+    }
+}
@@ -0,0 +1,138 @@
+
+/*
+ *  TensorReaderImpl.hpp
+ *  sfeMovie project
+ *
+ *  Copyright (C) 2010-2015 Lucas Soltic
+ *  lucas.soltic@orange.fr
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ *
+ */
+
+#ifndef SFEMOVIE_TENSORREADERIMPL_HPP
+#define SFEMOVIE_TENSORREADERIMPL_HPP
+
+#include <sfeMovie/TensorReader.hpp>
+#include "FrameReaderImpl.hpp"
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <stdint.h>
+
+extern "C"
+{
+#include <libswscale/swscale.h>
+}
+
+namespace sfe
+{
+    /** Turn the frames of a FrameReaderImpl into normalized float images
+     *
+     * A background thread decodes frames ahead and resizes them to 8 bits RGB images at the output
+     * size, so that only the conversion to floats is left when a batch is read
+     */
+    class TensorReaderImpl
+    {
+    public:
+        /** Default constructor
+         */
+        TensorReaderImpl();
+        
+        /** Default destructor
+         */
+        ~TensorReaderImpl();
+        
+        /** @see TensorReader::open()
+         */
+        bool open(const std::string& filename, const TensorFormat& format, unsigned int batchSize);
+        
+        /** @see TensorReader::setStride()
+         */
+        void setStride(unsigned int stride);
+        
+        /** @see TensorReader::getStride()
+         */
+        unsigned int getStride() const;
+        
+        /** @see TensorReader::seek()
+         */
+        bool seek(sf::Time position);
+        
+        /** @see TensorReader::readBatch()
+         */
+        unsigned int readBatch(float* batch, std::vector<sf::Time>* positions);
+        
+        /** @see TensorReader::getBatchSize()
+         */
+        unsigned int getBatchSize() const;
+        
+        /** @see TensorReader::getImageElementCount()
+         */
+        std::size_t getImageElementCount() const;
+        
+    private:
+        /** A resized frame waiting to be converted
+         */
+        struct Image
+        {
+            std::vector<uint8_t> pixels;
+            sf::Time position;
+        };
+        
+        /** Decode and resize frames until the images queue is full, the stream ends or the thread is stopped
+         */
+        void decodeAhead();
+        
+        /** Resize @a frame to the output size into @a image
+         */
+        void resize(const MediaFrame& frame, Image& image);
+        
+        /** Write @a image as floats to @a output, with the layout and normalization of the format
+         */
+        void convert(const Image& image, float* output) const;
+        
+        /** Start decoding ahead on the background thread
+         */
+        void startDecoding();
+        
+        /** Stop the background thread and forget the images decoded ahead
+         */
+        void stopDecoding();
+        
+        FrameReaderImpl m_reader;
+        TensorFormat m_format;
+        unsigned int m_batchSize;
+        unsigned int m_stride;
+        SwsContext* m_swsCtx;
+        
+        // Normalization as value * scale + bias, repeated to fill 3 SSE registers whatever the layout
+        float m_scales[3][12];
+        float m_biases[3][12];
+        
+        // Ring of the images decoded ahead, it holds two batches so that one is always being decoded
+        std::vector<Image> m_images;
+        std::size_t m_firstImage;
+        std::size_t m_imageCount;
+        bool m_endOfStream;
+        bool m_stopDecoding;
+        std::mutex m_imagesMutex;
+        std::condition_variable m_imagesCondition;
+        std::thread m_decodingThread;
+    };
+}
+
+#endif
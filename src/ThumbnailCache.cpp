@@ -0,0 +1,65 @@
+
+/*
+ *  ThumbnailCache.cpp
+ *  sfeMovie project
+ *
+ *  Copyright (C) 2010-2015 Lucas Soltic
+ *  lucas.soltic@orange.fr
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ *
+ */
+
+#include <sfeMovie/ThumbnailCache.hpp>
+#include "ThumbnailCacheImpl.hpp"
+
+namespace sfe
+{
+    ThumbnailCache::ThumbnailCache() :
+    m_impl(std::make_shared<ThumbnailCacheImpl>())
+    {
+    }
+    
+    ThumbnailCache::~ThumbnailCache()
+    {
+    }
+    
+    bool ThumbnailCache::open(const std::string& directory, sf::Uint64 maxSize)
+    {
+        return m_impl->open(directory, maxSize);
+    }
+    
+    bool ThumbnailCache::getPoster(const std::string& mediaFile, sf::Vector2u size, sf::Image& poster)
+    {
+        Thumbnails thumbnails = m_impl->getThumbnails(mediaFile, 1, size);
+        
+        if (thumbnails.empty())
+            return false;
+        
+        poster = thumbnails.front().image;
+        return true;
+    }
+    
+    Thumbnails ThumbnailCache::getThumbnails(const std::string& mediaFile, unsigned int count, sf::Vector2u size)
+    {
+        return m_impl->getThumbnails(mediaFile, count, size);
+    }
+    
+    bool ThumbnailCache::findThumbnails(const std::string& mediaFile, unsigned int count, sf::Vector2u size,
+                                        Thumbnails& thumbnails) const
+    {
+        return m_impl->findThumbnails(mediaFile, count, size, thumbnails);
+    }
+}
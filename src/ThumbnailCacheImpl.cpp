@@ -0,0 +1,420 @@
+
+/*
+ *  ThumbnailCacheImpl.cpp
+ *  sfeMovie project
+ *
+ *  Copyright (C) 2010-2015 Lucas Soltic
+ *  lucas.soltic@orange.fr
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ *
+ */
+
+#include "ThumbnailCacheImpl.hpp"
+#include "ThumbnailExtractor.hpp"
+#include "Utilities.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+namespace sfe
+{
+    namespace
+    {
+        const char IndexMagic[8] = { 'S', 'F', 'E', 'T', 'H', 'U', 'M', 'B' };
+        const uint32_t IndexVersion = 1;
+        const std::size_t IndexHeaderSize = sizeof(IndexMagic) + 2 * sizeof(uint32_t);
+        
+        // Hashing the beginning and end of the media is enough to notice it changed, and stays cheap
+        const std::size_t FingerprintBlockSize = 64 * 1024;
+        
+        // Position in microseconds, width and height before the pixels of each thumbnail
+        const std::size_t ThumbnailHeaderSize = sizeof(int64_t) + 2 * sizeof(uint32_t);
+        
+        // Compacting keeps this share of the maximum size, so that the files aren't rewritten on every store
+        const uint64_t CompactedSizeRatio = 4;
+        const uint64_t CompactedSizeShare = 3;
+        
+        template <typename T>
+        void writeValue(std::ofstream& file, const T& value)
+        {
+            file.write(reinterpret_cast<const char*>(&value), sizeof(value));
+        }
+        
+        template <typename T>
+        T readValue(const uint8_t* data)
+        {
+            T value;
+            std::memcpy(&value, data, sizeof(value));
+            return value;
+        }
+        
+        /** FNV-1a hash of @a size bytes, continuing from @a hash
+         */
+        uint64_t hashBytes(const char* bytes, std::size_t size, uint64_t hash)
+        {
+            for (std::size_t i = 0; i < size; i++)
+            {
+                hash ^= static_cast<uint8_t>(bytes[i]);
+                hash *= 1099511628211ULL;
+            }
+            
+            return hash;
+        }
+    }
+    
+    ThumbnailCacheImpl::ThumbnailCacheImpl() :
+    m_indexFile(),
+    m_dataFile(),
+    m_maxSize(0),
+    m_records(),
+    m_data(),
+    m_isOpen(false),
+    m_mutex()
+    {
+    }
+    
+    bool ThumbnailCacheImpl::open(const std::string& directory, uint64_t maxSize)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        
+        m_indexFile = directory + "/thumbnails.sfeindex";
+        m_dataFile = directory + "/thumbnails.sfedata";
+        m_maxSize = maxSize;
+        m_isOpen = load() || reset();
+        
+        // The cache may have been filled with a larger maximum size
+        if (m_isOpen && m_data.getSize() > m_maxSize)
+            m_isOpen = compact(m_maxSize / CompactedSizeRatio * CompactedSizeShare) || reset();
+        
+        if (! m_isOpen)
+            sfeLogError("ThumbnailCache::open() - could not use " + directory + " as thumbnails cache directory");
+        
+        return m_isOpen;
+    }
+    
+    Thumbnails ThumbnailCacheImpl::getThumbnails(const std::string& mediaFile, unsigned int count, sf::Vector2u size)
+    {
+        Thumbnails thumbnails;
+        
+        if (findThumbnails(mediaFile, count, size, thumbnails))
+            return thumbnails;
+        
+        // Extracted without holding the lock, so that other medias can be looked up in the meantime
+        thumbnails = ThumbnailExtractor(mediaFile, size).extract(count);
+        
+        IndexRecord record;
+        
+        if (! thumbnails.empty() && computeFingerprint(mediaFile, record))
+        {
+            record.width = size.x;
+            record.height = size.y;
+            record.count = count;
+            
+            std::lock_guard<std::mutex> lock(m_mutex);
+            
+            if (m_isOpen)
+                store(record, thumbnails);
+        }
+        
+        return thumbnails;
+    }
+    
+    bool ThumbnailCacheImpl::findThumbnails(const std::string& mediaFile, unsigned int count, sf::Vector2u size,
+                                            Thumbnails& thumbnails) const
+    {
+        IndexRecord record;
+        
+        if (! computeFingerprint(mediaFile, record))
+            return false;
+        
+        record.width = size.x;
+        record.height = size.y;
+        record.count = count;
+        
+        std::lock_guard<std::mutex> lock(m_mutex);
+        std::map<Key, IndexRecord>::const_iterator it = m_records.find(makeKey(record));
+        
+        return it != m_records.end() && readThumbnails(it->second, thumbnails);
+    }
+    
+    ThumbnailCacheImpl::Key ThumbnailCacheImpl::makeKey(const IndexRecord& record)
+    {
+        return Key(record.mediaSize, record.modificationTime, record.contentHash,
+                   record.width, record.height, record.count);
+    }
+    
+    bool ThumbnailCacheImpl::computeFingerprint(const std::string& mediaFile, IndexRecord& record)
+    {
+        uint64_t mediaSize = 0;
+        int64_t modificationTime = 0;
+        
+        if (! getFileStatus(mediaFile, mediaSize, modificationTime))
+            return false;
+        
+        std::ifstream file(mediaFile.c_str(), std::ios::binary);
+        
+        if (! file)
+            return false;
+        
+        const std::size_t blockSize = static_cast<std::size_t>(std::min<uint64_t>(FingerprintBlockSize, mediaSize));
+        std::vector<char> block(blockSize);
+        uint64_t hash = 14695981039346656037ULL;
+        
+        if (blockSize > 0)
+        {
+            if (! file.read(&block[0], blockSize))
+                return false;
+            
+            hash = hashBytes(&block[0], blockSize, hash);
+            
+            if (! file.seekg(static_cast<std::streamoff>(mediaSize - blockSize)) || ! file.read(&block[0], blockSize))
+                return false;
+            
+            hash = hashBytes(&block[0], blockSize, hash);
+        }
+        
+        record.mediaSize = mediaSize;
+        record.modificationTime = modificationTime;
+        record.contentHash = hash;
+        return true;
+    }
+    
+    bool ThumbnailCacheImpl::load()
+    {
+        m_records.clear();
+        
+        MappedFile index;
+        
+        if (! index.open(m_indexFile) || ! m_data.open(m_dataFile))
+            return false;
+        
+        const uint8_t* data = index.getData();
+        
+        if (index.getSize() < IndexHeaderSize || std::memcmp(data, IndexMagic, sizeof(IndexMagic)) != 0
+            || readValue<uint32_t>(data + sizeof(IndexMagic)) != IndexVersion
+            || readValue<uint32_t>(data + sizeof(IndexMagic) + sizeof(uint32_t)) != sizeof(IndexRecord))
+        {
+            sfeLogDebug("Ignoring outdated or invalid thumbnails cache " + m_indexFile);
+            return false;
+        }
+        
+        const std::size_t recordCount = (index.getSize() - IndexHeaderSize) / sizeof(IndexRecord);
+        
+        for (std::size_t i = 0; i < recordCount; i++)
+        {
+            const IndexRecord record = readValue<IndexRecord>(data + IndexHeaderSize + i * sizeof(IndexRecord));
+            
+            // Records whose data didn't make it to the disk are ignored, later records replace earlier ones.
+            // Corrupted counts are ignored too, each thumbnail taking at least its header in the data file
+            if (record.dataOffset <= m_data.getSize() && record.dataSize <= m_data.getSize() - record.dataOffset
+                && record.thumbnailCount <= record.dataSize / ThumbnailHeaderSize)
+            {
+                m_records[makeKey(record)] = record;
+            }
+        }
+        
+        sfeLogDebug("Loaded " + s(m_records.size()) + " thumbnails cache entries from " + m_indexFile);
+        return true;
+    }
+    
+    bool ThumbnailCacheImpl::reset()
+    {
+        m_records.clear();
+        m_data.close();
+        
+        {
+            std::ofstream index(m_indexFile.c_str(), std::ios::binary | std::ios::trunc);
+            std::ofstream data(m_dataFile.c_str(), std::ios::binary | std::ios::trunc);
+            
+            index.write(IndexMagic, sizeof(IndexMagic));
+            writeValue(index, IndexVersion);
+            writeValue(index, static_cast<uint32_t>(sizeof(IndexRecord)));
+            
+            if (! index || ! data)
+                return false;
+        }
+        
+        return m_data.open(m_dataFile);
+    }
+    
+    bool ThumbnailCacheImpl::readThumbnails(const IndexRecord& record, Thumbnails& thumbnails) const
+    {
+        const uint8_t* data = m_data.getData() + record.dataOffset;
+        const uint8_t* end = data + record.dataSize;
+        Thumbnails result(record.thumbnailCount);
+        
+        for (Thumbnail& thumbnail : result)
+        {
+            if (static_cast<std::size_t>(end - data) < ThumbnailHeaderSize)
+                return false;
+            
+            const int64_t position = readValue<int64_t>(data);
+            const uint32_t width = readValue<uint32_t>(data + sizeof(int64_t));
+            const uint32_t height = readValue<uint32_t>(data + sizeof(int64_t) + sizeof(uint32_t));
+            data += ThumbnailHeaderSize;
+            
+            const uint64_t pixelsSize = 4 * static_cast<uint64_t>(width) * height;
+            
+            if (static_cast<uint64_t>(end - data) < pixelsSize)
+                return false;
+            
+            thumbnail.position = sf::microseconds(position);
+            thumbnail.image.create(width, height, data);
+            data += pixelsSize;
+        }
+        
+        thumbnails.swap(result);
+        return true;
+    }
+    
+    void ThumbnailCacheImpl::store(IndexRecord record, const Thumbnails& thumbnails)
+    {
+        uint64_t storedSize = 0;
+        
+        for (const Thumbnail& thumbnail : thumbnails)
+            storedSize += ThumbnailHeaderSize + 4 * static_cast<uint64_t>(thumbnail.image.getSize().x) * thumbnail.image.getSize().y;
+        
+        if (storedSize > m_maxSize)
+        {
+            sfeLogDebug("Thumbnails of " + s(storedSize) + " bytes don't fit in the thumbnails cache, not storing them");
+            return;
+        }
+        
+        // Make room for the new thumbnails, dropping the oldest ones
+        if (m_data.getSize() + storedSize > m_maxSize)
+        {
+            const uint64_t compactedSize = std::min(m_maxSize / CompactedSizeRatio * CompactedSizeShare, m_maxSize - storedSize);
+            
+            if (! compact(compactedSize))
+            {
+                sfeLogWarning("Could not compact the thumbnails cache " + m_dataFile + ", emptying it");
+                m_isOpen = reset();
+                
+                if (! m_isOpen)
+                    return;
+            }
+        }
+        
+        // The thumbnails are written before their index record, so that the index never refers to missing data
+        {
+            std::ofstream data(m_dataFile.c_str(), std::ios::binary | std::ios::in | std::ios::out | std::ios::ate);
+            record.dataOffset = static_cast<uint64_t>(data.tellp());
+            
+            for (const Thumbnail& thumbnail : thumbnails)
+            {
+                const sf::Vector2u size = thumbnail.image.getSize();
+                writeValue(data, static_cast<int64_t>(thumbnail.position.asMicroseconds()));
+                writeValue(data, static_cast<uint32_t>(size.x));
+                writeValue(data, static_cast<uint32_t>(size.y));
+                data.write(reinterpret_cast<const char*>(thumbnail.image.getPixelsPtr()), 4 * size.x * size.y);
+            }
+            
+            record.dataSize = static_cast<uint64_t>(data.tellp()) - record.dataOffset;
+            record.thumbnailCount = static_cast<uint32_t>(thumbnails.size());
+            
+            if (! data)
+            {
+                sfeLogWarning("Could not write the thumbnails cache " + m_dataFile);
+                return;
+            }
+        }
+        
+        {
+            std::ofstream index(m_indexFile.c_str(), std::ios::binary | std::ios::app);
+            writeValue(index, record);
+            
+            if (! index)
+            {
+                sfeLogWarning("Could not write the thumbnails cache " + m_indexFile);
+                return;
+            }
+        }
+        
+        // Map the data file again to see the new thumbnails
+        if (m_data.open(m_dataFile))
+            m_records[makeKey(record)] = record;
+        else
+            m_isOpen = false;
+    }
+    
+    bool ThumbnailCacheImpl::compact(uint64_t dataSize)
+    {
+        // The data file is written in storing order, so the most recently stored records are the last ones
+        std::vector<IndexRecord> records;
+        records.reserve(m_records.size());
+        
+        for (const std::pair<const Key, IndexRecord>& pair : m_records)
+            records.push_back(pair.second);
+        
+        std::sort(records.begin(), records.end(), [](const IndexRecord& first, const IndexRecord& second)
+        {
+            return first.dataOffset > second.dataOffset;
+        });
+        
+        uint64_t keptSize = 0;
+        std::size_t keptCount = 0;
+        
+        while (keptCount < records.size() && keptSize + records[keptCount].dataSize <= dataSize)
+            keptSize += records[keptCount++].dataSize;
+        
+        records.resize(keptCount);
+        std::reverse(records.begin(), records.end());
+        
+        // Written next to the cache files first, so that a failure leaves the cache as it was
+        const std::string compactedIndexFile = m_indexFile + ".tmp";
+        const std::string compactedDataFile = m_dataFile + ".tmp";
+        
+        {
+            std::ofstream index(compactedIndexFile.c_str(), std::ios::binary | std::ios::trunc);
+            std::ofstream data(compactedDataFile.c_str(), std::ios::binary | std::ios::trunc);
+            
+            index.write(IndexMagic, sizeof(IndexMagic));
+            writeValue(index, IndexVersion);
+            writeValue(index, static_cast<uint32_t>(sizeof(IndexRecord)));
+            
+            for (IndexRecord record : records)
+            {
+                data.write(reinterpret_cast<const char*>(m_data.getData() + record.dataOffset),
+                           static_cast<std::streamsize>(record.dataSize));
+                record.dataOffset = static_cast<uint64_t>(data.tellp()) - record.dataSize;
+                writeValue(index, record);
+            }
+            
+            if (! index || ! data)
+            {
+                std::remove(compactedIndexFile.c_str());
+                std::remove(compactedDataFile.c_str());
+                return false;
+            }
+        }
+        
+        sfeLogDebug("Compacted the thumbnails cache " + m_dataFile + " from " + s(m_records.size()) + " to "
+                    + s(records.size()) + " entries");
+        
+        // Without index, an interrupted replacement leaves a cache that is reset rather than mismatched files
+        m_data.close();
+        std::remove(m_indexFile.c_str());
+        std::remove(m_dataFile.c_str());
+        
+        if (std::rename(compactedDataFile.c_str(), m_dataFile.c_str()) != 0 ||
+            std::rename(compactedIndexFile.c_str(), m_indexFile.c_str()) != 0)
+            return false;
+        
+        return load();
+    }
+}
@@ -0,0 +1,135 @@
+
+/*
+ *  ThumbnailCacheImpl.hpp
+ *  sfeMovie project
+ *
+ *  Copyright (C) 2010-2015 Lucas Soltic
+ *  lucas.soltic@orange.fr
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ *
+ */
+
+#ifndef SFEMOVIE_THUMBNAILCACHEIMPL_HPP
+#define SFEMOVIE_THUMBNAILCACHEIMPL_HPP
+
+#include <sfeMovie/ThumbnailCache.hpp>
+#include "MappedFile.hpp"
+#include <map>
+#include <mutex>
+#include <string>
+#include <tuple>
+#include <stdint.h>
+
+namespace sfe
+{
+    /** Thumbnails cache made of an index file and a data file in the cache directory
+     *
+     * The index is a header followed by fixed size records, it is memory mapped once when the cache is
+     * opened and new records are appended to it. The data file holds the thumbnails of each record
+     * one after the other, it is memory mapped too so that cached thumbnails are read without copy
+     * until they are turned into images. Once the data file would exceed its maximum size, both files
+     * are rewritten with only the most recently stored records
+     */
+    class ThumbnailCacheImpl
+    {
+    public:
+        /** Default constructor
+         */
+        ThumbnailCacheImpl();
+        
+        /** @see ThumbnailCache::open()
+         */
+        bool open(const std::string& directory, uint64_t maxSize);
+        
+        /** @see ThumbnailCache::getThumbnails()
+         */
+        Thumbnails getThumbnails(const std::string& mediaFile, unsigned int count, sf::Vector2u size);
+        
+        /** @see ThumbnailCache::findThumbnails()
+         */
+        bool findThumbnails(const std::string& mediaFile, unsigned int count, sf::Vector2u size,
+                            Thumbnails& thumbnails) const;
+        
+    private:
+        /** Index entry, stored as is in the index file
+         */
+        struct IndexRecord
+        {
+            uint64_t mediaSize;         // Fingerprint of the media
+            int64_t modificationTime;
+            uint64_t contentHash;
+            uint32_t width;             // Requested thumbnails
+            uint32_t height;
+            uint32_t count;
+            uint32_t thumbnailCount;    // Thumbnails actually stored
+            uint64_t dataOffset;        // Location of the thumbnails in the data file
+            uint64_t dataSize;
+        };
+        
+        typedef std::tuple<uint64_t, int64_t, uint64_t, uint32_t, uint32_t, uint32_t> Key;
+        
+        /** @return the key identifying @a record in the index
+         */
+        static Key makeKey(const IndexRecord& record);
+        
+        /** Fill the fingerprint fields of @a record from the media file, without decoding it
+         *
+         * @return true on success, false if the media file could not be read
+         */
+        static bool computeFingerprint(const std::string& mediaFile, IndexRecord& record);
+        
+        /** Map the data file and read the records of the index file, the lock must be held
+         *
+         * @return true if both files are valid, false otherwise
+         */
+        bool load();
+        
+        /** Create empty index and data files, the lock must be held
+         *
+         * @return true on success, false if the files could not be written
+         */
+        bool reset();
+        
+        /** Read the thumbnails of @a record from the mapped data file, the lock must be held
+         *
+         * @return true on success, false if the data is invalid
+         */
+        bool readThumbnails(const IndexRecord& record, Thumbnails& thumbnails) const;
+        
+        /** Append @a thumbnails to the data file and @a record to the index, the lock must be held
+         */
+        void store(IndexRecord record, const Thumbnails& thumbnails);
+        
+        /** Rewrite the cache files with the most recently stored records whose data fits in @a dataSize,
+         * the lock must be held
+         *
+         * Replaced records and the data of the dropped ones are removed from the files
+         *
+         * @return true on success, false if the cache files could not be rewritten
+         */
+        bool compact(uint64_t dataSize);
+        
+        std::string m_indexFile;
+        std::string m_dataFile;
+        uint64_t m_maxSize;
+        std::map<Key, IndexRecord> m_records;
+        MappedFile m_data;
+        bool m_isOpen;
+        mutable std::mutex m_mutex;
+    };
+}
+
+#endif
@@ -0,0 +1,187 @@
+
+/*
+ *  ThumbnailExtractor.cpp
+ *  sfeMovie project
+ *
+ *  Copyright (C) 2010-2015 Lucas Soltic
+ *  lucas.soltic@orange.fr
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ *
+ */
+
+#include "ThumbnailExtractor.hpp"
+#include "Macros.hpp"
+#include "Log.hpp"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <thread>
+
+namespace sfe
+{
+    ThumbnailExtractor::ThumbnailExtractor(const std::string& filename, sf::Vector2u size) :
+    m_filename(filename),
+    m_size(size)
+    {
+    }
+    
+    Thumbnails ThumbnailExtractor::extract(unsigned int count)
+    {
+        FrameReaderImpl reader;
+        
+        if (count == 0 || ! reader.open(m_filename, Video, -1))
+            return Thumbnails();
+        
+        const sf::Int64 duration = reader.getDuration().asMicroseconds();
+        std::vector<Slot> slots(duration > 0 ? count : 1);
+        
+        for (std::size_t i = 0; i < slots.size(); i++)
+            slots[i].thumbnail.position = sf::microseconds(duration * static_cast<sf::Int64>(i) / count);
+        
+        return extract(reader, slots);
+    }
+    
+    Thumbnails ThumbnailExtractor::extract(sf::Time interval)
+    {
+        FrameReaderImpl reader;
+        
+        if (interval <= sf::Time::Zero)
+        {
+            sfeLogError("Movie::extractThumbnails() - invalid argument: interval must be positive");
+            return Thumbnails();
+        }
+        
+        if (! reader.open(m_filename, Video, -1))
+            return Thumbnails();
+        
+        const sf::Time duration = reader.getDuration();
+        std::vector<Slot> slots;
+        sf::Time position;
+        
+        do
+        {
+            slots.push_back(Slot());
+            slots.back().thumbnail.position = position;
+            position += interval;
+        }
+        while (position < duration);
+        
+        return extract(reader, slots);
+    }
+    
+    Thumbnails ThumbnailExtractor::extract(FrameReaderImpl& reader, std::vector<Slot>& slots) const
+    {
+        for (Slot& slot : slots)
+            slot.extracted = false;
+        
+        // Each thread takes a contiguous range so that it only ever seeks forward
+        const std::size_t threadCount = std::min<std::size_t>(std::max(1u, std::thread::hardware_concurrency()), slots.size());
+        std::vector<std::thread> threads;
+        
+        for (std::size_t i = 1; i < threadCount; i++)
+        {
+            threads.push_back(std::thread(&ThumbnailExtractor::extractRange, this, nullptr, std::ref(slots),
+                                          i * slots.size() / threadCount, (i + 1) * slots.size() / threadCount));
+        }
+        
+        // The calling thread takes the first range, with the reader that is already open
+        extractRange(&reader, slots, 0, slots.size() / threadCount);
+        
+        for (std::thread& thread : threads)
+            thread.join();
+        
+        Thumbnails thumbnails;
+        thumbnails.reserve(slots.size());
+        
+        for (Slot& slot : slots)
+        {
+            if (slot.extracted)
+                thumbnails.push_back(slot.thumbnail);
+        }
+        
+        return thumbnails;
+    }
+    
+    void ThumbnailExtractor::extractRange(FrameReaderImpl* reader, std::vector<Slot>& slots,
+                                          std::size_t begin, std::size_t end) const
+    {
+        FrameReaderImpl ownReader;
+        
+        if (! reader)
+        {
+            if (! ownReader.open(m_filename, Video, -1))
+                return;
+            
+            reader = &ownReader;
+        }
+        
+        reader->setKeyFramesOnly(true);
+        SwsContext* swsCtx = nullptr;
+        
+        try
+        {
+            for (std::size_t i = begin; i < end; i++)
+            {
+                MediaFrame frame;
+                
+                if (reader->seek(slots[i].thumbnail.position) && reader->readFrame(frame))
+                {
+                    makeThumbnail(frame, swsCtx, slots[i].thumbnail);
+                    slots[i].extracted = true;
+                }
+            }
+        }
+        catch (std::runtime_error& e)
+        {
+            sfeLogError("Movie::extractThumbnails() - " + std::string(e.what()));
+        }
+        
+        if (swsCtx)
+            sws_freeContext(swsCtx);
+    }
+    
+    void ThumbnailExtractor::makeThumbnail(const MediaFrame& frame, SwsContext*& swsCtx, Thumbnail& thumbnail) const
+    {
+        const AVFrame* source = frame.getAVFrame();
+        sf::Vector2u size = m_size;
+        
+        if (size.x == 0 && size.y == 0)
+        {
+            size = sf::Vector2u(source->width, source->height);
+        }
+        else if (size.x == 0)
+        {
+            size.x = static_cast<unsigned int>(std::max(1.0, std::round(size.y * double(source->width) / source->height)));
+        }
+        else if (size.y == 0)
+        {
+            size.y = static_cast<unsigned int>(std::max(1.0, std::round(size.x * double(source->height) / source->width)));
+        }
+        
+        swsCtx = sws_getCachedContext(swsCtx, source->width, source->height, static_cast<AVPixelFormat>(source->format),
+                                      size.x, size.y, AV_PIX_FMT_RGBA, SWS_BILINEAR, nullptr, nullptr, nullptr);
+        CHECK(swsCtx, "sws_getCachedContext() error");
+        
+        // Scaled straight to the thumbnail size, the frame is never converted at its full size
+        std::vector<sf::Uint8> pixels(4 * size.x * size.y);
+        uint8_t* planes[4] = { pixels.data(), nullptr, nullptr, nullptr };
+        int linesizes[4] = { static_cast<int>(4 * size.x), 0, 0, 0 };
+        sws_scale(swsCtx, source->data, source->linesize, 0, source->height, planes, linesizes);
+        
+        thumbnail.image.create(size.x, size.y, pixels.data());
+        thumbnail.position = frame.getPosition();
+    }
+}
@@ -0,0 +1,95 @@
+
+/*
+ *  ThumbnailExtractor.hpp
+ *  sfeMovie project
+ *
+ *  Copyright (C) 2010-2015 Lucas Soltic
+ *  lucas.soltic@orange.fr
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ *
+ */
+
+#ifndef SFEMOVIE_THUMBNAILEXTRACTOR_HPP
+#define SFEMOVIE_THUMBNAILEXTRACTOR_HPP
+
+#include <sfeMovie/Thumbnail.hpp>
+#include "FrameReaderImpl.hpp"
+#include <string>
+#include <vector>
+
+extern "C"
+{
+#include <libswscale/swscale.h>
+}
+
+namespace sfe
+{
+    /** Make thumbnails of a video from its key frames, on several threads
+     *
+     * Each thread reads its own range of positions with its own FrameReaderImpl in key frames only
+     * mode, so that seeking costs a single key frame decoding rather than the playback fast-forward
+     */
+    class ThumbnailExtractor
+    {
+    public:
+        /** Prepare the extraction of thumbnails of the given @a size from the best video stream of a media
+         *
+         * @param filename the path to the media file
+         * @param size the size of the thumbnails, a width or height of 0 preserves the video aspect ratio
+         */
+        ThumbnailExtractor(const std::string& filename, sf::Vector2u size);
+        
+        /** @see Movie::extractThumbnails(const std::string&, unsigned int, sf::Vector2u)
+         */
+        Thumbnails extract(unsigned int count);
+        
+        /** @see Movie::extractThumbnails(const std::string&, sf::Time, sf::Vector2u)
+         */
+        Thumbnails extract(sf::Time interval);
+        
+    private:
+        /** A requested position and its thumbnail, once extracted
+         */
+        struct Slot
+        {
+            Thumbnail thumbnail;
+            bool extracted;
+        };
+        
+        /** Extract the thumbnails of @a slots, which hold the requested positions
+         *
+         * @param reader the reader opened on the media, used by the calling thread
+         */
+        Thumbnails extract(FrameReaderImpl& reader, std::vector<Slot>& slots) const;
+        
+        /** Extract the thumbnails of the slots in range [begin, end)
+         *
+         * @param reader the reader to use, or nullptr to open a new one
+         */
+        void extractRange(FrameReaderImpl* reader, std::vector<Slot>& slots, std::size_t begin, std::size_t end) const;
+        
+        /** Scale @a frame to the thumbnail size into @a thumbnail
+         *
+         * @param swsCtx the scaling context of the calling thread, created or updated as needed
+         */
+        void makeThumbnail(const MediaFrame& frame, SwsContext*& swsCtx, Thumbnail& thumbnail) const;
+        
+        std::string m_filename;
+        sf::Vector2u m_size;
+    };
+}
+
+#endif
@@ -25,9 +25,22 @@
 #include "Timer.hpp"
 #include "Macros.hpp"
 #include "Log.hpp"
+#include "Utilities.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
 
 namespace sfe
 {
+    namespace
+    {
+        const sf::Time DriftTolerance = sf::milliseconds(10);           // Drift left uncorrected
+        const sf::Time MaxSlewedDrift = sf::milliseconds(500);          // Drift corrected at once
+        const sf::Time DriftCorrectionDuration = sf::seconds(2);        // Time taken to absorb a drift
+        const double MaxRateCorrection = 0.02;
+        const double RateCorrectionStep = 0.001;
+    }
+    
     Timer::Observer::Observer()
     {
     }
@@ -57,10 +70,23 @@ namespace sfe
         return true;
     }
     
-    Timer::Timer() :
+    Timer::Timer(std::shared_ptr<Clock> clock) :
     m_pausedTime(sf::Time::Zero),
     m_status(Stopped),
-    m_timer(),
+    m_clock(clock ? clock : std::make_shared<SystemClock>()),
+    m_startTime(sf::Time::Zero),
+    m_startDelay(sf::Time::Zero),
+    m_rate(1),
+    m_startRetainCount(0),
+    m_startGeneration(0),
+    m_startReleased(false),
+    m_startMutex(),
+    m_startCondition(),
+    m_wakeUps(),
+    m_wakeUpCallbacks(),
+    m_dueCallbacks(),
+    m_nextWakeUpId(1),
+    m_wakeUpMutex(),
     m_observers()
     {
     }
@@ -92,11 +118,27 @@ namespace sfe
     {
         CHECK(getStatus() != Playing, "Timer::play() - timer playing twice");
         
+        {
+            std::lock_guard<std::mutex> lock(m_startMutex);
+            m_startGeneration++;
+            m_startRetainCount = 0;
+            m_startReleased = false;
+            m_startDelay = sf::Time::Zero;
+            m_rate = 1;
+        }
+        
         notifyObservers(Playing);
         
         Status oldStatus = getStatus();
-        m_status = Playing;
-        m_timer.restart();
+        
+        {
+            std::lock_guard<std::mutex> lock(m_startMutex);
+            m_status = Playing;
+            
+            // Observers may have retained and released the start meanwhile, from willPlay() or another thread
+            if (! m_startReleased)
+                m_startTime = m_clock->getElapsedTime();
+        }
         
         notifyObservers(oldStatus, getStatus());
     }
@@ -106,11 +148,20 @@ namespace sfe
         CHECK(getStatus() != Paused, "Timer::pause() - timer paused twice");
         
         Status oldStatus = getStatus();
-        m_status = Paused;
         
-        if (oldStatus != Stopped)
-            m_pausedTime += m_timer.getElapsedTime();
+        {
+            std::lock_guard<std::mutex> lock(m_startMutex);
+            
+            if (oldStatus != Stopped)
+                m_pausedTime += elapsedSinceStart();
+            
+            // A start that didn't complete yet is abandoned
+            m_status = Paused;
+            m_startGeneration++;
+            m_startRetainCount = 0;
+        }
         
+        m_startCondition.notify_all();
         notifyObservers(oldStatus, getStatus());
     }
     
@@ -119,9 +170,16 @@ namespace sfe
         CHECK(getStatus() != Stopped, "Timer::stop() - timer stopped twice");
         
         Status oldStatus = getStatus();
-        m_status = Stopped;
-        m_pausedTime = sf::Time::Zero;
         
+        {
+            std::lock_guard<std::mutex> lock(m_startMutex);
+            m_status = Stopped;
+            m_pausedTime = sf::Time::Zero;
+            m_startGeneration++;
+            m_startRetainCount = 0;
+        }
+        
+        m_startCondition.notify_all();
         notifyObservers(oldStatus, getStatus());
         
         seek(sf::Time::Zero);
@@ -136,7 +194,11 @@ namespace sfe
         if (oldStatus == Playing)
             pause();
         
-        m_pausedTime = position;
+        {
+            std::lock_guard<std::mutex> lock(m_startMutex);
+            m_pausedTime = position;
+        }
+        
         couldSeek = notifyObservers(oldPosition);
         
         if (oldStatus == Playing)
@@ -145,6 +207,203 @@ namespace sfe
         return couldSeek;
     }
     
+    uint64_t Timer::retainStart()
+    {
+        std::lock_guard<std::mutex> lock(m_startMutex);
+        m_startRetainCount++;
+        return m_startGeneration;
+    }
+    
+    void Timer::releaseStart(uint64_t token, sf::Time delay)
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_startMutex);
+            
+            if (token != m_startGeneration || m_startRetainCount == 0)
+                return;
+            
+            if (--m_startRetainCount > 0)
+                return;
+            
+            // Everyone is ready: this is when time actually starts flowing
+            m_startTime = m_clock->getElapsedTime();
+            m_startDelay = delay;
+            m_startReleased = true;
+        }
+        
+        m_startCondition.notify_all();
+    }
+    
+    bool Timer::isStarting() const
+    {
+        std::lock_guard<std::mutex> lock(m_startMutex);
+        return m_status == Playing && m_startRetainCount > 0;
+    }
+    
+    bool Timer::waitForStart(sf::Time timeout) const
+    {
+        std::unique_lock<std::mutex> lock(m_startMutex);
+        
+        return m_startCondition.wait_for(lock, std::chrono::microseconds(timeout.asMicroseconds()), [this]()
+        {
+            return m_status != Playing || m_startRetainCount == 0;
+        });
+    }
+    
+    sf::Time Timer::synchronize(sf::Time reference)
+    {
+        std::lock_guard<std::mutex> lock(m_startMutex);
+        
+        // Time doesn't flow yet while the start is retained or delayed
+        if (m_status != Playing || m_startRetainCount > 0 || m_clock->getElapsedTime() - m_startTime < m_startDelay)
+            return sf::Time::Zero;
+        
+        const sf::Time drift = reference - (m_pausedTime + elapsedSinceStart());
+        const sf::Int64 driftMicroseconds = std::abs(drift.asMicroseconds());
+        
+        if (driftMicroseconds > MaxSlewedDrift.asMicroseconds())
+        {
+            sfeLogDebug("Timer drifted by " + s(drift.asMilliseconds()) + "ms, resynchronizing at once");
+            
+            rebase();
+            m_pausedTime = reference;
+            m_rate = 1;
+        }
+        else
+        {
+            double rate = 1;
+            
+            if (driftMicroseconds > DriftTolerance.asMicroseconds())
+            {
+                // Steps avoid restarting the clock for every tiny change in the measured drift
+                const double correction = drift.asSeconds() / DriftCorrectionDuration.asSeconds();
+                rate += std::floor(correction / RateCorrectionStep + 0.5) * RateCorrectionStep;
+                rate = std::max(1 - MaxRateCorrection, std::min(1 + MaxRateCorrection, rate));
+            }
+            
+            if (rate != m_rate)
+            {
+                rebase();
+                m_rate = rate;
+            }
+        }
+        
+        return drift;
+    }
+    
+    Timer::WakeUpId Timer::scheduleWakeUp(sf::Time position, std::function<void()> callback)
+    {
+        CHECK(callback, "Timer::scheduleWakeUp() - invalid argument: callback");
+        std::lock_guard<std::mutex> lock(m_wakeUpMutex);
+        
+        WakeUp wakeUp;
+        wakeUp.position = position;
+        wakeUp.identifier = m_nextWakeUpId++;
+        
+        m_wakeUps.push(wakeUp);
+        m_wakeUpCallbacks.push_back(std::make_pair(wakeUp.identifier, std::move(callback)));
+        
+        return wakeUp.identifier;
+    }
+    
+    void Timer::cancelWakeUp(WakeUpId identifier)
+    {
+        std::lock_guard<std::mutex> lock(m_wakeUpMutex);
+        removeWakeUpCallback(identifier, nullptr);
+    }
+    
+    bool Timer::removeWakeUpCallback(WakeUpId identifier, std::function<void()>* callback)
+    {
+        for (std::size_t i = 0; i < m_wakeUpCallbacks.size(); i++)
+        {
+            if (m_wakeUpCallbacks[i].first == identifier)
+            {
+                if (callback)
+                    *callback = std::move(m_wakeUpCallbacks[i].second);
+                
+                // Order does not matter, swap with the last one rather than shifting the following ones
+                std::swap(m_wakeUpCallbacks[i], m_wakeUpCallbacks.back());
+                m_wakeUpCallbacks.pop_back();
+                return true;
+            }
+        }
+        
+        return false;
+    }
+    
+    bool Timer::hasWakeUpCallback(WakeUpId identifier) const
+    {
+        for (const std::pair<WakeUpId, std::function<void()> >& pair : m_wakeUpCallbacks)
+        {
+            if (pair.first == identifier)
+                return true;
+        }
+        
+        return false;
+    }
+    
+    void Timer::processWakeUps()
+    {
+        const sf::Time offset = getOffset();
+        
+        // m_dueCallbacks is only used here, from the thread that updates the media
+        {
+            std::lock_guard<std::mutex> lock(m_wakeUpMutex);
+            
+            while (!m_wakeUps.empty() && m_wakeUps.top().position <= offset)
+            {
+                const WakeUpId identifier = m_wakeUps.top().identifier;
+                m_wakeUps.pop();
+                
+                std::function<void()> callback;
+                if (removeWakeUpCallback(identifier, &callback))
+                    m_dueCallbacks.push_back(std::move(callback));
+            }
+        }
+        
+        // Callbacks may schedule new wake ups
+        for (std::function<void()>& callback : m_dueCallbacks)
+            callback();
+        
+        m_dueCallbacks.clear();
+    }
+    
+    bool Timer::getTimeUntilNextWakeUp(sf::Time& delay) const
+    {
+        sf::Time position;
+        
+        {
+            std::lock_guard<std::mutex> lock(m_wakeUpMutex);
+            
+            while (!m_wakeUps.empty() && !hasWakeUpCallback(m_wakeUps.top().identifier))
+                m_wakeUps.pop();
+            
+            if (m_wakeUps.empty())
+                return false;
+            
+            position = m_wakeUps.top().position;
+        }
+        
+        std::lock_guard<std::mutex> lock(m_startMutex);
+        const sf::Time offset = (m_status == Playing) ? m_pausedTime + elapsedSinceStart() : m_pausedTime;
+        const sf::Time timeLeft = position - offset;
+        
+        if (timeLeft <= sf::Time::Zero)
+            delay = sf::Time::Zero;
+        else
+            delay = sf::microseconds(static_cast<sf::Int64>(timeLeft.asMicroseconds() / m_rate));
+        
+        return true;
+    }
+    
+    bool Timer::WakeUp::operator>(const WakeUp& other) const
+    {
+        if (position != other.position)
+            return position > other.position;
+        
+        return identifier > other.identifier;
+    }
+    
     Status Timer::getStatus() const
     {
         return m_status;
@@ -152,12 +411,37 @@ namespace sfe
     
     sf::Time Timer::getOffset() const
     {
-        if (Timer::getStatus() == Playing)
-            return m_pausedTime + m_timer.getElapsedTime();
+        std::lock_guard<std::mutex> lock(m_startMutex);
+        
+        if (m_status == Playing)
+            return m_pausedTime + elapsedSinceStart();
         else
             return m_pausedTime;
     }
     
+    sf::Time Timer::elapsedSinceStart() const
+    {
+        if (m_startRetainCount > 0)
+            return sf::Time::Zero;
+        
+        sf::Time elapsed = m_clock->getElapsedTime() - m_startTime - m_startDelay;
+        
+        if (elapsed <= sf::Time::Zero)
+            return sf::Time::Zero;
+        
+        if (m_rate != 1)
+            elapsed = sf::microseconds(static_cast<sf::Int64>(elapsed.asMicroseconds() * m_rate));
+        
+        return elapsed;
+    }
+    
+    void Timer::rebase()
+    {
+        m_pausedTime += elapsedSinceStart();
+        m_startDelay = sf::Time::Zero;
+        m_startTime = m_clock->getElapsedTime();
+    }
+    
     void Timer::notifyObservers(Status futureStatus)
     {
         for (std::pair<int, std::set<Observer*> >&& pairByPriority : m_observersByPriority)
@@ -26,14 +26,28 @@
 #define SFEMOVIE_TIMER_HPP
 
 #include <set>
+#include <map>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <queue>
+#include <vector>
+#include <utility>
+#include <memory>
+#include <stdint.h>
 #include <SFML/System.hpp>
 #include <sfeMovie/Movie.hpp>
+#include <sfeMovie/Clock.hpp>
 
 namespace sfe
 {
     class Timer
     {
     public:
+        /** Identifies a wake up scheduled with scheduleWakeUp()
+         */
+        typedef uint64_t WakeUpId;
+        
         class Observer
         {
         public:
@@ -86,8 +100,11 @@ namespace sfe
         };
         
         /** Default constructor
+         *
+         * @param clock the source of time for this timer, or nullptr to follow the system time. The clock
+         * is never restarted, so it can be shared by several timers
          */
-        Timer();
+        Timer(std::shared_ptr<Clock> clock = nullptr);
         
         /** Register an observer that should be notified when this timer is
          * played, paused or stopped
@@ -126,6 +143,78 @@ namespace sfe
          */
         bool seek(sf::Time position);
         
+        /** Delay the moment at which this timer starts counting time after play()
+         *
+         * This is meant to be called from Observer::willPlay() by observers whose playback starts
+         * asynchronously. The timer status is Playing right away, but its offset doesn't move until
+         * every retained start has been released
+         *
+         * @return the token to give to releaseStart()
+         */
+        uint64_t retainStart();
+        
+        /** Release a start that was retained with retainStart()
+         *
+         * This can be called from any thread. Tokens retained before the latest play(), pause()
+         * or stop() are ignored
+         *
+         * @param token the token returned by retainStart()
+         * @param delay how long from now the observer's playback will actually be perceived
+         */
+        void releaseStart(uint64_t token, sf::Time delay = sf::Time::Zero);
+        
+        /** @return true if the timer is playing but its start is still retained by an observer
+         */
+        bool isStarting() const;
+        
+        /** Wait for the retained starts to be released
+         *
+         * @param timeout the maximum time to wait
+         * @return true if the timer is not starting anymore, false if @a timeout expired
+         */
+        bool waitForStart(sf::Time timeout) const;
+        
+        /** Slowly bring this timer's offset to the given reference position
+         *
+         * Small differences are absorbed by making the timer run slightly faster or slower, so that
+         * observers never see time jump. Large differences are corrected at once. Nothing is done
+         * if the timer is not playing or its start is retained
+         *
+         * @param reference the position that this timer should follow
+         * @return the difference between @a reference and this timer's offset before correction
+         */
+        sf::Time synchronize(sf::Time reference);
+        
+        /** Ask for @a callback to be called once this timer's offset reaches @a position
+         *
+         * Callbacks are called from processWakeUps(), this lets observers do their work only
+         * when it is due rather than every time they're polled
+         *
+         * @param position the timer offset at which @a callback should be called
+         * @param callback the function to call
+         * @return an identifier that can be given to cancelWakeUp()
+         */
+        WakeUpId scheduleWakeUp(sf::Time position, std::function<void()> callback);
+        
+        /** Cancel a wake up scheduled with scheduleWakeUp()
+         *
+         * Nothing is done if the wake up already happened or was already cancelled
+         *
+         * @param identifier the identifier returned by scheduleWakeUp()
+         */
+        void cancelWakeUp(WakeUpId identifier);
+        
+        /** Call the callbacks of the wake ups that are due, from the calling thread
+         */
+        void processWakeUps();
+        
+        /** Compute how long until the next scheduled wake up is due, assuming this timer keeps playing
+         *
+         * @param[out] delay the time left until the next wake up, zero if it is already due
+         * @return true if a wake up is scheduled and @a delay is set, false otherwise
+         */
+        bool getTimeUntilNextWakeUp(sf::Time& delay) const;
+        
         /** Return this timer status
          *
          * @return Playing, Paused or Stopped
@@ -163,9 +252,55 @@ namespace sfe
          */
         bool notifyObservers(sf::Time oldPosition);
         
+        /** @return the time elapsed since the timer actually started, the lock must be held
+         */
+        sf::Time elapsedSinceStart() const;
+        
+        /** Make the elapsed time part of the paused time and count time again from now, the lock must be held
+         */
+        void rebase();
+        
+        /** Forget the callback of wake up @a identifier, the wake up lock must be held
+         *
+         * @param[out] callback if not null, receives the removed callback
+         * @return true if the callback was still pending
+         */
+        bool removeWakeUpCallback(WakeUpId identifier, std::function<void()>* callback);
+        
+        /** @return true if the callback of wake up @a identifier is still pending, the wake up lock must be held
+         */
+        bool hasWakeUpCallback(WakeUpId identifier) const;
+        
+        /** A wake up ordered by position in the min-heap of scheduled wake ups
+         */
+        struct WakeUp
+        {
+            bool operator>(const WakeUp& other) const;
+            
+            sf::Time position;
+            WakeUpId identifier;
+        };
+        
         sf::Time m_pausedTime;
         Status m_status;
-        sf::Clock m_timer;
+        std::shared_ptr<Clock> m_clock;
+        sf::Time m_startTime; // Clock time from which the elapsed time is counted
+        sf::Time m_startDelay;
+        double m_rate;
+        int m_startRetainCount;
+        uint64_t m_startGeneration;
+        bool m_startReleased;
+        mutable std::mutex m_startMutex;
+        mutable std::condition_variable m_startCondition;
+        
+        // Cancelled wake ups are only removed from the heap once they reach its top
+        mutable std::priority_queue<WakeUp, std::vector<WakeUp>, std::greater<WakeUp> > m_wakeUps;
+        // Only a few wake ups are pending at once: vectors keep their storage from one frame to the next
+        std::vector<std::pair<WakeUpId, std::function<void()> > > m_wakeUpCallbacks;
+        std::vector<std::function<void()> > m_dueCallbacks;
+        WakeUpId m_nextWakeUpId;
+        mutable std::mutex m_wakeUpMutex;
+        
         std::map<Observer*, int> m_observers;
         std::map<int, std::set<Observer*> > m_observersByPriority;
     };
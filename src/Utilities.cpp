@@ -27,6 +27,8 @@
 #include <set>
 #include <utility>
 #include <iostream>
+#include <sys/types.h>
+#include <sys/stat.h>
 
 namespace sfe
 {
@@ -58,9 +60,41 @@ namespace sfe
         {
             case Audio:        return "audio";
             case Video:        return "video";
+            case Subtitle:    return "subtitle";
             case Unknown:    return "unknown";
             default:
                 CHECK(0, "inconcistency");
         }
     }
+    
+    sf::Time framePosition(const AVFrame* frame, const AVStream* stream)
+    {
+        int64_t timestamp = frame->best_effort_timestamp != AV_NOPTS_VALUE ? frame->best_effort_timestamp : frame->pts;
+        
+        if (timestamp == AV_NOPTS_VALUE)
+            return sf::Time::Zero;
+        
+        int64_t startTime = stream->start_time != AV_NOPTS_VALUE ? stream->start_time : 0;
+        AVRational seconds = av_mul_q(av_make_q(timestamp - startTime, 1), stream->time_base);
+        return sf::microseconds(static_cast<sf::Int64>(1000000 * av_q2d(seconds)));
+    }
+    
+    bool getFileStatus(const std::string& path, uint64_t& size, int64_t& modificationTime)
+    {
+#if defined(SFML_SYSTEM_WINDOWS)
+        struct _stat64 info;
+        
+        if (_stat64(path.c_str(), &info) != 0)
+            return false;
+#else
+        struct stat info;
+        
+        if (stat(path.c_str(), &info) != 0)
+            return false;
+#endif
+        
+        size = static_cast<uint64_t>(info.st_size);
+        modificationTime = static_cast<int64_t>(info.st_mtime);
+        return true;
+    }
 }
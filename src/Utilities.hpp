@@ -28,6 +28,7 @@
 #include "Stream.hpp"
 #include "Log.hpp"
 #include <string>
+#include <stdint.h>
 
 namespace sfe
 {
@@ -46,12 +47,30 @@ namespace sfe
      * Conversion is done as follow:
      * Audio      -> audio
      * Video      -> video
+     * Subtitle   -> subtitle
      * Unknown    -> unknown
      *
      * @param type the media type to stringify
      * @return the stringified media type
      */
     std::string mediaTypeToString(MediaType type);
+    
+    /** Compute the position of a decoded frame from the beginning of the media
+     *
+     * @param frame the decoded frame
+     * @param stream the stream the frame was decoded from
+     * @return the presentation time of @a frame, or sf::Time::Zero if it has no timestamp
+     */
+    sf::Time framePosition(const AVFrame* frame, const AVStream* stream);
+    
+    /** Read the size and last modification time of a file, used to tell whether caches built from it are outdated
+     *
+     * @param path the path to the file
+     * @param[out] size the size of the file in bytes
+     * @param[out] modificationTime the last modification time, in seconds since the epoch
+     * @return true on success, false if the file doesn't exist
+     */
+    bool getFileStatus(const std::string& path, uint64_t& size, int64_t& modificationTime);
 }
 
 #endif
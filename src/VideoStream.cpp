@@ -33,9 +33,22 @@ extern "C"
 #include "VideoStream.hpp"
 #include "Utilities.hpp"
 #include "Log.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
 
 namespace sfe
 {
+    namespace
+    {
+        /** Release the clip that a tapped frame kept alive, once the last reference to the frame is gone
+         */
+        void releaseTappedClip(void* opaque, uint8_t* data)
+        {
+            delete static_cast<std::shared_ptr<const FrameCache::Clip>*>(opaque);
+        }
+    }
+    
     VideoStream::VideoStream(AVFormatContext*& formatCtx, AVStream*& stream,
                              DataSource& dataSource, std::shared_ptr<Timer> timer, Delegate& delegate) :
     Stream(formatCtx ,stream, dataSource, timer),
@@ -43,8 +56,31 @@ namespace sfe
     m_rawVideoFrame(nullptr),
     m_rgbaVideoBuffer(),
     m_rgbaVideoLinesize(),
+    m_codecBufferingDelays(),
+    m_hasPreloadedFrame(false),
+    m_preloadRequested(false),
+    m_nextFrameWakeUp(0),
     m_delegate(delegate),
-    m_swsCtx(nullptr)
+    m_decodePool(),
+    m_decodingPriority(0),
+    m_decodingScheduled(false),
+    m_decodingJob(0),
+    m_decodingCancelled(false),
+    m_decodingMutex(),
+    m_decodingCondition(),
+    m_decodedFrames(),
+    m_recycledFrames(),
+    m_decodedEndOfStream(false),
+    m_decodedFramesMutex(),
+    m_swsCtx(nullptr),
+    m_frameCacheKey(),
+    m_recordedClip(),
+    m_recordedSize(0),
+    m_recordedFrameCount(0),
+    m_cachedClip(),
+    m_fastDecodeFile(),
+    m_cachedFrameIndex(NoCachedFrame),
+    m_playsCachedFrames(false)
     {
         int err;
         
@@ -68,10 +104,43 @@ namespace sfe
         CHECK(err, "VideoStream() - sf::Texture::create() error");
         
         initRescaler();
+        
+        // Frames are cached per stream of a media file, as long as the file keeps its size and modification time
+        const bool usesFastDecodeFiles = FastDecodeFile::isEnabled();
+        uint64_t mediaSize = 0;
+        int64_t modificationTime = 0;
+        
+        if ((usesFastDecodeFiles || FrameCache::getBudget() > 0) && m_formatCtx->url &&
+            getFileStatus(m_formatCtx->url, mediaSize, modificationTime))
+        {
+            m_frameCacheKey = std::string(m_formatCtx->url) + "#" + s(m_stream->index) + "#" + s(mediaSize)
+                              + "#" + s(modificationTime);
+            m_cachedClip = FrameCache::find(m_frameCacheKey);
+            
+            // A fast decode file made for this stream replaces the decoder as well
+            if (! m_cachedClip && usesFastDecodeFiles)
+            {
+                std::unique_ptr<FastDecodeFile> fastDecodeFile(new FastDecodeFile);
+                const sf::Vector2u frameSize(m_stream->codecpar->width, m_stream->codecpar->height);
+                
+                if (fastDecodeFile->open(m_formatCtx->url) && fastDecodeFile->getStreamIndex() == m_stream->index &&
+                    fastDecodeFile->getFrameSize() == frameSize)
+                {
+                    m_fastDecodeFile = std::move(fastDecodeFile);
+                }
+            }
+            
+            m_playsCachedFrames = m_cachedClip || m_fastDecodeFile;
+        }
+        
+        startRecording();
     }
     
     VideoStream::~VideoStream()
     {
+        waitForDecoding();
+        m_timer->cancelWakeUp(m_nextFrameWakeUp);
+        
         if (m_rawVideoFrame)
         {
             av_frame_free(&m_rawVideoFrame);
@@ -110,11 +179,38 @@ namespace sfe
     
     void VideoStream::update()
     {
+        // A frame requested while stopped is shown here rather than decoded by the thread that played or stopped
+        if (m_preloadRequested)
+        {
+            if (getStatus() == Playing)
+                m_preloadRequested = false;
+            else
+                finishPreload();
+        }
+        
+        // The next frame is not due yet
+        if (m_nextFrameWakeUp != 0 && getStatus() == Playing)
+            return;
+        
+        if (m_playsCachedFrames)
+        {
+            updateFromCachedFrames();
+            return;
+        }
+        
+        if (m_decodePool)
+        {
+            updateFromDecodedFrames();
+            return;
+        }
+        
         sf::Time gap;
         bool couldComputeGap = false;
         while (getStatus() == Playing && (couldComputeGap = getSynchronizationGap(gap)) &&
                gap < sf::Time::Zero)
         {
+            m_hasPreloadedFrame = false;
+            
             if (!onGetData(m_texture))
             {
                 setStatus(Stopped);
@@ -131,16 +227,65 @@ namespace sfe
         {
             setStatus(Stopped);
         }
+        
+        // Sleep until the next frame is to be displayed
+        if (couldComputeGap && getStatus() == Playing)
+        {
+            m_nextFrameWakeUp = m_timer->scheduleWakeUp(m_timer->getOffset() + gap, [this]()
+            {
+                m_nextFrameWakeUp = 0;
+            });
+        }
     }
     
     void VideoStream::flushBuffers()
     {
+        waitForDecoding();
+        
+        {
+            std::lock_guard<std::mutex> lock(m_decodedFramesMutex);
+            
+            for (std::unique_ptr<DecodedFrame>& frame : m_decodedFrames)
+                m_recycledFrames.push_back(std::move(frame));
+            
+            m_decodedFrames.clear();
+            
+            m_decodedEndOfStream = false;
+        }
+        
         m_codecBufferingDelays.clear();
+        m_hasPreloadedFrame = false;
+        
+        // Seeking is the chance to play the frames cached meanwhile by this stream or another one
+        if (! m_playsCachedFrames && ! m_frameCacheKey.empty())
+        {
+            m_cachedClip = FrameCache::find(m_frameCacheKey);
+            m_playsCachedFrames = m_cachedClip != nullptr;
+        }
+        
+        m_cachedFrameIndex = NoCachedFrame;
+        
+        // Only a pass from the very beginning gives all the frames of the stream
+        if (m_timer->getOffset() == sf::Time::Zero)
+            startRecording();
+        else
+            m_recordedClip.reset();
+        
+        // The next frame will be at another position
+        m_timer->cancelWakeUp(m_nextFrameWakeUp);
+        m_nextFrameWakeUp = 0;
+        
         Stream::flushBuffers();
     }
     
     bool VideoStream::fastForward(sf::Time targetPosition)
     {
+        if (m_playsCachedFrames)
+        {
+            showCachedFrame(targetPosition);
+            return true;
+        }
+        
         sf::Time position;
         bool couldGetPosition = false;
         
@@ -165,15 +310,124 @@ namespace sfe
     
     void VideoStream::preload()
     {
+        // Don't decode on the caller's thread again if the current image is still the first one
+        if (m_hasPreloadedFrame)
+            return;
+        
+        if (m_playsCachedFrames)
+        {
+            showCachedFrame(m_timer->getOffset());
+            m_hasPreloadedFrame = true;
+            return;
+        }
+        
         sfeLogDebug("Preload video image");
-        onGetData(m_texture);
+        m_hasPreloadedFrame = onGetData(m_texture);
+    }
+    
+    void VideoStream::requestPreload()
+    {
+        if (m_hasPreloadedFrame)
+            return;
+        
+        m_preloadRequested = true;
+        
+        if (m_decodePool && ! m_playsCachedFrames)
+            scheduleDecoding();
+    }
+    
+    void VideoStream::finishPreload()
+    {
+        if (! m_decodePool || m_playsCachedFrames)
+        {
+            m_preloadRequested = false;
+            preload();
+            return;
+        }
+        
+        std::unique_ptr<DecodedFrame> frame;
+        bool reachedEnd = false;
+        
+        {
+            std::lock_guard<std::mutex> lock(m_decodedFramesMutex);
+            
+            if (! m_decodedFrames.empty())
+            {
+                frame = std::move(m_decodedFrames.front());
+                m_decodedFrames.pop_front();
+            }
+            
+            reachedEnd = m_decodedEndOfStream;
+        }
+        
+        // Wait for the decode pool to deliver the frame
+        if (! frame)
+        {
+            if (reachedEnd)
+                m_preloadRequested = false;
+            else
+                scheduleDecoding();
+            
+            return;
+        }
+        
+        m_texture.update(frame->pixels.data());
+        m_hasPreloadedFrame = true;
+        m_preloadRequested = false;
+        
+        std::lock_guard<std::mutex> lock(m_decodedFramesMutex);
+        m_recycledFrames.push_back(std::move(frame));
+    }
+    
+    void VideoStream::prepare()
+    {
+        preload();
+        
+        if (m_decodePool)
+            scheduleDecoding();
+    }
+    
+    void VideoStream::setDecodePool(std::shared_ptr<DecodePool> pool, int priority)
+    {
+        waitForDecoding();
+        m_decodePool = pool;
+        m_decodingPriority = priority;
+    }
+    
+    void VideoStream::setDecodingPriority(int priority)
+    {
+        m_decodingPriority = priority;
+    }
+    
+    bool VideoStream::usesPackets() const
+    {
+        // Called by the demuxer from the thread reading packets
+        return ! m_playsCachedFrames;
     }
     
     bool VideoStream::onGetData(sf::Texture& texture)
     {
-        AVPacket* packet = popEncodedData();
         bool gotFrame = false;
+        bool goOn = decodeFrame(gotFrame);
+        
+        if (gotFrame)
+        {
+            rescale(m_rawVideoFrame, m_rgbaVideoBuffer, m_rgbaVideoLinesize);
+            texture.update(m_rgbaVideoBuffer[0]);
+            recordFrame(m_rgbaVideoBuffer[0]);
+        }
+        
+        if (! goOn)
+            finishRecording();
+        
+        return goOn;
+    }
+    
+    bool VideoStream::decodeFrame(bool& gotFrame)
+    {
+        AVPacket* packet = popEncodedData();
         bool goOn = false;
+        gotFrame = false;
         
         if (packet)
         {
@@ -186,12 +440,6 @@ namespace sfe
                 CHECK(packet != nullptr, "inconsistency error");
                 goOn = decodePacket(packet, m_rawVideoFrame, gotFrame, needsMoreDecoding);
                 
-                if (gotFrame)
-                {
-                    rescale(m_rawVideoFrame, m_rgbaVideoBuffer, m_rgbaVideoLinesize);
-                    texture.update(m_rgbaVideoBuffer[0]);
-                }
-                
                 if (!gotFrame && goOn)
                 {
                     // Decoding went fine but did not produce an image. This means the decoder is working in
@@ -212,7 +460,7 @@ namespace sfe
                 }
                 else
                 {
-                    av_packet_unref(packet);
+                    recyclePacket(packet);
                 }
                 
                 if (!gotFrame && goOn)
@@ -225,6 +473,386 @@ namespace sfe
         return goOn;
     }
     
+    void VideoStream::updateFromDecodedFrames()
+    {
+        if (getStatus() != Playing)
+            return;
+        
+        const sf::Time offset = m_timer->getOffset();
+        std::unique_ptr<DecodedFrame> dueFrame;
+        sf::Time nextPosition;
+        bool hasNextFrame = false;
+        bool reachedEnd = false;
+        
+        {
+            std::lock_guard<std::mutex> lock(m_decodedFramesMutex);
+            
+            // Only the latest due frame is displayed, the ones before it are late and skipped
+            while (! m_decodedFrames.empty() && m_decodedFrames.front()->position <= offset)
+            {
+                if (dueFrame)
+                    m_recycledFrames.push_back(std::move(dueFrame));
+                
+                dueFrame = std::move(m_decodedFrames.front());
+                m_decodedFrames.pop_front();
+            }
+            
+            if (! m_decodedFrames.empty())
+            {
+                nextPosition = m_decodedFrames.front()->position;
+                hasNextFrame = true;
+            }
+            
+            reachedEnd = m_decodedEndOfStream && m_decodedFrames.empty();
+        }
+        
+        if (dueFrame)
+        {
+            m_hasPreloadedFrame = false;
+            m_texture.update(dueFrame->pixels.data());
+            m_delegate.didUpdateVideo(*this, m_texture);
+            
+            std::lock_guard<std::mutex> lock(m_decodedFramesMutex);
+            m_recycledFrames.push_back(std::move(dueFrame));
+        }
+        
+        if (reachedEnd)
+        {
+            setStatus(Stopped);
+            return;
+        }
+        
+        // When the decoding is late, update() keeps checking for the next frame
+        if (hasNextFrame)
+        {
+            m_nextFrameWakeUp = m_timer->scheduleWakeUp(nextPosition, [this]()
+            {
+                m_nextFrameWakeUp = 0;
+            });
+        }
+        
+        scheduleDecoding();
+    }
+    
+    void VideoStream::updateFromCachedFrames()
+    {
+        if (getStatus() != Playing)
+            return;
+        
+        const sf::Time offset = m_timer->getOffset();
+        
+        if (showCachedFrame(offset))
+        {
+            m_hasPreloadedFrame = false;
+            m_delegate.didUpdateVideo(*this, m_texture);
+        }
+        
+        // The last frame stays on screen for one frame duration, then the stream ends
+        const std::size_t frameCount = getCachedFrameCount();
+        const float frameRate = getFrameRate();
+        sf::Time nextPosition = getCachedFramePosition(frameCount - 1);
+        
+        if (m_cachedFrameIndex + 1 < frameCount)
+            nextPosition = getCachedFramePosition(m_cachedFrameIndex + 1);
+        else if (frameRate > 0)
+            nextPosition += sf::seconds(1.f / frameRate);
+        
+        if (offset >= nextPosition)
+        {
+            setStatus(Stopped);
+            return;
+        }
+        
+        m_nextFrameWakeUp = m_timer->scheduleWakeUp(nextPosition, [this]()
+        {
+            m_nextFrameWakeUp = 0;
+        });
+    }
+    
+    bool VideoStream::showCachedFrame(sf::Time position)
+    {
+        // Binary search of the last frame starting at or before position, or the first one if none starts before
+        std::size_t index = 0;
+        std::size_t end = getCachedFrameCount();
+        
+        while (end - index > 1)
+        {
+            const std::size_t middle = index + (end - index) / 2;
+            
+            if (getCachedFramePosition(middle) <= position)
+                index = middle;
+            else
+                end = middle;
+        }
+        
+        if (index == m_cachedFrameIndex)
+            return false;
+        
+        m_cachedFrameIndex = index;
+        
+        if (m_cachedClip)
+        {
+            m_texture.update((*m_cachedClip)[index].pixels.data());
+        }
+        else if (m_fastDecodeFile->readFrame(index, m_rgbaVideoBuffer[0]))
+        {
+            m_texture.update(m_rgbaVideoBuffer[0]);
+        }
+        else
+        {
+            sfeLogError("Corrupted frame " + s(index) + " in the fast decode file of " + description());
+            return false;
+        }
+        
+        tapCachedFrame(index);
+        return true;
+    }
+    
+    void VideoStream::tapCachedFrame(std::size_t index)
+    {
+        if (! hasFrameTap())
+            return;
+        
+        const int width = getFrameSize().x;
+        const int height = getFrameSize().y;
+        const int frameSize = width * height * 4;
+        
+        AVFrame* frame = av_frame_alloc();
+        CHECK(frame, "VideoStream::tapCachedFrame() - out of memory");
+        
+        // The decoder output is gone, the tap gets the frame in the RGBA format it was cached in
+        frame->format = AV_PIX_FMT_RGBA;
+        frame->width = width;
+        frame->height = height;
+        
+        if (m_cachedClip)
+        {
+            // The cached pixels are shared, the clip is kept alive as long as the frame is referenced
+            std::shared_ptr<const FrameCache::Clip>* clip = new std::shared_ptr<const FrameCache::Clip>(m_cachedClip);
+            frame->buf[0] = av_buffer_create(const_cast<uint8_t*>((*m_cachedClip)[index].pixels.data()), frameSize,
+                                             releaseTappedClip, clip, AV_BUFFER_FLAG_READONLY);
+            
+            if (! frame->buf[0])
+                delete clip;
+        }
+        else
+        {
+            // The fast decode file is decompressed to a buffer that the next frame overwrites
+            frame->buf[0] = av_buffer_alloc(frameSize);
+            
+            if (frame->buf[0])
+                std::memcpy(frame->buf[0]->data, m_rgbaVideoBuffer[0], frameSize);
+        }
+        
+        if (! frame->buf[0])
+            av_frame_free(&frame);
+        
+        CHECK(frame, "VideoStream::tapCachedFrame() - out of memory");
+        
+        frame->data[0] = frame->buf[0]->data;
+        frame->linesize[0] = width * 4;
+        
+        tapFrame(frame, getCachedFramePosition(index));
+        av_frame_free(&frame);
+    }
+    
+    std::size_t VideoStream::getCachedFrameCount() const
+    {
+        return m_cachedClip ? m_cachedClip->size() : m_fastDecodeFile->getFrameCount();
+    }
+    
+    sf::Time VideoStream::getCachedFramePosition(std::size_t index) const
+    {
+        return m_cachedClip ? (*m_cachedClip)[index].position : m_fastDecodeFile->getFramePosition(index);
+    }
+    
+    void VideoStream::startRecording()
+    {
+        m_recordedClip.reset();
+        m_recordedSize = 0;
+        m_recordedFrameCount = 0;
+        
+        const std::size_t budget = FrameCache::getBudget();
+        
+        if (m_playsCachedFrames || m_frameCacheKey.empty() || budget == 0)
+            return;
+        
+        const std::size_t frameSize = static_cast<std::size_t>(getFrameSize().x) * getFrameSize().y * 4;
+        std::size_t expectedFrameCount = 0;
+        
+        // Don't even start when the duration already tells that the stream won't fit
+        if (m_formatCtx->duration != AV_NOPTS_VALUE)
+        {
+            const double frameCount = av_q2d(av_guess_frame_rate(m_formatCtx, m_stream, nullptr)) *
+                                      m_formatCtx->duration / AV_TIME_BASE;
+            
+            if (frameCount * (frameSize + sizeof(FrameCache::Frame)) > budget)
+                return;
+            
+            expectedFrameCount = static_cast<std::size_t>(std::ceil(frameCount));
+        }
+        
+        m_recordedClip = std::make_shared<FrameCache::Clip>(expectedFrameCount);
+        
+        for (FrameCache::Frame& frame : *m_recordedClip)
+            frame.pixels.resize(frameSize);
+    }
+    
+    void VideoStream::recordFrame(const uint8_t* pixels)
+    {
+        if (! m_recordedClip)
+            return;
+        
+        const std::size_t frameSize = static_cast<std::size_t>(getFrameSize().x) * getFrameSize().y * 4;
+        m_recordedSize += frameSize + sizeof(FrameCache::Frame);
+        
+        if (m_recordedSize > FrameCache::getBudget())
+        {
+            sfeLogDebug("Stopped recording the frames of " + m_frameCacheKey + ", they don't fit in the frame cache");
+            m_recordedClip.reset();
+            return;
+        }
+        
+        // Only a stream with more frames than its duration told needs to allocate more frames
+        if (m_recordedFrameCount == m_recordedClip->size())
+            m_recordedClip->emplace_back();
+        
+        FrameCache::Frame& frame = (*m_recordedClip)[m_recordedFrameCount++];
+        frame.position = framePosition(m_rawVideoFrame, m_stream);
+        frame.pixels.assign(pixels, pixels + frameSize);
+    }
+    
+    void VideoStream::finishRecording()
+    {
+        if (m_recordedClip && m_recordedFrameCount > 0)
+        {
+            // The duration may announce more frames than there were
+            m_recordedClip->resize(m_recordedFrameCount);
+            
+            std::stable_sort(m_recordedClip->begin(), m_recordedClip->end(),
+                             [](const FrameCache::Frame& first, const FrameCache::Frame& second)
+            {
+                return first.position < second.position;
+            });
+            
+            FrameCache::insert(m_frameCacheKey, m_recordedClip);
+        }
+        
+        m_recordedClip.reset();
+    }
+    
+    void VideoStream::scheduleDecoding()
+    {
+        // Only the thread calling update() schedules decoding, so no other decoding can be requested meanwhile
+        if (m_decodingScheduled)
+            return;
+        
+        {
+            std::lock_guard<std::mutex> lock(m_decodedFramesMutex);
+            if (m_decodedEndOfStream || m_decodedFrames.size() >= MaxDecodedFrames)
+                return;
+        }
+        
+        m_decodingScheduled = true;
+        m_decodingJob = m_decodePool->schedule([this]() { decodeAhead(); }, m_decodingPriority);
+    }
+    
+    void VideoStream::decodeAhead()
+    {
+        const std::size_t frameSize = static_cast<std::size_t>(getFrameSize().x) * getFrameSize().y * 4;
+        
+        try
+        {
+            while (! m_decodingCancelled)
+            {
+                std::unique_ptr<DecodedFrame> frame;
+                
+                {
+                    std::lock_guard<std::mutex> lock(m_decodedFramesMutex);
+                    if (m_decodedFrames.size() >= MaxDecodedFrames)
+                        break;
+                    
+                    if (! m_recycledFrames.empty())
+                    {
+                        frame = std::move(m_recycledFrames.back());
+                        m_recycledFrames.pop_back();
+                    }
+                }
+                
+                if (! frame)
+                {
+                    frame.reset(new DecodedFrame);
+                    frame->pixels.resize(frameSize);
+                }
+                
+                // Same position as the one update() compares to the timer when decoding synchronously
+                sf::Time position;
+                bool gotFrame = false;
+                bool goOn = computeEncodedPosition(position);
+                position -= codecBufferingDelay();
+                
+                if (goOn)
+                    goOn = decodeFrame(gotFrame);
+                
+                if (! goOn)
+                {
+                    finishRecording();
+                    
+                    std::lock_guard<std::mutex> lock(m_decodedFramesMutex);
+                    m_decodedEndOfStream = true;
+                    m_recycledFrames.push_back(std::move(frame));
+                    break;
+                }
+                
+                if (gotFrame)
+                {
+                    uint8_t* pixels[4] = { frame->pixels.data(), nullptr, nullptr, nullptr };
+                    int linesize[4] = { getFrameSize().x * 4, 0, 0, 0 };
+                    rescale(m_rawVideoFrame, pixels, linesize);
+                    recordFrame(frame->pixels.data());
+                    frame->position = position;
+                }
+                
+                std::lock_guard<std::mutex> lock(m_decodedFramesMutex);
+                
+                if (gotFrame)
+                    m_decodedFrames.push_back(std::move(frame));
+                else
+                    m_recycledFrames.push_back(std::move(frame));
+            }
+        }
+        catch (std::exception& e)
+        {
+            sfeLogError("VideoStream::decodeAhead() - " + std::string(e.what()));
+            
+            std::lock_guard<std::mutex> lock(m_decodedFramesMutex);
+            m_decodedEndOfStream = true;
+        }
+        
+        // Notify with the lock held: once waitForDecoding() returns, this stream may be destroyed
+        std::lock_guard<std::mutex> lock(m_decodingMutex);
+        m_decodingScheduled = false;
+        m_decodingCondition.notify_all();
+    }
+    
+    void VideoStream::waitForDecoding()
+    {
+        m_decodingCancelled = true;
+        
+        // Don't wait for a busy pool to reach the task only to have it return at once
+        if (m_decodingScheduled && m_decodePool && m_decodePool->cancel(m_decodingJob))
+        {
+            m_decodingScheduled = false;
+        }
+        else
+        {
+            std::unique_lock<std::mutex> lock(m_decodingMutex);
+            m_decodingCondition.wait(lock, [this]() { return ! m_decodingScheduled; });
+        }
+        
+        m_decodingCancelled = false;
+    }
+    
     bool VideoStream::getSynchronizationGap(sf::Time& gap)
     {
         sf::Time position;
@@ -253,6 +881,7 @@ namespace sfe
           return false;
         }
 
+        tapFrame(outputFrame);
         gotFrame = true;
         return true;
     }
@@ -282,12 +911,25 @@ namespace sfe
     void VideoStream::willPlay(const Timer &timer)
     {
         Stream::willPlay(timer);
+        // play() doesn't wait for the first frame to be decoded
         if (getStatus() == Stopped)
         {
-            preload();
+            requestPreload();
         }
     }
     
+    void VideoStream::didPause(const Timer& timer, Status previousStatus)
+    {
+        Stream::didPause(timer, previousStatus);
+        waitForDecoding();
+    }
+    
+    void VideoStream::didStop(const Timer& timer, Status previousStatus)
+    {
+        Stream::didStop(timer, previousStatus);
+        waitForDecoding();
+    }
+    
     sf::Time VideoStream::codecBufferingDelay() const
     {
         sf::Time delay;
@@ -27,7 +27,15 @@
 
 #include "Macros.hpp"
 #include "Stream.hpp"
+#include "DecodePool.hpp"
+#include "FrameCache.hpp"
+#include "FastDecodeFile.hpp"
 #include <SFML/Graphics.hpp>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <vector>
 #include <stdint.h>
 
 namespace sfe
@@ -76,6 +84,9 @@ namespace sfe
         sf::Texture& getVideoTexture();
         
         /** Update the video frame and the stream's status
+         *
+         * Once the current frame is displayed, nothing is done until the timer wakes this stream
+         * up for the next frame
          */
         void update() override;
         
@@ -88,11 +99,128 @@ namespace sfe
         bool fastForward(sf::Time targetPosition) override;
         
         /** Load packets until one frame can be decoded
+         *
+         * Nothing is done if a frame was already preloaded and not displayed by playback yet
          */
         void preload();
+        
+        /** Ask for a frame to be preloaded without decoding it on the calling thread
+         *
+         * The frame is decoded on the decode pool if there is one, and shown by the next update().
+         * Without decode pool, it is decoded by the next update()
+         */
+        void requestPreload();
+        
+        /** Preload the first frame and, when decoding on a DecodePool, start decoding the next ones
+         */
+        void prepare() override;
+        
+        /** Decode the frames ahead of time on the threads of @a pool rather than in update()
+         *
+         * update() then only uploads the frame that is due to the texture
+         *
+         * @param pool the pool that runs the decoding work, or nullptr to decode from update()
+         * @param priority the decoding work of the streams with the highest priority is run first, among
+         * all the streams decoding on @a pool
+         */
+        void setDecodePool(std::shared_ptr<DecodePool> pool, int priority);
+        
+        /** Change the priority given with setDecodePool()
+         */
+        void setDecodingPriority(int priority);
+        
+        /** @see Stream::usesPackets()
+         *
+         * Once all the frames of the stream are in the frame cache or a fast decode file, they're played from there
+         */
+        bool usesPackets() const override;
     private:
+        /** How many frames can be decoded ahead of time when decoding runs on a DecodePool
+         */
+        static const std::size_t MaxDecodedFrames = 3;
+        
+        /** Value of m_cachedFrameIndex when no cached frame is displayed
+         */
+        static const std::size_t NoCachedFrame = static_cast<std::size_t>(-1);
+        
+        /** A frame decoded ahead of time, waiting to be displayed
+         */
+        struct DecodedFrame
+        {
+            sf::Time position;
+            std::vector<uint8_t> pixels;
+        };
+        
         bool onGetData(sf::Texture& texture);
         
+        /** Decode the next frame into m_rawVideoFrame
+         *
+         * @param[out] gotFrame set to true if a frame was decoded
+         * @return false if no more data can be decoded (EOF), true otherwise
+         */
+        bool decodeFrame(bool& gotFrame);
+        
+        /** Display the decoded frame that is due, used instead of the regular update when decoding
+         * runs on a DecodePool
+         */
+        void updateFromDecodedFrames();
+        
+        /** Show the frame asked with requestPreload() once it is available
+         */
+        void finishPreload();
+        
+        /** Queue decodeAhead() on the decoding pool if more frames can be decoded
+         */
+        void scheduleDecoding();
+        
+        /** Decode frames until the decoded frames queue is full, run from the decoding pool
+         */
+        void decodeAhead();
+        
+        /** Stop decodeAhead() so that the decoder can be used from the calling thread
+         *
+         * A decodeAhead() task that no pool thread started yet is cancelled. Otherwise it stops after
+         * the frame it is decoding, and this waits for it to return
+         */
+        void waitForDecoding();
+        
+        /** Display the cached frame that is due, used instead of the regular update once the frames
+         * of this stream are in the frame cache or a fast decode file
+         */
+        void updateFromCachedFrames();
+        
+        /** Copy the cached frame to display at @a position to the texture
+         *
+         * @return true if the texture changed
+         */
+        bool showCachedFrame(sf::Time position);
+        
+        /** Give the cached frame @a index, whose RGBA pixels were just shown, to the frame tap
+         */
+        void tapCachedFrame(std::size_t index);
+        
+        /** @return the number of cached frames, from the frame cache or the fast decode file
+         */
+        std::size_t getCachedFrameCount() const;
+        
+        /** @return the position of cached frame @a index, from the frame cache or the fast decode file
+         */
+        sf::Time getCachedFramePosition(std::size_t index) const;
+        
+        /** Start recording the decoded frames for the frame cache, if the whole stream fits in its budget
+         *
+         * The storage of the expected frames is allocated here, so that recording doesn't allocate for each frame
+         */
+        void startRecording();
+        
+        /** Add the frame that was just decoded and converted to @a pixels to the recorded frames
+         */
+        void recordFrame(const uint8_t* pixels);
+        
+        /** Give the recorded frames to the frame cache once the end of the stream is reached
+         */
+        void finishRecording();
+        
         /** Returns the difference between the video stream timer and the reference timer
          *
          * A positive value means the video stream is ahead of the reference timer
@@ -134,6 +262,8 @@ namespace sfe
         
         // Timer::Observer interface
         void willPlay(const Timer &timer) override;
+        void didPause(const Timer& timer, Status previousStatus) override;
+        void didStop(const Timer& timer, Status previousStatus) override;
         
         /** Returns the delay caused by the FFmpeg decoder buffering
          */
@@ -145,10 +275,36 @@ namespace sfe
         uint8_t *m_rgbaVideoBuffer[4];
         int m_rgbaVideoLinesize[4];
         std::list<sf::Time> m_codecBufferingDelays;
+        bool m_hasPreloadedFrame;
+        bool m_preloadRequested;
+        Timer::WakeUpId m_nextFrameWakeUp;
         Delegate& m_delegate;
         
+        // Decoding ahead, only used with a decoding pool
+        std::shared_ptr<DecodePool> m_decodePool;
+        std::atomic<int> m_decodingPriority;
+        std::atomic<bool> m_decodingScheduled;
+        DecodePool::JobId m_decodingJob;
+        std::atomic<bool> m_decodingCancelled;
+        std::mutex m_decodingMutex;
+        std::condition_variable m_decodingCondition;
+        std::deque<std::unique_ptr<DecodedFrame> > m_decodedFrames;
+        std::vector<std::unique_ptr<DecodedFrame> > m_recycledFrames;
+        bool m_decodedEndOfStream;
+        std::mutex m_decodedFramesMutex;
+        
         // Rescaler data
         struct SwsContext *m_swsCtx;
+        
+        // Frame cache and fast decode file, the recorded frames are only used by the thread that decodes
+        std::string m_frameCacheKey;
+        std::shared_ptr<FrameCache::Clip> m_recordedClip;
+        std::size_t m_recordedSize;
+        std::size_t m_recordedFrameCount;
+        std::shared_ptr<const FrameCache::Clip> m_cachedClip;
+        std::unique_ptr<FastDecodeFile> m_fastDecodeFile;
+        std::size_t m_cachedFrameIndex;
+        std::atomic<bool> m_playsCachedFrames;
     };
 }
 
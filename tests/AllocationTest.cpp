@@ -0,0 +1,170 @@
+
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_MODULE AllocationTest
+#include <boost/test/unit_test.hpp>
+#include "TestHelpers.hpp"
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+using namespace sfe::test;
+
+namespace
+{
+    // Only allocations made while counting is enabled are counted, whatever the thread
+    std::atomic<bool> g_countAllocations(false);
+    std::atomic<unsigned int> g_allocationCount(0);
+    
+    const sf::Time WarmUpDuration = sf::seconds(1);
+    const sf::Time MeasureDuration = sf::seconds(2);
+    
+    // Enough for all the frames of small_1.ogv, 165 frames of 560x320 pixels
+    const std::size_t FrameCacheBudget = 256 * 1024 * 1024;
+    
+    /** Update @a movie at the pace of the rendering loop while it plays in real time for @a duration
+     */
+    void playInRealTime(sfe::Movie& movie, sf::Time duration)
+    {
+        for (sf::Clock clock; clock.getElapsedTime() < duration;)
+        {
+            sf::sleep(StepDuration);
+            movie.update();
+        }
+    }
+}
+
+void* operator new(std::size_t size)
+{
+    if (g_countAllocations)
+        g_allocationCount++;
+    
+    void* pointer = std::malloc(size ? size : 1);
+    
+    if (! pointer)
+        throw std::bad_alloc();
+    
+    return pointer;
+}
+
+void operator delete(void* pointer) noexcept
+{
+    std::free(pointer);
+}
+
+void* operator new[](std::size_t size)
+{
+    return operator new(size);
+}
+
+void operator delete[](void* pointer) noexcept
+{
+    operator delete(pointer);
+}
+
+BOOST_AUTO_TEST_CASE(AllocationTestSteadyStatePlayback)
+{
+    CountingDelegate delegate;
+    std::shared_ptr<sfe::ManualClock> clock = std::make_shared<sfe::ManualClock>();
+    std::shared_ptr<sfe::Timer> timer = std::make_shared<sfe::Timer>(clock);
+    std::shared_ptr<sfe::Demuxer> demuxer = std::make_shared<sfe::Demuxer>("small_1.ogv", timer, delegate);
+    demuxer->selectFirstVideoStream();
+    timer->play();
+    
+    // Let the queues and buffers reach their steady state size
+    playFor(*demuxer, *clock, WarmUpDuration);
+    
+    // The AVPacket structures are allocated with av_malloc(), which operator new doesn't see
+    const unsigned int warmUpFrameCount = delegate.m_frameCount;
+    const std::size_t warmUpPacketCount = demuxer->getAllocatedPacketCount();
+    g_allocationCount = 0;
+    g_countAllocations = true;
+    
+    playFor(*demuxer, *clock, MeasureDuration);
+    
+    g_countAllocations = false;
+    const std::size_t packetAllocationCount = demuxer->getAllocatedPacketCount() - warmUpPacketCount;
+    
+    BOOST_CHECK(delegate.m_frameCount > warmUpFrameCount);
+    BOOST_CHECK_MESSAGE(g_allocationCount == 0, g_allocationCount << " heap allocations during steady state playback");
+    BOOST_CHECK_MESSAGE(packetAllocationCount == 0, packetAllocationCount << " packets allocated during steady state playback");
+    
+    timer->stop();
+}
+
+BOOST_AUTO_TEST_CASE(AllocationTestMoviePlayback)
+{
+    // The whole playback of a Movie with its audio: MovieImpl::update(), the audio decoding thread fed
+    // by the SFML thread, and the video frames recorded for the frame cache during the first pass
+    sfe::Movie::setFrameCacheBudget(FrameCacheBudget);
+    
+    {
+        sfe::Movie movie;
+        BOOST_REQUIRE(movie.openFromFile("small_1.ogv"));
+        BOOST_REQUIRE(movie.getStreams(sfe::Audio).size() > 0);
+        movie.play();
+        
+        playInRealTime(movie, WarmUpDuration);
+        
+        const sf::Time warmUpOffset = movie.getPlayingOffset();
+        g_allocationCount = 0;
+        g_countAllocations = true;
+        
+        playInRealTime(movie, MeasureDuration);
+        
+        g_countAllocations = false;
+        
+        BOOST_CHECK(movie.getStatus() == sfe::Playing);
+        BOOST_CHECK(movie.getPlayingOffset() > warmUpOffset);
+        BOOST_CHECK_MESSAGE(g_allocationCount == 0, g_allocationCount << " heap allocations during steady state movie playback");
+        
+        movie.stop();
+    }
+    
+    sfe::Movie::setFrameCacheBudget(0);
+}
+
+#ifdef SFEMOVIE_USE_LIBASS
+BOOST_AUTO_TEST_CASE(AllocationTestSubtitles)
+{
+    // The events are all decoded during the first pass, the second pass only renders them again
+    PacketSource source("subtitles_1.ass");
+    AVStream** ffstream = source.findStream(AVMEDIA_TYPE_SUBTITLE);
+    BOOST_REQUIRE(ffstream);
+    
+    std::shared_ptr<sfe::ManualClock> clock = std::make_shared<sfe::ManualClock>();
+    std::shared_ptr<sfe::Timer> timer = std::make_shared<sfe::Timer>(clock);
+    sfe::SubtitleStream stream(source.getFormatContext(), *ffstream, source, timer);
+    source.feed(stream, *ffstream);
+    
+    const sf::Time duration = sf::seconds(7);
+    unsigned int visibleUpdates = 0;
+    timer->play();
+    
+    for (sf::Time elapsed; elapsed < duration; elapsed += StepDuration)
+    {
+        clock->advance(StepDuration);
+        stream.update();
+    }
+    
+    timer->stop();
+    timer->play();
+    g_allocationCount = 0;
+    g_countAllocations = true;
+    
+    for (sf::Time elapsed; elapsed < duration; elapsed += StepDuration)
+    {
+        clock->advance(StepDuration);
+        stream.update();
+        
+        if (stream.hasVisibleSubtitles())
+            visibleUpdates++;
+    }
+    
+    g_countAllocations = false;
+    
+    BOOST_CHECK(visibleUpdates > 0);
+    BOOST_CHECK_MESSAGE(g_allocationCount == 0, g_allocationCount << " heap allocations while rendering subtitles again");
+    
+    timer->stop();
+}
+#endif
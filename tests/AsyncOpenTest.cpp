@@ -0,0 +1,177 @@
+
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_MODULE AsyncOpenTest
+#include <boost/test/unit_test.hpp>
+#include <sfeMovie/Movie.hpp>
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <csignal>
+#include <cstdio>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+    /** Update @a movie until the callback of its asynchronous opening set @a called
+     */
+    bool waitForCallback(sfe::Movie& movie, const bool& called, sf::Time timeout = sf::seconds(10))
+    {
+        for (sf::Clock clock; ! called && clock.getElapsedTime() < timeout;)
+        {
+            sf::sleep(sf::milliseconds(10));
+            movie.update();
+        }
+        
+        return called;
+    }
+    
+    /** @return true if @a image has a pixel that is not black
+     */
+    bool hasContent(const sf::Image& image)
+    {
+        for (unsigned int y = 0; y < image.getSize().y; y++)
+        {
+            for (unsigned int x = 0; x < image.getSize().x; x++)
+            {
+                const sf::Color color = image.getPixel(x, y);
+                
+                if (color.r > 0 || color.g > 0 || color.b > 0)
+                    return true;
+            }
+        }
+        
+        return false;
+    }
+}
+
+BOOST_AUTO_TEST_CASE(AsyncOpenTestPoster)
+{
+    sfe::Movie movie;
+    bool called = false;
+    bool succeeded = false;
+    sf::Vector2u posterSize;
+    bool posterHasContent = false;
+    
+    movie.openFromFileAsync("small_1.ogv", [&](bool success)
+    {
+        // The poster frame is there as soon as the callback is called, without any update
+        called = true;
+        succeeded = success;
+        posterSize = movie.getCurrentImage().getSize();
+        posterHasContent = hasContent(movie.getCurrentImage().copyToImage());
+    });
+    
+    BOOST_CHECK(movie.isOpening());
+    BOOST_REQUIRE(waitForCallback(movie, called));
+    
+    BOOST_CHECK(succeeded);
+    BOOST_CHECK(! movie.isOpening());
+    BOOST_CHECK(movie.getStatus() == sfe::Stopped);
+    BOOST_CHECK(posterSize.x > 0 && posterSize.y > 0);
+    BOOST_CHECK(posterHasContent);
+}
+
+BOOST_AUTO_TEST_CASE(AsyncOpenTestFailure)
+{
+    sfe::Movie movie;
+    bool called = false;
+    bool succeeded = true;
+    
+    movie.openFromFileAsync("missing_file.ogv", [&](bool success)
+    {
+        called = true;
+        succeeded = success;
+    });
+    
+    BOOST_REQUIRE(waitForCallback(movie, called));
+    BOOST_CHECK(! succeeded);
+}
+
+BOOST_AUTO_TEST_CASE(AsyncOpenTestReplaced)
+{
+    // Opening another media cancels the first opening, whose callback is never called
+    sfe::Movie movie;
+    bool firstCalled = false;
+    bool secondCalled = false;
+    
+    movie.openFromFileAsync("small_1.ogv", [&](bool success) { firstCalled = true; });
+    movie.openFromFileAsync("small_4.wav", [&](bool success) { secondCalled = true; });
+    
+    BOOST_REQUIRE(waitForCallback(movie, secondCalled));
+    BOOST_CHECK(! firstCalled);
+    BOOST_CHECK(movie.getDuration() < sf::seconds(4));
+}
+
+#if defined(__unix__) || defined(__APPLE__)
+BOOST_AUTO_TEST_CASE(AsyncOpenTestCancelledIO)
+{
+    // The media trickles in through a pipe, so that the opening is still reading it when the movie is destroyed
+    std::ifstream source("small_1.ogv", std::ios::binary);
+    const std::vector<char> bytes((std::istreambuf_iterator<char>(source)), std::istreambuf_iterator<char>());
+    BOOST_REQUIRE(! bytes.empty());
+    
+    const std::string pipePath = "async_open_test.ogv";
+    std::remove(pipePath.c_str());
+    BOOST_REQUIRE(mkfifo(pipePath.c_str(), 0600) == 0);
+    std::signal(SIGPIPE, SIG_IGN);
+    
+    const std::size_t headSize = 8 * 1024;
+    std::atomic<std::size_t> written(0);
+    std::atomic<bool> readerClosed(false);
+    std::atomic<bool> stopWriting(false);
+    
+    std::thread writer([&]()
+    {
+        // Blocks until the movie opens the pipe
+        const int pipe = open(pipePath.c_str(), O_WRONLY);
+        
+        while (pipe >= 0 && ! stopWriting && written < bytes.size())
+        {
+            const std::size_t chunkSize = std::min<std::size_t>(written < headSize ? 1024 : 64, bytes.size() - written);
+            
+            if (write(pipe, &bytes[written], chunkSize) < 0)
+            {
+                readerClosed = true;
+                break;
+            }
+            
+            written += chunkSize;
+            sf::sleep(sf::milliseconds(20));
+        }
+        
+        if (pipe >= 0)
+            close(pipe);
+    });
+    
+    bool called = false;
+    std::unique_ptr<sfe::Movie> movie(new sfe::Movie);
+    movie->openFromFileAsync(pipePath, [&called](bool success) { called = true; });
+    
+    while (written < headSize)
+        sf::sleep(sf::milliseconds(10));
+    
+    // Destroying the movie aborts the reads, the pipe is closed long before the whole media was written
+    movie.reset();
+    
+    for (sf::Clock clock; ! readerClosed && written < bytes.size() && clock.getElapsedTime() < sf::seconds(5);)
+        sf::sleep(sf::milliseconds(10));
+    
+    BOOST_CHECK(readerClosed);
+    BOOST_CHECK(written < bytes.size() / 2);
+    BOOST_CHECK(! called);
+    
+    stopWriting = true;
+    writer.join();
+    std::remove(pipePath.c_str());
+}
+#endif
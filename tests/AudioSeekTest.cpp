@@ -0,0 +1,78 @@
+
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_MODULE AudioSeekTest
+#include <boost/test/unit_test.hpp>
+#include "TestHelpers.hpp"
+#include "AudioResampler.hpp"
+#include <sfeMovie/AudioSettings.hpp>
+#include <string>
+
+using namespace sfe::test;
+
+namespace
+{
+    DummyDelegate delegate;
+    
+    /** Seek a media while it plays, resampling its audio with soxr
+     *
+     * soxr outputs nothing for the first frames after a flush, while the decoded frames never start on
+     * the seek target so that the beginning of the first decoded frames is discarded
+     */
+    void seekWithSoxResampler(const std::string& mediaFile)
+    {
+        sfe::AudioSettings settings;
+        settings.sampleRate = 96000;
+        settings.resamplerEngine = sfe::SoxResampler;
+        
+        std::shared_ptr<sfe::ManualClock> clock = std::make_shared<sfe::ManualClock>();
+        std::shared_ptr<sfe::Timer> timer = std::make_shared<sfe::Timer>(clock);
+        std::shared_ptr<sfe::Demuxer> demuxer = std::make_shared<sfe::Demuxer>(mediaFile, timer, delegate, settings);
+        demuxer->selectFirstAudioStream();
+        
+        std::shared_ptr<sfe::AudioStream> audioStream = demuxer->getSelectedAudioStream();
+        BOOST_REQUIRE(audioStream);
+        
+        // The timer starts once the audio device got its first decoded samples
+        timer->play();
+        BOOST_REQUIRE(timer->waitForStart(sf::seconds(5)));
+        playFor(*demuxer, *clock, sf::milliseconds(200));
+        
+        const sf::Time duration = demuxer->getDuration();
+        const float targets[] = { 0.5f, 0.2f, 0.75f };
+        
+        for (float target : targets)
+        {
+            // Decoding stops if the samples after the seek can't be stored, and the timer is then never released
+            const sf::Time position = duration * target;
+            BOOST_CHECK(timer->seek(position));
+            BOOST_REQUIRE_MESSAGE(timer->waitForStart(sf::seconds(5)),
+                                  mediaFile << ": no audio after seeking to " << position.asSeconds() << "s");
+            
+            playFor(*demuxer, *clock, sf::milliseconds(200));
+            
+            sf::Time playbackPosition;
+            BOOST_CHECK(timer->getOffset() > position && timer->getOffset() <= position + sf::milliseconds(200));
+            BOOST_CHECK(audioStream->sfe::Stream::getStatus() == sfe::Playing);
+            BOOST_CHECK(audioStream->getPlaybackPosition(playbackPosition));
+            BOOST_CHECK_MESSAGE(playbackPosition + sf::milliseconds(100) >= position
+                                && playbackPosition < position + sf::seconds(1),
+                                mediaFile << ": seeked to " << position.asSeconds() << "s, playing at "
+                                << playbackPosition.asSeconds() << "s");
+        }
+        
+        timer->stop();
+    }
+}
+
+BOOST_AUTO_TEST_CASE(AudioSeekTestSoxResampler)
+{
+    if (! sfe::AudioResampler::isEngineAvailable(sfe::SoxResampler))
+    {
+        BOOST_TEST_MESSAGE("FFmpeg is built without soxr, skipping the test");
+        return;
+    }
+    
+    // Free codecs only, see DemuxerShortMP3Test
+    seekWithSoxResampler("small_3.flac");
+    seekWithSoxResampler("small_1.ogv");
+}
@@ -0,0 +1,143 @@
+
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_MODULE AudioSwitchTest
+#include <boost/test/unit_test.hpp>
+#include "TestHelpers.hpp"
+#include <algorithm>
+#include <stdexcept>
+
+using namespace sfe::test;
+
+namespace
+{
+    DummyDelegate delegate;
+    
+    // Audio given to the audio device at once, the switch must not take longer
+    const sf::Time ChunkDuration = sf::milliseconds(100);
+    
+    /** Measures how late the video frames are shown, from the frames given to the frame tap
+     *
+     * Without a decoding pool the frames are decoded by update() just before being shown, so the last
+     * tapped frame is the one shown next. A frame that is tapped but never shown was skipped for being late
+     */
+    class LatenessDelegate : public sfe::VideoStream::Delegate
+    {
+    public:
+        LatenessDelegate() :
+        m_timer(),
+        m_measuring(false),
+        m_hasPendingFrame(false),
+        m_pendingPosition(),
+        m_maxLateness(),
+        m_skippedFrameCount(0)
+        {
+        }
+        
+        void tap(const sfe::MediaFrame& frame)
+        {
+            if (m_measuring && m_hasPendingFrame)
+                m_skippedFrameCount++;
+            
+            m_pendingPosition = frame.getPosition();
+            m_hasPendingFrame = true;
+        }
+        
+        void didUpdateVideo(const sfe::VideoStream& sender, const sf::Texture& image)
+        {
+            if (m_measuring && m_hasPendingFrame)
+                m_maxLateness = std::max(m_maxLateness, m_timer->getOffset() - m_pendingPosition);
+            
+            m_hasPendingFrame = false;
+        }
+        
+        std::shared_ptr<sfe::Timer> m_timer;
+        bool m_measuring;
+        bool m_hasPendingFrame;
+        sf::Time m_pendingPosition;
+        sf::Time m_maxLateness;
+        unsigned int m_skippedFrameCount;
+    };
+}
+
+BOOST_AUTO_TEST_CASE(AudioSwitchWhilePlayingTest)
+{
+    // small_5.ogv is small_1.ogv with its Vorbis track duplicated into a second audio track
+    LatenessDelegate latenessDelegate;
+    std::shared_ptr<sfe::Timer> timer = std::make_shared<sfe::Timer>();
+    std::shared_ptr<sfe::Demuxer> demuxer = std::make_shared<sfe::Demuxer>("small_5.ogv", timer, latenessDelegate);
+    demuxer->selectFirstVideoStream();
+    demuxer->selectFirstAudioStream();
+    latenessDelegate.m_timer = timer;
+    
+    std::shared_ptr<sfe::VideoStream> videoStream = demuxer->getSelectedVideoStream();
+    std::shared_ptr<sfe::AudioStream> firstStream = demuxer->getSelectedAudioStream();
+    BOOST_REQUIRE(videoStream);
+    BOOST_REQUIRE(firstStream);
+    videoStream->setFrameTap([&latenessDelegate](const sfe::MediaFrame& frame) { latenessDelegate.tap(frame); });
+    
+    std::shared_ptr<sfe::AudioStream> secondStream;
+    
+    for (const std::shared_ptr<sfe::Stream>& stream : demuxer->getStreamsOfType(sfe::Audio))
+    {
+        if (stream != firstStream)
+            secondStream = std::static_pointer_cast<sfe::AudioStream>(stream);
+    }
+    
+    BOOST_REQUIRE(secondStream);
+    
+    timer->play();
+    BOOST_REQUIRE(timer->waitForStart(sf::seconds(5)));
+    playInRealTime(*demuxer, sf::milliseconds(500));
+    
+    // The other track takes over once its audio is decoded, the timer never stops meanwhile
+    const sf::Time frameDuration = sf::seconds(1.f / videoStream->getFrameRate());
+    const sf::Time switchOffset = timer->getOffset();
+    latenessDelegate.m_measuring = true;
+    BOOST_CHECK_NO_THROW(demuxer->selectAudioStream(secondStream));
+    
+    for (sf::Clock clock; demuxer->getSelectedAudioStream() != secondStream && clock.getElapsedTime() < sf::seconds(2);)
+    {
+        sf::sleep(StepDuration);
+        demuxer->update();
+        BOOST_CHECK(timer->getStatus() == sfe::Playing);
+    }
+    
+    BOOST_REQUIRE(demuxer->getSelectedAudioStream() == secondStream);
+    BOOST_CHECK_MESSAGE(timer->getOffset() - switchOffset <= ChunkDuration, "the switch took "
+                        << (timer->getOffset() - switchOffset).asMilliseconds() << "ms");
+    
+    // The video keeps its pace while the audio tracks are swapped
+    playInRealTime(*demuxer, sf::milliseconds(200));
+    latenessDelegate.m_measuring = false;
+    BOOST_CHECK(videoStream->getStatus() == sfe::Playing);
+    BOOST_CHECK(latenessDelegate.m_skippedFrameCount == 0);
+    BOOST_CHECK_MESSAGE(latenessDelegate.m_maxLateness < frameDuration, "a video frame was shown "
+                        << latenessDelegate.m_maxLateness.asMilliseconds() << "ms late during the switch");
+    BOOST_CHECK(secondStream->sfe::Stream::getStatus() == sfe::Playing);
+    
+    // Disabling the audio is immediate and doesn't touch the video
+    BOOST_CHECK_NO_THROW(demuxer->selectAudioStream(nullptr));
+    BOOST_CHECK(! demuxer->getSelectedAudioStream());
+    BOOST_CHECK(timer->getStatus() == sfe::Playing);
+    playInRealTime(*demuxer, sf::milliseconds(200));
+    BOOST_CHECK(videoStream->getStatus() == sfe::Playing);
+    
+    videoStream->setFrameTap(nullptr);
+    timer->stop();
+}
+
+BOOST_AUTO_TEST_CASE(AudioSwitchWhilePausedTest)
+{
+    std::shared_ptr<sfe::Timer> timer = std::make_shared<sfe::Timer>();
+    std::shared_ptr<sfe::Demuxer> demuxer = std::make_shared<sfe::Demuxer>("small_1.ogv", timer, delegate);
+    demuxer->selectFirstVideoStream();
+    demuxer->selectFirstAudioStream();
+    
+    timer->play();
+    BOOST_REQUIRE(timer->waitForStart(sf::seconds(5)));
+    timer->pause();
+    
+    BOOST_CHECK_THROW(demuxer->selectAudioStream(nullptr), std::runtime_error);
+    
+    timer->stop();
+}
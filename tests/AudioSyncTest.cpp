@@ -0,0 +1,179 @@
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_MODULE AudioSyncTest
+#include <boost/test/unit_test.hpp>
+#include "TestHelpers.hpp"
+#include <algorithm>
+#include <cstdlib>
+
+using namespace sfe::test;
+
+namespace
+{
+    DummyDelegate delegate;
+    
+    // The drift left once the timer follows the audio device, one frame at 25 fps
+    const sf::Time MaxCorrectedDrift = sf::milliseconds(40);
+    
+    /** Distance between two positions
+     */
+    sf::Time distance(sf::Time a, sf::Time b)
+    {
+        return sf::microseconds(std::abs((a - b).asMicroseconds()));
+    }
+    
+    /** Measures, each time a video frame is shown, how far the timer that chose the frame is from the audio
+     */
+    class SyncDelegate : public sfe::VideoStream::Delegate
+    {
+    public:
+        SyncDelegate() :
+        m_timer(),
+        m_audioStream(),
+        m_settlingDuration(sf::seconds(1)),
+        m_frameCount(0),
+        m_maxDrift()
+        {
+        }
+        
+        void didUpdateVideo(const sfe::VideoStream& sender, const sf::Texture& image)
+        {
+            sf::Time audioPosition;
+            m_frameCount++;
+            
+            if (m_audioStream && m_audioStream->getPlaybackPosition(audioPosition) && audioPosition > m_settlingDuration)
+                m_maxDrift = std::max(m_maxDrift, distance(m_timer->getOffset(), audioPosition));
+        }
+        
+        std::shared_ptr<sfe::Timer> m_timer;
+        std::shared_ptr<sfe::AudioStream> m_audioStream;
+        sf::Time m_settlingDuration;
+        unsigned int m_frameCount;
+        sf::Time m_maxDrift;
+    };
+}
+
+BOOST_AUTO_TEST_CASE(AudioSyncTestConvergence)
+{
+    // Timer::synchronize() alone: the reference positions are given, the timer follows a manual clock
+    std::shared_ptr<sfe::ManualClock> clock = std::make_shared<sfe::ManualClock>();
+    sfe::Timer timer(clock);
+    timer.play();
+    BOOST_REQUIRE(timer.getStatus() == sfe::Playing);
+    
+    // A reference that starts a bit late and runs 1% faster than the clock
+    sf::Time reference = -sf::milliseconds(30);
+    const sf::Time settlingDuration = sf::seconds(3);
+    sf::Time maxDrift;
+    
+    for (sf::Time elapsed; elapsed < sf::seconds(10); elapsed += StepDuration)
+    {
+        clock->advance(StepDuration);
+        reference += StepDuration * 1.01f;
+        timer.synchronize(reference);
+        
+        // Leave the correction some time to converge
+        if (elapsed > settlingDuration)
+            maxDrift = std::max(maxDrift, distance(timer.getOffset(), reference));
+    }
+    
+    BOOST_CHECK(maxDrift < MaxCorrectedDrift);
+    
+    // Large differences are corrected at once
+    reference += sf::seconds(1);
+    timer.synchronize(reference);
+    BOOST_CHECK(distance(timer.getOffset(), reference) < StepDuration);
+    
+    timer.stop();
+}
+
+BOOST_AUTO_TEST_CASE(AudioSyncTestLongPlayback)
+{
+    // The whole media is played by the audio device, and the timer follows the system time as by default
+    const sf::Time settlingDuration = sf::seconds(2);
+    
+    std::shared_ptr<sfe::Timer> timer = std::make_shared<sfe::Timer>(std::make_shared<sfe::SystemClock>());
+    std::shared_ptr<sfe::Demuxer> demuxer = std::make_shared<sfe::Demuxer>("long_1.wav", timer, delegate);
+    demuxer->selectFirstAudioStream();
+    demuxer->setAudioMasterClock(true);
+    
+    std::shared_ptr<sfe::AudioStream> audioStream = demuxer->getSelectedAudioStream();
+    BOOST_REQUIRE(audioStream);
+    
+    const sf::Time duration = demuxer->getDuration();
+    timer->play();
+    BOOST_REQUIRE(timer->waitForStart(sf::seconds(5)));
+    
+    sf::Clock wallClock;
+    sf::Time audioPosition;
+    sf::Time maxDrift;
+    sf::Time systemClockDrift;
+    sf::Time wallClockOrigin;
+    bool hasOrigin = false;
+    
+    while (audioStream->sfe::Stream::getStatus() == sfe::Playing && wallClock.getElapsedTime() < duration + sf::seconds(5))
+    {
+        sf::sleep(StepDuration);
+        demuxer->update();
+        
+        if (! audioStream->getPlaybackPosition(audioPosition))
+            continue;
+        
+        // How far the audio device is from the system time since the audio started, without correction
+        if (! hasOrigin)
+        {
+            wallClockOrigin = wallClock.getElapsedTime() - audioPosition;
+            hasOrigin = true;
+        }
+        
+        systemClockDrift = audioPosition - (wallClock.getElapsedTime() - wallClockOrigin);
+        
+        if (audioPosition > settlingDuration)
+            maxDrift = std::max(maxDrift, distance(timer->getOffset(), audioPosition));
+    }
+    
+    BOOST_TEST_MESSAGE("played " << audioPosition.asSeconds() << "s of audio, the audio device drifted by "
+                       << systemClockDrift.asMilliseconds() << "ms from the system clock");
+    BOOST_TEST_MESSAGE("max drift following the audio clock: " << maxDrift.asMilliseconds() << "ms");
+    
+    BOOST_CHECK(audioPosition > duration - sf::seconds(1));
+    BOOST_CHECK(maxDrift < MaxCorrectedDrift);
+    
+    timer->stop();
+}
+
+BOOST_AUTO_TEST_CASE(AudioSyncTestVideo)
+{
+    // The video frames are chosen by the timer, which follows the audio device
+    SyncDelegate syncDelegate;
+    std::shared_ptr<sfe::Timer> timer = std::make_shared<sfe::Timer>(std::make_shared<sfe::SystemClock>());
+    std::shared_ptr<sfe::Demuxer> demuxer = std::make_shared<sfe::Demuxer>("small_1.ogv", timer, syncDelegate);
+    demuxer->selectFirstAudioStream();
+    demuxer->selectFirstVideoStream();
+    demuxer->setAudioMasterClock(true);
+    
+    std::shared_ptr<sfe::VideoStream> videoStream = demuxer->getSelectedVideoStream();
+    BOOST_REQUIRE(videoStream);
+    syncDelegate.m_timer = timer;
+    syncDelegate.m_audioStream = demuxer->getSelectedAudioStream();
+    BOOST_REQUIRE(syncDelegate.m_audioStream);
+    
+    const sf::Time duration = demuxer->getDuration();
+    timer->play();
+    BOOST_REQUIRE(timer->waitForStart(sf::seconds(5)));
+    
+    for (sf::Clock wallClock; videoStream->getStatus() == sfe::Playing && wallClock.getElapsedTime() < duration + sf::seconds(5);)
+    {
+        sf::sleep(StepDuration);
+        demuxer->update();
+    }
+    
+    const unsigned int expectedFrameCount = static_cast<unsigned int>(duration.asSeconds() * videoStream->getFrameRate());
+    BOOST_TEST_MESSAGE("showed " << syncDelegate.m_frameCount << " frames out of " << expectedFrameCount
+                       << ", max drift from the audio when showing a frame: " << syncDelegate.m_maxDrift.asMilliseconds() << "ms");
+    
+    BOOST_CHECK(videoStream->getStatus() == sfe::Stopped);
+    BOOST_CHECK(syncDelegate.m_frameCount > expectedFrameCount / 2);
+    BOOST_CHECK(syncDelegate.m_maxDrift < MaxCorrectedDrift);
+    
+    timer->stop();
+}
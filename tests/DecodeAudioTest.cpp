@@ -0,0 +1,163 @@
+
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_MODULE DecodeAudioTest
+#include <boost/test/unit_test.hpp>
+#include <sfeMovie/Movie.hpp>
+#include <SFML/Audio.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+namespace
+{
+    /** The samples of a WAV file, read without FFmpeg
+     */
+    struct WavFile
+    {
+        unsigned channelCount;
+        unsigned sampleRate;
+        unsigned bitsPerSample;
+        std::vector<char> data;
+    };
+    
+    bool readWav(const std::string& path, WavFile& wav)
+    {
+        std::ifstream file(path.c_str(), std::ios::binary);
+        std::vector<char> bytes((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+        
+        if (bytes.size() < 12 || std::memcmp(&bytes[0], "RIFF", 4) != 0 || std::memcmp(&bytes[8], "WAVE", 4) != 0)
+            return false;
+        
+        bool hasFormat = false;
+        
+        // The chunks are little endian, as is the machine running the tests
+        for (std::size_t offset = 12; offset + 8 <= bytes.size();)
+        {
+            uint32_t chunkSize = 0;
+            std::memcpy(&chunkSize, &bytes[offset + 4], 4);
+            const std::size_t chunkBegin = offset + 8;
+            
+            if (std::memcmp(&bytes[offset], "fmt ", 4) == 0 && chunkSize >= 16)
+            {
+                uint16_t channelCount = 0;
+                uint32_t sampleRate = 0;
+                uint16_t bitsPerSample = 0;
+                std::memcpy(&channelCount, &bytes[chunkBegin + 2], 2);
+                std::memcpy(&sampleRate, &bytes[chunkBegin + 4], 4);
+                std::memcpy(&bitsPerSample, &bytes[chunkBegin + 14], 2);
+                
+                wav.channelCount = channelCount;
+                wav.sampleRate = sampleRate;
+                wav.bitsPerSample = bitsPerSample;
+                hasFormat = true;
+            }
+            else if (std::memcmp(&bytes[offset], "data", 4) == 0)
+            {
+                const std::size_t dataSize = std::min<std::size_t>(chunkSize, bytes.size() - chunkBegin);
+                wav.data.assign(bytes.begin() + chunkBegin, bytes.begin() + chunkBegin + dataSize);
+                return hasFormat;
+            }
+            
+            // Chunks are padded to an even size
+            offset = chunkBegin + chunkSize + (chunkSize & 1);
+        }
+        
+        return false;
+    }
+}
+
+BOOST_AUTO_TEST_CASE(DecodeAudioTestFloatFormats)
+{
+    // 24 bits samples, whose precision is lost when converted to 16 bits integers
+    sfe::Movie movie;
+    BOOST_REQUIRE(movie.openFromFile("small_4.wav"));
+    
+    const std::size_t channelCount = movie.getChannelCount();
+    BOOST_REQUIRE(channelCount == 2);
+    
+    std::vector<sf::Int16> int16Samples;
+    std::vector<float> floatSamples;
+    std::vector<float> planarSamples;
+    BOOST_REQUIRE(movie.decodeAudio(int16Samples));
+    BOOST_REQUIRE(movie.decodeAudio(floatSamples, sfe::FloatSamples));
+    BOOST_REQUIRE(movie.decodeAudio(planarSamples, sfe::PlanarFloatSamples));
+    
+    BOOST_REQUIRE(! int16Samples.empty());
+    BOOST_REQUIRE(floatSamples.size() == int16Samples.size());
+    BOOST_REQUIRE(planarSamples.size() == int16Samples.size());
+    
+    const std::size_t frameCount = floatSamples.size() / channelCount;
+    bool sameValues = true;
+    bool samePlanarValues = true;
+    bool keepsPrecision = false;
+    
+    for (std::size_t i = 0; i < frameCount; i++)
+    {
+        for (std::size_t channel = 0; channel < channelCount; channel++)
+        {
+            const float value = floatSamples[i * channelCount + channel];
+            const float scaled = value * 32768.f;
+            
+            sameValues = sameValues && std::fabs(scaled - int16Samples[i * channelCount + channel]) <= 1.f;
+            samePlanarValues = samePlanarValues && planarSamples[channel * frameCount + i] == value;
+            keepsPrecision = keepsPrecision || scaled != std::floor(scaled);
+        }
+    }
+    
+    BOOST_CHECK(sameValues);
+    BOOST_CHECK(samePlanarValues);
+    BOOST_CHECK(keepsPrecision);
+    
+    // Float samples can't be decoded as integers
+    BOOST_CHECK(movie.decodeAudio(floatSamples, sfe::Int16Samples) == false);
+}
+
+BOOST_AUTO_TEST_CASE(DecodeAudioTestInt16Wav)
+{
+    // 16 bits samples, decoded as is
+    WavFile wav;
+    BOOST_REQUIRE(readWav("left-right.wav", wav));
+    BOOST_REQUIRE(wav.bitsPerSample == 16);
+    
+    sfe::Movie movie;
+    BOOST_REQUIRE(movie.openFromFile("left-right.wav"));
+    
+    std::vector<sf::Int16> samples;
+    BOOST_REQUIRE(movie.decodeAudio(samples));
+    BOOST_CHECK(movie.getChannelCount() == wav.channelCount);
+    BOOST_CHECK(movie.getSampleRate() == wav.sampleRate);
+    BOOST_REQUIRE(samples.size() == wav.data.size() / sizeof(sf::Int16));
+    BOOST_CHECK(std::memcmp(&samples[0], &wav.data[0], wav.data.size()) == 0);
+    
+    sf::SoundBuffer buffer;
+    BOOST_REQUIRE(movie.decodeAudio(buffer));
+    BOOST_CHECK(buffer.getChannelCount() == wav.channelCount);
+    BOOST_CHECK(buffer.getSampleRate() == wav.sampleRate);
+    BOOST_REQUIRE(buffer.getSampleCount() == samples.size());
+    BOOST_CHECK(std::memcmp(buffer.getSamples(), &samples[0], samples.size() * sizeof(sf::Int16)) == 0);
+}
+
+BOOST_AUTO_TEST_CASE(DecodeAudioTestFloatWav)
+{
+    // Long enough to be decoded on several threads, the parts must join without gap nor overlap
+    WavFile wav;
+    BOOST_REQUIRE(readWav("long_1.wav", wav));
+    BOOST_REQUIRE(wav.bitsPerSample == 32);
+    
+    sfe::Movie movie;
+    BOOST_REQUIRE(movie.openFromFile("long_1.wav"));
+    
+    std::vector<float> samples;
+    BOOST_REQUIRE(movie.decodeAudio(samples, sfe::FloatSamples));
+    BOOST_CHECK(movie.getChannelCount() == wav.channelCount);
+    BOOST_REQUIRE(samples.size() == wav.data.size() / sizeof(float));
+    BOOST_CHECK(std::memcmp(&samples[0], &wav.data[0], wav.data.size()) == 0);
+    
+    std::vector<sf::Int16> int16Samples;
+    BOOST_REQUIRE(movie.decodeAudio(int16Samples));
+    BOOST_CHECK(int16Samples.size() == samples.size());
+}
@@ -0,0 +1,124 @@
+
+#include "DecodePool.hpp"
+#include "TestHelpers.hpp"
+#include <algorithm>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+using namespace sfe::test;
+
+namespace
+{
+    struct BenchmarkResult
+    {
+        float framesPerSecond;
+        float updateLoad;
+    };
+    
+    /** Play @a movieCount movies for @a duration, decoding on @a pool or in update() if it's nullptr
+     */
+    BenchmarkResult playMovies(const std::string& mediaFile, unsigned int movieCount, sf::Time duration,
+                               std::shared_ptr<sfe::DecodePool> pool)
+    {
+        CountingDelegate delegate;
+        std::vector<std::shared_ptr<sfe::Timer> > timers;
+        std::vector<std::shared_ptr<sfe::Demuxer> > demuxers;
+        
+        for (unsigned int i = 0; i < movieCount; i++)
+        {
+            std::shared_ptr<sfe::Timer> timer = std::make_shared<sfe::Timer>();
+            std::shared_ptr<sfe::Demuxer> demuxer = std::make_shared<sfe::Demuxer>(mediaFile, timer, delegate);
+            demuxer->selectFirstVideoStream();
+            
+            if (pool)
+                demuxer->getSelectedVideoStream()->setDecodePool(pool, 0);
+            
+            timers.push_back(timer);
+            demuxers.push_back(demuxer);
+        }
+        
+        for (std::shared_ptr<sfe::Timer> timer : timers)
+            timer->play();
+        
+        sf::Clock clock;
+        sf::Time updateTime;
+        
+        while (clock.getElapsedTime() < duration)
+        {
+            sf::Clock updateClock;
+            
+            for (std::shared_ptr<sfe::Demuxer> demuxer : demuxers)
+                demuxer->update();
+            
+            updateTime += updateClock.getElapsedTime();
+            sf::sleep(sf::milliseconds(1));
+        }
+        
+        BenchmarkResult result;
+        result.framesPerSecond = delegate.m_frameCount / clock.getElapsedTime().asSeconds();
+        result.updateLoad = updateTime / clock.getElapsedTime();
+        
+        for (std::shared_ptr<sfe::Timer> timer : timers)
+            timer->stop();
+        
+        return result;
+    }
+}
+
+/** Standalone benchmark of the shared decoding, not run by ctest
+ *
+ * Like a video wall: many movies are played at once from the same rendering thread, decoding
+ * either in update() or on a DecodePool. The aggregate frames per second are printed for
+ * each movie count and each thread count.
+ *
+ * Usage: DecodePoolBenchmark [media file] [seconds per measure]
+ */
+int main(int argc, char** argv)
+{
+    const std::string mediaFile = (argc > 1) ? argv[1] : "small_1.ogv";
+    const sf::Time duration = sf::seconds((argc > 2) ? static_cast<float>(std::atof(argv[2])) : 4.f);
+    
+    const unsigned int movieCounts[] = { 1, 4, 16, 32 };
+    const unsigned int cores = std::max(1u, std::thread::hardware_concurrency());
+    
+    // 0 stands for decoding in update()
+    std::vector<unsigned int> threadCounts(1, 0);
+    
+    for (unsigned int threadCount = 1; threadCount < cores; threadCount *= 2)
+        threadCounts.push_back(threadCount);
+    
+    threadCounts.push_back(cores);
+    
+    std::cout << "Aggregate frames per second (rendering thread load in update()), "
+              << mediaFile << ", " << cores << " cores" << std::endl;
+    std::cout << std::setw(8) << "movies";
+    
+    for (unsigned int threadCount : threadCounts)
+        std::cout << std::setw(18) << (threadCount ? std::to_string(threadCount) + " thread(s)" : "update()");
+    
+    std::cout << std::endl;
+    
+    for (unsigned int movieCount : movieCounts)
+    {
+        std::cout << std::setw(8) << movieCount;
+        
+        for (unsigned int threadCount : threadCounts)
+        {
+            std::shared_ptr<sfe::DecodePool> pool;
+            
+            if (threadCount)
+                pool = std::make_shared<sfe::DecodePool>(threadCount);
+            
+            const BenchmarkResult result = playMovies(mediaFile, movieCount, duration, pool);
+            std::cout << std::setw(11) << std::fixed << std::setprecision(1) << result.framesPerSecond
+                      << " (" << std::setw(3) << static_cast<int>(result.updateLoad * 100) << "%)" << std::flush;
+        }
+        
+        std::cout << std::endl;
+    }
+    
+    return EXIT_SUCCESS;
+}
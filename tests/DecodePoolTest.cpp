@@ -0,0 +1,110 @@
+
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_MODULE DecodePoolTest
+#include <boost/test/unit_test.hpp>
+#include "DecodePool.hpp"
+#include <SFML/System.hpp>
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+BOOST_AUTO_TEST_CASE(DecodePoolPriorityTest)
+{
+    // A single thread makes the execution order observable
+    sfe::DecodePool pool(1);
+    std::mutex orderMutex;
+    std::vector<int> order;
+    std::atomic<bool> blocked(true);
+    std::atomic<int> done(0);
+    
+    // Keep the thread busy while the other tasks are queued
+    pool.schedule([&blocked]() { while (blocked) sf::sleep(sf::milliseconds(1)); });
+    
+    for (int priority = 0; priority < 4; priority++)
+    {
+        pool.schedule([&, priority]()
+        {
+            std::lock_guard<std::mutex> lock(orderMutex);
+            order.push_back(priority);
+            done++;
+        }, priority);
+    }
+    
+    blocked = false;
+    
+    while (done < 4)
+        sf::sleep(sf::milliseconds(1));
+    
+    BOOST_REQUIRE(order.size() == 4);
+    BOOST_CHECK(order[0] == 3);
+    BOOST_CHECK(order[1] == 2);
+    BOOST_CHECK(order[2] == 1);
+    BOOST_CHECK(order[3] == 0);
+}
+
+BOOST_AUTO_TEST_CASE(DecodePoolGlobalPriorityTest)
+{
+    sfe::DecodePool pool(2);
+    std::mutex orderMutex;
+    std::vector<int> order;
+    std::atomic<bool> firstBlocked(true);
+    std::atomic<bool> secondBlocked(true);
+    std::atomic<int> started(0);
+    std::atomic<int> done(0);
+    
+    // Keep both threads busy while the other tasks are queued
+    pool.schedule([&]() { started++; while (firstBlocked) sf::sleep(sf::milliseconds(1)); });
+    pool.schedule([&]() { started++; while (secondBlocked) sf::sleep(sf::milliseconds(1)); });
+    
+    while (started < 2)
+        sf::sleep(sf::milliseconds(1));
+    
+    // The tasks are spread over the two queues
+    for (int priority = 0; priority < 4; priority++)
+    {
+        pool.schedule([&, priority]()
+        {
+            std::lock_guard<std::mutex> lock(orderMutex);
+            order.push_back(priority);
+            done++;
+        }, priority);
+    }
+    
+    // The only free thread runs the tasks of both queues by priority
+    firstBlocked = false;
+    
+    while (done < 4)
+        sf::sleep(sf::milliseconds(1));
+    
+    secondBlocked = false;
+    
+    BOOST_REQUIRE(order.size() == 4);
+    BOOST_CHECK(order[0] == 3);
+    BOOST_CHECK(order[1] == 2);
+    BOOST_CHECK(order[2] == 1);
+    BOOST_CHECK(order[3] == 0);
+}
+
+BOOST_AUTO_TEST_CASE(DecodePoolCancelTest)
+{
+    sfe::DecodePool pool(1);
+    std::atomic<bool> blocked(true);
+    std::atomic<bool> cancelledRan(false);
+    std::atomic<bool> done(false);
+    
+    pool.schedule([&blocked]() { while (blocked) sf::sleep(sf::milliseconds(1)); });
+    sfe::DecodePool::JobId cancelled = pool.schedule([&cancelledRan]() { cancelledRan = true; });
+    
+    // A queued task is removed without waiting for the busy thread
+    BOOST_CHECK(pool.cancel(cancelled) == true);
+    BOOST_CHECK(pool.cancel(cancelled) == false);
+    
+    sfe::DecodePool::JobId last = pool.schedule([&done]() { done = true; });
+    blocked = false;
+    
+    while (! done)
+        sf::sleep(sf::milliseconds(1));
+    
+    BOOST_CHECK(cancelledRan == false);
+    BOOST_CHECK(pool.cancel(last) == false);
+}
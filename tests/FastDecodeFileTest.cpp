@@ -0,0 +1,222 @@
+
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_MODULE FastDecodeFileTest
+#include <boost/test/unit_test.hpp>
+#include "FastDecodeFile.hpp"
+#include "Lz4.hpp"
+#include "TestHelpers.hpp"
+#include <sfeMovie/Movie.hpp>
+#include <SFML/System.hpp>
+#include <cstdio>
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace sfe::test;
+
+namespace
+{
+    /** Text with short and overlapping matches, the input of the reference blocks
+     */
+    std::vector<uint8_t> referenceText()
+    {
+        std::string text;
+        
+        for (int i = 0; i < 3; i++)
+            text += "sfeMovie plays movies in SFML applications. ";
+        
+        text += std::string(76, 'a');
+        
+        for (char c = '0'; c <= 'z'; c++)
+            text += c;
+        
+        for (int i = 0; i < 14; i++)
+            text += "abc";
+        
+        text += "The end.";
+        return std::vector<uint8_t>(text.begin(), text.end());
+    }
+    
+    // Blocks of referenceText() extracted from the frames written by the reference lz4 1.9.4 command line tool,
+    // with its fast (-1) and high compression (-9) levels
+    const uint8_t ReferenceFastBlock[] =
+    {
+        0xf0, 0x01, 0x73, 0x66, 0x65, 0x4d, 0x6f, 0x76, 0x69, 0x65, 0x20, 0x70, 0x6c, 0x61, 0x79, 0x73,
+        0x20, 0x6d, 0x0c, 0x00, 0xff, 0x09, 0x73, 0x20, 0x69, 0x6e, 0x20, 0x53, 0x46, 0x4d, 0x4c, 0x20,
+        0x61, 0x70, 0x70, 0x6c, 0x69, 0x63, 0x61, 0x74, 0x69, 0x6f, 0x6e, 0x73, 0x2e, 0x20, 0x2c, 0x00,
+        0x45, 0x1f, 0x61, 0x01, 0x00, 0x38, 0xff, 0x42, 0x30, 0x31, 0x32, 0x33, 0x34, 0x35, 0x36, 0x37,
+        0x38, 0x39, 0x3a, 0x3b, 0x3c, 0x3d, 0x3e, 0x3f, 0x40, 0x41, 0x42, 0x43, 0x44, 0x45, 0x46, 0x47,
+        0x48, 0x49, 0x4a, 0x4b, 0x4c, 0x4d, 0x4e, 0x4f, 0x50, 0x51, 0x52, 0x53, 0x54, 0x55, 0x56, 0x57,
+        0x58, 0x59, 0x5a, 0x5b, 0x5c, 0x5d, 0x5e, 0x5f, 0x60, 0x61, 0x62, 0x63, 0x64, 0x65, 0x66, 0x67,
+        0x68, 0x69, 0x6a, 0x6b, 0x6c, 0x6d, 0x6e, 0x6f, 0x70, 0x71, 0x72, 0x73, 0x74, 0x75, 0x76, 0x77,
+        0x78, 0x79, 0x7a, 0x61, 0x62, 0x63, 0x61, 0x62, 0x63, 0x06, 0x00, 0x11, 0x80, 0x54, 0x68, 0x65,
+        0x20, 0x65, 0x6e, 0x64, 0x2e
+    };
+    
+    const uint8_t ReferenceHighBlock[] =
+    {
+        0xf0, 0x01, 0x73, 0x66, 0x65, 0x4d, 0x6f, 0x76, 0x69, 0x65, 0x20, 0x70, 0x6c, 0x61, 0x79, 0x73,
+        0x20, 0x6d, 0x0c, 0x00, 0xff, 0x09, 0x73, 0x20, 0x69, 0x6e, 0x20, 0x53, 0x46, 0x4d, 0x4c, 0x20,
+        0x61, 0x70, 0x70, 0x6c, 0x69, 0x63, 0x61, 0x74, 0x69, 0x6f, 0x6e, 0x73, 0x2e, 0x20, 0x2c, 0x00,
+        0x45, 0x1f, 0x61, 0x01, 0x00, 0x38, 0xff, 0x3f, 0x30, 0x31, 0x32, 0x33, 0x34, 0x35, 0x36, 0x37,
+        0x38, 0x39, 0x3a, 0x3b, 0x3c, 0x3d, 0x3e, 0x3f, 0x40, 0x41, 0x42, 0x43, 0x44, 0x45, 0x46, 0x47,
+        0x48, 0x49, 0x4a, 0x4b, 0x4c, 0x4d, 0x4e, 0x4f, 0x50, 0x51, 0x52, 0x53, 0x54, 0x55, 0x56, 0x57,
+        0x58, 0x59, 0x5a, 0x5b, 0x5c, 0x5d, 0x5e, 0x5f, 0x60, 0x61, 0x62, 0x63, 0x64, 0x65, 0x66, 0x67,
+        0x68, 0x69, 0x6a, 0x6b, 0x6c, 0x6d, 0x6e, 0x6f, 0x70, 0x71, 0x72, 0x73, 0x74, 0x75, 0x76, 0x77,
+        0x78, 0x79, 0x7a, 0x61, 0x62, 0x63, 0x03, 0x00, 0x14, 0x80, 0x54, 0x68, 0x65, 0x20, 0x65, 0x6e,
+        0x64, 0x2e
+    };
+    
+    /** Compress @a source and check that it decompresses back to the same bytes
+     */
+    void checkRoundTrip(const std::vector<uint8_t>& source)
+    {
+        std::vector<uint8_t> compressed(sfe::lz4CompressBound(source.size()));
+        const std::size_t compressedSize = sfe::lz4Compress(source.data(), source.size(), compressed.data());
+        BOOST_REQUIRE(compressedSize <= compressed.size());
+        
+        std::vector<uint8_t> decompressed(source.size());
+        BOOST_CHECK_MESSAGE(sfe::lz4Decompress(compressed.data(), compressedSize, decompressed.data(), decompressed.size()),
+                            "can't decompress " << source.size() << " bytes");
+        BOOST_CHECK_MESSAGE(decompressed == source, "different bytes after a round trip of " << source.size() << " bytes");
+    }
+}
+
+BOOST_AUTO_TEST_CASE(FastDecodeFileTestLz4RoundTrip)
+{
+    // Flat areas like the ones of UI animations, with some noise
+    std::vector<uint8_t> source(100000);
+    
+    for (std::size_t i = 0; i < source.size(); i++)
+        source[i] = (i % 4000 < 100) ? static_cast<uint8_t>(i * 7919 % 251) : static_cast<uint8_t>(i / 4000);
+    
+    std::vector<uint8_t> compressed(sfe::lz4CompressBound(source.size()));
+    const std::size_t compressedSize = sfe::lz4Compress(source.data(), source.size(), compressed.data());
+    BOOST_CHECK(compressedSize < source.size() / 4);
+    
+    std::vector<uint8_t> decompressed(source.size());
+    BOOST_CHECK(sfe::lz4Decompress(compressed.data(), compressedSize, decompressed.data(), decompressed.size()));
+    BOOST_CHECK(decompressed == source);
+    
+    // Truncated blocks are rejected
+    BOOST_CHECK(! sfe::lz4Decompress(compressed.data(), compressedSize / 2, decompressed.data(), decompressed.size()));
+}
+
+BOOST_AUTO_TEST_CASE(FastDecodeFileTestLz4Reference)
+{
+    // Blocks written by the reference implementation decompress to their input
+    const std::vector<uint8_t> text = referenceText();
+    std::vector<uint8_t> decompressed(text.size());
+    
+    BOOST_CHECK(sfe::lz4Decompress(ReferenceFastBlock, sizeof(ReferenceFastBlock), decompressed.data(), decompressed.size()));
+    BOOST_CHECK(decompressed == text);
+    
+    std::fill(decompressed.begin(), decompressed.end(), 0);
+    BOOST_CHECK(sfe::lz4Decompress(ReferenceHighBlock, sizeof(ReferenceHighBlock), decompressed.data(), decompressed.size()));
+    BOOST_CHECK(decompressed == text);
+    
+    // The size of the output is exact
+    decompressed.resize(text.size() + 1);
+    BOOST_CHECK(! sfe::lz4Decompress(ReferenceFastBlock, sizeof(ReferenceFastBlock), decompressed.data(), decompressed.size()));
+    
+    checkRoundTrip(text);
+}
+
+BOOST_AUTO_TEST_CASE(FastDecodeFileTestLz4RandomData)
+{
+    std::mt19937 generator(42);
+    std::uniform_int_distribution<int> byteDistribution(0, 255);
+    
+    // Incompressible data, whose blocks are only literals and must still fit in the bound
+    std::vector<uint8_t> noise(300000);
+    
+    for (uint8_t& byte : noise)
+        byte = static_cast<uint8_t>(byteDistribution(generator));
+    
+    checkRoundTrip(noise);
+    
+    // The sizes around the minimal match and the end of block rules
+    for (std::size_t size = 0; size < 40; size++)
+    {
+        checkRoundTrip(std::vector<uint8_t>(size, 'x'));
+        checkRoundTrip(std::vector<uint8_t>(noise.begin(), noise.begin() + size));
+    }
+    
+    // Random runs and repeats, with offsets close to the 64 KB window limit
+    std::uniform_int_distribution<int> lengthDistribution(1, 300);
+    std::uniform_int_distribution<int> offsetDistribution(1, 70000);
+    
+    for (int sample = 0; sample < 20; sample++)
+    {
+        std::vector<uint8_t> source;
+        
+        while (source.size() < 200000)
+        {
+            const std::size_t length = lengthDistribution(generator);
+            const std::size_t offset = offsetDistribution(generator);
+            
+            for (std::size_t i = 0; i < length; i++)
+            {
+                if (offset <= source.size() && sample % 2 == 0)
+                    source.push_back(source[source.size() - offset]);
+                else
+                    source.push_back(static_cast<uint8_t>(byteDistribution(generator) % (sample + 2)));
+            }
+        }
+        
+        checkRoundTrip(source);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(FastDecodeFileTestPlayback)
+{
+    // Work on a copy, so that the other tests keep decoding the original media
+    const std::string mediaFile = "fast_decode_1.ogv";
+    {
+        std::ifstream source("small_1.ogv", std::ios::binary);
+        std::ofstream destination(mediaFile.c_str(), std::ios::binary | std::ios::trunc);
+        destination << source.rdbuf();
+    }
+    
+    BOOST_REQUIRE(sfe::Movie::createFastDecodeFile(mediaFile));
+    
+    sfe::FastDecodeFile file;
+    BOOST_REQUIRE(file.open(mediaFile));
+    BOOST_CHECK(file.getFrameCount() > 0);
+    
+    std::vector<uint8_t> pixels(4 * file.getFrameSize().x * file.getFrameSize().y);
+    BOOST_CHECK(file.readFrame(file.getFrameCount() - 1, pixels.data()));
+    
+    // The file is only looked for once enabled
+    BOOST_CHECK(! sfe::Movie::areFastDecodeFilesEnabled());
+    {
+        DummyDelegate delegate;
+        std::shared_ptr<sfe::Timer> timer = std::make_shared<sfe::Timer>(std::make_shared<sfe::ManualClock>());
+        sfe::Demuxer demuxer(mediaFile, timer, delegate);
+        demuxer.selectFirstVideoStream();
+        BOOST_REQUIRE(demuxer.getSelectedVideoStream() != nullptr);
+        BOOST_CHECK(demuxer.getSelectedVideoStream()->usesPackets());
+    }
+    
+    sfe::Movie::setFastDecodeFilesEnabled(true);
+    
+    {
+        CountingDelegate delegate;
+        std::shared_ptr<sfe::ManualClock> clock = std::make_shared<sfe::ManualClock>();
+        std::shared_ptr<sfe::Timer> timer = std::make_shared<sfe::Timer>(clock);
+        sfe::Demuxer demuxer(mediaFile, timer, delegate);
+        demuxer.selectFirstVideoStream();
+        
+        std::shared_ptr<sfe::VideoStream> videoStream = demuxer.getSelectedVideoStream();
+        BOOST_REQUIRE(videoStream != nullptr);
+        BOOST_CHECK(! videoStream->usesPackets());
+        
+        BOOST_CHECK(playVideoToEnd(demuxer, *timer, *clock));
+        BOOST_CHECK(delegate.m_frameCount > 0);
+    }
+    
+    sfe::Movie::setFastDecodeFilesEnabled(false);
+    std::remove(sfe::FastDecodeFile::pathFor(mediaFile).c_str());
+    std::remove(mediaFile.c_str());
+}
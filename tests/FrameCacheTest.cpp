@@ -0,0 +1,176 @@
+
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_MODULE FrameCacheTest
+#include <boost/test/unit_test.hpp>
+#include "FrameCache.hpp"
+#include "TestHelpers.hpp"
+#include <SFML/Graphics.hpp>
+#include <cstdio>
+#include <fstream>
+#include <vector>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#if defined(_WIN32)
+#include <sys/utime.h>
+#else
+#include <utime.h>
+#endif
+
+using namespace sfe::test;
+
+namespace
+{
+    /** Records the timer position and a hash of the image of each displayed frame
+     */
+    class RecordingDelegate : public sfe::VideoStream::Delegate
+    {
+    public:
+        RecordingDelegate() :
+        m_timer(),
+        m_positions(),
+        m_hashes()
+        {
+        }
+        
+        void didUpdateVideo(const sfe::VideoStream& sender, const sf::Texture& image)
+        {
+            const sf::Image pixels = image.copyToImage();
+            const sf::Uint8* data = pixels.getPixelsPtr();
+            const std::size_t size = 4 * pixels.getSize().x * pixels.getSize().y;
+            uint64_t hash = 14695981039346656037ULL;
+            
+            for (std::size_t i = 0; i < size; i++)
+            {
+                hash ^= data[i];
+                hash *= 1099511628211ULL;
+            }
+            
+            m_positions.push_back(m_timer->getOffset());
+            m_hashes.push_back(hash);
+        }
+        
+        void clear()
+        {
+            m_positions.clear();
+            m_hashes.clear();
+        }
+        
+        std::shared_ptr<sfe::Timer> m_timer;
+        std::vector<sf::Time> m_positions;
+        std::vector<uint64_t> m_hashes;
+    };
+}
+
+BOOST_AUTO_TEST_CASE(FrameCacheTestLoopFromCache)
+{
+    RecordingDelegate delegate;
+    sfe::FrameCache::setBudget(256 * 1024 * 1024);
+    
+    std::shared_ptr<sfe::ManualClock> clock = std::make_shared<sfe::ManualClock>();
+    std::shared_ptr<sfe::Timer> timer = std::make_shared<sfe::Timer>(clock);
+    std::shared_ptr<sfe::Demuxer> demuxer = std::make_shared<sfe::Demuxer>("small_1.ogv", timer, delegate);
+    demuxer->selectFirstVideoStream();
+    delegate.m_timer = timer;
+    
+    std::shared_ptr<sfe::VideoStream> videoStream = demuxer->getSelectedVideoStream();
+    BOOST_REQUIRE(videoStream != nullptr);
+    BOOST_CHECK(videoStream->usesPackets());
+    
+    // The first pass decodes the frames and caches them, the second one only plays the cached frames
+    BOOST_CHECK(playVideoToEnd(*demuxer, *timer, *clock));
+    BOOST_CHECK(! videoStream->usesPackets());
+    
+    const std::vector<sf::Time> decodedPositions = delegate.m_positions;
+    const std::vector<uint64_t> decodedHashes = delegate.m_hashes;
+    BOOST_REQUIRE(! decodedHashes.empty());
+    delegate.clear();
+    
+    BOOST_CHECK(playVideoToEnd(*demuxer, *timer, *clock));
+    BOOST_CHECK(! videoStream->usesPackets());
+    
+    // The cached frames are the decoded images, shown at the same timer positions
+    BOOST_REQUIRE(delegate.m_hashes.size() == decodedHashes.size());
+    
+    for (std::size_t i = 0; i < decodedHashes.size(); i++)
+    {
+        BOOST_CHECK_MESSAGE(delegate.m_hashes[i] == decodedHashes[i], "cached frame " << i << " differs from the decoded one");
+        BOOST_CHECK_MESSAGE(delegate.m_positions[i] == decodedPositions[i], "cached frame " << i << " shown at "
+                            << delegate.m_positions[i].asMilliseconds() << "ms instead of "
+                            << decodedPositions[i].asMilliseconds() << "ms");
+    }
+    
+    // Another media playing the same file starts from the cached frames
+    std::shared_ptr<sfe::Timer> otherTimer = std::make_shared<sfe::Timer>(clock);
+    sfe::Demuxer otherDemuxer("small_1.ogv", otherTimer, delegate);
+    otherDemuxer.selectFirstVideoStream();
+    BOOST_CHECK(! otherDemuxer.getSelectedVideoStream()->usesPackets());
+    
+    // Lowering the budget evicts the clip
+    sfe::FrameCache::setBudget(0);
+    sfe::Demuxer uncachedDemuxer("small_1.ogv", otherTimer, delegate);
+    uncachedDemuxer.selectFirstVideoStream();
+    BOOST_CHECK(uncachedDemuxer.getSelectedVideoStream()->usesPackets());
+}
+
+BOOST_AUTO_TEST_CASE(FrameCacheTestModifiedMedia)
+{
+    // Work on a copy, so that its modification time can be changed
+    const std::string mediaFile = "frame_cache_1.ogv";
+    {
+        std::ifstream source("small_1.ogv", std::ios::binary);
+        std::ofstream destination(mediaFile.c_str(), std::ios::binary | std::ios::trunc);
+        destination << source.rdbuf();
+    }
+    
+    DummyDelegate delegate;
+    sfe::FrameCache::setBudget(256 * 1024 * 1024);
+    std::shared_ptr<sfe::ManualClock> clock = std::make_shared<sfe::ManualClock>();
+    
+    {
+        std::shared_ptr<sfe::Timer> timer = std::make_shared<sfe::Timer>(clock);
+        sfe::Demuxer demuxer(mediaFile, timer, delegate);
+        demuxer.selectFirstVideoStream();
+        BOOST_CHECK(playVideoToEnd(demuxer, *timer, *clock));
+        BOOST_CHECK(! demuxer.getSelectedVideoStream()->usesPackets());
+    }
+    
+    struct stat status;
+    BOOST_REQUIRE(stat(mediaFile.c_str(), &status) == 0);
+    
+    struct utimbuf times;
+    times.actime = status.st_atime;
+    times.modtime = status.st_mtime - 3600;
+    BOOST_REQUIRE(utime(mediaFile.c_str(), &times) == 0);
+    
+    // The same path with another modification time is decoded again
+    {
+        std::shared_ptr<sfe::Timer> timer = std::make_shared<sfe::Timer>(clock);
+        sfe::Demuxer demuxer(mediaFile, timer, delegate);
+        demuxer.selectFirstVideoStream();
+        BOOST_CHECK(demuxer.getSelectedVideoStream()->usesPackets());
+    }
+    
+    sfe::FrameCache::setBudget(0);
+    std::remove(mediaFile.c_str());
+}
+
+BOOST_AUTO_TEST_CASE(FrameCacheTestEviction)
+{
+    std::shared_ptr<sfe::FrameCache::Clip> clip = std::make_shared<sfe::FrameCache::Clip>(1);
+    clip->front().pixels.resize(1000);
+    
+    sfe::FrameCache::setBudget(2500);
+    sfe::FrameCache::insert("first", clip);
+    sfe::FrameCache::insert("second", clip);
+    
+    // Using the first clip makes the second one the least recently used
+    BOOST_CHECK(sfe::FrameCache::find("first") == clip);
+    sfe::FrameCache::insert("third", clip);
+    
+    BOOST_CHECK(sfe::FrameCache::find("first") == clip);
+    BOOST_CHECK(sfe::FrameCache::find("second") == nullptr);
+    BOOST_CHECK(sfe::FrameCache::find("third") == clip);
+    
+    sfe::FrameCache::setBudget(0);
+}
@@ -0,0 +1,110 @@
+
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_MODULE FrameReaderTest
+#include <boost/test/unit_test.hpp>
+#include <sfeMovie/FrameReader.hpp>
+#include <vector>
+
+BOOST_AUTO_TEST_CASE(FrameReaderTestOpen)
+{
+    sfe::FrameReader reader;
+    sfe::MediaFrame frame;
+    
+    BOOST_CHECK(reader.open("non-existing-file.ogv") == false);
+    BOOST_CHECK(reader.readFrame(frame) == false);
+    BOOST_CHECK(frame.isEmpty());
+    
+    BOOST_REQUIRE(reader.open("small_1.ogv"));
+    BOOST_CHECK(reader.getMediaType() == sfe::Video);
+    BOOST_CHECK(reader.getDuration() > sf::Time::Zero);
+}
+
+BOOST_AUTO_TEST_CASE(FrameReaderTestIteration)
+{
+    sfe::FrameReader reader;
+    BOOST_REQUIRE(reader.open("small_1.ogv"));
+    
+    std::vector<sf::Time> positions;
+    
+    for (const sfe::MediaFrame& frame : reader)
+    {
+        BOOST_CHECK(frame.getMediaType() == sfe::Video);
+        BOOST_CHECK(frame.getSize().x > 0 && frame.getSize().y > 0);
+        BOOST_CHECK(frame.getData(0) != nullptr);
+        
+        if (! positions.empty())
+            BOOST_CHECK(frame.getPosition() > positions.back());
+        
+        positions.push_back(frame.getPosition());
+    }
+    
+    BOOST_REQUIRE(positions.size() > 10);
+    
+    // Every other frame from the beginning
+    BOOST_REQUIRE(reader.seek(sf::Time::Zero));
+    reader.setStride(2);
+    
+    std::vector<sf::Time> stridedPositions;
+    for (const sfe::MediaFrame& frame : reader)
+        stridedPositions.push_back(frame.getPosition());
+    
+    BOOST_CHECK(stridedPositions.size() == (positions.size() + 1) / 2);
+    BOOST_CHECK(stridedPositions[1] == positions[2]);
+    
+    // Frames before the seek position are never given
+    const sf::Time middle = positions[positions.size() / 2];
+    reader.setStride(1);
+    BOOST_REQUIRE(reader.seek(middle));
+    
+    sfe::MediaFrame frame;
+    BOOST_REQUIRE(reader.readFrame(frame));
+    BOOST_CHECK(frame.getPosition() >= middle);
+}
+
+BOOST_AUTO_TEST_CASE(FrameReaderTestAudio)
+{
+    sfe::FrameReader reader;
+    // Free codecs only, see DemuxerShortMP3Test
+    BOOST_REQUIRE(reader.open("small_3.flac", sfe::Audio));
+    
+    sfe::MediaFrame frame;
+    BOOST_REQUIRE(reader.readFrame(frame));
+    BOOST_CHECK(frame.getMediaType() == sfe::Audio);
+    BOOST_CHECK(frame.getSampleCount() > 0);
+    BOOST_CHECK(frame.getChannelCount() > 0);
+    BOOST_CHECK(frame.getSampleRate() > 0);
+    
+    // The frame data outlives the following reads
+    sfe::MediaFrame kept = frame;
+    BOOST_REQUIRE(reader.readFrame(frame));
+    BOOST_CHECK(kept.getData(0) != nullptr);
+    BOOST_CHECK(kept.getPosition() < frame.getPosition());
+}
+
+BOOST_AUTO_TEST_CASE(FrameReaderTestKeyFrames)
+{
+    sfe::FrameReader reader;
+    BOOST_REQUIRE(reader.open("small_1.ogv"));
+    
+    unsigned int frameCount = 0;
+    for (sfe::FrameReader::Iterator it = reader.begin(); it != reader.end(); ++it)
+        frameCount++;
+    
+    BOOST_REQUIRE(reader.seek(sf::Time::Zero));
+    reader.setKeyFramesOnly(true);
+    
+    std::vector<sf::Time> keyFramePositions;
+    for (const sfe::MediaFrame& frame : reader)
+        keyFramePositions.push_back(frame.getPosition());
+    
+    BOOST_CHECK(! keyFramePositions.empty());
+    BOOST_CHECK(keyFramePositions.size() < frameCount);
+    
+    // Seeking lands on the last key frame before the position
+    const sf::Time position = reader.getDuration() / 2.f;
+    BOOST_REQUIRE(reader.seek(position));
+    
+    sfe::MediaFrame frame;
+    BOOST_REQUIRE(reader.readFrame(frame));
+    BOOST_CHECK(frame.getPosition() <= position);
+}
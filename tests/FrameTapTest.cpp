@@ -0,0 +1,132 @@
+
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_MODULE FrameTapTest
+#include <boost/test/unit_test.hpp>
+#include "FastDecodeFile.hpp"
+#include "FrameCache.hpp"
+#include "TestHelpers.hpp"
+#include <cstdio>
+#include <fstream>
+#include <vector>
+
+using namespace sfe::test;
+
+namespace
+{
+    /** Records the video frames given to a frame tap
+     */
+    class TappedFrames
+    {
+    public:
+        void tap(const sfe::MediaFrame& frame)
+        {
+            BOOST_CHECK(frame.getMediaType() == sfe::Video);
+            BOOST_CHECK(frame.getData(0) != nullptr);
+            
+            if (frame.getFormat() == AV_PIX_FMT_RGBA)
+                m_convertedPositions.push_back(frame.getPosition());
+            else
+                m_decodedPositions.push_back(frame.getPosition());
+            
+            m_lastFrame = frame;
+        }
+        
+        // Frames from the decoder, and frames already converted to RGBA by the frame cache or a fast decode file
+        std::vector<sf::Time> m_decodedPositions;
+        std::vector<sf::Time> m_convertedPositions;
+        sfe::MediaFrame m_lastFrame;
+    };
+    
+    void setTap(sfe::VideoStream& videoStream, TappedFrames& frames)
+    {
+        videoStream.setFrameTap([&frames](const sfe::MediaFrame& frame) { frames.tap(frame); });
+    }
+}
+
+BOOST_AUTO_TEST_CASE(FrameTapTestCachedFrames)
+{
+    DummyDelegate delegate;
+    sfe::FrameCache::setBudget(256 * 1024 * 1024);
+    
+    std::shared_ptr<sfe::ManualClock> clock = std::make_shared<sfe::ManualClock>();
+    std::shared_ptr<sfe::Timer> timer = std::make_shared<sfe::Timer>(clock);
+    std::shared_ptr<sfe::Demuxer> demuxer = std::make_shared<sfe::Demuxer>("small_1.ogv", timer, delegate);
+    demuxer->selectFirstVideoStream();
+    
+    std::shared_ptr<sfe::VideoStream> videoStream = demuxer->getSelectedVideoStream();
+    BOOST_REQUIRE(videoStream != nullptr);
+    
+    TappedFrames frames;
+    setTap(*videoStream, frames);
+    
+    // The first pass gives every decoded frame
+    BOOST_CHECK(playVideoToEnd(*demuxer, *timer, *clock));
+    BOOST_CHECK(frames.m_decodedPositions.size() > 0);
+    BOOST_CHECK(frames.m_convertedPositions.empty());
+    
+    // The second pass plays the cached frames, which are given as they are shown
+    BOOST_REQUIRE(! videoStream->usesPackets());
+    const std::size_t decodedCount = frames.m_decodedPositions.size();
+    BOOST_CHECK(playVideoToEnd(*demuxer, *timer, *clock));
+    
+    BOOST_CHECK(frames.m_decodedPositions.size() == decodedCount);
+    BOOST_CHECK(frames.m_convertedPositions == frames.m_decodedPositions);
+    
+    // The cached pixels are given without copy, as a packed RGBA image
+    const sf::Vector2i frameSize(videoStream->getFrameSize().x, videoStream->getFrameSize().y);
+    BOOST_CHECK(frames.m_lastFrame.getSize() == frameSize);
+    BOOST_CHECK(frames.m_lastFrame.getLineSize(0) == frameSize.x * 4);
+    BOOST_CHECK(frames.m_lastFrame.getData(0) != nullptr);
+    
+    // Without tap, nothing is given anymore
+    videoStream->setFrameTap(nullptr);
+    frames.m_convertedPositions.clear();
+    BOOST_CHECK(playVideoToEnd(*demuxer, *timer, *clock));
+    BOOST_CHECK(frames.m_convertedPositions.empty());
+    
+    sfe::FrameCache::setBudget(0);
+}
+
+BOOST_AUTO_TEST_CASE(FrameTapTestFastDecodeFile)
+{
+    // Work on a copy, so that the other tests keep decoding the original media
+    const std::string mediaFile = "frame_tap_1.ogv";
+    {
+        std::ifstream source("small_1.ogv", std::ios::binary);
+        std::ofstream destination(mediaFile.c_str(), std::ios::binary | std::ios::trunc);
+        destination << source.rdbuf();
+    }
+    
+    BOOST_REQUIRE(sfe::Movie::createFastDecodeFile(mediaFile));
+    
+    sfe::FastDecodeFile file;
+    BOOST_REQUIRE(file.open(mediaFile));
+    sfe::Movie::setFastDecodeFilesEnabled(true);
+    
+    {
+        DummyDelegate delegate;
+        std::shared_ptr<sfe::ManualClock> clock = std::make_shared<sfe::ManualClock>();
+        std::shared_ptr<sfe::Timer> timer = std::make_shared<sfe::Timer>(clock);
+        sfe::Demuxer demuxer(mediaFile, timer, delegate);
+        demuxer.selectFirstVideoStream();
+        
+        std::shared_ptr<sfe::VideoStream> videoStream = demuxer.getSelectedVideoStream();
+        BOOST_REQUIRE(videoStream != nullptr);
+        BOOST_REQUIRE(! videoStream->usesPackets());
+        
+        TappedFrames frames;
+        setTap(*videoStream, frames);
+        BOOST_CHECK(playVideoToEnd(demuxer, *timer, *clock));
+        
+        // Every frame of the file is shown once, none is decoded
+        BOOST_CHECK(frames.m_decodedPositions.empty());
+        BOOST_REQUIRE(frames.m_convertedPositions.size() == file.getFrameCount());
+        
+        for (std::size_t i = 0; i < file.getFrameCount(); i++)
+            BOOST_CHECK(frames.m_convertedPositions[i] == file.getFramePosition(i));
+    }
+    
+    sfe::Movie::setFastDecodeFilesEnabled(false);
+    std::remove(sfe::FastDecodeFile::pathFor(mediaFile).c_str());
+    std::remove(mediaFile.c_str());
+}
@@ -0,0 +1,54 @@
+
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_MODULE PacketCacheTest
+#include <boost/test/unit_test.hpp>
+#include "TestHelpers.hpp"
+
+using namespace sfe::test;
+
+namespace
+{
+    /** Play until the video stream ends and return the number of displayed frames
+     */
+    unsigned int playToEnd(sfe::Demuxer& demuxer, sfe::Timer& timer, sfe::ManualClock& clock, CountingDelegate& delegate)
+    {
+        const unsigned int initialFrameCount = delegate.m_frameCount;
+        playVideoToEnd(demuxer, timer, clock);
+        return delegate.m_frameCount - initialFrameCount;
+    }
+}
+
+BOOST_AUTO_TEST_CASE(PacketCacheTestReplay)
+{
+    CountingDelegate delegate;
+    std::shared_ptr<sfe::ManualClock> clock = std::make_shared<sfe::ManualClock>();
+    std::shared_ptr<sfe::Timer> timer = std::make_shared<sfe::Timer>(clock);
+    sfe::Demuxer demuxer("small_1.ogv", timer, delegate);
+    demuxer.selectFirstVideoStream();
+    
+    BOOST_REQUIRE(demuxer.loadPacketCache(64 * 1024 * 1024));
+    BOOST_CHECK(demuxer.hasPacketCache());
+    
+    // Replaying reads the same packets from memory again
+    const unsigned int firstPassFrameCount = playToEnd(demuxer, *timer, *clock, delegate);
+    BOOST_CHECK(firstPassFrameCount > 0);
+    BOOST_CHECK_EQUAL(playToEnd(demuxer, *timer, *clock, delegate), firstPassFrameCount);
+    
+    // Seeking restarts from the key frame before the target
+    BOOST_CHECK(timer->seek(sf::seconds(1)));
+    BOOST_CHECK(playToEnd(demuxer, *timer, *clock, delegate) < firstPassFrameCount);
+}
+
+BOOST_AUTO_TEST_CASE(PacketCacheTestTooLarge)
+{
+    CountingDelegate delegate;
+    std::shared_ptr<sfe::ManualClock> clock = std::make_shared<sfe::ManualClock>();
+    std::shared_ptr<sfe::Timer> timer = std::make_shared<sfe::Timer>(clock);
+    sfe::Demuxer demuxer("small_1.ogv", timer, delegate);
+    demuxer.selectFirstVideoStream();
+    
+    // The media is read from its beginning as if nothing happened
+    BOOST_CHECK(! demuxer.loadPacketCache(1024));
+    BOOST_CHECK(! demuxer.hasPacketCache());
+    BOOST_CHECK(playToEnd(demuxer, *timer, *clock, delegate) > 0);
+}
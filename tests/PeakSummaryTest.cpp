@@ -0,0 +1,115 @@
+
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_MODULE PeakSummaryTest
+#include <boost/test/unit_test.hpp>
+#include <sfeMovie/Movie.hpp>
+#include "PeakSummaryImpl.hpp"
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <limits>
+#include <random>
+#include <vector>
+
+namespace
+{
+    typedef sfe::PeakSummaryImpl::SampleAccumulator SampleAccumulator;
+    
+    /** Same reduction as PeakSummaryImpl::reduceSamples(), one sample at a time
+     */
+    void reduceSamplesReference(const sf::Int16* samples, std::size_t samplesCount, SampleAccumulator& accumulator)
+    {
+        for (std::size_t i = 0; i < samplesCount; i++)
+        {
+            const int64_t value = samples[i];
+            accumulator.minimum = std::min(accumulator.minimum, samples[i]);
+            accumulator.maximum = std::max(accumulator.maximum, samples[i]);
+            accumulator.sumSquares += static_cast<uint64_t>(value * value);
+        }
+        
+        accumulator.samplesCount += samplesCount;
+    }
+    
+    bool operator==(const SampleAccumulator& left, const SampleAccumulator& right)
+    {
+        return left.minimum == right.minimum && left.maximum == right.maximum &&
+               left.sumSquares == right.sumSquares && left.samplesCount == right.samplesCount;
+    }
+}
+
+BOOST_AUTO_TEST_CASE(PeakSummaryTestReduceSamples)
+{
+    std::mt19937 generator(42);
+    std::uniform_int_distribution<int> distribution(std::numeric_limits<sf::Int16>::min(),
+                                                    std::numeric_limits<sf::Int16>::max());
+    std::vector<sf::Int16> samples(1024);
+    
+    for (sf::Int16& sample : samples)
+        sample = static_cast<sf::Int16>(distribution(generator));
+    
+    // The extreme values, whose squares overflow signed 32 bits integers once summed by pair
+    std::fill(samples.begin() + 64, samples.begin() + 80, std::numeric_limits<sf::Int16>::min());
+    std::fill(samples.begin() + 80, samples.begin() + 96, std::numeric_limits<sf::Int16>::max());
+    
+    // Unaligned starts and lengths that leave a scalar remainder after the vectorized part
+    for (std::size_t offset = 0; offset < 8; offset++)
+    {
+        for (std::size_t count = 0; offset + count <= samples.size(); count += 1 + count / 4)
+        {
+            SampleAccumulator reduced;
+            SampleAccumulator reference;
+            sfe::PeakSummaryImpl::reduceSamples(&samples[offset], count, reduced);
+            reduceSamplesReference(&samples[offset], count, reference);
+            
+            // Continuing from a previous reduction
+            sfe::PeakSummaryImpl::reduceSamples(&samples[0], offset, reduced);
+            reduceSamplesReference(&samples[0], offset, reference);
+            
+            BOOST_CHECK_MESSAGE(reduced == reference, "different reduction of " << count
+                                << " samples at offset " << offset);
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(PeakSummaryTestFinestLevel)
+{
+    sfe::Movie movie;
+    BOOST_REQUIRE(movie.openFromFile("long_1.wav"));
+    
+    std::vector<sf::Int16> samples;
+    BOOST_REQUIRE(movie.decodeAudio(samples));
+    BOOST_REQUIRE(! samples.empty());
+    
+    std::shared_ptr<const sfe::PeakSummary> summary = movie.getPeakSummary();
+    BOOST_REQUIRE(summary);
+    
+    for (sf::Clock clock; ! summary->isComplete() && clock.getElapsedTime() < sf::seconds(20);)
+        sf::sleep(sf::milliseconds(10));
+    
+    BOOST_REQUIRE(summary->isComplete());
+    
+    // The level 0 peaks match the decoded samples reduced one by one
+    const std::size_t samplesPerPeak = summary->getSamplesPerPeak(0) * movie.getChannelCount();
+    const std::vector<sfe::Peak> peaks = summary->getPeaks(0);
+    BOOST_REQUIRE(peaks.size() == (samples.size() + samplesPerPeak - 1) / samplesPerPeak);
+    
+    bool samePeaks = true;
+    
+    for (std::size_t i = 0; i < peaks.size(); i++)
+    {
+        const std::size_t begin = i * samplesPerPeak;
+        const std::size_t count = std::min(samplesPerPeak, samples.size() - begin);
+        SampleAccumulator reference;
+        reduceSamplesReference(&samples[begin], count, reference);
+        
+        const float rms = static_cast<float>(std::sqrt(static_cast<double>(reference.sumSquares) / count) / 32768.0);
+        samePeaks = samePeaks && peaks[i].minimum == reference.minimum / 32768.f
+                              && peaks[i].maximum == reference.maximum / 32768.f
+                              && std::fabs(peaks[i].rms - rms) <= 1e-4f;
+    }
+    
+    BOOST_CHECK(samePeaks);
+    
+    // The disk cache is opt-in, so nothing is written next to the media by default
+    BOOST_CHECK(! std::ifstream("long_1.wav.sfepeaks"));
+}
@@ -0,0 +1,127 @@
+
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_MODULE PlaylistTest
+#include <boost/test/unit_test.hpp>
+#include <sfeMovie/Playlist.hpp>
+#include "TestHelpers.hpp"
+#include <algorithm>
+#include <vector>
+
+using namespace sfe::test;
+
+namespace
+{
+    /** Update @a playlist in real time until @a condition is met or @a timeout elapsed
+     *
+     * @return true if the condition was met
+     */
+    template <typename Condition>
+    bool updateUntil(sfe::Playlist& playlist, sf::Time timeout, Condition condition)
+    {
+        for (sf::Clock clock; clock.getElapsedTime() < timeout;)
+        {
+            sf::sleep(StepDuration);
+            playlist.update();
+            
+            if (condition())
+                return true;
+        }
+        
+        return false;
+    }
+}
+
+BOOST_AUTO_TEST_CASE(PlaylistTestLoop)
+{
+    // The missing media in the middle is skipped, the short last one keeps the test fast.
+    // Free codecs only, see DemuxerShortMP3Test
+    sfe::Playlist playlist;
+    playlist.add("small_1.ogv");
+    playlist.add("non-existing-file.ogv");
+    playlist.add("small_4.wav");
+    playlist.setLoop(true);
+    
+    BOOST_CHECK(playlist.getItemCount() == 3);
+    BOOST_CHECK(playlist.getCurrentItem() == 3);
+    BOOST_CHECK(playlist.getStatus() == sfe::Stopped);
+    
+    // Record each media start until the playlist wrapped around
+    std::vector<std::size_t> startedItems;
+    const sfe::Movie* startedMovie = nullptr;
+    bool stopped = false;
+    playlist.play();
+    
+    updateUntil(playlist, sf::seconds(20), [&]()
+    {
+        stopped = stopped || playlist.getStatus() != sfe::Playing;
+        
+        if (playlist.getCurrentItem() < playlist.getItemCount() && &playlist.getCurrentMovie() != startedMovie)
+        {
+            startedMovie = &playlist.getCurrentMovie();
+            startedItems.push_back(playlist.getCurrentItem());
+        }
+        
+        return startedItems.size() == 3;
+    });
+    
+    BOOST_CHECK(! stopped);
+    BOOST_REQUIRE(startedItems.size() == 3);
+    BOOST_CHECK(startedItems[0] == 0);
+    BOOST_CHECK(startedItems[1] == 2);
+    BOOST_CHECK(startedItems[2] == 0);
+    
+    // Stopping goes back to the first media, which is prepared again
+    playlist.stop();
+    BOOST_CHECK(playlist.getStatus() == sfe::Stopped);
+    BOOST_CHECK(playlist.getItemCount() == 3);
+    BOOST_CHECK(playlist.getCurrentItem() == 3);
+    BOOST_CHECK(playlist.getLoop());
+    
+    playlist.play();
+    BOOST_CHECK(updateUntil(playlist, sf::seconds(5), [&]() { return playlist.getCurrentItem() == 0; }));
+    BOOST_CHECK(playlist.getStatus() == sfe::Playing);
+    playlist.stop();
+}
+
+BOOST_AUTO_TEST_CASE(PlaylistTestNothingToPlay)
+{
+    sfe::Playlist playlist;
+    playlist.add("non-existing-file.ogv");
+    playlist.play();
+    
+    // The only media fails to open, so the playlist ends without starting anything
+    BOOST_CHECK(updateUntil(playlist, sf::seconds(5), [&]() { return playlist.getStatus() == sfe::Stopped; }));
+    BOOST_CHECK(playlist.getCurrentItem() == playlist.getItemCount());
+}
+
+BOOST_AUTO_TEST_CASE(PlaylistTestGapless)
+{
+    // The application sleeps as long as getTimeUntilNextFrame() allows, the switch must not wait for another update
+    sfe::Playlist playlist;
+    playlist.add("small_4.wav");
+    playlist.add("small_4.wav");
+    playlist.play();
+    
+    BOOST_REQUIRE(updateUntil(playlist, sf::seconds(5), [&]() { return playlist.getCurrentItem() == 0; }));
+    
+    const sfe::Movie* firstMovie = &playlist.getCurrentMovie();
+    const sf::Time duration = firstMovie->getDuration();
+    sf::Time offsetBeforeSwitch;
+    
+    for (sf::Clock clock; &playlist.getCurrentMovie() == firstMovie && clock.getElapsedTime() < duration + sf::seconds(5);)
+    {
+        sf::sleep(std::min(playlist.getTimeUntilNextFrame(), sf::seconds(1)));
+        offsetBeforeSwitch = firstMovie->getPlayingOffset();
+        playlist.update();
+    }
+    
+    BOOST_REQUIRE(playlist.getCurrentItem() == 1);
+    BOOST_TEST_MESSAGE("switched " << (duration - offsetBeforeSwitch).asMicroseconds() << "us before the end");
+    
+    // Sleeping is only precise to a few milliseconds
+    BOOST_CHECK(offsetBeforeSwitch <= duration + sf::milliseconds(5));
+    BOOST_CHECK(offsetBeforeSwitch >= duration - sf::milliseconds(20));
+    BOOST_CHECK(playlist.getCurrentMovie().getStatus() == sfe::Playing);
+    
+    playlist.stop();
+}
@@ -0,0 +1,113 @@
+
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_MODULE SubtitleStreamTest
+#include <boost/test/unit_test.hpp>
+#include "TestHelpers.hpp"
+#include <SFML/Graphics.hpp>
+#include <cstdlib>
+
+using namespace sfe::test;
+
+namespace
+{
+    /** Pixels of the rendered subtitles, in the top and bottom halves of the overlay
+     */
+    struct PixelCount
+    {
+        unsigned int top;
+        unsigned int bottom;
+    };
+    
+    /** Count the opaque pixels of @a image whose color is close to @a color
+     */
+    PixelCount countPixels(const sf::Image& image, sf::Color color)
+    {
+        PixelCount count = { 0, 0 };
+        
+        for (unsigned int y = 0; y < image.getSize().y; y++)
+        {
+            for (unsigned int x = 0; x < image.getSize().x; x++)
+            {
+                const sf::Color pixel = image.getPixel(x, y);
+                
+                if (pixel.a > 200 && std::abs(pixel.r - color.r) < 60 && std::abs(pixel.g - color.g) < 60 &&
+                    std::abs(pixel.b - color.b) < 60)
+                {
+                    if (y < image.getSize().y / 2)
+                        count.top++;
+                    else
+                        count.bottom++;
+                }
+            }
+        }
+        
+        return count;
+    }
+    
+    /** Update @a stream until the timer reaches @a position
+     */
+    void playUntil(sfe::SubtitleStream& stream, sfe::Timer& timer, sfe::ManualClock& clock, sf::Time position)
+    {
+        while (timer.getOffset() < position)
+        {
+            clock.advance(StepDuration);
+            stream.update();
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(SubtitleStreamTestStyledEvents)
+{
+    PacketSource source("subtitles_1.ass");
+    AVStream** ffstream = source.findStream(AVMEDIA_TYPE_SUBTITLE);
+    BOOST_REQUIRE(ffstream);
+    
+    std::shared_ptr<sfe::ManualClock> clock = std::make_shared<sfe::ManualClock>();
+    std::shared_ptr<sfe::Timer> timer = std::make_shared<sfe::Timer>(clock);
+    sfe::SubtitleStream stream(source.getFormatContext(), *ffstream, source, timer);
+    source.feed(stream, *ffstream);
+    timer->play();
+    
+    // The overlay is only created once a subtitle is displayed
+    playUntil(stream, *timer, *clock, sf::milliseconds(250));
+    BOOST_CHECK(! stream.hasVisibleSubtitles());
+    BOOST_CHECK(stream.getOverlay().getSize() == sf::Vector2u(0, 0));
+    
+    // Default style: white text with a black outline, at the bottom of the 1280x720 overlay of media without video
+    playUntil(stream, *timer, *clock, sf::seconds(1));
+    BOOST_REQUIRE(stream.hasVisibleSubtitles());
+    BOOST_REQUIRE(stream.getOverlay().getSize() == sf::Vector2u(1280, 720));
+    
+    sf::Image overlay = stream.getOverlay().copyToImage();
+    PixelCount white = countPixels(overlay, sf::Color::White);
+    PixelCount black = countPixels(overlay, sf::Color::Black);
+    BOOST_CHECK(white.top == 0 && white.bottom > 0);
+    BOOST_CHECK(black.top == 0 && black.bottom > 0);
+    
+    // Title style: larger yellow text at the top, without outline
+    playUntil(stream, *timer, *clock, sf::seconds(3));
+    BOOST_REQUIRE(stream.hasVisibleSubtitles());
+    
+    overlay = stream.getOverlay().copyToImage();
+    const PixelCount yellow = countPixels(overlay, sf::Color::Yellow);
+    white = countPixels(overlay, sf::Color::White);
+    black = countPixels(overlay, sf::Color::Black);
+    BOOST_CHECK(yellow.top > 0 && yellow.bottom == 0);
+    BOOST_CHECK(yellow.top > white.top + white.bottom);
+    BOOST_CHECK(black.top + black.bottom == 0);
+    
+    // Inline override of the color of the Default style
+    playUntil(stream, *timer, *clock, sf::seconds(5));
+    BOOST_REQUIRE(stream.hasVisibleSubtitles());
+    
+    overlay = stream.getOverlay().copyToImage();
+    const PixelCount red = countPixels(overlay, sf::Color::Red);
+    white = countPixels(overlay, sf::Color::White);
+    BOOST_CHECK(red.top == 0 && red.bottom > 0);
+    BOOST_CHECK(white.top + white.bottom == 0);
+    
+    playUntil(stream, *timer, *clock, sf::seconds(7));
+    BOOST_CHECK(! stream.hasVisibleSubtitles());
+    
+    timer->stop();
+}
@@ -0,0 +1,156 @@
+
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_MODULE TensorReaderTest
+#include <boost/test/unit_test.hpp>
+#include <sfeMovie/TensorReader.hpp>
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace
+{
+    const unsigned int Width = 37;
+    const unsigned int Height = 21;
+    const unsigned int BatchSize = 4;
+    const std::size_t PixelCount = Width * Height;
+    
+    // Different for each channel, so that a value normalized with the parameters of another channel is noticed
+    const float Mean[3] = { 0.485f, 0.2f, 0.75f };
+    const float Deviation[3] = { 0.229f, 0.5f, 0.125f };
+    
+    /** Read the first batch of small_1.ogv
+     *
+     * @param normalized true to use Mean and Deviation, false to get the values in range [0, 1]
+     */
+    std::vector<float> readFirstBatch(sfe::TensorFormat::Layout layout, bool normalized,
+                                      std::vector<sf::Time>* positions = nullptr)
+    {
+        sfe::TensorFormat format;
+        format.width = Width;
+        format.height = Height;
+        format.layout = layout;
+    
+        if (normalized)
+        {
+            std::copy(Mean, Mean + 3, format.mean);
+            std::copy(Deviation, Deviation + 3, format.deviation);
+        }
+    
+        sfe::TensorReader reader;
+        BOOST_REQUIRE(reader.open("small_1.ogv", format, BatchSize));
+        BOOST_REQUIRE(reader.getBatchElementCount() == BatchSize * 3 * PixelCount);
+    
+        std::vector<float> batch(reader.getBatchElementCount());
+        BOOST_REQUIRE(reader.readBatch(batch.data(), positions) == BatchSize);
+        return batch;
+    }
+    
+    /** Index of a channel value in a batch of the given @a layout
+     */
+    std::size_t indexOf(sfe::TensorFormat::Layout layout, std::size_t image, std::size_t pixel, std::size_t channel)
+    {
+        if (layout == sfe::TensorFormat::NCHW)
+            return image * 3 * PixelCount + channel * PixelCount + pixel;
+        else
+            return image * 3 * PixelCount + pixel * 3 + channel;
+    }
+    
+    /** Check that the normalized batch matches the values of the 8-bit image, normalized one by one
+     */
+    void checkNormalization(sfe::TensorFormat::Layout layout)
+    {
+        const std::vector<float> unit = readFirstBatch(layout, false);
+        const std::vector<float> normalized = readFirstBatch(layout, true);
+        bool inRange = true;
+        bool sameValues = true;
+        
+        for (std::size_t image = 0; image < BatchSize; image++)
+        {
+            for (std::size_t pixel = 0; pixel < PixelCount; pixel++)
+            {
+                for (std::size_t channel = 0; channel < 3; channel++)
+                {
+                    const std::size_t index = indexOf(layout, image, pixel, channel);
+                    const float level = std::round(unit[index] * 255.f);
+                    const float reference = (level / 255.f - Mean[channel]) / Deviation[channel];
+                    
+                    inRange = inRange && unit[index] >= 0.f && unit[index] <= 1.f;
+                    sameValues = sameValues && std::fabs(normalized[index] - reference) <= 1e-4f;
+                }
+            }
+        }
+        
+        BOOST_CHECK(inRange);
+        BOOST_CHECK_MESSAGE(sameValues, "normalization mismatch for layout " << layout);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(TensorReaderTestLayouts)
+{
+    sfe::TensorFormat format;
+    sfe::TensorReader reader;
+    BOOST_CHECK(reader.open("small_1.ogv", format, 0) == false);
+    
+    std::vector<sf::Time> positions;
+    const std::vector<float> planar = readFirstBatch(sfe::TensorFormat::NCHW, false, &positions);
+    const std::vector<float> interleaved = readFirstBatch(sfe::TensorFormat::NHWC, false);
+    BOOST_CHECK(positions.size() == BatchSize && positions[0] < positions[BatchSize - 1]);
+    
+    // Both layouts hold the same images, only ordered differently. The conversions to packed
+    // and planar RGB may round differently, hence the tolerance of 2 levels out of 255
+    bool sameValues = true;
+    
+    for (std::size_t image = 0; image < BatchSize; image++)
+    {
+        for (std::size_t pixel = 0; pixel < PixelCount; pixel++)
+        {
+            for (std::size_t channel = 0; channel < 3; channel++)
+            {
+                const float planarValue = planar[indexOf(sfe::TensorFormat::NCHW, image, pixel, channel)];
+                const float interleavedValue = interleaved[indexOf(sfe::TensorFormat::NHWC, image, pixel, channel)];
+                sameValues = sameValues && std::fabs(planarValue - interleavedValue) <= 2.f / 255.f + 1e-5f;
+            }
+        }
+    }
+    
+    BOOST_CHECK(sameValues);
+}
+
+BOOST_AUTO_TEST_CASE(TensorReaderTestNormalization)
+{
+    checkNormalization(sfe::TensorFormat::NCHW);
+    checkNormalization(sfe::TensorFormat::NHWC);
+}
+
+BOOST_AUTO_TEST_CASE(TensorReaderTestEndOfStream)
+{
+    sfe::TensorFormat format;
+    format.width = 16;
+    format.height = 16;
+    
+    sfe::TensorReader reader;
+    BOOST_REQUIRE(reader.open("small_1.ogv", format, 64));
+    
+    std::vector<float> batch(reader.getBatchElementCount());
+    unsigned int imageCount = 0;
+    unsigned int batchCount = 0;
+    
+    while (unsigned int count = reader.readBatch(batch.data()))
+    {
+        imageCount += count;
+        batchCount++;
+    }
+    
+    BOOST_CHECK(imageCount > 0);
+    BOOST_CHECK(batchCount == (imageCount + 63) / 64);
+    BOOST_CHECK(reader.readBatch(batch.data()) == 0);
+    
+    // Reading again from the beginning gives the same images
+    BOOST_REQUIRE(reader.seek(sf::Time::Zero));
+    unsigned int secondImageCount = 0;
+    
+    while (unsigned int count = reader.readBatch(batch.data()))
+        secondImageCount += count;
+    
+    BOOST_CHECK(secondImageCount == imageCount);
+}
@@ -0,0 +1,174 @@
+
+#ifndef SFEMOVIE_TESTHELPERS_HPP
+#define SFEMOVIE_TESTHELPERS_HPP
+
+#include "Demuxer.hpp"
+#include "Timer.hpp"
+#include <sfeMovie/Clock.hpp>
+#include <SFML/System.hpp>
+#include <stdexcept>
+#include <string>
+
+/** Helpers shared by the tests that drive a Demuxer from a ManualClock
+ */
+namespace sfe
+{
+    namespace test
+    {
+        class DummyDelegate : public VideoStream::Delegate
+        {
+        public:
+            void didUpdateVideo(const VideoStream& sender, const sf::Texture& image)
+            {
+            }
+        };
+        
+        class CountingDelegate : public VideoStream::Delegate
+        {
+        public:
+            CountingDelegate() :
+            m_frameCount(0)
+            {
+            }
+            
+            void didUpdateVideo(const VideoStream& sender, const sf::Texture& image)
+            {
+                m_frameCount++;
+            }
+            
+            unsigned int m_frameCount;
+        };
+        
+        /** Reads a media without a Demuxer, to give all its packets at once to a stream
+         *
+         * Passive streams like SubtitleStream only get the packets read for the other streams, this
+         * lets them be tested on medias that have no other stream
+         */
+        class PacketSource : public Stream::DataSource
+        {
+        public:
+            PacketSource(const std::string& filename) :
+            m_formatCtx(nullptr)
+            {
+                if (avformat_open_input(&m_formatCtx, filename.c_str(), nullptr, nullptr) != 0 ||
+                    avformat_find_stream_info(m_formatCtx, nullptr) < 0)
+                    throw std::runtime_error("PacketSource - unable to open " + filename);
+            }
+            
+            ~PacketSource()
+            {
+                avformat_close_input(&m_formatCtx);
+            }
+            
+            AVFormatContext*& getFormatContext()
+            {
+                return m_formatCtx;
+            }
+            
+            /** @return the first stream of the given FFmpeg media type, or nullptr if there is none
+             */
+            AVStream** findStream(AVMediaType type)
+            {
+                for (unsigned int i = 0; i < m_formatCtx->nb_streams; i++)
+                {
+                    if (m_formatCtx->streams[i]->codecpar->codec_type == type)
+                        return &m_formatCtx->streams[i];
+                }
+                
+                return nullptr;
+            }
+            
+            /** Read the whole media and give the packets of @a ffstream to @a stream
+             */
+            void feed(Stream& stream, const AVStream* ffstream)
+            {
+                AVPacket* packet = allocatePacket();
+                
+                while (av_read_frame(m_formatCtx, packet) == 0)
+                {
+                    if (packet->stream_index == ffstream->index)
+                    {
+                        stream.pushEncodedData(packet);
+                        packet = allocatePacket();
+                    }
+                    else
+                    {
+                        av_packet_unref(packet);
+                    }
+                }
+                
+                recyclePacket(packet);
+            }
+            
+            void requestMoreData(Stream& starvingStream)
+            {
+            }
+            
+            void resetEndOfFileStatus()
+            {
+            }
+            
+            AVPacket* allocatePacket()
+            {
+                return av_packet_alloc();
+            }
+            
+            void recyclePacket(AVPacket* packet)
+            {
+                av_packet_free(&packet);
+            }
+            
+        private:
+            AVFormatContext* m_formatCtx;
+        };
+        
+        /** How much the manual clock is advanced between two updates, like a 100 Hz rendering loop
+         */
+        const sf::Time StepDuration = sf::milliseconds(10);
+        
+        /** Advance @a clock by @a duration, updating @a demuxer after each step
+         */
+        inline void playFor(Demuxer& demuxer, ManualClock& clock, sf::Time duration)
+        {
+            for (sf::Time elapsed; elapsed < duration; elapsed += StepDuration)
+            {
+                clock.advance(StepDuration);
+                demuxer.update();
+            }
+        }
+        
+        /** Update @a demuxer at the pace of the rendering loop while it plays in real time for @a duration
+         */
+        inline void playInRealTime(Demuxer& demuxer, sf::Time duration)
+        {
+            for (sf::Clock clock; clock.getElapsedTime() < duration;)
+            {
+                sf::sleep(StepDuration);
+                demuxer.update();
+            }
+        }
+        
+        /** Play the selected video stream of @a demuxer until it ends, then stop @a timer
+         *
+         * @return true if the video stream ended within @a timeout, false otherwise
+         */
+        inline bool playVideoToEnd(Demuxer& demuxer, Timer& timer, ManualClock& clock,
+                                   sf::Time timeout = sf::seconds(20))
+        {
+            std::shared_ptr<VideoStream> videoStream = demuxer.getSelectedVideoStream();
+            timer.play();
+            
+            for (sf::Time elapsed; elapsed < timeout && videoStream->getStatus() == Playing; elapsed += StepDuration)
+            {
+                clock.advance(StepDuration);
+                demuxer.update();
+            }
+            
+            const bool ended = (videoStream->getStatus() == Stopped);
+            timer.stop();
+            return ended;
+        }
+    }
+}
+
+#endif
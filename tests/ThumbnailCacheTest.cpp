@@ -0,0 +1,242 @@
+
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_MODULE ThumbnailCacheTest
+#include <boost/test/unit_test.hpp>
+#include <sfeMovie/ThumbnailCache.hpp>
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#if defined(_WIN32)
+#include <sys/utime.h>
+#else
+#include <utime.h>
+#endif
+
+namespace
+{
+    // The cache is created in the working directory, next to a copy of the media that can be modified
+    const std::string CacheDirectory = ".";
+    const std::string IndexFile = "./thumbnails.sfeindex";
+    const std::string DataFile = "./thumbnails.sfedata";
+    const std::string MediaFile = "thumbnail_cache_1.ogv";
+    
+    const unsigned int ThumbnailCount = 3;
+    const sf::Vector2u ThumbnailSize(64, 0);
+    
+    std::vector<char> readFile(const std::string& path)
+    {
+        std::ifstream file(path.c_str(), std::ios::binary);
+        return std::vector<char>(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    }
+    
+    void writeFile(const std::string& path, const std::vector<char>& content)
+    {
+        std::ofstream file(path.c_str(), std::ios::binary | std::ios::trunc);
+        file.write(content.data(), content.size());
+    }
+    
+    /** Start from a fresh copy of the media and no cache files
+     */
+    void resetFiles()
+    {
+        std::remove(IndexFile.c_str());
+        std::remove(DataFile.c_str());
+        writeFile(MediaFile, readFile("small_1.ogv"));
+    }
+    
+    void removeFiles()
+    {
+        std::remove(IndexFile.c_str());
+        std::remove(DataFile.c_str());
+        std::remove(MediaFile.c_str());
+    }
+    
+    /** Extract the thumbnails of the media copy through a new cache, so that they are stored in the cache files
+     */
+    sfe::Thumbnails fillCache()
+    {
+        sfe::ThumbnailCache cache;
+        BOOST_REQUIRE(cache.open(CacheDirectory));
+        
+        sfe::Thumbnails thumbnails = cache.getThumbnails(MediaFile, ThumbnailCount, ThumbnailSize);
+        BOOST_REQUIRE(! thumbnails.empty());
+        return thumbnails;
+    }
+    
+    /** @return true if the thumbnails of the media copy are found by a newly opened cache
+     */
+    bool isCached()
+    {
+        sfe::ThumbnailCache cache;
+        sfe::Thumbnails thumbnails;
+        BOOST_REQUIRE(cache.open(CacheDirectory));
+        
+        return cache.findThumbnails(MediaFile, ThumbnailCount, ThumbnailSize, thumbnails);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(ThumbnailCacheTestRoundTrip)
+{
+    resetFiles();
+    const sfe::Thumbnails extracted = fillCache();
+    
+    // A new cache finds the stored thumbnails without decoding the media
+    sfe::ThumbnailCache cache;
+    BOOST_REQUIRE(cache.open(CacheDirectory));
+    
+    sfe::Thumbnails cached;
+    BOOST_REQUIRE(cache.findThumbnails(MediaFile, ThumbnailCount, ThumbnailSize, cached));
+    BOOST_REQUIRE(cached.size() == extracted.size());
+    
+    for (std::size_t i = 0; i < cached.size(); i++)
+    {
+        const sf::Vector2u size = cached[i].image.getSize();
+        BOOST_CHECK(cached[i].position == extracted[i].position);
+        BOOST_REQUIRE(size == extracted[i].image.getSize());
+        BOOST_CHECK(std::equal(cached[i].image.getPixelsPtr(), cached[i].image.getPixelsPtr() + 4 * size.x * size.y,
+                               extracted[i].image.getPixelsPtr()));
+    }
+    
+    // Other requests of the same media are other entries
+    BOOST_CHECK(! cache.findThumbnails(MediaFile, ThumbnailCount + 1, ThumbnailSize, cached));
+    BOOST_CHECK(! cache.findThumbnails(MediaFile, ThumbnailCount, sf::Vector2u(32, 0), cached));
+    
+    removeFiles();
+}
+
+BOOST_AUTO_TEST_CASE(ThumbnailCacheTestModifiedMedia)
+{
+    // A different size invalidates the entry
+    resetFiles();
+    fillCache();
+    BOOST_REQUIRE(isCached());
+    
+    {
+        std::ofstream media(MediaFile.c_str(), std::ios::binary | std::ios::app);
+        media.put(0);
+    }
+    
+    BOOST_CHECK(! isCached());
+    
+    // So does a different modification time, even with the same content
+    resetFiles();
+    fillCache();
+    BOOST_REQUIRE(isCached());
+    
+    struct stat status;
+    BOOST_REQUIRE(stat(MediaFile.c_str(), &status) == 0);
+    
+    struct utimbuf times;
+    times.actime = status.st_atime;
+    times.modtime = status.st_mtime - 3600;
+    BOOST_REQUIRE(utime(MediaFile.c_str(), &times) == 0);
+    
+    BOOST_CHECK(! isCached());
+    removeFiles();
+}
+
+BOOST_AUTO_TEST_CASE(ThumbnailCacheTestCorruptedFiles)
+{
+    // Truncated data: the record refers to missing thumbnails
+    resetFiles();
+    fillCache();
+    
+    std::vector<char> data = readFile(DataFile);
+    data.resize(data.size() / 2);
+    writeFile(DataFile, data);
+    BOOST_CHECK(! isCached());
+    
+    // The cache is still usable and extracts the thumbnails again
+    fillCache();
+    BOOST_CHECK(isCached());
+    
+    // Truncated index: the partially written record is ignored
+    resetFiles();
+    fillCache();
+    
+    std::vector<char> index = readFile(IndexFile);
+    index.pop_back();
+    writeFile(IndexFile, index);
+    BOOST_CHECK(! isCached());
+    
+    // Absurd thumbnail count: the thumbnailCount field of the only record, after the 16 bytes header,
+    // the 3 fingerprint fields and the 3 request fields
+    resetFiles();
+    fillCache();
+    
+    index = readFile(IndexFile);
+    const std::size_t thumbnailCountOffset = 16 + 3 * 8 + 3 * 4;
+    BOOST_REQUIRE(index.size() > thumbnailCountOffset + 4);
+    std::fill(index.begin() + thumbnailCountOffset, index.begin() + thumbnailCountOffset + 4, '\xff');
+    writeFile(IndexFile, index);
+    BOOST_CHECK(! isCached());
+    
+    // Invalid index header: the cache is reset
+    resetFiles();
+    fillCache();
+    
+    index = readFile(IndexFile);
+    index[0] = 'X';
+    writeFile(IndexFile, index);
+    BOOST_CHECK(! isCached());
+    BOOST_CHECK(readFile(DataFile).empty());
+    
+    removeFiles();
+}
+
+BOOST_AUTO_TEST_CASE(ThumbnailCacheTestMaxSize)
+{
+    // Each thumbnail of 64 pixels wide takes about 9KB, so that the third request doesn't fit next to the first two
+    const sf::Uint64 maxSize = 50000;
+    resetFiles();
+    
+    {
+        sfe::ThumbnailCache cache;
+        BOOST_REQUIRE(cache.open(CacheDirectory, maxSize));
+        
+        for (unsigned int count = 1; count <= 3; count++)
+        {
+            BOOST_REQUIRE(cache.getThumbnails(MediaFile, count, ThumbnailSize).size() == count);
+            BOOST_CHECK(readFile(DataFile).size() <= maxSize);
+        }
+        
+        // The oldest thumbnails were dropped to make room for the newest ones
+        sfe::Thumbnails thumbnails;
+        BOOST_CHECK(! cache.findThumbnails(MediaFile, 1, ThumbnailSize, thumbnails));
+        BOOST_CHECK(cache.findThumbnails(MediaFile, 3, ThumbnailSize, thumbnails));
+        BOOST_CHECK(thumbnails.size() == 3);
+    }
+    
+    // The compacted files are valid for another cache
+    {
+        sfe::ThumbnailCache cache;
+        sfe::Thumbnails thumbnails;
+        BOOST_REQUIRE(cache.open(CacheDirectory, maxSize));
+        BOOST_CHECK(cache.findThumbnails(MediaFile, 3, ThumbnailSize, thumbnails));
+    }
+    
+    // Opening with a lower maximum size compacts right away
+    {
+        sfe::ThumbnailCache cache;
+        BOOST_REQUIRE(cache.open(CacheDirectory, maxSize / 2));
+        BOOST_CHECK(readFile(DataFile).size() <= maxSize / 2);
+    }
+    
+    // Thumbnails larger than the maximum size are returned but not stored
+    {
+        sfe::ThumbnailCache cache;
+        sfe::Thumbnails thumbnails;
+        BOOST_REQUIRE(cache.open(CacheDirectory, 1000));
+        BOOST_CHECK(cache.getThumbnails(MediaFile, 1, ThumbnailSize).size() == 1);
+        BOOST_CHECK(! cache.findThumbnails(MediaFile, 1, ThumbnailSize, thumbnails));
+        BOOST_CHECK(readFile(DataFile).size() <= 1000);
+    }
+    
+    removeFiles();
+}
@@ -0,0 +1,94 @@
+
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_MODULE ThumbnailTest
+#include <boost/test/unit_test.hpp>
+#include <sfeMovie/FrameReader.hpp>
+#include <sfeMovie/Movie.hpp>
+#include <cmath>
+#include <cstdlib>
+
+namespace
+{
+    /** Read the native video size and the duration of @a filename
+     */
+    void readVideoProperties(const std::string& filename, sf::Vector2u& size, sf::Time& duration)
+    {
+        sfe::FrameReader reader;
+        sfe::MediaFrame frame;
+        BOOST_REQUIRE(reader.open(filename));
+        BOOST_REQUIRE(reader.readFrame(frame));
+        
+        size = sf::Vector2u(frame.getSize());
+        duration = reader.getDuration();
+    }
+    
+    /** Check that @a thumbnails are ordered, within the media and all of the @a expected size
+     */
+    void checkThumbnails(const sfe::Thumbnails& thumbnails, sf::Vector2u expected, sf::Time duration)
+    {
+        for (std::size_t i = 0; i < thumbnails.size(); i++)
+        {
+            BOOST_CHECK(thumbnails[i].position >= sf::Time::Zero);
+            BOOST_CHECK(thumbnails[i].position < duration);
+            BOOST_CHECK(thumbnails[i].image.getSize() == expected);
+            
+            if (i > 0)
+                BOOST_CHECK(thumbnails[i].position >= thumbnails[i - 1].position);
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(ThumbnailTestCount)
+{
+    sf::Vector2u videoSize;
+    sf::Time duration;
+    readVideoProperties("small_1.ogv", videoSize, duration);
+    
+    // Explicit size
+    sfe::Thumbnails thumbnails = sfe::Movie::extractThumbnails("small_1.ogv", 5, sf::Vector2u(80, 60));
+    BOOST_CHECK(thumbnails.size() == 5);
+    checkThumbnails(thumbnails, sf::Vector2u(80, 60), duration);
+    
+    // Height computed from the width, and the other way around, to preserve the aspect ratio
+    const unsigned int derivedHeight = static_cast<unsigned int>(std::round(64.0 * videoSize.y / videoSize.x));
+    thumbnails = sfe::Movie::extractThumbnails("small_1.ogv", 3, sf::Vector2u(64, 0));
+    BOOST_CHECK(thumbnails.size() == 3);
+    checkThumbnails(thumbnails, sf::Vector2u(64, derivedHeight), duration);
+    
+    const unsigned int derivedWidth = static_cast<unsigned int>(std::round(48.0 * videoSize.x / videoSize.y));
+    thumbnails = sfe::Movie::extractThumbnails("small_1.ogv", 3, sf::Vector2u(0, 48));
+    BOOST_CHECK(thumbnails.size() == 3);
+    checkThumbnails(thumbnails, sf::Vector2u(derivedWidth, 48), duration);
+    
+    // Native size
+    thumbnails = sfe::Movie::extractThumbnails("small_1.ogv", 1, sf::Vector2u(0, 0));
+    BOOST_REQUIRE(thumbnails.size() == 1);
+    checkThumbnails(thumbnails, videoSize, duration);
+    
+    // Nothing to extract
+    BOOST_CHECK(sfe::Movie::extractThumbnails("small_1.ogv", 0, sf::Vector2u(64, 0)).empty());
+    BOOST_CHECK(sfe::Movie::extractThumbnails("small_3.flac", 3, sf::Vector2u(64, 0)).empty());
+    BOOST_CHECK(sfe::Movie::extractThumbnails("non-existing-file.ogv", 3, sf::Vector2u(64, 0)).empty());
+}
+
+BOOST_AUTO_TEST_CASE(ThumbnailTestInterval)
+{
+    sf::Vector2u videoSize;
+    sf::Time duration;
+    readVideoProperties("small_1.ogv", videoSize, duration);
+    
+    // One thumbnail at the beginning of each interval
+    const sf::Time interval = sf::milliseconds(500);
+    const int expectedCount = static_cast<int>(std::ceil(duration / interval));
+    const unsigned int derivedHeight = static_cast<unsigned int>(std::round(64.0 * videoSize.y / videoSize.x));
+    
+    sfe::Thumbnails thumbnails = sfe::Movie::extractThumbnails("small_1.ogv", interval, sf::Vector2u(64, 0));
+    BOOST_CHECK_MESSAGE(std::abs(static_cast<int>(thumbnails.size()) - expectedCount) <= 1,
+                        thumbnails.size() << " thumbnails for a duration of " << duration.asSeconds() << "s");
+    BOOST_REQUIRE(! thumbnails.empty());
+    checkThumbnails(thumbnails, sf::Vector2u(64, derivedHeight), duration);
+    
+    // An interval longer than the media gives the first thumbnail only
+    BOOST_CHECK(sfe::Movie::extractThumbnails("small_1.ogv", duration * 2.f, sf::Vector2u(64, 0)).size() == 1);
+    BOOST_CHECK(sfe::Movie::extractThumbnails("small_1.ogv", sf::Time::Zero, sf::Vector2u(64, 0)).empty());
+}
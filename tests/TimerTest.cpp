@@ -140,3 +140,174 @@ BOOST_AUTO_TEST_CASE(TimerTestPriorities)
     
     timer.play();
 }
+
+namespace
+{
+    class StartRetainer : public sfe::Timer::Observer {
+    public:
+        StartRetainer() :
+        sfe::Timer::Observer(),
+        m_token(0)
+        {
+        }
+        
+        void willPlay(const sfe::Timer& timer)
+        {
+            m_token = const_cast<sfe::Timer&>(timer).retainStart();
+        }
+        
+        uint64_t m_token;
+    };
+    
+    /** Releases its start before willPlay() returns, as an audio thread that is fast enough would
+     */
+    class ImmediateStarter : public sfe::Timer::Observer {
+    public:
+        ImmediateStarter(sf::Time delay) :
+        sfe::Timer::Observer(),
+        m_delay(delay)
+        {
+        }
+        
+        void willPlay(const sfe::Timer& timer)
+        {
+            sfe::Timer& mutableTimer = const_cast<sfe::Timer&>(timer);
+            mutableTimer.releaseStart(mutableTimer.retainStart(), m_delay);
+        }
+        
+        sf::Time m_delay;
+    };
+}
+
+BOOST_AUTO_TEST_CASE(TimerTestRetainedStart)
+{
+    sfe::Timer timer;
+    StartRetainer retainer;
+    
+    timer.addObserver(retainer);
+    timer.play();
+    BOOST_CHECK(timer.getStatus() == sfe::Playing);
+    BOOST_CHECK(timer.isStarting() == true);
+    
+    sf::sleep(sf::milliseconds(100));
+    BOOST_CHECK(timer.getOffset() == sf::Time::Zero);
+    BOOST_CHECK(timer.waitForStart(sf::milliseconds(10)) == false);
+    
+    timer.releaseStart(retainer.m_token);
+    BOOST_CHECK(timer.isStarting() == false);
+    BOOST_CHECK(timer.waitForStart(sf::Time::Zero) == true);
+    
+    sf::sleep(sf::milliseconds(100));
+    BOOST_CHECK(timer.getOffset() != sf::Time::Zero);
+    
+    // Tokens retained before the latest play() are ignored
+    uint64_t oldToken = retainer.m_token;
+    timer.stop();
+    timer.play();
+    timer.releaseStart(oldToken);
+    BOOST_CHECK(timer.isStarting() == true);
+    
+    // Pausing abandons the pending start
+    timer.pause();
+    BOOST_CHECK(timer.isStarting() == false);
+    BOOST_CHECK(timer.waitForStart(sf::Time::Zero) == true);
+}
+
+BOOST_AUTO_TEST_CASE(TimerTestReleasedBeforePlaying)
+{
+    std::shared_ptr<sfe::ManualClock> clock = std::make_shared<sfe::ManualClock>();
+    sfe::Timer timer(clock);
+    ImmediateStarter starter(sf::milliseconds(100));
+    
+    // A release that happens before play() returns is kept, with its delay
+    timer.addObserver(starter);
+    timer.play();
+    BOOST_CHECK(timer.isStarting() == false);
+    
+    clock->advance(sf::milliseconds(150));
+    BOOST_CHECK(timer.getOffset() == sf::milliseconds(50));
+}
+
+BOOST_AUTO_TEST_CASE(TimerTestManualClock)
+{
+    std::shared_ptr<sfe::ManualClock> clock = std::make_shared<sfe::ManualClock>();
+    sfe::Timer timer(clock);
+    
+    timer.play();
+    BOOST_CHECK(timer.getOffset() == sf::Time::Zero);
+    
+    clock->advance(sf::milliseconds(1500));
+    BOOST_CHECK(timer.getOffset() == sf::milliseconds(1500));
+    
+    timer.pause();
+    clock->advance(sf::seconds(10));
+    BOOST_CHECK(timer.getOffset() == sf::milliseconds(1500));
+    
+    timer.play();
+    clock->advance(sf::milliseconds(500));
+    BOOST_CHECK(timer.getOffset() == sf::seconds(2));
+    
+    timer.stop();
+    BOOST_CHECK(timer.getOffset() == sf::Time::Zero);
+}
+
+BOOST_AUTO_TEST_CASE(TimerTestSharedClock)
+{
+    std::shared_ptr<sfe::ManualClock> clock = std::make_shared<sfe::ManualClock>();
+    sfe::Timer first(clock);
+    sfe::Timer second(clock);
+    
+    first.play();
+    clock->advance(sf::seconds(1));
+    
+    // Starting, seeking or stopping a timer doesn't reset the time of the other timers on the same clock
+    second.play();
+    clock->advance(sf::milliseconds(500));
+    BOOST_CHECK(first.getOffset() == sf::milliseconds(1500));
+    BOOST_CHECK(second.getOffset() == sf::milliseconds(500));
+    
+    second.seek(sf::seconds(3));
+    clock->advance(sf::milliseconds(500));
+    BOOST_CHECK(first.getOffset() == sf::seconds(2));
+    BOOST_CHECK(second.getOffset() == sf::milliseconds(3500));
+    
+    second.stop();
+    clock->advance(sf::milliseconds(500));
+    BOOST_CHECK(first.getOffset() == sf::milliseconds(2500));
+    BOOST_CHECK(second.getOffset() == sf::Time::Zero);
+    BOOST_CHECK(clock->getElapsedTime() == sf::milliseconds(2500));
+}
+
+BOOST_AUTO_TEST_CASE(TimerTestWakeUps)
+{
+    std::shared_ptr<sfe::ManualClock> clock = std::make_shared<sfe::ManualClock>();
+    sfe::Timer timer(clock);
+    sf::Time delay;
+    int firstCalls = 0;
+    int secondCalls = 0;
+    
+    timer.scheduleWakeUp(sf::milliseconds(50), [&firstCalls]() { firstCalls++; });
+    sfe::Timer::WakeUpId second = timer.scheduleWakeUp(sf::milliseconds(80), [&secondCalls]() { secondCalls++; });
+    
+    BOOST_CHECK(timer.getTimeUntilNextWakeUp(delay) == true);
+    BOOST_CHECK(delay == sf::milliseconds(50));
+    
+    timer.play();
+    clock->advance(sf::milliseconds(40));
+    timer.processWakeUps();
+    BOOST_CHECK(firstCalls == 0);
+    
+    clock->advance(sf::milliseconds(20));
+    timer.processWakeUps();
+    BOOST_CHECK(firstCalls == 1);
+    BOOST_CHECK(timer.getTimeUntilNextWakeUp(delay) == true);
+    BOOST_CHECK(delay == sf::milliseconds(20));
+    
+    timer.cancelWakeUp(second);
+    BOOST_CHECK(timer.getTimeUntilNextWakeUp(delay) == false);
+    
+    clock->advance(sf::milliseconds(30));
+    timer.processWakeUps();
+    BOOST_CHECK(firstCalls == 1);
+    BOOST_CHECK(secondCalls == 0);
+}
@@ -0,0 +1,131 @@
+
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_MODULE TransportLatencyTest
+#include <boost/test/unit_test.hpp>
+#include "TestHelpers.hpp"
+
+using namespace sfe::test;
+
+namespace
+{
+    DummyDelegate delegate;
+    
+    // The durations are only reported: wall-clock thresholds would fail on loaded machines. The
+    // transitions are checked not to wait for the audio device through the timer state instead
+    template <typename Transition>
+    sf::Time measure(Transition transition)
+    {
+        sf::Clock clock;
+        transition();
+        return clock.getElapsedTime();
+    }
+}
+
+BOOST_AUTO_TEST_CASE(TransportLatencyTest)
+{
+    std::shared_ptr<sfe::Timer> timer = std::make_shared<sfe::Timer>();
+    std::shared_ptr<sfe::Demuxer> demuxer = std::make_shared<sfe::Demuxer>("long_1.wav", timer, delegate);
+    demuxer->selectFirstAudioStream();
+    
+    sf::Time playDuration = measure([&]() { timer->play(); });
+    BOOST_TEST_MESSAGE("play() took " << playDuration.asMicroseconds() << "us");
+    BOOST_CHECK(timer->getStatus() == sfe::Playing);
+    
+    // Time doesn't flow as long as the audio device didn't get its first samples
+    if (timer->isStarting())
+        BOOST_CHECK(timer->getOffset() == sf::Time::Zero);
+    
+    // Completion of the start is signaled when the audio thread gets its first samples
+    sf::Time startDuration = measure([&]() { BOOST_CHECK(timer->waitForStart(sf::seconds(5))); });
+    BOOST_TEST_MESSAGE("audio started " << (playDuration + startDuration).asMicroseconds() << "us after play()");
+    
+    sf::sleep(sf::milliseconds(500));
+    demuxer->update();
+    
+    sf::Time pauseDuration = measure([&]() { timer->pause(); });
+    BOOST_TEST_MESSAGE("pause() took " << pauseDuration.asMicroseconds() << "us");
+    BOOST_CHECK(timer->getStatus() == sfe::Paused);
+    
+    const sf::Time pausedOffset = timer->getOffset();
+    BOOST_CHECK(pausedOffset > sf::Time::Zero);
+    
+    sf::Time resumeDuration = measure([&]() { timer->play(); });
+    BOOST_TEST_MESSAGE("resuming play() took " << resumeDuration.asMicroseconds() << "us");
+    BOOST_CHECK(timer->isStarting() == false);
+    BOOST_CHECK(timer->getOffset() >= pausedOffset);
+    
+    sf::sleep(sf::milliseconds(500));
+    demuxer->update();
+    
+    sf::Time stopDuration = measure([&]() { timer->stop(); });
+    BOOST_TEST_MESSAGE("stop() took " << stopDuration.asMicroseconds() << "us");
+    BOOST_CHECK(timer->getOffset() == sf::Time::Zero);
+    
+    // Stopping abandons the start of a play() whose audio didn't start yet
+    timer->play();
+    timer->stop();
+    BOOST_CHECK(timer->isStarting() == false);
+    BOOST_CHECK(timer->waitForStart(sf::Time::Zero));
+}
+
+BOOST_AUTO_TEST_CASE(TransportLatencyTestPrepared)
+{
+    // Once prepared, play() doesn't wait for any decoding: the first image is the current one and the audio
+    // device gets its first samples as soon as it asks for them
+    CountingDelegate countingDelegate;
+    std::shared_ptr<sfe::Timer> timer = std::make_shared<sfe::Timer>();
+    std::shared_ptr<sfe::Demuxer> demuxer = std::make_shared<sfe::Demuxer>("small_1.ogv", timer, countingDelegate);
+    demuxer->selectFirstAudioStream();
+    demuxer->selectFirstVideoStream();
+    
+    std::shared_ptr<sfe::AudioStream> audioStream = demuxer->getSelectedAudioStream();
+    std::shared_ptr<sfe::VideoStream> videoStream = demuxer->getSelectedVideoStream();
+    BOOST_REQUIRE(audioStream && videoStream);
+    
+    sf::Time prepareDuration = measure([&]()
+    {
+        for (std::shared_ptr<sfe::Stream> stream : demuxer->getSelectedStreams())
+            stream->prepare();
+    });
+    BOOST_TEST_MESSAGE("prepare() took " << prepareDuration.asMicroseconds() << "us");
+    
+    for (sf::Clock clock; ! audioStream->isPrepared() && clock.getElapsedTime() < sf::seconds(5);)
+    {
+        sf::sleep(sf::milliseconds(1));
+        demuxer->update();
+    }
+    
+    BOOST_REQUIRE(audioStream->isPrepared());
+    
+    const sf::Time framePeriod = sf::seconds(1.f / videoStream->getFrameRate());
+    sf::Time audioPosition;
+    sf::Clock clock;
+    timer->play();
+    
+    while ((! audioStream->getPlaybackPosition(audioPosition) || videoStream->getStatus() != sfe::Playing)
+           && clock.getElapsedTime() < sf::seconds(1))
+    {
+        sf::sleep(sf::milliseconds(1));
+        demuxer->update();
+    }
+    
+    const sf::Time startDuration = clock.getElapsedTime();
+    BOOST_TEST_MESSAGE("audio and video started " << startDuration.asMicroseconds() << "us after play()");
+    
+    BOOST_CHECK(! timer->isStarting());
+    BOOST_CHECK(videoStream->getStatus() == sfe::Playing);
+    BOOST_CHECK(audioStream->getPlaybackPosition(audioPosition));
+    BOOST_CHECK(startDuration <= framePeriod);
+    
+    // The image after the prepared one is due one frame period after the start
+    while (countingDelegate.m_frameCount == 0 && clock.getElapsedTime() < sf::seconds(1))
+    {
+        sf::sleep(sf::milliseconds(1));
+        demuxer->update();
+    }
+    
+    BOOST_CHECK(countingDelegate.m_frameCount > 0);
+    BOOST_CHECK(clock.getElapsedTime() <= startDuration + framePeriod * 2.f);
+    
+    timer->stop();
+}